@@ -0,0 +1,236 @@
+// StatementRegistry 热点语句的延迟基准，每条语句以三种方式执行并输出 p50 / p99：
+// - legacy：引入登记处之前的路径，每个请求重新拼接 SQL 文本，再按文本查找（首次遇到时 PREPARE）后执行，
+//   与 drogon 按文本缓存预编译语句的做法相同；原本就是固定文本的语句没有这一列；
+// - plain：每次解析规划（PQexecParams），相当于每个请求拼接出不同文本；
+// - prepared：登记处的固定文本预编译后复用（PQprepare + PQexecPrepared）。
+// 用法：statement_registry_bench "<libpq 连接串>" <doc_id> <user_id> [iterations]
+// 只执行只读语句，可以指向任意已初始化的库；结果与数据量、缓存状态有关，比较同一次运行内的两列即可。
+#include <libpq-fe.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "repositories/StatementRegistry.h"
+
+namespace {
+
+enum class Mode { Legacy, Plain, Prepared };
+
+struct Case {
+    std::string name;
+    std::string sql;
+    std::vector<std::string> params;
+    std::function<std::string()> legacy;  // 旧路径的按请求拼接；为空表示原本就是固定文本
+};
+
+// ---- 引入登记处之前 DocumentController::list 与 NotificationController 中按请求拼接 SQL 的代码 ----
+
+std::string legacyDocumentList(bool hasStatusFilter, bool useCursor) {
+    std::string statusWhere = hasStatusFilter ? " AND d.status = $2::text" : "";
+    int nextParam = hasStatusFilter ? 3 : 2;
+    std::string keysetWhere;
+    if (useCursor) {
+        keysetWhere = " AND (u.updated_at, u.doc_id) < (TIMESTAMPTZ 'epoch' + $" + std::to_string(nextParam) +
+                      "::bigint * INTERVAL '1 microsecond', $" + std::to_string(nextParam + 1) + "::bigint)";
+        nextParam += 2;
+    }
+    std::string limitParam = "$" + std::to_string(nextParam) + "::integer";
+    std::string offsetParam = "$" + std::to_string(nextParam + 1) + "::integer";
+    return "SELECT d.id, d.title, d.owner_id, d.is_locked, d.status, d.created_at, d.updated_at, "
+           "       (EXTRACT(EPOCH FROM u.updated_at) * 1000000)::bigint AS updated_us "
+           "FROM user_doc_access u "
+           "JOIN document d ON d.id = u.doc_id "
+           "WHERE u.user_id = $1::bigint" +
+           statusWhere + keysetWhere +
+           " ORDER BY u.updated_at DESC, u.doc_id DESC "
+           "LIMIT " +
+           limitParam + " OFFSET " + offsetParam;
+}
+
+std::string legacyDocumentCount(bool hasStatusFilter, bool estimate) {
+    constexpr int kEstimateCap = 10000;
+    std::string statusWhere = hasStatusFilter ? " AND d.status = $2::text" : "";
+    std::string visibleIds = hasStatusFilter ? "SELECT 1 FROM user_doc_access u JOIN document d ON d.id = u.doc_id "
+                                               "WHERE u.user_id = $1::bigint" +
+                                                       statusWhere
+                                             : "SELECT 1 FROM user_doc_access u WHERE u.user_id = $1::bigint";
+    return estimate ? "SELECT COUNT(*) AS total FROM (" + visibleIds + " LIMIT " + std::to_string(kEstimateCap + 1) +
+                              ") v"
+                    : "SELECT COUNT(*) AS total FROM (" + visibleIds + ") v";
+}
+
+std::string legacyNotificationBase() {
+    return "FROM notification n "
+           "WHERE n.user_id = $1::bigint "
+           "  AND ($2::boolean = FALSE OR n.is_read = FALSE) "
+           "  AND ($3 = '' OR n.type = $3) "
+           "  AND ($4 = '' OR (n.payload->>'doc_id') = $4) "
+           "  AND ($5 = '' OR n.created_at >= $5::timestamptz) "
+           "  AND ($6 = '' OR n.created_at <= $6::timestamptz) ";
+}
+
+std::string legacyNotificationList() {
+    std::string baseQuery = legacyNotificationBase();
+    return "SELECT n.id, n.type, n.payload::text AS payload_text, n.is_read, n.created_at " + baseQuery +
+           "ORDER BY n.created_at DESC "
+           "LIMIT $7::integer OFFSET $8::integer";
+}
+
+std::string legacyNotificationCount() {
+    return "SELECT COUNT(*) AS total " + legacyNotificationBase();
+}
+
+struct Summary {
+    double p50{0};
+    double p99{0};
+    double mean{0};
+    bool ok{true};
+};
+
+// 每次迭代的耗时（微秒），返回 p50 / p99 / 平均值
+Summary summarize(std::vector<double> samples) {
+    Summary summary;
+    if (samples.empty()) return summary;
+    std::sort(samples.begin(), samples.end());
+    auto at = [&](double q) { return samples[std::min(samples.size() - 1, static_cast<size_t>(q * samples.size()))]; };
+    summary.p50 = at(0.50);
+    summary.p99 = at(0.99);
+    double total = 0;
+    for (double sample : samples) total += sample;
+    summary.mean = total / samples.size();
+    return summary;
+}
+
+bool succeeded(PGresult* result, const std::string& name) {
+    ExecStatusType status = PQresultStatus(result);
+    if (status == PGRES_TUPLES_OK || status == PGRES_COMMAND_OK) return true;
+    std::fprintf(stderr, "%s: %s", name.c_str(), PQresultErrorMessage(result));
+    return false;
+}
+
+// 旧路径：按拼接出的文本查找已准备的语句，首次遇到时 PREPARE（与 drogon 每条连接的语句缓存一致）
+PGresult* execLegacy(PGconn* conn, const std::string& sql, int count, const char* const* values,
+                     std::unordered_map<std::string, std::string>& statements) {
+    auto it = statements.find(sql);
+    if (it == statements.end()) {
+        std::string name = "bench_legacy_" + std::to_string(statements.size());
+        PGresult* result = PQprepare(conn, name.c_str(), sql.c_str(), count, nullptr);
+        if (PQresultStatus(result) != PGRES_COMMAND_OK) return result;
+        PQclear(result);
+        it = statements.emplace(sql, name).first;
+    }
+    return PQexecPrepared(conn, it->second.c_str(), count, values, nullptr, nullptr, 0);
+}
+
+Summary run(PGconn* conn, const Case& c, int iterations, Mode mode) {
+    std::vector<const char*> values;
+    for (const auto& param : c.params) values.push_back(param.c_str());
+    const int count = static_cast<int>(values.size());
+    const std::string statement = "bench_" + c.name;
+    const bool prepared = mode == Mode::Prepared;
+    std::unordered_map<std::string, std::string> legacyStatements;
+    if (prepared) {
+        PGresult* result = PQprepare(conn, statement.c_str(), c.sql.c_str(), count, nullptr);
+        bool ok = succeeded(result, c.name);
+        PQclear(result);
+        if (!ok) return Summary{0, 0, 0, false};
+    }
+
+    std::vector<double> samples;
+    samples.reserve(iterations);
+    // 先执行几次预热（建立连接缓存、填充共享缓冲区），不计入结果
+    const int warmup = std::min(iterations, 20);
+    for (int i = -warmup; i < iterations; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        PGresult* result = nullptr;
+        if (mode == Mode::Legacy) {
+            // 拼接文本的开销计入耗时
+            result = execLegacy(conn, c.legacy(), count, values.data(), legacyStatements);
+        } else if (prepared) {
+            result = PQexecPrepared(conn, statement.c_str(), count, values.data(), nullptr, nullptr, 0);
+        } else {
+            result = PQexecParams(conn, c.sql.c_str(), count, nullptr, values.data(), nullptr, nullptr, 0);
+        }
+        auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        bool ok = succeeded(result, c.name);
+        PQclear(result);
+        if (!ok) return Summary{0, 0, 0, false};
+        if (i >= 0) samples.push_back(elapsed);
+    }
+
+    if (prepared) {
+        PGresult* result = PQexec(conn, ("DEALLOCATE " + statement).c_str());
+        PQclear(result);
+    }
+    for (const auto& item : legacyStatements) {
+        PGresult* result = PQexec(conn, ("DEALLOCATE " + item.second).c_str());
+        PQclear(result);
+    }
+    return summarize(std::move(samples));
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 4) {
+        std::fprintf(stderr, "usage: %s \"<conninfo>\" <doc_id> <user_id> [iterations]\n", argv[0]);
+        return 2;
+    }
+    const std::string docId = argv[2];
+    const std::string userId = argv[3];
+    const int iterations = argc > 4 ? std::max(1, std::atoi(argv[4])) : 2000;
+
+    PGconn* conn = PQconnectdb(argv[1]);
+    if (PQstatus(conn) != CONNECTION_OK) {
+        std::fprintf(stderr, "connection failed: %s", PQerrorMessage(conn));
+        PQfinish(conn);
+        return 1;
+    }
+
+    const std::vector<Case> cases = {
+            {"doc_permission", StatementRegistry::docPermission(), {docId, userId}},
+            {"doc_access_exists", StatementRegistry::docAccessExists(), {docId, userId}},
+            {"user_role", StatementRegistry::userRole(), {userId}},
+            {"document_with_tags", StatementRegistry::documentWithTags(), {docId}},
+            {"published_version", StatementRegistry::publishedVersion(), {docId}},
+            {"document_list", StatementRegistry::documentList(false, false), {userId, "20", "0"},
+             [] { return legacyDocumentList(false, false); }},
+            {"document_count", StatementRegistry::documentCount(false, true), {userId},
+             [] { return legacyDocumentCount(false, true); }},
+            {"notification_list", StatementRegistry::notificationList(), {userId, "false", "", "", "", "", "20", "0"},
+             legacyNotificationList},
+            {"notification_count", StatementRegistry::notificationCount(), {userId, "false", "", "", "", ""},
+             legacyNotificationCount},
+    };
+
+    std::printf("%d iterations per mode, latency in microseconds\n", iterations);
+    std::printf("%-20s %10s %10s %10s %10s %10s %10s %10s %10s %10s\n", "statement", "legacy p50", "legacy p99",
+                "legacy avg", "plain p50", "plain p99", "plain avg", "prep p50", "prep p99", "prep avg");
+    int failures = 0;
+    for (const auto& c : cases) {
+        Summary legacy;
+        if (c.legacy) legacy = run(conn, c, iterations, Mode::Legacy);
+        Summary plain = run(conn, c, iterations, Mode::Plain);
+        Summary prepared = run(conn, c, iterations, Mode::Prepared);
+        if (!legacy.ok || !plain.ok || !prepared.ok) {
+            ++failures;
+            continue;
+        }
+        std::string legacyColumns = "         -          -          -";
+        if (c.legacy) {
+            char buffer[64];
+            std::snprintf(buffer, sizeof(buffer), "%10.1f %10.1f %10.1f", legacy.p50, legacy.p99, legacy.mean);
+            legacyColumns = buffer;
+        }
+        std::printf("%-20s %s %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n", c.name.c_str(), legacyColumns.c_str(),
+                    plain.p50, plain.p99, plain.mean, prepared.p50, prepared.p99, prepared.mean);
+    }
+    PQfinish(conn);
+    return failures > 0 ? 1 : 0;
+}
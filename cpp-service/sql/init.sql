@@ -101,7 +101,8 @@ CREATE TABLE task (
   due_at TIMESTAMPTZ,
   created_by BIGINT NOT NULL REFERENCES "user"(id),
   created_at TIMESTAMPTZ NOT NULL DEFAULT NOW(),
-  updated_at TIMESTAMPTZ NOT NULL DEFAULT NOW()
+  updated_at TIMESTAMPTZ NOT NULL DEFAULT NOW(),
+  completed_at TIMESTAMPTZ -- 最近一次变为 done 的时间，由触发器维护
 );
 
 -- 通知
@@ -114,12 +115,260 @@ CREATE TABLE notification (
   created_at TIMESTAMPTZ NOT NULL DEFAULT NOW()
 );
 
+-- 未读通知计数（与 notification 同一语句内维护）
+CREATE TABLE notification_counter (
+  user_id BIGINT PRIMARY KEY REFERENCES "user"(id) ON DELETE CASCADE,
+  unread INTEGER NOT NULL DEFAULT 0,
+  updated_at TIMESTAMPTZ NOT NULL DEFAULT NOW()
+);
+
 -- 索引
 CREATE INDEX idx_document_owner_updated ON document(owner_id, updated_at DESC);
 CREATE INDEX idx_doc_tag_tag ON doc_tag(tag_id);
+CREATE INDEX idx_doc_acl_user ON doc_acl(user_id);
 CREATE INDEX idx_comment_doc_created ON comment(doc_id, created_at DESC);
 CREATE INDEX idx_task_doc_status ON task(doc_id, status);
 
+-- 用户可访问文档索引：owner 与 doc_acl 合并后的有效权限，由触发器维护，
+-- 列表与权限检查只需按 (user_id, ...) 做一次索引范围扫描
+CREATE TABLE user_doc_access (
+  user_id BIGINT NOT NULL REFERENCES "user"(id) ON DELETE CASCADE,
+  doc_id BIGINT NOT NULL REFERENCES document(id) ON DELETE CASCADE,
+  permission VARCHAR(16) NOT NULL, -- owner/editor/viewer
+  updated_at TIMESTAMPTZ NOT NULL,
+  PRIMARY KEY (user_id, doc_id)
+);
+
+CREATE INDEX idx_user_doc_access_user_updated
+  ON user_doc_access(user_id, updated_at DESC, doc_id DESC) INCLUDE (permission);
+CREATE INDEX idx_user_doc_access_doc ON user_doc_access(doc_id);
+
+-- 重新计算单个 (doc_id, user_id) 的有效权限：owner 优先，其次 doc_acl
+CREATE OR REPLACE FUNCTION refresh_user_doc_access(p_doc_id BIGINT, p_user_id BIGINT) RETURNS VOID AS $$
+DECLARE
+  v_permission VARCHAR(16);
+  v_updated_at TIMESTAMPTZ;
+BEGIN
+  SELECT CASE WHEN d.owner_id = p_user_id THEN 'owner' ELSE a.permission END, d.updated_at
+  INTO v_permission, v_updated_at
+  FROM document d
+  LEFT JOIN doc_acl a ON a.doc_id = d.id AND a.user_id = p_user_id
+  WHERE d.id = p_doc_id;
+
+  IF v_permission IS NULL THEN
+    DELETE FROM user_doc_access WHERE doc_id = p_doc_id AND user_id = p_user_id;
+  ELSE
+    INSERT INTO user_doc_access (user_id, doc_id, permission, updated_at)
+    VALUES (p_user_id, p_doc_id, v_permission, v_updated_at)
+    ON CONFLICT (user_id, doc_id) DO UPDATE
+    SET permission = EXCLUDED.permission, updated_at = EXCLUDED.updated_at;
+  END IF;
+END;
+$$ LANGUAGE plpgsql;
+
+-- document：新建写入 owner，转移所有权时重算新旧 owner，updated_at 变化时同步排序键
+CREATE OR REPLACE FUNCTION trg_document_user_doc_access() RETURNS TRIGGER AS $$
+BEGIN
+  IF TG_OP = 'INSERT' THEN
+    PERFORM refresh_user_doc_access(NEW.id, NEW.owner_id);
+  ELSE
+    IF NEW.updated_at IS DISTINCT FROM OLD.updated_at THEN
+      UPDATE user_doc_access SET updated_at = NEW.updated_at WHERE doc_id = NEW.id;
+    END IF;
+    IF NEW.owner_id IS DISTINCT FROM OLD.owner_id THEN
+      PERFORM refresh_user_doc_access(NEW.id, OLD.owner_id);
+      PERFORM refresh_user_doc_access(NEW.id, NEW.owner_id);
+    END IF;
+  END IF;
+  RETURN NULL;
+END;
+$$ LANGUAGE plpgsql;
+
+-- doc_acl：任意增删改都重算受影响的 (doc_id, user_id)
+CREATE OR REPLACE FUNCTION trg_doc_acl_user_doc_access() RETURNS TRIGGER AS $$
+BEGIN
+  IF TG_OP IN ('UPDATE', 'DELETE') THEN
+    PERFORM refresh_user_doc_access(OLD.doc_id, OLD.user_id);
+  END IF;
+  IF TG_OP IN ('INSERT', 'UPDATE') THEN
+    PERFORM refresh_user_doc_access(NEW.doc_id, NEW.user_id);
+  END IF;
+  RETURN NULL;
+END;
+$$ LANGUAGE plpgsql;
+
+CREATE TRIGGER document_user_doc_access
+  AFTER INSERT OR UPDATE OF owner_id, updated_at ON document
+  FOR EACH ROW EXECUTE FUNCTION trg_document_user_doc_access();
+
+CREATE TRIGGER doc_acl_user_doc_access
+  AFTER INSERT OR UPDATE OR DELETE ON doc_acl
+  FOR EACH ROW EXECUTE FUNCTION trg_doc_acl_user_doc_access();
+
+-- 用户活跃度计数：文档数、评论数、已完成任务数由触发器增量维护，
+-- 管理员用户列表按主键直接读取，避免每次请求对全表做 GROUP BY
+CREATE TABLE user_activity_stats (
+  user_id BIGINT PRIMARY KEY REFERENCES "user"(id) ON DELETE CASCADE,
+  document_count INTEGER NOT NULL DEFAULT 0,
+  comment_count INTEGER NOT NULL DEFAULT 0,
+  completed_task_count INTEGER NOT NULL DEFAULT 0,
+  updated_at TIMESTAMPTZ NOT NULL DEFAULT NOW()
+);
+
+-- 对单个用户的计数做增量调整
+CREATE OR REPLACE FUNCTION bump_user_activity(p_user_id BIGINT, p_documents INTEGER, p_comments INTEGER,
+                                              p_completed_tasks INTEGER) RETURNS VOID AS $$
+BEGIN
+  INSERT INTO user_activity_stats (user_id, document_count, comment_count, completed_task_count, updated_at)
+  VALUES (p_user_id, p_documents, p_comments, p_completed_tasks, NOW())
+  ON CONFLICT (user_id) DO UPDATE
+  SET document_count = user_activity_stats.document_count + EXCLUDED.document_count,
+      comment_count = user_activity_stats.comment_count + EXCLUDED.comment_count,
+      completed_task_count = user_activity_stats.completed_task_count + EXCLUDED.completed_task_count,
+      updated_at = NOW();
+END;
+$$ LANGUAGE plpgsql;
+
+-- document：按 owner 计数，转移所有权时从旧 owner 移到新 owner
+CREATE OR REPLACE FUNCTION trg_document_user_activity() RETURNS TRIGGER AS $$
+BEGIN
+  IF TG_OP = 'UPDATE' AND NEW.owner_id = OLD.owner_id THEN
+    RETURN NULL;
+  END IF;
+  IF TG_OP IN ('UPDATE', 'DELETE') THEN
+    PERFORM bump_user_activity(OLD.owner_id, -1, 0, 0);
+  END IF;
+  IF TG_OP IN ('INSERT', 'UPDATE') THEN
+    PERFORM bump_user_activity(NEW.owner_id, 1, 0, 0);
+  END IF;
+  RETURN NULL;
+END;
+$$ LANGUAGE plpgsql;
+
+-- comment：按 author 计数
+CREATE OR REPLACE FUNCTION trg_comment_user_activity() RETURNS TRIGGER AS $$
+BEGIN
+  IF TG_OP = 'UPDATE' AND NEW.author_id = OLD.author_id THEN
+    RETURN NULL;
+  END IF;
+  IF TG_OP IN ('UPDATE', 'DELETE') THEN
+    PERFORM bump_user_activity(OLD.author_id, 0, -1, 0);
+  END IF;
+  IF TG_OP IN ('INSERT', 'UPDATE') THEN
+    PERFORM bump_user_activity(NEW.author_id, 0, 1, 0);
+  END IF;
+  RETURN NULL;
+END;
+$$ LANGUAGE plpgsql;
+
+-- task：只统计 status = 'done' 的任务，按 created_by 计数
+CREATE OR REPLACE FUNCTION trg_task_user_activity() RETURNS TRIGGER AS $$
+BEGIN
+  IF TG_OP = 'UPDATE' AND NEW.created_by = OLD.created_by AND (NEW.status = 'done') = (OLD.status = 'done') THEN
+    RETURN NULL;
+  END IF;
+  IF TG_OP IN ('UPDATE', 'DELETE') AND OLD.status = 'done' THEN
+    PERFORM bump_user_activity(OLD.created_by, 0, 0, -1);
+  END IF;
+  IF TG_OP IN ('INSERT', 'UPDATE') AND NEW.status = 'done' THEN
+    PERFORM bump_user_activity(NEW.created_by, 0, 0, 1);
+  END IF;
+  RETURN NULL;
+END;
+$$ LANGUAGE plpgsql;
+
+CREATE TRIGGER document_user_activity
+  AFTER INSERT OR DELETE OR UPDATE OF owner_id ON document
+  FOR EACH ROW EXECUTE FUNCTION trg_document_user_activity();
+
+CREATE TRIGGER comment_user_activity
+  AFTER INSERT OR DELETE OR UPDATE OF author_id ON comment
+  FOR EACH ROW EXECUTE FUNCTION trg_comment_user_activity();
+
+CREATE TRIGGER task_user_activity
+  AFTER INSERT OR DELETE OR UPDATE OF status, created_by ON task
+  FOR EACH ROW EXECUTE FUNCTION trg_task_user_activity();
+
+-- 新用户注册时写入计数行，保证每个用户都有一行（用户导出按计数排序时由该表驱动）
+CREATE OR REPLACE FUNCTION trg_user_activity_stats_init() RETURNS TRIGGER AS $$
+BEGIN
+  INSERT INTO user_activity_stats (user_id) VALUES (NEW.id) ON CONFLICT (user_id) DO NOTHING;
+  RETURN NULL;
+END;
+$$ LANGUAGE plpgsql;
+
+CREATE TRIGGER user_activity_stats_init
+  AFTER INSERT ON "user"
+  FOR EACH ROW EXECUTE FUNCTION trg_user_activity_stats_init();
+
+-- 用户导出的键集翻页：(排序键, id)
+CREATE INDEX idx_user_created_id ON "user"(created_at, id);
+CREATE INDEX idx_user_activity_stats_documents ON user_activity_stats(document_count, user_id);
+CREATE INDEX idx_user_activity_stats_comments ON user_activity_stats(comment_count, user_id);
+CREATE INDEX idx_user_activity_stats_tasks ON user_activity_stats(completed_task_count, user_id);
+-- 分批校正按用户统计源表（document 的 owner_id 已由 idx_document_owner_updated 覆盖）
+CREATE INDEX idx_comment_author ON comment(author_id);
+CREATE INDEX idx_task_done_created_by ON task(created_by) WHERE status = 'done';
+
+-- 用户活跃度分时汇总：后台聚合器（AnalyticsRollup）按 UTC 小时 / 天汇总每个用户的活动，
+-- 管理员统计接口按桶读取，查询开销只与时间范围内的桶数有关
+CREATE TABLE user_activity_hourly (
+  bucket_start TIMESTAMPTZ NOT NULL,
+  user_id BIGINT NOT NULL REFERENCES "user"(id) ON DELETE CASCADE,
+  documents_created INTEGER NOT NULL DEFAULT 0,
+  comments_created INTEGER NOT NULL DEFAULT 0,
+  tasks_completed INTEGER NOT NULL DEFAULT 0, -- 该小时内变为 done 的任务（按 completed_at、created_by）
+  tasks_updated INTEGER NOT NULL DEFAULT 0,   -- 该小时内更新过的任务（计入活跃用户）
+  PRIMARY KEY (bucket_start, user_id)
+);
+
+CREATE TABLE user_activity_daily (
+  bucket_start TIMESTAMPTZ NOT NULL,
+  user_id BIGINT NOT NULL REFERENCES "user"(id) ON DELETE CASCADE,
+  documents_created INTEGER NOT NULL DEFAULT 0,
+  comments_created INTEGER NOT NULL DEFAULT 0,
+  tasks_completed INTEGER NOT NULL DEFAULT 0,
+  tasks_updated INTEGER NOT NULL DEFAULT 0,
+  PRIMARY KEY (bucket_start, user_id)
+);
+
+-- 聚合器按时间范围读取源表
+CREATE INDEX idx_document_created ON document(created_at);
+CREATE INDEX idx_comment_created ON comment(created_at);
+CREATE INDEX idx_task_updated ON task(updated_at);
+CREATE INDEX idx_task_completed ON task(completed_at) WHERE completed_at IS NOT NULL;
+
+-- 任务变为 done 时记录完成时间，离开 done 时清空；之后的编辑不改变完成时间，聚合器不会重复计数
+CREATE OR REPLACE FUNCTION trg_task_completed_at() RETURNS TRIGGER AS $$
+BEGIN
+  IF NEW.status <> 'done' THEN
+    NEW.completed_at := NULL;
+  ELSIF TG_OP = 'INSERT' OR OLD.status <> 'done' THEN
+    NEW.completed_at := NOW();
+  END IF;
+  RETURN NEW;
+END;
+$$ LANGUAGE plpgsql;
+
+CREATE TRIGGER task_completed_at
+  BEFORE INSERT OR UPDATE OF status ON task
+  FOR EACH ROW EXECUTE FUNCTION trg_task_completed_at();
+
+-- 聚合进度：rolled_until 之前的小时桶已汇总完毕
+CREATE TABLE analytics_rollup_state (
+  name VARCHAR(64) PRIMARY KEY,
+  rolled_until TIMESTAMPTZ NOT NULL,
+  updated_at TIMESTAMPTZ NOT NULL DEFAULT NOW()
+);
+
+-- 用户搜索按子串匹配邮箱 / 昵称（ILIKE '%关键词%'），需要 pg_trgm 的 GIN 索引
+CREATE EXTENSION IF NOT EXISTS pg_trgm;
+CREATE INDEX idx_user_email_trgm ON "user" USING gin (email gin_trgm_ops);
+CREATE INDEX idx_user_profile_nickname_trgm ON user_profile USING gin (nickname gin_trgm_ops);
+-- 单个字符的关键词提取不出三元组，按前缀匹配（lower(...) LIKE '关键词%'）
+CREATE INDEX idx_user_email_prefix ON "user" (lower(email) text_pattern_ops);
+CREATE INDEX idx_user_profile_nickname_prefix ON user_profile (lower(nickname) text_pattern_ops);
+
 -- 权限授予，确保应用账号可访问
 DO
 $$
@@ -141,3 +390,24 @@ BEGIN
 END;
 $$ LANGUAGE plpgsql;
 
+-- 异步导出任务：由提交的实例执行，状态与产物位置在此共享给所有实例
+CREATE TABLE export_job (
+  id VARCHAR(32) PRIMARY KEY,
+  user_id BIGINT NOT NULL REFERENCES "user"(id) ON DELETE CASCADE,
+  doc_id BIGINT NOT NULL REFERENCES document(id) ON DELETE CASCADE,
+  format VARCHAR(16) NOT NULL,
+  status VARCHAR(16) NOT NULL DEFAULT 'queued', -- queued/running/succeeded/failed
+  progress INTEGER NOT NULL DEFAULT 0,
+  error TEXT,
+  instance_id VARCHAR(64) NOT NULL, -- 执行任务的实例，定期续期 updated_at
+  cache_key VARCHAR(64), -- 产物在实例本地导出缓存中的键
+  artifact_object TEXT, -- 产物在 MinIO 中的对象名
+  filename TEXT,
+  content_type TEXT,
+  created_at TIMESTAMPTZ NOT NULL DEFAULT NOW(),
+  updated_at TIMESTAMPTZ NOT NULL DEFAULT NOW(),
+  finished_at TIMESTAMPTZ
+);
+CREATE INDEX idx_export_job_user_active ON export_job(user_id) WHERE status IN ('queued', 'running');
+CREATE INDEX idx_export_job_instance_queued ON export_job(instance_id, created_at) WHERE status = 'queued';
+CREATE INDEX idx_export_job_finished ON export_job(finished_at) WHERE finished_at IS NOT NULL;
@@ -0,0 +1,57 @@
+#include "AdminSystemController.h"
+
+#include <json/json.h>
+
+#include <memory>
+
+#include "../services/ExportCache.h"
+#include "../services/ExportJobQueue.h"
+#include "../services/NotificationHub.h"
+#include "../services/NotificationWriter.h"
+#include "../services/SearchService.h"
+#include "../services/UserSearchCache.h"
+#include "../utils/PermissionUtils.h"
+#include "../utils/ResponseUtils.h"
+
+void AdminSystemController::getNotificationQueues(const HttpRequestPtr& req,
+                                                  std::function<void(const HttpResponsePtr&)>&& callback) {
+    auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr&)>>(std::move(callback));
+    PermissionUtils::ensureAdmin(req, callbackPtr, [callbackPtr]() {
+        Json::Value data = NotificationHub::getQueueMetrics();
+        data["writer"] = NotificationWriter::getMetrics();
+        ResponseUtils::sendSuccess(*callbackPtr, data, k200OK);
+    });
+}
+
+void AdminSystemController::getSearchIndexStatus(const HttpRequestPtr& req,
+                                                 std::function<void(const HttpResponsePtr&)>&& callback) {
+    auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr&)>>(std::move(callback));
+    PermissionUtils::ensureAdmin(req, callbackPtr, [callbackPtr]() {
+        SearchService::getIndexStatus(
+                [callbackPtr](const Json::Value& status) { ResponseUtils::sendSuccess(*callbackPtr, status, k200OK); });
+    });
+}
+
+void AdminSystemController::getExportCacheStats(const HttpRequestPtr& req,
+                                                std::function<void(const HttpResponsePtr&)>&& callback) {
+    auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr&)>>(std::move(callback));
+    PermissionUtils::ensureAdmin(req, callbackPtr, [callbackPtr]() {
+        ResponseUtils::sendSuccess(*callbackPtr, ExportCache::getStats(), k200OK);
+    });
+}
+
+void AdminSystemController::getExportJobStats(const HttpRequestPtr& req,
+                                              std::function<void(const HttpResponsePtr&)>&& callback) {
+    auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr&)>>(std::move(callback));
+    PermissionUtils::ensureAdmin(req, callbackPtr, [callbackPtr]() {
+        ResponseUtils::sendSuccess(*callbackPtr, ExportJobQueue::getStats(), k200OK);
+    });
+}
+
+void AdminSystemController::getUserSearchCacheStats(const HttpRequestPtr& req,
+                                                    std::function<void(const HttpResponsePtr&)>&& callback) {
+    auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr&)>>(std::move(callback));
+    PermissionUtils::ensureAdmin(req, callbackPtr, [callbackPtr]() {
+        ResponseUtils::sendSuccess(*callbackPtr, UserSearchCache::getStats(), k200OK);
+    });
+}
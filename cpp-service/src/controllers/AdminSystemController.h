@@ -0,0 +1,40 @@
+#pragma once
+#include <drogon/HttpController.h>
+#include <drogon/drogon.h>
+
+#include <functional>
+
+using namespace drogon;
+
+/**
+ * 运维类管理接口（仅 admin 可访问），用于查看服务内部队列等运行指标。
+ */
+class AdminSystemController : public drogon::HttpController<AdminSystemController> {
+public:
+    METHOD_LIST_BEGIN
+    ADD_METHOD_TO(AdminSystemController::getNotificationQueues, "/api/admin/system/notification-queues", Get,
+                  "JwtAuthFilter");
+    ADD_METHOD_TO(AdminSystemController::getSearchIndexStatus, "/api/admin/system/search-index", Get,
+                  "JwtAuthFilter");
+    ADD_METHOD_TO(AdminSystemController::getExportCacheStats, "/api/admin/system/export-cache", Get,
+                  "JwtAuthFilter");
+    ADD_METHOD_TO(AdminSystemController::getExportJobStats, "/api/admin/system/export-jobs", Get, "JwtAuthFilter");
+    ADD_METHOD_TO(AdminSystemController::getUserSearchCacheStats, "/api/admin/system/user-search-cache", Get,
+                  "JwtAuthFilter");
+    METHOD_LIST_END
+
+    // 通知 WebSocket 出站队列深度
+    void getNotificationQueues(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback);
+
+    // 搜索索引队列状态与最近的 Meilisearch 任务
+    void getSearchIndexStatus(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback);
+
+    // 导出产物缓存的占用与命中情况
+    void getExportCacheStats(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback);
+
+    // 异步导出任务队列的排队 / 运行情况
+    void getExportJobStats(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback);
+
+    // 用户搜索缓存的条目数与命中情况
+    void getUserSearchCacheStats(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback);
+};
@@ -11,11 +11,79 @@
 #include <unordered_set>
 #include <utility>
 
+#include "../utils/PermissionUtils.h"
 #include "../utils/ResponseUtils.h"
 
 using drogon::orm::Result;
 
 namespace {
+// 桶边界按 UTC 计算
+#define UTC_TRUNC(unit, expr) "date_trunc('" unit "', (" expr ") AT TIME ZONE 'UTC') AT TIME ZONE 'UTC'"
+
+// 管理员统计，时间范围对齐到整点（from 所在小时到 to 所在小时结束），整天部分读日桶，首尾读小时桶。参数：
+//   $1 from, $2 to[, $3 limit]
+// 三条统计共用：按 [$1, $2] 选出日桶与小时桶，汇总为每个用户一行（per_user）
+const char* const kActivityPerUser =
+        "WITH hours AS ("
+        "   SELECT " UTC_TRUNC("hour", "$1::timestamptz") " AS from_hour, "
+        "          " UTC_TRUNC("hour", "$2::timestamptz") " + INTERVAL '1 hour' AS to_hour"
+        "), bounds AS ("
+        "   SELECT from_hour, to_hour, "
+        "          " UTC_TRUNC("day", "from_hour - INTERVAL '1 microsecond'") " + INTERVAL '1 day' AS from_day, "
+        "          " UTC_TRUNC("day", "to_hour") " AS to_day "
+        "   FROM hours"
+        "), buckets AS ("
+        "   SELECT a.user_id, a.documents_created, a.comments_created, a.tasks_completed "
+        "   FROM bounds b JOIN user_activity_daily a "
+        "     ON a.bucket_start >= b.from_day AND a.bucket_start < b.to_day "
+        "   UNION ALL "
+        "   SELECT a.user_id, a.documents_created, a.comments_created, a.tasks_completed "
+        "   FROM bounds b JOIN user_activity_hourly a "
+        "     ON a.bucket_start >= b.from_hour AND a.bucket_start < LEAST(b.from_day, b.to_hour) "
+        "   UNION ALL "
+        "   SELECT a.user_id, a.documents_created, a.comments_created, a.tasks_completed "
+        "   FROM bounds b JOIN user_activity_hourly a "
+        "     ON a.bucket_start >= GREATEST(b.to_day, b.from_day) AND a.bucket_start < b.to_hour"
+        "), per_user AS ("
+        "   SELECT user_id, SUM(documents_created) AS documents_created, "
+        "          SUM(comments_created) AS comments_created, SUM(tasks_completed) AS tasks_completed "
+        "   FROM buckets GROUP BY user_id"
+        ") ";
+
+// -> documents_created, comments_created, tasks_completed, active_users, aggregated_at
+const std::string kActivityTotalsSql =
+        std::string(kActivityPerUser) +
+        "SELECT COALESCE(SUM(documents_created), 0) AS documents_created, "
+        "       COALESCE(SUM(comments_created), 0) AS comments_created, "
+        "       COALESCE(SUM(tasks_completed), 0) AS tasks_completed, "
+        "       COUNT(*) AS active_users, "
+        "       (SELECT updated_at FROM analytics_rollup_state WHERE name = 'user_activity') AS aggregated_at "
+        "FROM per_user";
+
+// -> 活动最多的用户（id, email, role, nickname, 各项计数, last_login_at）
+const std::string kActivityTopUsersSql =
+        std::string(kActivityPerUser) +
+        "SELECT u.id, u.email, u.role, COALESCE(up.nickname, '') AS nickname, "
+        "       p.documents_created, p.comments_created, p.tasks_completed, u.last_login_at "
+        "FROM per_user p "
+        "JOIN \"user\" u ON u.id = p.user_id "
+        "LEFT JOIN user_profile up ON up.user_id = u.id "
+        "WHERE p.documents_created + p.comments_created + p.tasks_completed > 0 "
+        "ORDER BY p.documents_created DESC, p.comments_created DESC "
+        "LIMIT $3::integer";
+
+// -> 按角色汇总的各项计数
+const std::string kActivityRoleBreakdownSql =
+        std::string(kActivityPerUser) +
+        "SELECT u.role, "
+        "       COALESCE(SUM(p.documents_created), 0) AS documents_created, "
+        "       COALESCE(SUM(p.comments_created), 0) AS comments_created, "
+        "       COALESCE(SUM(p.tasks_completed), 0) AS tasks_completed "
+        "FROM \"user\" u "
+        "LEFT JOIN per_user p ON p.user_id = u.id "
+        "GROUP BY u.role ORDER BY u.role";
+#undef UTC_TRUNC
+
 template <typename SuccessCb, typename ErrorCb>
 void execWithParams(const std::shared_ptr<drogon::orm::DbClient>& db, const std::string& sql,
                     const std::vector<std::string>& params, SuccessCb&& successCb, ErrorCb&& errorCb) {
@@ -28,10 +96,26 @@ void execWithParams(const std::shared_ptr<drogon::orm::DbClient>& db, const std:
 }
 
 constexpr int kMaxPageSize = 100;
-constexpr int kMaxExportSize = 5000;
+// 导出每次读取的行数
+constexpr int kExportPageSize = 1000;
 const std::unordered_set<std::string> kAllowedRoles = {"admin", "editor", "viewer"};
 const std::unordered_set<std::string> kAllowedStatuses = {"active", "disabled", "suspended"};
 
+// 用户列表 / 导出 / 详情共用的查询：累计计数读 user_activity_stats（触发器增量维护，后台定期校正）；
+// 近 30 天活跃文档数随时间窗口变化无法预先维护，只对结果中的用户按 idx_document_owner_updated 逐个统计
+const char* const kUserColumns =
+        "SELECT u.id, u.email, u.role, u.status, u.is_locked, u.remark, u.created_at, u.updated_at, "
+        "u.last_login_at, COALESCE(p.nickname, '') AS nickname, COALESCE(p.avatar_url, '') AS avatar_url, "
+        "COALESCE(p.bio, '') AS bio, COALESCE(s.document_count, 0) AS document_count, "
+        "(SELECT COUNT(*) FROM document d WHERE d.owner_id = u.id AND d.updated_at > NOW() - INTERVAL '30 days') "
+        "    AS active_document_count, "
+        "COALESCE(s.comment_count, 0) AS comment_count, "
+        "COALESCE(s.completed_task_count, 0) AS completed_tasks ";
+const std::string kUserSelectSql = std::string(kUserColumns) +
+                                   "FROM \"user\" u "
+                                   "LEFT JOIN user_profile p ON u.id = p.user_id "
+                                   "LEFT JOIN user_activity_stats s ON s.user_id = u.id ";
+
 std::string formatTimePoint(const std::chrono::system_clock::time_point& tp) {
     std::time_t tt = std::chrono::system_clock::to_time_t(tp);
     std::tm tm{};
@@ -65,7 +149,7 @@ void AdminUserController::listUsers(const HttpRequestPtr& req, std::function<voi
     int adminId = std::stoi(adminIdStr);
     auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr&)>>(std::move(callback));
 
-    ensureAdmin(adminId, callbackPtr, [=]() {
+    PermissionUtils::ensureAdmin(adminId, callbackPtr, [=]() {
         UserListOptions options;
         if (!parseUserListOptions(req, options, callbackPtr, false)) {
             return;
@@ -89,23 +173,8 @@ void AdminUserController::listUsers(const HttpRequestPtr& req, std::function<voi
             }
 
             std::string listSql =
-                    "SELECT u.id, u.email, u.role, u.status, u.is_locked, u.remark, u.created_at, u.updated_at, "
-                    "u.last_login_at, COALESCE(p.nickname, '') AS nickname, COALESCE(p.avatar_url, '') AS avatar_url, "
-                    "COALESCE(p.bio, '') AS bio, COALESCE(doc_stats.doc_count, 0) AS document_count, "
-                    "COALESCE(doc_stats.active_doc_count, 0) AS active_document_count, "
-                    "COALESCE(comment_stats.comment_count, 0) AS comment_count, "
-                    "COALESCE(task_stats.completed_tasks, 0) AS completed_tasks "
-                    "FROM \"user\" u "
-                    "LEFT JOIN user_profile p ON u.id = p.user_id "
-                    "LEFT JOIN (SELECT owner_id, COUNT(*) AS doc_count, "
-                    "                   COUNT(*) FILTER (WHERE updated_at > NOW() - INTERVAL '30 days') "
-                    "                       AS active_doc_count "
-                    "            FROM document GROUP BY owner_id) doc_stats ON doc_stats.owner_id = u.id "
-                    "LEFT JOIN (SELECT author_id, COUNT(*) AS comment_count FROM comment GROUP BY author_id) "
-                    "            comment_stats ON comment_stats.author_id = u.id "
-                    "LEFT JOIN (SELECT created_by, COUNT(*) FILTER (WHERE status = 'done') AS completed_tasks "
-                    "            FROM task GROUP BY created_by) task_stats ON task_stats.created_by = u.id " +
-                    options.whereClause + " ORDER BY " + options.orderExpr + " " + options.orderDirection;
+                    kUserSelectSql + options.whereClause + " ORDER BY " + options.orderExpr + " " +
+                    options.orderDirection;
 
             int limitIndex = static_cast<int>(options.params.size()) + 1;
             int offsetIndex = limitIndex + 1;
@@ -145,6 +214,77 @@ void AdminUserController::listUsers(const HttpRequestPtr& req, std::function<voi
     });
 }
 
+namespace {
+const char* const kUserCsvHeader =
+        "ID,Email,Role,Status,Locked,Created At,Last Login,Documents,Active Documents,Comments,Completed Tasks\n";
+
+// 一次用户导出的状态
+struct UserExportSession {
+    std::shared_ptr<drogon::orm::DbClient> db;
+    std::string nextPageSql;  // 最后两个参数为上一页末行的排序键与 ID
+    std::vector<std::string> params;
+    drogon::ResponseStreamPtr stream;
+    size_t exported{0};
+};
+
+void appendUserCsv(const Result& rows, std::string& out) {
+    for (const auto& row : rows) {
+        out += std::to_string(row["id"].as<int64_t>());
+        out += ',';
+        out += escapeCsv(row["email"].isNull() ? "" : row["email"].as<std::string>());
+        out += ',';
+        out += row["role"].as<std::string>();
+        out += ',';
+        out += row["status"].as<std::string>();
+        out += ',';
+        out += row["is_locked"].as<bool>() ? "true" : "false";
+        out += ',';
+        out += escapeCsv(row["created_at"].as<std::string>());
+        out += ',';
+        out += escapeCsv(row["last_login_at"].isNull() ? "" : row["last_login_at"].as<std::string>());
+        out += ',';
+        out += std::to_string(row["document_count"].as<int>());
+        out += ',';
+        out += std::to_string(row["active_document_count"].as<int>());
+        out += ',';
+        out += std::to_string(row["comment_count"].as<int>());
+        out += ',';
+        out += std::to_string(row["completed_tasks"].as<int>());
+        out += '\n';
+    }
+}
+
+// 发送一页并接着查询下一页。send 只是把数据交给连接的事件循环，不会阻塞；
+// 页面按顺序逐个处理，同一时刻最多只有一页在查询
+void sendUserExportPage(const std::shared_ptr<UserExportSession>& session, const Result& page) {
+    std::string chunk = session->exported == 0 ? kUserCsvHeader : "";
+    appendUserCsv(page, chunk);
+    session->exported += page.size();
+    if (!session->stream->send(chunk)) {
+        LOG_INFO << "[UserExport] Client disconnected after " << session->exported << " rows";
+        return;
+    }
+    if (page.size() < static_cast<size_t>(kExportPageSize)) {
+        session->stream->close();
+        return;
+    }
+
+    auto params = session->params;
+    params.push_back(page[page.size() - 1]["sort_key"].as<std::string>());
+    params.push_back(page[page.size() - 1]["id"].as<std::string>());
+    execWithParams(
+            session->db, session->nextPageSql, params,
+            [session](const Result& next) { sendUserExportPage(session, next); },
+            [session](const drogon::orm::DrogonDbException& e) {
+                LOG_ERROR << "[UserExport] Aborted after " << session->exported << " rows: " << e.base().what();
+                // 响应头已发出，只能在文件末尾注明导出不完整
+                session->stream->send("Export aborted: database error\n");
+                session->stream->close();
+            });
+}
+}  // namespace
+
+// 导出用户：按键集游标逐页读取并以分块传输发送 CSV，内存占用与总行数无关
 void AdminUserController::exportUsers(const HttpRequestPtr& req,
                                       std::function<void(const HttpResponsePtr&)>&& callback) {
     std::string adminIdStr = req->getParameter("user_id");
@@ -155,7 +295,7 @@ void AdminUserController::exportUsers(const HttpRequestPtr& req,
     int adminId = std::stoi(adminIdStr);
     auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr&)>>(std::move(callback));
 
-    ensureAdmin(adminId, callbackPtr, [=]() {
+    PermissionUtils::ensureAdmin(adminId, callbackPtr, [=]() {
         UserListOptions options;
         if (!parseUserListOptions(req, options, callbackPtr, true)) {
             return;
@@ -167,59 +307,44 @@ void AdminUserController::exportUsers(const HttpRequestPtr& req,
             return;
         }
 
-        std::string listSql =
-                "SELECT u.id, u.email, u.role, u.status, u.is_locked, u.remark, u.created_at, u.updated_at, "
-                "u.last_login_at, COALESCE(p.nickname, '') AS nickname, COALESCE(p.avatar_url, '') AS avatar_url, "
-                "COALESCE(p.bio, '') AS bio, COALESCE(doc_stats.doc_count, 0) AS document_count, "
-                "COALESCE(doc_stats.active_doc_count, 0) AS active_document_count, "
-                "COALESCE(comment_stats.comment_count, 0) AS comment_count, "
-                "COALESCE(task_stats.completed_tasks, 0) AS completed_tasks "
-                "FROM \"user\" u "
-                "LEFT JOIN user_profile p ON u.id = p.user_id "
-                "LEFT JOIN (SELECT owner_id, COUNT(*) AS doc_count, "
-                "                   COUNT(*) FILTER (WHERE updated_at > NOW() - INTERVAL '30 days') "
-                "                       AS active_doc_count "
-                "            FROM document GROUP BY owner_id) doc_stats ON doc_stats.owner_id = u.id "
-                "LEFT JOIN (SELECT author_id, COUNT(*) AS comment_count FROM comment GROUP BY author_id) "
-                "            comment_stats ON comment_stats.author_id = u.id "
-                "LEFT JOIN (SELECT created_by, COUNT(*) FILTER (WHERE status = 'done') AS completed_tasks "
-                "            FROM task GROUP BY created_by) task_stats ON task_stats.created_by = u.id " +
-                options.whereClause + " ORDER BY " + options.orderExpr + " " + options.orderDirection;
-
-        int limitIndex = static_cast<int>(options.params.size()) + 1;
-        listSql += " LIMIT $" + std::to_string(limitIndex);
-
-        auto params = options.params;
-        params.push_back(std::to_string(options.pageSize));
-
-        auto listCallback = [=](const Result& rows) {
-            std::ostringstream csv;
-            csv << "ID,Email,Role,Status,Locked,Created At,Last Login,Documents,Active Documents,Comments,Completed "
-                   "Tasks\n";
-            for (const auto& row : rows) {
-                csv << row["id"].as<int>() << ',' << escapeCsv(row["email"].as<std::string>()) << ','
-                    << row["role"].as<std::string>() << ',' << row["status"].as<std::string>() << ','
-                    << (row["is_locked"].as<bool>() ? "true" : "false") << ','
-                    << escapeCsv(row["created_at"].as<std::string>()) << ','
-                    << escapeCsv(row["last_login_at"].isNull() ? "" : row["last_login_at"].as<std::string>()) << ','
-                    << row["document_count"].as<int>() << ',' << row["active_document_count"].as<int>() << ','
-                    << row["comment_count"].as<int>() << ',' << row["completed_tasks"].as<int>() << '\n';
-            }
-
-            auto resp = HttpResponse::newHttpResponse();
-            resp->setStatusCode(k200OK);
-            resp->addHeader("Content-Type", "text/csv; charset=utf-8");
-            resp->addHeader("Content-Disposition", "attachment; filename=\"users.csv\"");
-            resp->setBody(csv.str());
-            (*callbackPtr)(resp);
-        };
-
-        auto listError = [=](const drogon::orm::DrogonDbException& e) {
-            ResponseUtils::sendError(*callbackPtr, "Database error: " + std::string(e.base().what()),
-                                     k500InternalServerError);
-        };
-
-        execWithParams(db, listSql, params, listCallback, listError);
+        // 按计数排序时由 user_activity_stats 的 (计数, user_id) 索引驱动；每个用户都有计数行（注册时写入）
+        std::string from = options.keysetOnStats ? "FROM user_activity_stats s "
+                                                   "JOIN \"user\" u ON u.id = s.user_id "
+                                                   "LEFT JOIN user_profile p ON u.id = p.user_id "
+                                                 : "FROM \"user\" u "
+                                                   "LEFT JOIN user_profile p ON u.id = p.user_id "
+                                                   "LEFT JOIN user_activity_stats s ON s.user_id = u.id ";
+        std::string select = std::string(kUserColumns) + ", " + options.keysetExpr + "::text AS sort_key " + from;
+        std::string order = " ORDER BY " + options.keysetExpr + " " + options.orderDirection + ", " +
+                            options.keysetIdExpr + " " + options.orderDirection + " LIMIT " +
+                            std::to_string(kExportPageSize);
+
+        int keyIndex = static_cast<int>(options.params.size()) + 1;
+        std::string cursor = " AND (" + options.keysetExpr + ", " + options.keysetIdExpr + ") " +
+                             (options.orderDirection == "ASC" ? ">" : "<") + " ($" + std::to_string(keyIndex) +
+                             "::" + options.keysetType + ", $" + std::to_string(keyIndex + 1) + "::bigint)";
+
+        auto session = std::make_shared<UserExportSession>();
+        session->db = db;
+        session->nextPageSql = select + options.whereClause + cursor + order;
+        session->params = options.params;
+
+        // 首页查询成功后再发出响应头，之前的错误仍以 JSON 返回
+        execWithParams(
+                db, select + options.whereClause + order, options.params,
+                [=](const Result& firstPage) {
+                    auto resp = HttpResponse::newAsyncStreamResponse([session, firstPage](ResponseStreamPtr stream) {
+                        session->stream = std::move(stream);
+                        sendUserExportPage(session, firstPage);
+                    });
+                    resp->setContentTypeString("text/csv; charset=utf-8");
+                    resp->addHeader("Content-Disposition", "attachment; filename=\"users.csv\"");
+                    (*callbackPtr)(resp);
+                },
+                [=](const drogon::orm::DrogonDbException& e) {
+                    ResponseUtils::sendError(*callbackPtr, "Database error: " + std::string(e.base().what()),
+                                             k500InternalServerError);
+                });
     });
 }
 
@@ -239,7 +364,7 @@ void AdminUserController::updateUserStatus(const HttpRequestPtr& req,
     int targetUserId = std::stoi(userIdPath);
     auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr&)>>(std::move(callback));
 
-    ensureAdmin(adminId, callbackPtr, [=]() {
+    PermissionUtils::ensureAdmin(adminId, callbackPtr, [=]() {
         auto jsonPtr = req->jsonObject();
         if (!jsonPtr) {
             ResponseUtils::sendError(*callbackPtr, "Invalid JSON body", k400BadRequest);
@@ -343,7 +468,7 @@ void AdminUserController::updateUserRoles(const HttpRequestPtr& req,
     int targetUserId = std::stoi(userIdPath);
     auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr&)>>(std::move(callback));
 
-    ensureAdmin(adminId, callbackPtr, [=]() {
+    PermissionUtils::ensureAdmin(adminId, callbackPtr, [=]() {
         auto jsonPtr = req->jsonObject();
         if (!jsonPtr) {
             ResponseUtils::sendError(*callbackPtr, "Invalid JSON body", k400BadRequest);
@@ -416,7 +541,7 @@ void AdminUserController::getUserAnalytics(const HttpRequestPtr& req,
     int adminId = std::stoi(adminIdStr);
     auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr&)>>(std::move(callback));
 
-    ensureAdmin(adminId, callbackPtr, [=]() {
+    PermissionUtils::ensureAdmin(adminId, callbackPtr, [=]() {
         auto now = std::chrono::system_clock::now();
         std::string toParam = req->getParameter("to");
         std::string fromParam = req->getParameter("from");
@@ -449,25 +574,6 @@ void AdminUserController::getUserAnalytics(const HttpRequestPtr& req,
 
         std::vector<std::string> rangeParams = {fromParam, toParam};
 
-        std::string totalsSql =
-                "SELECT "
-                "  (SELECT COUNT(*) FROM document WHERE created_at BETWEEN $1::timestamptz AND $2::timestamptz) "
-                "      AS documents_created, "
-                "  (SELECT COUNT(*) FROM comment WHERE created_at BETWEEN $1::timestamptz AND $2::timestamptz) "
-                "      AS comments_created, "
-                "  (SELECT COUNT(*) FROM task WHERE status = 'done' "
-                "      AND updated_at BETWEEN $1::timestamptz AND $2::timestamptz) AS tasks_completed, "
-                "  (SELECT COUNT(*) FROM ("
-                "       SELECT owner_id AS user_id FROM document WHERE created_at BETWEEN $1::timestamptz AND "
-                "$2::timestamptz "
-                "       UNION "
-                "       SELECT author_id AS user_id FROM comment WHERE created_at BETWEEN $1::timestamptz AND "
-                "$2::timestamptz "
-                "       UNION "
-                "       SELECT created_by AS user_id FROM task WHERE updated_at BETWEEN $1::timestamptz AND "
-                "$2::timestamptz "
-                "   ) AS activity) AS active_users";
-
         auto totalsCallback = [=](const Result& totalsResult) {
             if (!totalsResult.empty()) {
                 Json::Value totals;
@@ -476,32 +582,12 @@ void AdminUserController::getUserAnalytics(const HttpRequestPtr& req,
                 totals["tasks_completed"] = totalsResult[0]["tasks_completed"].as<int>();
                 totals["active_users"] = totalsResult[0]["active_users"].as<int>();
                 (*responseJson)["totals"] = totals;
+                // 汇总表最近一次更新的时间，之后的活动尚未计入
+                if (!totalsResult[0]["aggregated_at"].isNull()) {
+                    (*responseJson)["range"]["aggregated_at"] = totalsResult[0]["aggregated_at"].as<std::string>();
+                }
             }
 
-            std::string topUserSql =
-                    "SELECT u.id, u.email, u.role, COALESCE(up.nickname, '') AS nickname, "
-                    "COALESCE(doc_counts.doc_count, 0) AS documents_created, "
-                    "COALESCE(comment_counts.comment_count, 0) AS comments_created, "
-                    "COALESCE(task_counts.completed_tasks, 0) AS tasks_completed, "
-                    "u.last_login_at "
-                    "FROM \"user\" u "
-                    "LEFT JOIN user_profile up ON u.id = up.user_id "
-                    "LEFT JOIN (SELECT owner_id, COUNT(*) AS doc_count "
-                    "           FROM document WHERE created_at BETWEEN $1::timestamptz AND $2::timestamptz "
-                    "           GROUP BY owner_id) doc_counts ON doc_counts.owner_id = u.id "
-                    "LEFT JOIN (SELECT author_id, COUNT(*) AS comment_count "
-                    "           FROM comment WHERE created_at BETWEEN $1::timestamptz AND $2::timestamptz "
-                    "           GROUP BY author_id) comment_counts ON comment_counts.author_id = u.id "
-                    "LEFT JOIN (SELECT created_by, COUNT(*) AS completed_tasks "
-                    "           FROM task WHERE status = 'done' AND updated_at BETWEEN $1::timestamptz AND "
-                    "$2::timestamptz "
-                    "           GROUP BY created_by) task_counts ON task_counts.created_by = u.id "
-                    "WHERE COALESCE(doc_counts.doc_count, 0) + COALESCE(comment_counts.comment_count, 0) + "
-                    "      COALESCE(task_counts.completed_tasks, 0) > 0 "
-                    "ORDER BY COALESCE(doc_counts.doc_count, 0) DESC, "
-                    "         COALESCE(comment_counts.comment_count, 0) DESC "
-                    "LIMIT $3::integer";
-
             auto userParams = rangeParams;
             userParams.push_back(std::to_string(limit));
 
@@ -523,24 +609,6 @@ void AdminUserController::getUserAnalytics(const HttpRequestPtr& req,
                 }
                 (*responseJson)["top_users"] = topUsers;
 
-                std::string roleSql =
-                        "SELECT u.role, "
-                        "COALESCE(SUM(doc_counts.doc_count), 0) AS documents_created, "
-                        "COALESCE(SUM(comment_counts.comment_count), 0) AS comments_created, "
-                        "COALESCE(SUM(task_counts.completed_tasks), 0) AS tasks_completed "
-                        "FROM \"user\" u "
-                        "LEFT JOIN (SELECT owner_id, COUNT(*) AS doc_count "
-                        "           FROM document WHERE created_at BETWEEN $1::timestamptz AND $2::timestamptz "
-                        "           GROUP BY owner_id) doc_counts ON doc_counts.owner_id = u.id "
-                        "LEFT JOIN (SELECT author_id, COUNT(*) AS comment_count "
-                        "           FROM comment WHERE created_at BETWEEN $1::timestamptz AND $2::timestamptz "
-                        "           GROUP BY author_id) comment_counts ON comment_counts.author_id = u.id "
-                        "LEFT JOIN (SELECT created_by, COUNT(*) AS completed_tasks "
-                        "           FROM task WHERE status = 'done' AND updated_at BETWEEN $1::timestamptz AND "
-                        "$2::timestamptz "
-                        "           GROUP BY created_by) task_counts ON task_counts.created_by = u.id "
-                        "GROUP BY u.role ORDER BY u.role";
-
                 auto roleCallback = [=](const Result& roleRows) {
                     Json::Value roleStats(Json::arrayValue);
                     for (const auto& row : roleRows) {
@@ -560,7 +628,7 @@ void AdminUserController::getUserAnalytics(const HttpRequestPtr& req,
                                              k500InternalServerError);
                 };
 
-                execWithParams(db, roleSql, rangeParams, roleCallback, roleError);
+                execWithParams(db, kActivityRoleBreakdownSql, rangeParams, roleCallback, roleError);
             };
 
             auto userError = [=](const drogon::orm::DrogonDbException& e) {
@@ -568,7 +636,7 @@ void AdminUserController::getUserAnalytics(const HttpRequestPtr& req,
                                          k500InternalServerError);
             };
 
-            execWithParams(db, topUserSql, userParams, userCallback, userError);
+            execWithParams(db, kActivityTopUsersSql, userParams, userCallback, userError);
         };
 
         auto totalsError = [=](const drogon::orm::DrogonDbException& e) {
@@ -576,46 +644,13 @@ void AdminUserController::getUserAnalytics(const HttpRequestPtr& req,
                                      k500InternalServerError);
         };
 
-        execWithParams(db, totalsSql, rangeParams, totalsCallback, totalsError);
+        execWithParams(db, kActivityTotalsSql, rangeParams, totalsCallback, totalsError);
     });
 }
 
-bool AdminUserController::ensureAdmin(int userId, std::shared_ptr<std::function<void(const HttpResponsePtr&)>> callback,
-                                      std::function<void()> onSuccess) {
-    auto db = drogon::app().getDbClient();
-    if (!db) {
-        ResponseUtils::sendError(*callback, "Database not available", k500InternalServerError);
-        return false;
-    }
-
-    db->execSqlAsync(
-            "SELECT role FROM \"user\" WHERE id = $1",
-            [=](const Result& r) {
-                if (r.empty()) {
-                    ResponseUtils::sendError(*callback, "User not found", k404NotFound);
-                    return;
-                }
-                std::string role = r[0]["role"].as<std::string>();
-                if (role != "admin") {
-                    ResponseUtils::sendError(*callback, "Admin privileges required", k403Forbidden);
-                    return;
-                }
-                onSuccess();
-            },
-            [=](const drogon::orm::DrogonDbException& e) {
-                ResponseUtils::sendError(*callback, "Database error: " + std::string(e.base().what()),
-                                         k500InternalServerError);
-            },
-            std::to_string(userId));
-    return true;
-}
-
 bool AdminUserController::parseUserListOptions(const HttpRequestPtr& req, UserListOptions& options,
                                                std::shared_ptr<std::function<void(const HttpResponsePtr&)>> callback,
                                                bool forExport) {
-    int defaultPageSize = forExport ? 1000 : 20;
-    int maxPageSize = forExport ? kMaxExportSize : kMaxPageSize;
-
     options.page = 1;
     std::string pageStr = req->getParameter("page");
     if (!pageStr.empty()) {
@@ -625,16 +660,18 @@ bool AdminUserController::parseUserListOptions(const HttpRequestPtr& req, UserLi
         }
     }
 
-    options.pageSize = defaultPageSize;
+    options.pageSize = 20;
     std::string sizeStr = req->getParameter("page_size");
     if (!sizeStr.empty()) {
         try {
-            options.pageSize = std::max(1, std::min(maxPageSize, std::stoi(sizeStr)));
+            options.pageSize = std::max(1, std::min(kMaxPageSize, std::stoi(sizeStr)));
         } catch (...) {
         }
     }
     if (forExport) {
+        // 导出不分页，按排序键逐批读取全部匹配的用户
         options.page = 1;
+        options.pageSize = kExportPageSize;
     }
     options.offset = (options.page - 1) * options.pageSize;
 
@@ -652,16 +689,26 @@ bool AdminUserController::parseUserListOptions(const HttpRequestPtr& req, UserLi
         sortOrder = "desc";
     }
 
+    options.keysetIdExpr = "u.id";
+    options.keysetOnStats = false;
     if (sortBy == "last_login_at") {
         options.orderExpr = "u.last_login_at";
-    } else if (sortBy == "document_count") {
-        options.orderExpr = "COALESCE(doc_stats.doc_count, 0)";
-    } else if (sortBy == "comment_count") {
-        options.orderExpr = "COALESCE(comment_stats.comment_count, 0)";
-    } else if (sortBy == "completed_tasks") {
-        options.orderExpr = "COALESCE(task_stats.completed_tasks, 0)";
+        // 从未登录的用户排在最早
+        options.keysetExpr = "COALESCE(u.last_login_at, '-infinity'::timestamptz)";
+        options.keysetType = "timestamptz";
+    } else if (sortBy == "document_count" || sortBy == "comment_count" || sortBy == "completed_tasks") {
+        std::string column = sortBy == "document_count"  ? "s.document_count"
+                             : sortBy == "comment_count" ? "s.comment_count"
+                                                         : "s.completed_task_count";
+        options.orderExpr = "COALESCE(" + column + ", 0)";
+        options.keysetExpr = column;
+        options.keysetIdExpr = "s.user_id";
+        options.keysetType = "integer";
+        options.keysetOnStats = true;
     } else {
         options.orderExpr = "u.created_at";
+        options.keysetExpr = "u.created_at";
+        options.keysetType = "timestamptz";
     }
     options.orderDirection = sortOrder == "asc" ? "ASC" : "DESC";
 
@@ -719,23 +766,7 @@ void AdminUserController::fetchUserDetail(int targetUserId,
     }
 
     db->execSqlAsync(
-            "SELECT u.id, u.email, u.role, u.status, u.is_locked, u.remark, u.created_at, u.updated_at, "
-            "u.last_login_at, COALESCE(p.nickname, '') AS nickname, COALESCE(p.avatar_url, '') AS avatar_url, "
-            "COALESCE(p.bio, '') AS bio, "
-            "COALESCE(doc_stats.doc_count, 0) AS document_count, "
-            "COALESCE(doc_stats.active_doc_count, 0) AS active_document_count, "
-            "COALESCE(comment_stats.comment_count, 0) AS comment_count, "
-            "COALESCE(task_stats.completed_tasks, 0) AS completed_tasks "
-            "FROM \"user\" u "
-            "LEFT JOIN user_profile p ON u.id = p.user_id "
-            "LEFT JOIN (SELECT owner_id, COUNT(*) AS doc_count, "
-            "                   COUNT(*) FILTER (WHERE updated_at > NOW() - INTERVAL '30 days') AS active_doc_count "
-            "            FROM document GROUP BY owner_id) doc_stats ON doc_stats.owner_id = u.id "
-            "LEFT JOIN (SELECT author_id, COUNT(*) AS comment_count FROM comment GROUP BY author_id) comment_stats "
-            "            ON comment_stats.author_id = u.id "
-            "LEFT JOIN (SELECT created_by, COUNT(*) FILTER (WHERE status = 'done') AS completed_tasks "
-            "            FROM task GROUP BY created_by) task_stats ON task_stats.created_by = u.id "
-            "WHERE u.id = $1",
+            kUserSelectSql + "WHERE u.id = $1",
             [=](const Result& r) {
                 if (r.empty()) {
                     ResponseUtils::sendError(*callback, "User not found", k404NotFound);
@@ -36,11 +36,13 @@ private:
         std::vector<std::string> params;
         std::string orderExpr;
         std::string orderDirection;
+        // 导出按 (keysetExpr, keysetIdExpr) 键集翻页，排序键非空且有配套索引；keysetType 为游标参数的类型
+        std::string keysetExpr;
+        std::string keysetIdExpr;
+        std::string keysetType;
+        bool keysetOnStats{false};  // 排序键来自 user_activity_stats，由该表驱动查询
     };
 
-    bool ensureAdmin(int userId, std::shared_ptr<std::function<void(const HttpResponsePtr&)>> callback,
-                     std::function<void()> onSuccess);
-
     bool parseUserListOptions(const HttpRequestPtr& req, UserListOptions& options,
                               std::shared_ptr<std::function<void(const HttpResponsePtr&)>> callback, bool forExport);
 
@@ -4,50 +4,73 @@
 #include <openssl/bio.h>
 #include <openssl/buffer.h>
 #include <openssl/evp.h>
-#include <unistd.h>  // for access()
 
+#include <algorithm>
 #include <ctime>
-#include <fstream>
-#include <sstream>
 #include <vector>
 
+#include "../repositories/StatementRegistry.h"
+#include "../services/DocumentLoader.h"
+#include "../utils/ConfigUtils.h"
 #include "../utils/JwtUtil.h"
 #include "../utils/MinIOClient.h"
 #include "../utils/PermissionUtils.h"
 #include "../utils/ResponseUtils.h"
 
-// 辅助函数：从配置文件读取配置值（直接读取配置文件）
-static std::string getConfigValue(const std::string& key, const std::string& defaultValue = "") {
-    std::string configPath = "config.json";
-    if (access("config.json", F_OK) != 0) {
-        configPath = "../config.json";
-    }
+// 辅助函数：从配置文件读取 webhook_token
+static std::string getWebhookTokenFromConfig() { return ConfigUtils::getValue("webhook_token", ""); }
+
+// 辅助函数：bootstrap 内联快照的大小上限（字节），0 表示不内联
+static int64_t getBootstrapInlineMaxBytes() {
+    static const int64_t maxBytes = [] {
+        try {
+            return std::max<int64_t>(0, std::stoll(ConfigUtils::getValue("bootstrap_inline_max_bytes", "262144")));
+        } catch (...) {
+            return static_cast<int64_t>(262144);
+        }
+    }();
+    return maxBytes;
+}
 
-    try {
-        std::ifstream file(configPath);
-        if (file.is_open()) {
-            std::stringstream buffer;
-            buffer << file.rdbuf();
-            file.close();
-
-            Json::Value root;
-            Json::Reader reader;
-            if (reader.parse(buffer.str(), root)) {
-                if (root.isMember("app") && root["app"].isMember(key)) {
-                    return root["app"][key].asString();
-                }
+// 辅助函数：Base64 编码（使用 OpenSSL）
+static std::string base64Encode(const std::vector<char>& data) {
+    if (data.empty()) return "";
+    std::string encoded(4 * ((data.size() + 2) / 3), '\0');
+    int len = EVP_EncodeBlock(reinterpret_cast<unsigned char*>(&encoded[0]),
+                              reinterpret_cast<const unsigned char*>(data.data()), static_cast<int>(data.size()));
+    encoded.resize(len > 0 ? static_cast<size_t>(len) : 0);
+    return encoded;
+}
+
+// 辅助函数：从快照 URL 中提取 MinIO objectName，无法识别时返回空字符串
+// URL 格式: http://localhost:9000/documents/snapshots/doc-123/filename.bin
+static std::string extractSnapshotObjectName(const std::string& minioUrl) {
+    size_t bucketPos = minioUrl.find("/documents/");
+    if (bucketPos != std::string::npos) {
+        // 提取 documents/ 之后的部分
+        return minioUrl.substr(bucketPos + 11);  // 跳过 "/documents/"
+    }
+    // 可能是相对路径或已经提取过的路径
+    if (minioUrl.find("snapshots/") != std::string::npos) {
+        // 已经是 snapshots/ 开头的路径
+        return minioUrl;
+    }
+    // 尝试从完整 URL 中提取
+    size_t httpPos = minioUrl.find("://");
+    if (httpPos != std::string::npos) {
+        size_t pathStart = minioUrl.find('/', httpPos + 3);
+        if (pathStart != std::string::npos) {
+            std::string path = minioUrl.substr(pathStart + 1);  // 跳过第一个 /
+            size_t bucketSlash = path.find('/');
+            if (bucketSlash != std::string::npos) {
+                return path.substr(bucketSlash + 1);  // 跳过 bucket 名称
             }
+            return path;
         }
-    } catch (...) {
-        // 忽略异常
     }
-
-    return defaultValue;
+    return "";
 }
 
-// 辅助函数：从配置文件读取 webhook_token
-static std::string getWebhookTokenFromConfig() { return getConfigValue("webhook_token", ""); }
-
 void CollaborationController::getToken(const HttpRequestPtr& req,
                                        std::function<void(const HttpResponsePtr&)>&& callback) {
     // 1.获取user_id
@@ -87,7 +110,7 @@ void CollaborationController::getToken(const HttpRequestPtr& req,
         payload["type"] = "collab";
 
         // 从配置获取 JWT secret
-        std::string secret = getConfigValue("jwt_secret", "default-secret");
+        std::string secret = ConfigUtils::getValue("jwt_secret", "default-secret");
 
         std::string token = JwtUtil::generateToken(payload, secret, 3600);  // 1 小时
 
@@ -130,88 +153,115 @@ void CollaborationController::getBootstrap(const HttpRequestPtr& req,
         return;
     }
 
-    // 3.检查权限 (需要viewer或更高权限)
-    auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr&)>>(std::move(callback));
-    PermissionUtils::hasPermission(docId, userId, "viewer", [=](bool hasPermission) {
-        if (!hasPermission) {
-            ResponseUtils::sendError(*callbackPtr, "Forbidden", k403Forbidden);
-            return;
-        }
+    // inline=1 时，小于上限的快照直接以 base64 内联返回，省去一次下载请求
+    std::string inlineParam = req->getParameter("inline");
+    bool inlineSnapshot = inlineParam == "1" || inlineParam == "true";
 
-        // 4.查询文档的最新发布版本
-        auto db = drogon::app().getDbClient();
-        if (!db) {
-            ResponseUtils::sendError(*callbackPtr, "Database not available", k400BadRequest);
-            return;
-        }
-
-        db->execSqlAsync(
-                "SELECT dv.snapshot_url, dv.snapshot_sha256, dv.id as version_id, dv.content_html, dv.content_text "
-                "FROM document d "
-                "LEFT JOIN document_version dv ON d.last_published_version_id = dv.id "
-                "WHERE d.id = $1",
-                [=](const drogon::orm::Result& r) {
-                    if (r.empty() || r[0]["snapshot_url"].isNull()) {
-                        // 没有快照,返回空
-                        Json::Value responseJson;
-                        responseJson["snapshot_url"] = Json::Value::null;
-                        responseJson["sha256"] = Json::Value::null;
-                        responseJson["version_id"] = Json::Value::null;
-                        ResponseUtils::sendSuccess(*callbackPtr, responseJson, k200OK);
-                        return;
-                    }
-                    Json::Value responseJson;
-                    std::string snapshotUrl = r[0]["snapshot_url"].as<std::string>();
-
-                    // 检查是否是导入占位符 URL (import://markdown/xxx)
-                    if (snapshotUrl.find("import://") == 0) {
-                        // 对于导入的文档，返回 content_html 让前端初始化
-                        std::cerr << "Bootstrap: Found import placeholder URL: " << snapshotUrl
-                                  << ", returning content_html for frontend initialization." << std::endl;
-                        responseJson["snapshot_url"] = Json::Value::null;
-                        responseJson["sha256"] = Json::Value::null;
-                        responseJson["version_id"] = r[0]["version_id"].isNull()
-                                                             ? Json::Value::null
-                                                             : Json::Value(r[0]["version_id"].as<int>());
-                        // 返回 content_html 和 content_text，让前端可以从 HTML 初始化
-                        if (!r[0]["content_html"].isNull()) {
-                            responseJson["content_html"] = r[0]["content_html"].as<std::string>();
-                        }
-                        if (!r[0]["content_text"].isNull()) {
-                            responseJson["content_text"] = r[0]["content_text"].as<std::string>();
-                        }
-                        ResponseUtils::sendSuccess(*callbackPtr, responseJson, k200OK);
-                        return;
-                    }
+    auto db = drogon::app().getDbClient();
+    if (!db) {
+        ResponseUtils::sendError(callback, "Database not available", k500InternalServerError);
+        return;
+    }
 
-                    // 返回代理 URL 而不是直接的 MinIO URL，避免签名问题
-                    // 如果已经是代理 URL，直接返回；否则转换为代理 URL
-                    if (snapshotUrl.find("/api/collab/snapshot/") != std::string::npos) {
-                        responseJson["snapshot_url"] = snapshotUrl;
-                    } else {
-                        // 转换为代理 URL
-                        responseJson["snapshot_url"] = "/api/collab/snapshot/" + docIdStr + "/download";
-                    }
-                    responseJson["sha256"] = r[0]["snapshot_sha256"].as<std::string>();
-                    responseJson["version_id"] = r[0]["version_id"].as<int>();
+    // 3.一次查询同时取得访问权限与最新发布版本（任意权限即可查看）。结果与用户相关，
+    //   不走 DocumentLoader 按文档合并的加载
+    auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr&)>>(std::move(callback));
+    db->execSqlAsync(
+            StatementRegistry::bootstrapVersion(),
+            [=](const drogon::orm::Result& r) {
+                if (r.empty() || r[0]["permission"].isNull()) {
+                    ResponseUtils::sendError(*callbackPtr, "Forbidden", k403Forbidden);
+                    return;
+                }
 
-                    // 优化：即使有快照 URL，也返回 content_html 和 content_text 作为后备方案
-                    // 这样当快照文件无法访问时（例如恢复的旧版本），前端仍可以从 HTML 内容初始化
-                    if (!r[0]["content_html"].isNull() && !r[0]["content_html"].as<std::string>().empty()) {
+                if (r[0]["snapshot_url"].isNull()) {
+                    // 没有快照,返回空
+                    Json::Value responseJson;
+                    responseJson["snapshot_url"] = Json::Value::null;
+                    responseJson["sha256"] = Json::Value::null;
+                    responseJson["version_id"] = Json::Value::null;
+                    ResponseUtils::sendSuccess(*callbackPtr, responseJson, k200OK);
+                    return;
+                }
+                Json::Value responseJson;
+                std::string snapshotUrl = r[0]["snapshot_url"].as<std::string>();
+
+                // 检查是否是导入占位符 URL (import://markdown/xxx)
+                if (snapshotUrl.find("import://") == 0) {
+                    // 对于导入的文档，返回 content_html 让前端初始化
+                    std::cerr << "Bootstrap: Found import placeholder URL: " << snapshotUrl
+                              << ", returning content_html for frontend initialization." << std::endl;
+                    responseJson["snapshot_url"] = Json::Value::null;
+                    responseJson["sha256"] = Json::Value::null;
+                    responseJson["version_id"] = r[0]["version_id"].isNull()
+                                                         ? Json::Value::null
+                                                         : Json::Value(r[0]["version_id"].as<int>());
+                    // 返回 content_html 和 content_text，让前端可以从 HTML 初始化
+                    if (!r[0]["content_html"].isNull()) {
                         responseJson["content_html"] = r[0]["content_html"].as<std::string>();
                     }
-                    if (!r[0]["content_text"].isNull() && !r[0]["content_text"].as<std::string>().empty()) {
+                    if (!r[0]["content_text"].isNull()) {
                         responseJson["content_text"] = r[0]["content_text"].as<std::string>();
                     }
+                    ResponseUtils::sendSuccess(*callbackPtr, responseJson, k200OK);
+                    return;
+                }
+
+                // 返回代理 URL 而不是直接的 MinIO URL，避免签名问题
+                // 如果已经是代理 URL，直接返回；否则转换为代理 URL
+                if (snapshotUrl.find("/api/collab/snapshot/") != std::string::npos) {
+                    responseJson["snapshot_url"] = snapshotUrl;
+                } else {
+                    // 转换为代理 URL
+                    responseJson["snapshot_url"] = "/api/collab/snapshot/" + docIdStr + "/download";
+                }
+                responseJson["sha256"] = r[0]["snapshot_sha256"].as<std::string>();
+                responseJson["version_id"] = r[0]["version_id"].as<int>();
 
+                // 优化：即使有快照 URL，也返回 content_html 和 content_text 作为后备方案
+                // 这样当快照文件无法访问时（例如恢复的旧版本），前端仍可以从 HTML 内容初始化
+                if (!r[0]["content_html"].isNull() && !r[0]["content_html"].as<std::string>().empty()) {
+                    responseJson["content_html"] = r[0]["content_html"].as<std::string>();
+                }
+                if (!r[0]["content_text"].isNull() && !r[0]["content_text"].as<std::string>().empty()) {
+                    responseJson["content_text"] = r[0]["content_text"].as<std::string>();
+                }
+
+                // 5.按需内联快照内容；超过上限或下载失败时仍返回 snapshot_url，由前端单独下载。
+                // 前端有 HTML / 文本内容时会优先用它初始化，不会用到快照，此时不再下载内联
+                auto hasContent = [&responseJson](const char* key) {
+                    return responseJson.isMember(key) &&
+                           responseJson[key].asString().find_first_not_of(" \t\r\n") != std::string::npos;
+                };
+                bool needsSnapshot = !hasContent("content_html") && !hasContent("content_text");
+                int64_t sizeBytes = r[0]["size_bytes"].isNull() ? -1 : r[0]["size_bytes"].as<int64_t>();
+                std::string objectName = extractSnapshotObjectName(snapshotUrl);
+                if (!inlineSnapshot || !needsSnapshot || sizeBytes < 0 ||
+                    sizeBytes > getBootstrapInlineMaxBytes() || objectName.empty()) {
+                    responseJson["snapshot_inlined"] = false;
                     ResponseUtils::sendSuccess(*callbackPtr, responseJson, k200OK);
                     return;
-                },
-                [=](const drogon::orm::DrogonDbException& e) {
-                    ResponseUtils::sendError(*callbackPtr, "Database error: " + std::string(e.base().what()));
-                },
-                docIdStr);
-    });
+                }
+
+                auto responsePtr = std::make_shared<Json::Value>(std::move(responseJson));
+                DocumentLoader::loadSnapshot(
+                        objectName,
+                        [=](const std::vector<char>& data) {
+                            (*responsePtr)["snapshot_base64"] = base64Encode(data);
+                            (*responsePtr)["snapshot_inlined"] = true;
+                            ResponseUtils::sendSuccess(*callbackPtr, *responsePtr, k200OK);
+                        },
+                        [=](const std::string& error) {
+                            LOG_WARN << "Bootstrap: failed to inline snapshot for doc " << docId << ": " << error;
+                            (*responsePtr)["snapshot_inlined"] = false;
+                            ResponseUtils::sendSuccess(*callbackPtr, *responsePtr, k200OK);
+                        });
+            },
+            [=](const drogon::orm::DrogonDbException& e) {
+                ResponseUtils::sendError(*callbackPtr, "Database error: " + std::string(e.base().what()),
+                                         k500InternalServerError);
+            },
+            std::to_string(docId), std::to_string(userId));
 }
 
 void CollaborationController::handleSnapshot(const HttpRequestPtr& req,
@@ -308,6 +358,7 @@ void CollaborationController::handleSnapshot(const HttpRequestPtr& req,
                                                 "updated_at = NOW()"
                                                 "WHERE id = $2::integer",
                                                 [=](const drogon::orm::Result&) {
+                                                    DocumentLoader::invalidate(std::stoi(docIdStr));
                                                     Json::Value responseJson;
                                                     responseJson["version_id"] = versionId;
                                                     responseJson["message"] = "Snapshot saved successfully";
@@ -555,6 +606,7 @@ void CollaborationController::saveSnapshotMetadata(const HttpRequestPtr& req,
                                         "updated_at = NOW()"
                                         "WHERE id = $2::integer",
                                         [=](const drogon::orm::Result&) {
+                                            DocumentLoader::invalidate(std::stoi(docIdStr));
                                             Json::Value responseJson;
                                             responseJson["version_id"] = versionId;
                                             responseJson["message"] = "Snapshot saved successfully";
@@ -626,18 +678,9 @@ void CollaborationController::downloadSnapshot(const HttpRequestPtr& req,
             return;
         }
 
-        // 4.查询文档的最新快照 URL
-        auto db = drogon::app().getDbClient();
-        if (!db) {
-            ResponseUtils::sendError(*callbackPtr, "Database not available", k500InternalServerError);
-            return;
-        }
-
-        db->execSqlAsync(
-                "SELECT dv.snapshot_url "
-                "FROM document d "
-                "LEFT JOIN document_version dv ON d.last_published_version_id = dv.id "
-                "WHERE d.id = $1",
+        // 4.查询文档的最新快照 URL（与 bootstrap 共用同一查询，并发请求合并）
+        DocumentLoader::loadPublishedVersion(
+                docId,
                 [=](const drogon::orm::Result& r) {
                     if (r.empty() || r[0]["snapshot_url"].isNull()) {
                         ResponseUtils::sendError(*callbackPtr, "Snapshot not found", k404NotFound);
@@ -647,44 +690,15 @@ void CollaborationController::downloadSnapshot(const HttpRequestPtr& req,
                     std::string minioUrl = r[0]["snapshot_url"].as<std::string>();
 
                     // 5.从 MinIO URL 中提取 objectName
-                    // URL 格式: http://localhost:9000/documents/snapshots/doc-123/filename.bin
-                    std::string objectName;
-                    size_t bucketPos = minioUrl.find("/documents/");
-                    if (bucketPos != std::string::npos) {
-                        // 提取 documents/ 之后的部分
-                        objectName = minioUrl.substr(bucketPos + 11);  // 跳过 "/documents/"
-                    } else {
-                        // 如果 URL 格式不对，尝试其他方式
-                        // 可能是相对路径或已经提取过的路径
-                        if (minioUrl.find("snapshots/") != std::string::npos) {
-                            // 已经是 snapshots/ 开头的路径
-                            objectName = minioUrl;
-                        } else {
-                            // 尝试从完整 URL 中提取
-                            size_t httpPos = minioUrl.find("://");
-                            if (httpPos != std::string::npos) {
-                                size_t pathStart = minioUrl.find('/', httpPos + 3);
-                                if (pathStart != std::string::npos) {
-                                    std::string path = minioUrl.substr(pathStart + 1);  // 跳过第一个 /
-                                    size_t bucketSlash = path.find('/');
-                                    if (bucketSlash != std::string::npos) {
-                                        objectName = path.substr(bucketSlash + 1);  // 跳过 bucket 名称
-                                    } else {
-                                        objectName = path;
-                                    }
-                                }
-                            }
-                        }
-
-                        if (objectName.empty()) {
-                            ResponseUtils::sendError(*callbackPtr, "Invalid snapshot URL format: " + minioUrl,
-                                                     k500InternalServerError);
-                            return;
-                        }
+                    std::string objectName = extractSnapshotObjectName(minioUrl);
+                    if (objectName.empty()) {
+                        ResponseUtils::sendError(*callbackPtr, "Invalid snapshot URL format: " + minioUrl,
+                                                 k500InternalServerError);
+                        return;
                     }
 
-                    // 6.从 MinIO 下载文件
-                    MinIOClient::downloadFile(
+                    // 6.从 MinIO 下载文件（对象名随版本变化，同一快照的并发下载合并为一次）
+                    DocumentLoader::loadSnapshot(
                             objectName,
                             [=](const std::vector<char>& data) {
                                 // 下载成功，返回文件内容
@@ -703,10 +717,8 @@ void CollaborationController::downloadSnapshot(const HttpRequestPtr& req,
                                                          k500InternalServerError);
                             });
                 },
-                [=](const drogon::orm::DrogonDbException& e) {
-                    ResponseUtils::sendError(*callbackPtr, "Database error: " + std::string(e.base().what()),
-                                             k500InternalServerError);
-                },
-                docIdStr);
+                [=](const std::string& error) {
+                    ResponseUtils::sendError(*callbackPtr, error, k500InternalServerError);
+                });
     });
 }
\ No newline at end of file
@@ -1,27 +1,46 @@
 #include "DocumentController.h"
 
 #include <drogon/HttpClient.h>
-#include <drogon/MultiPart.h>
 #include <drogon/drogon.h>
 #include <json/json.h>
 
+#include <algorithm>
+#include <condition_variable>
 #include <cstdlib>
 #include <ctime>
 #include <fstream>
+#include <iterator>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <numeric>
 #include <regex>
 #include <sstream>
+#include <stdexcept>
+#include <string_view>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
+#include "../repositories/StatementRegistry.h"
 #include "../repositories/VersionRepository.h"
+#include "../services/DocumentLoader.h"
+#include "../services/ExportCache.h"
+#include "../services/BatchImporter.h"
+#include "../services/ExportJobQueue.h"
 #include "../services/SearchService.h"
+#include "../utils/ArchiveReader.h"
+#include "../utils/ConfigUtils.h"
+#include "../utils/DbTransaction.h"
+#include "../utils/DbUtils.h"
 #include "../utils/DiffUtils.h"
+#include "../utils/MarkdownCodec.h"
+#include "../utils/MinIOClient.h"
+#include "../utils/MultipartStreamParser.h"
 #include "../utils/NotificationUtils.h"
 #include "../utils/PermissionUtils.h"
 #include "../utils/ResponseUtils.h"
+#include "../utils/ZipStreamWriter.h"
 
 static void queryDocumentWithTags(const drogon::orm::DbClientPtr& db, int docId,
                                   std::shared_ptr<std::function<void(const HttpResponsePtr&)>> callbackPtr);
@@ -121,6 +140,7 @@ static void buildDocumentResponse(const drogon::orm::Result& r,
 }
 
 // 辅助函数:处理标签更新
+// 同一事务内两条语句：补齐不存在的标签，再按名称取 id、删除不再需要的关联、只插入新增的关联
 static void handleUpdateTags(const drogon::orm::DbClientPtr& db, int docId, const Json::Value& json,
                              const drogon::orm::Result& docResult,
                              std::shared_ptr<std::function<void(const drogon::HttpResponsePtr&)>> callbackPtr) {
@@ -130,101 +150,59 @@ static void handleUpdateTags(const drogon::orm::DbClientPtr& db, int docId, cons
         return;
     }
 
+    // tags 不是数组时按清空处理
+    std::vector<std::string> tagNames;
+    const Json::Value& tagsJson = json["tags"];
+    if (tagsJson.isArray()) {
+        for (const auto& tag : tagsJson) {
+            tagNames.push_back(tag.asString());
+        }
+    }
     std::string docIdStr = std::to_string(docId);
-
-    // 删除旧标签关联
-    db->execSqlAsync(
-            "DELETE FROM doc_tag WHERE doc_id = $1::integer",
-            [=](const drogon::orm::Result& r) {
-                Json::Value tagsJson = json["tags"];
-                if (!tagsJson.isArray() || tagsJson.size() == 0) {
-                    // 没有新标签,查询文档（包括标签）并返回
-                    queryDocumentWithTags(db, docId, callbackPtr);
-                    return;
-                }
-
-                // 处理新标签,逐个插入
-                // 使用shared_ptr确保所有lambda共享同一个状态
-                struct TagUpdaterState {
-                    drogon::orm::DbClientPtr db;
-                    int docId;
-                    Json::Value tagsJson;
-                    std::shared_ptr<std::function<void(const HttpResponsePtr&)>> callbackPtr;
-                    int index = 0;
-                };
-
-                auto state = std::make_shared<TagUpdaterState>(TagUpdaterState{db, docId, tagsJson, callbackPtr});
-
-                // 定义递归处理函数（使用shared_ptr包装function以支持递归）
-                auto processNext = std::make_shared<std::function<void()>>();
-                *processNext = [=]() mutable {
-                    if (state->index >= int(state->tagsJson.size())) {
-                        // 所有标签处理完成,查询文档（包括标签）并返回响应
-                        queryDocumentWithTags(state->db, state->docId, state->callbackPtr);
-                        return;
-                    }
-                    std::string tagName = state->tagsJson[state->index].asString();
-                    state->index++;
-
-                    // 查找或创建标签
-                    state->db->execSqlAsync(
-                            "INSERT INTO tag (name) VALUES ($1) ON CONFLICT (name) DO UPDATE SET name = $1 "
-                            "RETURNING id, name",
-                            [=](const drogon::orm::Result& tagResult) mutable {
-                                if (!tagResult.empty()) {
-                                    int tagId = tagResult[0]["id"].as<int>();
-
-                                    // 关联文档和标签
-                                    state->db->execSqlAsync(
-                                            "INSERT INTO doc_tag (doc_id, tag_id) VALUES ($1::integer, "
-                                            "$2::integer) ON CONFLICT DO NOTHING",
-                                            [=](const drogon::orm::Result& r) mutable { (*processNext)(); },
-                                            [=](const drogon::orm::DrogonDbException& e) {
-                                                ResponseUtils::sendError(
-                                                        *(state->callbackPtr),
-                                                        "Database error: " + std::string(e.base().what()),
-                                                        k500InternalServerError);
-                                                return;
-                                            },
-                                            std::to_string(state->docId), std::to_string(tagId));
-                                } else {
-                                    (*processNext)();
-                                }
-                            },
-                            [=](const drogon::orm::DrogonDbException& e) {
-                                ResponseUtils::sendError(*(state->callbackPtr),
-                                                         "Database error: " + std::string(e.base().what()),
-                                                         k500InternalServerError);
-                                return;
-                            },
-                            tagName);
-                };
-
-                // 开始处理
-                (*processNext)();
-            },
-            [=](const drogon::orm::DrogonDbException& e) {
-                ResponseUtils::sendError(*callbackPtr, "Database error: " + std::string(e.base().what()),
-                                         k500InternalServerError);
-                return;
+    std::string namesArray = DbUtils::buildTextArrayLiteral(tagNames);
+
+    DbTransaction::begin(
+            db,
+            [=](const std::shared_ptr<DbTransaction>& tx) {
+                // 已存在的标签不写入：DO NOTHING 不产生新的行版本，也不锁住热门标签行
+                tx->exec(
+                        "INSERT INTO tag (name) "
+                        "SELECT DISTINCT btrim(name) FROM unnest($1::text[]) AS name WHERE btrim(name) <> '' "
+                        "ON CONFLICT (name) DO NOTHING",
+                        nullptr, namesArray);
+                // READ COMMITTED 下每条语句使用新快照：与上一条冲突的并发插入已提交，这里能按名称查到
+                tx->exec(
+                        "WITH wanted AS ("
+                        "   SELECT t.id FROM tag t "
+                        "   WHERE t.name IN (SELECT btrim(name) FROM unnest($2::text[]) AS name)"
+                        "), removed AS ("
+                        "   DELETE FROM doc_tag WHERE doc_id = $1::bigint AND tag_id NOT IN (SELECT id FROM wanted) "
+                        "   RETURNING tag_id"
+                        "), added AS ("
+                        "   INSERT INTO doc_tag (doc_id, tag_id) "
+                        "   SELECT $1::bigint, w.id FROM wanted w "
+                        "   WHERE NOT EXISTS "
+                        "       (SELECT 1 FROM doc_tag dt WHERE dt.doc_id = $1::bigint AND dt.tag_id = w.id) "
+                        "   ON CONFLICT DO NOTHING "
+                        "   RETURNING tag_id"
+                        ") "
+                        "SELECT (SELECT COUNT(*) FROM added) AS added, (SELECT COUNT(*) FROM removed) AS removed",
+                        nullptr, docIdStr, namesArray);
+                tx->commit([=]() { queryDocumentWithTags(db, docId, callbackPtr); });
             },
-            docIdStr);
+            [callbackPtr](const std::string& message, drogon::HttpStatusCode code) {
+                ResponseUtils::sendError(*callbackPtr, message, code);
+            });
 }
 
 // 辅助函数：查询文档（包括标签）并返回响应
 static void queryDocumentWithTags(const drogon::orm::DbClientPtr& db, int docId,
                                   std::shared_ptr<std::function<void(const HttpResponsePtr&)>> callbackPtr) {
+    // 调用方刚写入过文档，不复用写入前发起的读取
+    DocumentLoader::invalidate(docId);
     std::string docIdStr = std::to_string(docId);
     db->execSqlAsync(
-            "SELECT d.id, d.title, d.owner_id, d.is_locked, d.status, d.last_published_version_id, "
-            "       d.created_at, d.updated_at, "
-            "       COALESCE(json_agg(json_build_object('id', t.id, 'name', t.name)) "
-            "                FILTER (WHERE t.id IS NOT NULL), '[]'::json) as tags "
-            "FROM document d "
-            "LEFT JOIN doc_tag dt ON d.id = dt.doc_id "
-            "LEFT JOIN tag t ON dt.tag_id = t.id "
-            "WHERE d.id = $1::integer "
-            "GROUP BY d.id",
+            StatementRegistry::documentWithTags(),
             [=](const drogon::orm::Result& r) {
                 if (r.empty()) {
                     ResponseUtils::sendError(*callbackPtr, "Document not found", k404NotFound);
@@ -437,6 +415,30 @@ void DocumentController::list(const HttpRequestPtr& req, std::function<void(cons
     int pageSize = parseIntParam("pageSize", 1, 100, 20);
     int offset = (page - 1) * pageSize;
 
+    // 游标分页：cursor 为上一页返回的 next_cursor（格式 "<updated_at 微秒时间戳>_<id>"）
+    std::string cursor = req->getParameter("cursor");
+    std::string cursorUpdatedUs;
+    std::string cursorId;
+    if (!cursor.empty()) {
+        size_t sep = cursor.find('_');
+        try {
+            if (sep == std::string::npos) throw std::invalid_argument("cursor");
+            cursorUpdatedUs = std::to_string(std::stoll(cursor.substr(0, sep)));
+            cursorId = std::to_string(std::stoll(cursor.substr(sep + 1)));
+        } catch (...) {
+            ResponseUtils::sendError(callback, "Invalid cursor", k400BadRequest);
+            return;
+        }
+    }
+    bool useCursor = !cursorId.empty();
+
+    // 总数模式：exact 精确计数 / estimate 最多计到上限 / none 不计数。
+    // 页码模式默认 exact 以兼容旧客户端，游标模式默认 none
+    std::string totalMode = req->getParameter("total");
+    if (totalMode != "exact" && totalMode != "estimate" && totalMode != "none") {
+        totalMode = useCursor ? "none" : "exact";
+    }
+
     // 获取状态筛选参数
     // 尝试多种方式获取参数
     std::string statusFilter = req->getParameter("status");
@@ -472,36 +474,25 @@ void DocumentController::list(const HttpRequestPtr& req, std::function<void(cons
     }
     auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr&)>>(std::move(callback));
 
-    // 构建WHERE子句
-    std::string baseWhere = "WHERE (d.owner_id = $1::integer OR a.user_id = $1::integer)";
-    std::string statusWhere = "";
-    if (hasStatusFilter) {
-        // 使用文本类型进行字符串比较
-        statusWhere = " AND d.status = $2::text";
-    }
+    // 可见文档来自 user_doc_access（owner 与 ACL 合并、由触发器维护），
+    // 按 (user_id, updated_at, doc_id) 索引范围扫描，深分页与第一页代价相同。
+    // 列表与计数都取自固定形态的语句，每条连接上只需准备一次
+    const std::string& listSql = StatementRegistry::documentList(hasStatusFilter, useCursor);
+    const std::string& countSql = StatementRegistry::documentCount(hasStatusFilter, totalMode == "estimate");
+    constexpr int kEstimateCap = StatementRegistry::kDocumentCountEstimateCap;
 
-    // 查询总和和列表
-    std::string countSql =
-            "SELECT COUNT(DISTINCT d.id) as total "
-            "FROM document d "
-            "LEFT JOIN doc_acl a ON d.id = a.doc_id " +
-            baseWhere + statusWhere;
+    // 游标模式不使用 offset；多取一条用于判断是否还有下一页
+    int effectiveOffset = useCursor ? 0 : offset;
+    std::string limitStr = std::to_string(pageSize + 1);
+    std::string offsetStr = std::to_string(effectiveOffset);
 
-    std::string listSql =
-            "SELECT DISTINCT d.id, d.title, d.owner_id, d.is_locked, d.status, d.created_at, d.updated_at "
-            "FROM document d "
-            "LEFT JOIN doc_acl a ON d.id = a.doc_id " +
-            baseWhere + statusWhere +
-            " ORDER BY d.updated_at DESC "
-            "LIMIT $" +
-            std::to_string(hasStatusFilter ? 3 : 2) + "::integer OFFSET $" + std::to_string(hasStatusFilter ? 4 : 3) +
-            "::integer";
-
-    // 执行查询的回调函数
+    // 执行查询的回调函数（total < 0 表示未计数）
     auto processListResult = [=](const drogon::orm::Result& listResult, int total) {
         Json::Value responseJson;
         Json::Value docsArray(Json::arrayValue);
-        for (const auto& row : listResult) {
+        size_t count = std::min(listResult.size(), static_cast<size_t>(pageSize));
+        for (size_t i = 0; i < count; ++i) {
+            const auto& row = listResult[i];
             Json::Value docJson;
             docJson["id"] = row["id"].as<int>();
             docJson["title"] = row["title"].as<std::string>();
@@ -519,8 +510,25 @@ void DocumentController::list(const HttpRequestPtr& req, std::function<void(cons
             docsArray.append(docJson);
         }
 
+        bool hasMore = listResult.size() > static_cast<size_t>(pageSize);
         responseJson["docs"] = docsArray;
-        responseJson["total"] = total;
+        responseJson["has_more"] = hasMore;
+        if (hasMore && count > 0) {
+            const auto& last = listResult[count - 1];
+            responseJson["next_cursor"] =
+                    std::to_string(last["updated_us"].as<int64_t>()) + "_" + std::to_string(last["id"].as<int64_t>());
+        } else {
+            responseJson["next_cursor"] = Json::nullValue;
+        }
+        if (total >= 0) {
+            if (totalMode == "estimate" && total > kEstimateCap) {
+                responseJson["total"] = kEstimateCap;
+                responseJson["total_is_estimate"] = true;
+            } else {
+                responseJson["total"] = total;
+                responseJson["total_is_estimate"] = false;
+            }
+        }
         responseJson["page"] = page;
         responseJson["pageSize"] = pageSize;
 
@@ -532,33 +540,34 @@ void DocumentController::list(const HttpRequestPtr& req, std::function<void(cons
                                  k500InternalServerError);
     };
 
-    // 执行查询
+    // 查询列表（参数个数随状态筛选、游标变化）
+    auto runList = [=](int total) {
+        auto onList = [=](const drogon::orm::Result& listResult) { processListResult(listResult, total); };
+        if (hasStatusFilter && useCursor) {
+            db->execSqlAsync(listSql, onList, errorCallback, userIdStr, statusFilter, cursorUpdatedUs, cursorId,
+                             limitStr, offsetStr);
+        } else if (hasStatusFilter) {
+            db->execSqlAsync(listSql, onList, errorCallback, userIdStr, statusFilter, limitStr, offsetStr);
+        } else if (useCursor) {
+            db->execSqlAsync(listSql, onList, errorCallback, userIdStr, cursorUpdatedUs, cursorId, limitStr,
+                             offsetStr);
+        } else {
+            db->execSqlAsync(listSql, onList, errorCallback, userIdStr, limitStr, offsetStr);
+        }
+    };
+
+    if (totalMode == "none") {
+        runList(-1);
+        return;
+    }
+
+    auto onCount = [=](const drogon::orm::Result& countResult) {
+        runList(countResult.empty() ? 0 : countResult[0]["total"].as<int>());
+    };
     if (hasStatusFilter) {
-        db->execSqlAsync(
-                countSql,
-                [=](const drogon::orm::Result& countResult) mutable {
-                    int total = countResult.empty() ? 0 : countResult[0]["total"].as<int>();
-                    db->execSqlAsync(
-                            listSql,
-                            [=](const drogon::orm::Result& listResult) mutable {
-                                processListResult(listResult, total);
-                            },
-                            errorCallback, userIdStr, statusFilter, std::to_string(pageSize), std::to_string(offset));
-                },
-                errorCallback, userIdStr, statusFilter);
+        db->execSqlAsync(countSql, onCount, errorCallback, userIdStr, statusFilter);
     } else {
-        db->execSqlAsync(
-                countSql,
-                [=](const drogon::orm::Result& countResult) mutable {
-                    int total = countResult.empty() ? 0 : countResult[0]["total"].as<int>();
-                    db->execSqlAsync(
-                            listSql,
-                            [=](const drogon::orm::Result& listResult) mutable {
-                                processListResult(listResult, total);
-                            },
-                            errorCallback, userIdStr, std::to_string(pageSize), std::to_string(offset));
-                },
-                errorCallback, userIdStr);
+        db->execSqlAsync(countSql, onCount, errorCallback, userIdStr);
     }
 }
 
@@ -572,8 +581,9 @@ void DocumentController::get(const HttpRequestPtr& req, std::function<void(const
     }
     std::string docIdStr = routingParams[0];
     // 验证 docId 是否为有效数字
+    int docId;
     try {
-        std::stoi(docIdStr);
+        docId = std::stoi(docIdStr);
     } catch (...) {
         ResponseUtils::sendError(callback, "Invalid document ID", k400BadRequest);
         return;
@@ -603,16 +613,9 @@ void DocumentController::get(const HttpRequestPtr& req, std::function<void(const
 
     auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr&)>>(std::move(callback));
 
-    db->execSqlAsync(
-            "SELECT d.id, d.title, d.owner_id, d.is_locked, d.status, d.last_published_version_id, "
-            "       d.created_at, d.updated_at, "
-            "       COALESCE(json_agg(json_build_object('id', t.id, 'name', t.name)) "
-            "                FILTER (WHERE t.id IS NOT NULL), '[]'::json) as tags "
-            "FROM document d "
-            "LEFT JOIN doc_tag dt ON d.id = dt.doc_id "
-            "LEFT JOIN tag t ON dt.tag_id = t.id "
-            "WHERE d.id = $1::integer "
-            "GROUP BY d.id",
+    // 同一文档的并发读取合并为一次查询
+    DocumentLoader::loadDocument(
+            docId,
             [=](const drogon::orm::Result& r) {
                 if (r.empty()) {
                     ResponseUtils::sendError(*callbackPtr, "Document not found", k404NotFound);
@@ -622,9 +625,9 @@ void DocumentController::get(const HttpRequestPtr& req, std::function<void(const
                 // 检查权限（简单检查：owner 或 ACL 中存在）
                 int ownerId = r[0]["owner_id"].as<int>();
                 if (ownerId != userId) {
-                    // 检查 ACL
+                    // 检查可访问文档索引
                     db->execSqlAsync(
-                            "SELECT 1 FROM doc_acl WHERE doc_id = $1::integer AND user_id = $2::integer",
+                            StatementRegistry::docAccessExists(),
                             [=](const drogon::orm::Result& aclResult) {
                                 if (aclResult.empty()) {
                                     ResponseUtils::sendError(*callbackPtr, "Forbidden", k403Forbidden);
@@ -642,11 +645,7 @@ void DocumentController::get(const HttpRequestPtr& req, std::function<void(const
                     buildDocumentResponse(r, callbackPtr);
                 }
             },
-            [=](const drogon::orm::DrogonDbException& e) {
-                ResponseUtils::sendError(*callbackPtr, "Database error: " + std::string(e.base().what()),
-                                         k500InternalServerError);
-            },
-            docIdStr);
+            [=](const std::string& error) { ResponseUtils::sendError(*callbackPtr, error, k500InternalServerError); });
 }
 
 void DocumentController::update(const drogon::HttpRequestPtr& req,
@@ -866,43 +865,44 @@ void DocumentController::deleteDoc(const HttpRequestPtr& req, std::function<void
         return;
     }
 
-    // 3.检查权限(必须是owner)
+    // 3.删除文档：owner 校验与删除合并为一条语句，一次往返即可区分 404 / 403
+    auto db = drogon::app().getDbClient();
+    if (!db) {
+        ResponseUtils::sendError(callback, "Database not available", k500InternalServerError);
+        return;
+    }
     auto callbackPtr = std::make_shared<std::function<void(const drogon::HttpResponsePtr&)>>(std::move(callback));
-    PermissionUtils::hasPermission(docId, userId, "owner", [=](bool hasPermission) {
-        if (!hasPermission) {
-            ResponseUtils::sendError(*callbackPtr, "Forbidden: Only owner can delete document", k403Forbidden);
-            return;
-        }
-
-        // 4.删除文档
-        auto db = drogon::app().getDbClient();
-        if (!db) {
-            ResponseUtils::sendError(*callbackPtr, "Database not available", k500InternalServerError);
-            return;
-        }
-        db->execSqlAsync(
-                "DELETE FROM document WHERE id = $1::integer AND owner_id = $2::integer",
-                [=](const drogon::orm::Result& r) {
-                    // 检查是否真的删除了文档
-                    if (r.affectedRows() == 0) {
-                        ResponseUtils::sendError(*callbackPtr, "Document not found or you are not the owner",
-                                                 k404NotFound);
-                        return;
-                    }
-                    // 从搜索索引中删除文档
-                    SearchService::deleteDocument(docId);
-                    // 返回成功删除的响应
-                    Json::Value responseJson;
-                    responseJson["message"] = "Document deleted successfully";
-                    responseJson["id"] = docId;
-                    ResponseUtils::sendSuccess(*callbackPtr, responseJson, k200OK);
-                },
-                [=](const drogon::orm::DrogonDbException& e) {
-                    ResponseUtils::sendError(*callbackPtr, "Database error: " + std::string(e.base().what()),
-                                             k500InternalServerError);
-                },
-                docIdStr, userIdStr);
-    });
+    db->execSqlAsync(
+            "WITH target AS ("
+            "   SELECT owner_id FROM document WHERE id = $1::bigint"
+            "), del AS ("
+            "   DELETE FROM document WHERE id = $1::bigint AND owner_id = $2::bigint RETURNING id"
+            ") "
+            "SELECT (SELECT owner_id FROM target) AS owner_id, EXISTS (SELECT 1 FROM del) AS deleted",
+            [=](const drogon::orm::Result& r) {
+                if (r.empty() || r[0]["owner_id"].isNull()) {
+                    ResponseUtils::sendError(*callbackPtr, "Document not found", k404NotFound);
+                    return;
+                }
+                if (!r[0]["deleted"].as<bool>()) {
+                    ResponseUtils::sendError(*callbackPtr, "Forbidden: Only owner can delete document",
+                                             k403Forbidden);
+                    return;
+                }
+                DocumentLoader::invalidate(docId);
+                // 从搜索索引中删除文档
+                SearchService::deleteDocument(docId);
+                // 返回成功删除的响应
+                Json::Value responseJson;
+                responseJson["message"] = "Document deleted successfully";
+                responseJson["id"] = docId;
+                ResponseUtils::sendSuccess(*callbackPtr, responseJson, k200OK);
+            },
+            [=](const drogon::orm::DrogonDbException& e) {
+                ResponseUtils::sendError(*callbackPtr, "Database error: " + std::string(e.base().what()),
+                                         k500InternalServerError);
+            },
+            docIdStr, std::to_string(userId));
 }
 
 void DocumentController::getAcl(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback) {
@@ -987,12 +987,47 @@ void DocumentController::updateAcl(const HttpRequestPtr& req, std::function<void
         ResponseUtils::sendError(callback, "Invalid JSON", k400BadRequest);
         return;
     }
-    Json::Value json = *jsonPtr;
+    const Json::Value& json = *jsonPtr;
     if (!json.isMember("acl") || !json["acl"].isArray()) {
         ResponseUtils::sendError(callback, "acl array is required", k400BadRequest);
         return;
     }
 
+    // 4.校验 ACL 条目（在权限检查前完成，避免闭包中复制整个请求 JSON）
+    std::vector<int64_t> aclUserIds;
+    std::vector<std::string> aclPermissions;
+    std::unordered_map<int, std::string> newAclMap;
+    for (const auto& item : json["acl"]) {
+        if (!item.isMember("user_id") || !item.isMember("permission")) {
+            ResponseUtils::sendError(callback, "Invalid ACL item: user_id and permission are required",
+                                     k400BadRequest);
+            return;
+        }
+        int aclUserId;
+        try {
+            aclUserId = item["user_id"].asInt();
+        } catch (...) {
+            ResponseUtils::sendError(callback, "Invalid user_id in ACL item", k400BadRequest);
+            return;
+        }
+        if (aclUserId == userId) {
+            ResponseUtils::sendError(callback, "Owner permission cannot be modified", k400BadRequest);
+            return;
+        }
+        std::string permission = item["permission"].asString();
+        if (permission != "viewer" && permission != "editor") {
+            ResponseUtils::sendError(callback, "Invalid permission: must be 'viewer' or 'editor'", k400BadRequest);
+            return;
+        }
+        aclUserIds.push_back(aclUserId);
+        aclPermissions.push_back(permission);
+        newAclMap[aclUserId] = permission;
+    }
+    bool hasAclItems = !aclUserIds.empty();
+    std::string userIdArray = DbUtils::buildIntArrayLiteral(aclUserIds);
+    std::string permissionArray = DbUtils::buildTextArrayLiteral(aclPermissions);
+    auto newAclMapPtr = std::make_shared<const std::unordered_map<int, std::string>>(std::move(newAclMap));
+
     auto db = drogon::app().getDbClient();
     if (!db) {
         ResponseUtils::sendError(callback, "Database not available", k500InternalServerError);
@@ -1001,123 +1036,55 @@ void DocumentController::updateAcl(const HttpRequestPtr& req, std::function<void
 
     auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr&)>>(std::move(callback));
 
-    // 4.验证当前用户是 owner
+    // 5.验证当前用户是 owner
     PermissionUtils::hasPermission(docId, userId, "owner", [=](bool hasPermission) {
         if (!hasPermission) {
             ResponseUtils::sendError(*callbackPtr, "Only document owner can update ACL", k403Forbidden);
             return;
         }
 
-        Json::Value aclArray = json["acl"];
-        std::vector<std::pair<int, std::string>> aclItems;
-        aclItems.reserve(aclArray.size());
-        std::unordered_map<int, std::string> newAclMap;
-
-        for (const auto& item : aclArray) {
-            if (!item.isMember("user_id") || !item.isMember("permission")) {
-                ResponseUtils::sendError(*callbackPtr, "Invalid ACL item: user_id and permission are required",
-                                         k400BadRequest);
-                return;
-            }
-            int aclUserId;
-            try {
-                aclUserId = item["user_id"].asInt();
-            } catch (...) {
-                ResponseUtils::sendError(*callbackPtr, "Invalid user_id in ACL item", k400BadRequest);
-                return;
-            }
-            if (aclUserId == userId) {
-                ResponseUtils::sendError(*callbackPtr, "Owner permission cannot be modified", k400BadRequest);
-                return;
-            }
-            std::string permission = item["permission"].asString();
-            if (permission != "viewer" && permission != "editor") {
-                ResponseUtils::sendError(*callbackPtr, "Invalid permission: must be 'viewer' or 'editor'",
-                                         k400BadRequest);
-                return;
-            }
-            aclItems.emplace_back(aclUserId, permission);
-            newAclMap[aclUserId] = permission;
-        }
-
-        auto errorHandler = [=](const drogon::orm::DrogonDbException& e) {
-            ResponseUtils::sendError(*callbackPtr, "Database error: " + std::string(e.base().what()),
-                                     k500InternalServerError);
-        };
-
-        auto fetchAcl = [=]() { queryAclAndRespond(db, docId, userId, callbackPtr); };
-
-        auto previousAclMapPtr = std::make_shared<std::unordered_map<int, std::string>>();
-        auto newAclMapPtr = std::make_shared<std::unordered_map<int, std::string>>(std::move(newAclMap));
-
-        auto notifyPermissionChanges = [=](const std::unordered_map<int, std::string>& previousAcl) {
-            for (const auto& entry : *newAclMapPtr) {
-                auto it = previousAcl.find(entry.first);
-                if (it == previousAcl.end() || it->second != entry.second) {
-                    NotificationUtils::createPermissionChangeNotification(docId, entry.first, entry.second);
-                }
-            }
-        };
-
-        auto applyAclChanges = [=](const std::shared_ptr<std::unordered_map<int, std::string>>& previousAcl) {
-            db->execSqlAsync(
-                    "DELETE FROM doc_acl WHERE doc_id = $1::bigint AND permission != 'owner'",
-                    [=](const drogon::orm::Result&) {
-                        if (aclItems.empty()) {
-                            fetchAcl();
-                            return;
-                        }
-
-                        auto buildIntArray = [](const std::vector<std::pair<int, std::string>>& items) {
-                            std::ostringstream oss;
-                            oss << "{";
-                            for (size_t i = 0; i < items.size(); ++i) {
-                                if (i > 0) {
-                                    oss << ",";
-                                }
-                                oss << items[i].first;
-                            }
-                            oss << "}";
-                            return oss.str();
-                        };
-
-                        auto buildTextArray = [](const std::vector<std::pair<int, std::string>>& items) {
-                            std::ostringstream oss;
-                            oss << "{";
-                            for (size_t i = 0; i < items.size(); ++i) {
-                                if (i > 0) {
-                                    oss << ",";
+        // 6.在同一事务中读取旧 ACL、删除并写入新 ACL；语句一次性排队，流水线执行
+        DbTransaction::begin(
+                db,
+                [=](const std::shared_ptr<DbTransaction>& tx) {
+                    auto previousAcl = std::make_shared<std::unordered_map<int, std::string>>();
+                    // 先锁文档行：没有非 owner 的 ACL 行时 FOR UPDATE 锁不到任何行，
+                    // 并发的两次更新都会插入同一批行，后提交的一方撞上 doc_acl 主键
+                    tx->exec("SELECT 1 FROM document WHERE id = $1::bigint FOR UPDATE", nullptr, docIdStr);
+                    tx->exec(
+                            "SELECT user_id, permission FROM doc_acl "
+                            "WHERE doc_id = $1::bigint AND permission != 'owner'",
+                            [previousAcl](const drogon::orm::Result& r) {
+                                for (const auto& row : r) {
+                                    (*previousAcl)[row["user_id"].as<int>()] = row["permission"].as<std::string>();
                                 }
-                                oss << "\"" << items[i].second << "\"";
-                            }
-                            oss << "}";
-                            return oss.str();
-                        };
-
-                        std::string userIdArray = buildIntArray(aclItems);
-                        std::string permissionArray = buildTextArray(aclItems);
-
-                        db->execSqlAsync(
+                            },
+                            docIdStr);
+                    tx->exec("DELETE FROM doc_acl WHERE doc_id = $1::bigint AND permission != 'owner'", nullptr,
+                             docIdStr);
+                    if (hasAclItems) {
+                        tx->exec(
                                 "INSERT INTO doc_acl (doc_id, user_id, permission) "
                                 "SELECT $1::bigint, unnest($2::bigint[]), unnest($3::varchar[])",
-                                [=](const drogon::orm::Result&) {
-                                    notifyPermissionChanges(*previousAcl);
-                                    fetchAcl();
-                                },
-                                errorHandler, docIdStr, userIdArray, permissionArray);
-                    },
-                    errorHandler, docIdStr);
-        };
-
-        db->execSqlAsync(
-                "SELECT user_id, permission FROM doc_acl WHERE doc_id = $1::bigint AND permission != 'owner'",
-                [=](const drogon::orm::Result& currentAcl) {
-                    for (const auto& row : currentAcl) {
-                        (*previousAclMapPtr)[row["user_id"].as<int>()] = row["permission"].as<std::string>();
+                                nullptr, docIdStr, userIdArray, permissionArray);
                     }
-                    applyAclChanges(previousAclMapPtr);
+                    tx->commit([=]() {
+                        // 提交后再发送权限变更通知
+                        for (const auto& entry : *newAclMapPtr) {
+                            auto it = previousAcl->find(entry.first);
+                            if (it == previousAcl->end() || it->second != entry.second) {
+                                NotificationUtils::createPermissionChangeNotification(docId, entry.first,
+                                                                                      entry.second);
+                            }
+                        }
+                        // 同步搜索索引中的可访问用户
+                        SearchService::updateDocumentAcl(docId);
+                        queryAclAndRespond(db, docId, userId, callbackPtr);
+                    });
                 },
-                [=](const drogon::orm::DrogonDbException& e) { errorHandler(e); }, docIdStr);
+                [callbackPtr](const std::string& message, drogon::HttpStatusCode code) {
+                    ResponseUtils::sendError(*callbackPtr, message, code);
+                });
     });
 }
 
@@ -1660,6 +1627,7 @@ void DocumentController::createVersion(const HttpRequestPtr& req,
         VersionRepository::insertVersion(
                 db, params,
                 [=](int versionId, int versionNumber) {
+                    DocumentLoader::invalidate(docId);
                     Json::Value responseJson;
                     responseJson["version_id"] = versionId;
                     responseJson["version_number"] = versionNumber;
@@ -1713,7 +1681,7 @@ void DocumentController::restoreVersion(const HttpRequestPtr& req,
             return;
         }
 
-        // 4. 验证版本存在且属于该文档
+        // 4. 复制目标版本为新版本并设为当前版本：单条语句完成，快照与正文不经过应用层
         auto db = drogon::app().getDbClient();
         if (!db) {
             ResponseUtils::sendError(*callbackPtr, "Database not available", k500InternalServerError);
@@ -1721,77 +1689,46 @@ void DocumentController::restoreVersion(const HttpRequestPtr& req,
         }
 
         db->execSqlAsync(
-                "SELECT snapshot_url, snapshot_sha256, size_bytes, content_text, content_html "
-                "FROM document_version "
-                "WHERE id = $1::bigint AND doc_id = $2::bigint",
+                "WITH src AS ("
+                "   SELECT snapshot_url, snapshot_sha256, size_bytes, content_text, content_html "
+                "   FROM document_version WHERE id = $2::bigint AND doc_id = $1::bigint"
+                "), ins AS ("
+                "   INSERT INTO document_version "
+                "   (doc_id, version_number, snapshot_url, snapshot_sha256, size_bytes, created_by, change_summary, "
+                "    source, content_text, content_html) "
+                "   SELECT $1::bigint, "
+                "          (SELECT COALESCE(MAX(version_number), 0) + 1 FROM document_version WHERE doc_id = "
+                "$1::bigint), "
+                "          src.snapshot_url, src.snapshot_sha256, src.size_bytes, $3::integer, $4, 'restore', "
+                "          src.content_text, src.content_html "
+                "   FROM src "
+                "   RETURNING id, version_number"
+                "), upd AS ("
+                "   UPDATE document SET last_published_version_id = ins.id, updated_at = NOW() "
+                "   FROM ins WHERE document.id = $1::bigint"
+                ") "
+                "SELECT id, version_number FROM ins",
                 [=](const drogon::orm::Result& r) {
                     if (r.empty()) {
                         ResponseUtils::sendError(*callbackPtr, "Version not found", k404NotFound);
                         return;
                     }
-
-                    const auto& row = r[0];
-                    std::string snapshotUrl = row["snapshot_url"].as<std::string>();
-                    std::string sha256 = row["snapshot_sha256"].as<std::string>();
-                    int64_t sizeBytes = row["size_bytes"].as<int64_t>();
-                    std::string contentText = row["content_text"].isNull() ? "" : row["content_text"].as<std::string>();
-                    std::string contentHtml = row["content_html"].isNull() ? "" : row["content_html"].as<std::string>();
-
-                    // 5. 创建新版本记录（标记为 restore 来源）
-                    VersionInsertParams params;
-                    params.docId = docId;
-                    params.creatorId = userId;
-                    params.snapshotUrl = snapshotUrl;
-                    params.snapshotSha256 = sha256;
-                    params.sizeBytes = sizeBytes;
-                    params.changeSummary = "Restored from version " + std::to_string(versionId);
-                    params.source = "restore";
-                    params.contentText = contentText;
-                    params.contentHtml = contentHtml;
-
-                    VersionRepository::insertVersion(
-                            db, params,
-                            [=](int newVersionId, int newVersionNumber) {
-                                // 更新文档的 last_published_version_id，使恢复的版本成为当前版本
-                                db->execSqlAsync(
-                                        "UPDATE document SET last_published_version_id = $1::bigint, updated_at = "
-                                        "NOW() "
-                                        "WHERE id = $2::bigint",
-                                        [=](const drogon::orm::Result&) {
-                                            Json::Value responseJson;
-                                            responseJson["version_id"] = newVersionId;
-                                            responseJson["version_number"] = newVersionNumber;
-                                            responseJson["doc_id"] = docId;
-                                            responseJson["restored_from_version_id"] = versionId;
-                                            responseJson["message"] =
-                                                    "Version restored successfully. Document content will be "
-                                                    "updated "
-                                                    "on next load.";
-                                            ResponseUtils::sendSuccess(*callbackPtr, responseJson, k201Created);
-                                        },
-                                        [=](const drogon::orm::DrogonDbException& e) {
-                                            // 即使更新失败，版本已创建，返回成功但提示需要刷新
-                                            Json::Value responseJson;
-                                            responseJson["version_id"] = newVersionId;
-                                            responseJson["version_number"] = newVersionNumber;
-                                            responseJson["doc_id"] = docId;
-                                            responseJson["restored_from_version_id"] = versionId;
-                                            responseJson["message"] =
-                                                    "Version restored successfully, but failed to update document "
-                                                    "reference. Please refresh the document.";
-                                            ResponseUtils::sendSuccess(*callbackPtr, responseJson, k201Created);
-                                        },
-                                        std::to_string(newVersionId), std::to_string(docId));
-                            },
-                            [=](const std::string& message, drogon::HttpStatusCode code) {
-                                ResponseUtils::sendError(*callbackPtr, message, code);
-                            });
+                    DocumentLoader::invalidate(docId);
+                    Json::Value responseJson;
+                    responseJson["version_id"] = r[0]["id"].as<int>();
+                    responseJson["version_number"] = r[0]["version_number"].as<int>();
+                    responseJson["doc_id"] = docId;
+                    responseJson["restored_from_version_id"] = versionId;
+                    responseJson["message"] =
+                            "Version restored successfully. Document content will be updated on next load.";
+                    ResponseUtils::sendSuccess(*callbackPtr, responseJson, k201Created);
                 },
                 [=](const drogon::orm::DrogonDbException& e) {
                     ResponseUtils::sendError(*callbackPtr, "Database error: " + std::string(e.base().what()),
                                              k500InternalServerError);
                 },
-                std::to_string(versionId), std::to_string(docId));
+                std::to_string(docId), std::to_string(versionId), std::to_string(userId),
+                "Restored from version " + std::to_string(versionId));
     });
 }
 
@@ -1943,23 +1880,64 @@ void DocumentController::getVersionDiff(const HttpRequestPtr& req,
 
 // 辅助函数：从配置文件获取 doc-converter-service URL
 static std::string getConverterServiceUrl() {
-    std::ifstream configFile("config.json");
-    if (!configFile.is_open()) {
-        configFile.open("../config.json");
-        if (!configFile.is_open()) {
-            return "http://localhost:3002";  // 默认值
-        }
-    }
+    return ConfigUtils::getValue("doc_converter_url", "http://localhost:3002");
+}
 
-    Json::Value config;
-    Json::Reader reader;
-    if (reader.parse(configFile, config) && config.isMember("app")) {
-        if (config["app"].isMember("doc_converter_url")) {
-            return config["app"]["doc_converter_url"].asString();
+namespace {
+// 单个导入文件的大小上限
+constexpr size_t kImportMaxBytes = 50 * 1024 * 1024;
+// 单个导入生成的 HTML 上限（单请求内存上限）
+constexpr size_t kImportMaxHtmlBytes = 2 * kImportMaxBytes;
+// 每次交给 multipart 解析器的字节数
+constexpr size_t kImportChunkBytes = 64 * 1024;
+// 批量导入归档的条目数与解压后总大小上限
+constexpr size_t kBatchImportMaxFiles = 5000;
+constexpr uint64_t kBatchImportMaxBytes = 512ULL * 1024 * 1024;
+
+// 导入内存预算：所有进行中的导入按预计占用预留内存（单文件导入按请求体大小，批量导入按单批大小），
+// 总量不超过 app.import_memory_budget_mb。
+// 至少允许一个导入进行，避免单个大文件永远无法导入。
+class ImportBudget {
+public:
+    static std::shared_ptr<ImportBudget> reserve(size_t bytes) {
+        static const size_t budget = loadBudget();
+        std::lock_guard<std::mutex> lock(mutex());
+        size_t& used = inUse();
+        if (used > 0 && used + bytes > budget) return nullptr;
+        used += bytes;
+        return std::shared_ptr<ImportBudget>(new ImportBudget(bytes));
+    }
+
+    ~ImportBudget() {
+        std::lock_guard<std::mutex> lock(mutex());
+        inUse() -= bytes_;
+    }
+
+private:
+    explicit ImportBudget(size_t bytes) : bytes_(bytes) {}
+
+    static std::mutex& mutex() {
+        static std::mutex m;
+        return m;
+    }
+    static size_t& inUse() {
+        static size_t used = 0;
+        return used;
+    }
+    static size_t loadBudget() {
+        size_t megabytes = 256;
+        try {
+            long value = std::stol(ConfigUtils::getValue("import_memory_budget_mb", "256"));
+            if (value > 0) megabytes = static_cast<size_t>(value);
+        } catch (...) {
+            // 保持默认值
         }
+        return megabytes * 1024 * 1024;
     }
-    return "http://localhost:3002";  // 默认值
-}
+
+    size_t bytes_;
+};
+}  // namespace
 
 // Markdown 文档导入（支持文件上传和 JSON 文本两种方式）
 void DocumentController::importMarkdown(const HttpRequestPtr& req,
@@ -1971,36 +1949,96 @@ void DocumentController::importMarkdown(const HttpRequestPtr& req,
     }
     int userId = std::stoi(userIdStr);
 
-    std::string markdown;
     std::string title;
+    // HTML 只保留一份，后续回调共享
+    auto html = std::make_shared<std::string>();
+    // 索引正文在提交后才生成，避免整个导入期间多持有一份原文
+    std::function<std::string()> indexContent;
+
+    std::string boundary = MultipartStreamParser::boundaryFrom(req->getHeader("content-type"));
+    if (!boundary.empty()) {
+        // 文件上传方式：请求体超过 client_max_memory_body_size 时由 Drogon 落盘并映射，
+        // 这里按块解析，只有文件部分的正文会被逐段渲染为 HTML，其余部分直接跳过
+        std::string_view body = req->body();
+        if (body.size() > kImportMaxBytes + kImportChunkBytes) {
+            ResponseUtils::sendError(callback, "File size exceeds 50MB limit", k400BadRequest);
+            return;
+        }
+        // 预留 HTML（约为原文两倍）与索引正文
+        auto reservation = ImportBudget::reserve(body.size() * 3);
+        if (!reservation) {
+            ResponseUtils::sendError(callback, "Too many imports in progress, please retry later",
+                                     k503ServiceUnavailable);
+            return;
+        }
 
-    // 检查是否是文件上传（multipart/form-data）
-    drogon::MultiPartParser parser;
-    bool isFileUpload = (parser.parse(req) == 0 && !parser.getFiles().empty());
-
-    if (isFileUpload) {
-        // 文件上传方式
-        const auto& files = parser.getFiles();
-        const auto& file = files.front();
-
-        // 验证文件类型
-        std::string fileName = file.getFileName();
-        if (fileName.find(".md") == std::string::npos && fileName.find(".markdown") == std::string::npos) {
-            ResponseUtils::sendError(callback, "Invalid file type. Please upload a .md or .markdown file",
+        MarkdownStreamRenderer renderer;
+        bool sawFile = false;
+        bool inFile = false;
+        std::string fileName;
+        uint64_t fileOffset = 0;
+        size_t fileLength = 0;
+        std::string error;
+
+        MultipartStreamParser parser(
+                boundary,
+                [&](const MultipartStreamParser::PartInfo& part) {
+                    inFile = false;
+                    if (sawFile || part.filename.empty()) return true;  // 只处理第一个文件
+                    // 验证文件类型
+                    if (part.filename.find(".md") == std::string::npos &&
+                        part.filename.find(".markdown") == std::string::npos) {
+                        error = "Invalid file type. Please upload a .md or .markdown file";
+                        return false;
+                    }
+                    sawFile = inFile = true;
+                    fileName = part.filename;
+                    fileOffset = part.dataOffset;
+                    return true;
+                },
+                [&](const char* data, size_t length) {
+                    if (!inFile) return true;
+                    fileLength += length;
+                    if (fileLength > kImportMaxBytes) {
+                        error = "File size exceeds 50MB limit";
+                        return false;
+                    }
+                    // 第一遍只收集链接引用定义，定义可以出现在使用之后
+                    renderer.collect(data, length);
+                    return true;
+                },
+                [&]() {
+                    if (inFile) renderer.endCollect();
+                    inFile = false;
+                    return true;
+                });
+        for (size_t offset = 0; offset < body.size(); offset += kImportChunkBytes) {
+            if (!parser.feed(body.data() + offset, std::min(kImportChunkBytes, body.size() - offset))) break;
+        }
+        if (!error.empty()) {
+            ResponseUtils::sendError(callback, error, k400BadRequest);
+            return;
+        }
+        if (!parser.done() || !sawFile) {
+            ResponseUtils::sendError(callback,
+                                     "Invalid request. Please provide markdown content in JSON or upload a .md file",
                                      k400BadRequest);
             return;
         }
-
-        // 检查文件大小（50MB限制）
-        size_t fileSize = file.fileLength();
-        if (fileSize > 50 * 1024 * 1024) {
-            ResponseUtils::sendError(callback, "File size exceeds 50MB limit", k400BadRequest);
+        if (fileLength == 0) {
+            ResponseUtils::sendError(callback, "Markdown content is empty", k400BadRequest);
             return;
         }
-
-        // 读取文件内容
-        const char* fileData = file.fileData();
-        markdown = std::string(fileData, fileSize);
+        // 第二遍：文件正文仍在请求体中，逐块渲染为 HTML
+        std::string_view file = body.substr(fileOffset, fileLength);
+        for (size_t offset = 0; offset < file.size(); offset += kImportChunkBytes) {
+            renderer.feed(file.data() + offset, std::min(kImportChunkBytes, file.size() - offset), *html);
+            if (html->size() > kImportMaxHtmlBytes) {
+                ResponseUtils::sendError(callback, "Converted document is too large", k413RequestEntityTooLarge);
+                return;
+            }
+        }
+        renderer.finish(*html);
 
         // 从文件名提取标题（去掉扩展名）
         title = fileName;
@@ -2011,6 +2049,10 @@ void DocumentController::importMarkdown(const HttpRequestPtr& req,
         if (title.empty()) {
             title = "Imported Markdown";
         }
+        // 原文仍在请求体中，持有 req 即可在索引时读取；预留的内存在索引正文交出后释放
+        indexContent = [req, fileOffset, fileLength, reservation]() {
+            return std::string(req->body().substr(fileOffset, fileLength));
+        };
     } else {
         // JSON 文本方式（原有逻辑）
         auto jsonPtr = req->jsonObject();
@@ -2020,150 +2062,146 @@ void DocumentController::importMarkdown(const HttpRequestPtr& req,
                                      k400BadRequest);
             return;
         }
-        Json::Value json = *jsonPtr;
+        const Json::Value& json = *jsonPtr;
 
         if (!json.isMember("markdown")) {
             ResponseUtils::sendError(callback, "markdown content is required", k400BadRequest);
             return;
         }
 
-        markdown = json["markdown"].asString();
+        auto markdown = std::make_shared<const std::string>(json["markdown"].asString());
+        if (markdown->empty()) {
+            ResponseUtils::sendError(callback, "Markdown content is empty", k400BadRequest);
+            return;
+        }
         title = json.get("title", "Imported Markdown").asString();
+        // Markdown 在进程内转换为 HTML，不再经过 doc-converter
+        *html = MarkdownCodec::toHtml(*markdown);
+        indexContent = [markdown]() { return *markdown; };
     }
 
-    if (markdown.empty()) {
-        ResponseUtils::sendError(callback, "Markdown content is empty", k400BadRequest);
+    auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr&)>>(std::move(callback));
+    const std::string sizeBytes = std::to_string(html->size());
+
+    // 文档、首个版本、last_published_version_id 在同一事务内写入；
+    // 版本语句通过 currval 取得新文档 ID，两条语句可一次性排队，无需等待第一条返回
+    DbTransaction::begin(
+            drogon::app().getDbClient(),
+            [=](const std::shared_ptr<DbTransaction>& tx) {
+                auto docId = std::make_shared<int>(0);
+                tx->exec(
+                        "INSERT INTO document (title, owner_id, created_at, updated_at) "
+                        "VALUES ($1, $2, NOW(), NOW()) RETURNING id",
+                        [docId](const drogon::orm::Result& r) {
+                            if (!r.empty()) *docId = r[0]["id"].as<int>();
+                        },
+                        title, std::to_string(userId));
+                // 为导入的文档创建版本，使用占位符值
+                tx->exec(
+                        "WITH ver AS ("
+                        "   INSERT INTO document_version (doc_id, version_number, snapshot_url, "
+                        "   snapshot_sha256, size_bytes, content_html, created_by, source, created_at) "
+                        "   SELECT doc.id, 1, 'import://markdown/' || doc.id, $1, $2::bigint, $3, $4::integer, "
+                        "          'import', NOW() "
+                        "   FROM (SELECT currval(pg_get_serial_sequence('document', 'id')) AS id) doc "
+                        "   RETURNING id, doc_id"
+                        ") "
+                        "UPDATE document SET last_published_version_id = ver.id, updated_at = NOW() "
+                        "FROM ver WHERE document.id = ver.doc_id",
+                        nullptr, std::string(64, '0'), sizeBytes, std::move(*html), std::to_string(userId));
+                tx->commit([=]() {
+                    // 将导入的文档索引到 Meilisearch
+                    SearchService::indexDocument(*docId, title, indexContent());
+                    Json::Value responseJson;
+                    responseJson["id"] = *docId;
+                    responseJson["title"] = title;
+                    responseJson["message"] = "Document imported successfully";
+                    ResponseUtils::sendSuccess(*callbackPtr, responseJson, k201Created);
+                });
+            },
+            [callbackPtr](const std::string& message, drogon::HttpStatusCode code) {
+                ResponseUtils::sendError(*callbackPtr, message, code);
+            });
+}
+
+// 批量导入：上传 ZIP / tar 归档（multipart 文件字段或直接作为请求体），返回逐个文件的结果清单
+void DocumentController::importBatch(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback) {
+    std::string userIdStr = req->getParameter("user_id");
+    if (userIdStr.empty()) {
+        ResponseUtils::sendError(callback, "Unauthorized", k401Unauthorized);
         return;
     }
+    int userId = std::stoi(userIdStr);
 
-    std::string converterUrl = getConverterServiceUrl();
-    auto client = drogon::HttpClient::newHttpClient(converterUrl);
-    auto converterReq = drogon::HttpRequest::newHttpRequest();
-    converterReq->setMethod(drogon::Post);
-    converterReq->setPath("/convert/markdown-to-html");
-    converterReq->setContentTypeCode(drogon::CT_APPLICATION_JSON);
-
-    Json::Value converterPayload;
-    converterPayload["markdown"] = markdown;
-    Json::StreamWriterBuilder builder;
-    converterReq->setBody(Json::writeString(builder, converterPayload));
-
-    auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr&)>>(std::move(callback));
-
-    client->sendRequest(converterReq, [=](drogon::ReqResult result, const drogon::HttpResponsePtr& resp) {
-        if (result != drogon::ReqResult::Ok) {
-            std::string errorMsg =
-                    "Failed to connect to converter service: " + std::to_string(static_cast<int>(result));
-            std::cerr << "Markdown import: Failed to connect to converter service. Result: " << static_cast<int>(result)
-                      << std::endl;
-            ResponseUtils::sendError(*callbackPtr, errorMsg, k500InternalServerError);
-            return;
-        }
-        if (resp->getStatusCode() != k200OK) {
-            std::string errorMsg = "Converter service returned error: " + std::to_string(resp->getStatusCode());
-            std::string responseBody;
-            if (resp->getBody().size() > 0) {
-                responseBody = std::string(resp->getBody().data(), resp->getBody().size());
-                errorMsg += " - " + responseBody.substr(0, 500);
+    // 归档数据直接引用请求体（大请求体由 Drogon 落盘并映射），不做拷贝
+    std::string_view archiveData = req->body();
+    std::string boundary = MultipartStreamParser::boundaryFrom(req->getHeader("content-type"));
+    if (!boundary.empty()) {
+        bool found = false;
+        bool inFile = false;
+        uint64_t fileOffset = 0;
+        size_t fileLength = 0;
+        MultipartStreamParser parser(
+                boundary,
+                [&](const MultipartStreamParser::PartInfo& part) {
+                    inFile = !found && !part.filename.empty();
+                    if (inFile) {
+                        found = true;
+                        fileOffset = part.dataOffset;
+                    }
+                    return true;
+                },
+                [&](const char*, size_t length) {
+                    if (inFile) fileLength += length;
+                    return true;
+                },
+                [&]() {
+                    inFile = false;
+                    return true;
+                });
+        for (size_t offset = 0; offset < archiveData.size(); offset += kImportChunkBytes) {
+            if (!parser.feed(archiveData.data() + offset, std::min(kImportChunkBytes, archiveData.size() - offset))) {
+                break;
             }
-            std::cerr << "Markdown import: Converter service error. Status: " << resp->getStatusCode()
-                      << ", Body: " << responseBody << std::endl;
-            ResponseUtils::sendError(*callbackPtr, errorMsg, k500InternalServerError);
-            return;
         }
-
-        auto jsonPtr = resp->getJsonObject();
-        if (!jsonPtr) {
-            std::string errorMsg = "Invalid JSON response from converter service";
-            if (resp->getBody().size() > 0) {
-                errorMsg += ": " + std::string(resp->getBody().data(), std::min(resp->getBody().size(), size_t(200)));
-            }
-            ResponseUtils::sendError(*callbackPtr, errorMsg, k500InternalServerError);
+        if (!parser.done() || !found) {
+            ResponseUtils::sendError(callback, "Please upload a .zip or .tar archive", k400BadRequest);
             return;
         }
+        archiveData = archiveData.substr(fileOffset, fileLength);
+    }
 
-        if (jsonPtr->isMember("error")) {
-            std::string errorMsg = "Conversion failed: " + (*jsonPtr)["error"].asString();
-            ResponseUtils::sendError(*callbackPtr, errorMsg, k500InternalServerError);
-            return;
-        }
+    auto archive = std::make_shared<ArchiveReader>();
+    std::string error;
+    if (!archive->open(archiveData, error)) {
+        ResponseUtils::sendError(callback, error, k400BadRequest);
+        return;
+    }
+    // 限制文件数与解压后的总大小，防止压缩炸弹
+    uint64_t totalBytes = 0;
+    for (const auto& entry : archive->entries()) totalBytes += entry.size;
+    if (archive->entries().size() > kBatchImportMaxFiles) {
+        ResponseUtils::sendError(callback,
+                                 "Archive contains more than " + std::to_string(kBatchImportMaxFiles) + " entries",
+                                 k413RequestEntityTooLarge);
+        return;
+    }
+    if (totalBytes > kBatchImportMaxBytes) {
+        ResponseUtils::sendError(callback, "Archive expands to more than 512MB", k413RequestEntityTooLarge);
+        return;
+    }
 
-        if (!jsonPtr->isMember("html")) {
-            ResponseUtils::sendError(*callbackPtr, "Invalid conversion response: missing 'html' field",
-                                     k500InternalServerError);
-            return;
-        }
-
-        std::string html = (*jsonPtr)["html"].asString();
-
-        auto db = drogon::app().getDbClient();
-        if (!db) {
-            ResponseUtils::sendError(*callbackPtr, "Database not available", k500InternalServerError);
-            return;
-        }
-
-        db->execSqlAsync(
-                "INSERT INTO document (title, owner_id, created_at, updated_at) VALUES ($1, $2, NOW(), NOW()) "
-                "RETURNING id",
-                [=](const drogon::orm::Result& r) {
-                    if (r.empty()) {
-                        ResponseUtils::sendError(*callbackPtr, "Failed to create document", k500InternalServerError);
-                        return;
-                    }
-                    int docId = r[0]["id"].as<int>();
-
-                    // 为导入的文档创建版本，使用占位符值
-                    std::string placeholderUrl = "import://markdown/" + std::to_string(docId);
-                    std::string placeholderSha256 = "0000000000000000000000000000000000000000000000000000000000000000";
-                    int64_t contentSize = static_cast<int64_t>(html.length());
+    // 同一时刻只有一个批次在内存中：原文、HTML 与写库参数
+    auto reservation = ImportBudget::reserve(BatchImporter::kBatchBytes * 3);
+    if (!reservation) {
+        ResponseUtils::sendError(callback, "Too many imports in progress, please retry later", k503ServiceUnavailable);
+        return;
+    }
 
-                    db->execSqlAsync(
-                            "INSERT INTO document_version (doc_id, version_number, snapshot_url, snapshot_sha256, "
-                            "size_bytes, content_html, created_by, source, created_at) "
-                            "VALUES ($1, 1, $2, $3, $4, $5, $6, 'import', NOW()) RETURNING id",
-                            [=](const drogon::orm::Result& r) {
-                                if (r.empty()) {
-                                    ResponseUtils::sendError(*callbackPtr, "Failed to create version",
-                                                             k500InternalServerError);
-                                    return;
-                                }
-                                int versionId = r[0]["id"].as<int>();
-
-                                // 更新文档的 last_published_version_id
-                                db->execSqlAsync(
-                                        "UPDATE document SET last_published_version_id = $1::bigint, updated_at = "
-                                        "NOW() "
-                                        "WHERE id = $2::bigint",
-                                        [=](const drogon::orm::Result&) {
-                                            // 将导入的文档索引到 Meilisearch
-                                            SearchService::indexDocument(docId, title,
-                                                                         markdown.empty() ? title : markdown);
-                                            Json::Value responseJson;
-                                            responseJson["id"] = docId;
-                                            responseJson["title"] = title;
-                                            responseJson["message"] = "Document imported successfully";
-                                            ResponseUtils::sendSuccess(*callbackPtr, responseJson, k201Created);
-                                        },
-                                        [=](const drogon::orm::DrogonDbException& e) {
-                                            ResponseUtils::sendError(*callbackPtr,
-                                                                     "Database error: " + std::string(e.base().what()),
-                                                                     k500InternalServerError);
-                                        },
-                                        std::to_string(versionId), std::to_string(docId));
-                            },
-                            [=](const drogon::orm::DrogonDbException& e) {
-                                ResponseUtils::sendError(*callbackPtr,
-                                                         "Database error: " + std::string(e.base().what()),
-                                                         k500InternalServerError);
-                            },
-                            std::to_string(docId), placeholderUrl, placeholderSha256, std::to_string(contentSize), html,
-                            std::to_string(userId));
-                },
-                [=](const drogon::orm::DrogonDbException& e) {
-                    ResponseUtils::sendError(*callbackPtr, "Database error: " + std::string(e.base().what()),
-                                             k500InternalServerError);
-                },
-                title, std::to_string(userId));
+    auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr&)>>(std::move(callback));
+    // req 持有归档数据，完成前不能释放
+    BatchImporter::run(userId, archive, [req, reservation, callbackPtr](const Json::Value& manifest) {
+        ResponseUtils::sendSuccess(*callbackPtr, manifest, k200OK);
     });
 }
 
@@ -2268,79 +2306,123 @@ void DocumentController::exportWord(const HttpRequestPtr& req, std::function<voi
     });
 }
 
-// 辅助函数：执行 Word 导出（通过 doc-converter-service 流式生成，再将二进制文件透传给前端）
-// 辅助函数：执行 Word 导出（通过 doc-converter-service 流式生成，再将二进制文件透传给前端）
-static void proceedWithWordExport(std::shared_ptr<std::function<void(const HttpResponsePtr&)>> callbackPtr,
-                                  const std::string& title, const std::string& content) {
+// 辅助函数：返回导出的附件。cachedPath 非空时是 ExportCache::acquire(cacheKey) 固定的产物，以文件响应返回（sendfile），
+// 框架释放响应（连接已打开文件）时解除固定；文件不可读时改用内存中的内容，没有内容时返回 false 由调用方处理
+static bool sendExportAttachment(const std::shared_ptr<std::function<void(const HttpResponsePtr&)>>& callbackPtr,
+                                 const std::string& cacheKey, const std::string& cachedPath, const char* data,
+                                 size_t length, const std::string& filename, const std::string& contentType) {
+    HttpResponsePtr fileResp;
+    if (!cachedPath.empty()) {
+        auto resp = HttpResponse::newFileResponse(cachedPath);
+        if (resp->getStatusCode() == k200OK) {
+            fileResp = HttpResponsePtr(resp.get(), [resp, cacheKey](HttpResponse*) mutable {
+                resp.reset();
+                ExportCache::release(cacheKey);
+            });
+        } else {
+            ExportCache::release(cacheKey, true);
+        }
+    }
+    if (!fileResp) {
+        if (!data) return false;
+        fileResp = HttpResponse::newHttpResponse();
+        fileResp->setBody(std::string(data, length));
+        fileResp->setStatusCode(k200OK);
+    }
+
+    // 设置内容类型和下载文件名
+    fileResp->setContentTypeString(contentType);
+    std::string disposition =
+            "attachment; filename=\"" + filename + "\"; filename*=UTF-8''" + drogon::utils::urlEncode(filename);
+    fileResp->addHeader("Content-Disposition", disposition);
+    (*callbackPtr)(fileResp);
+    return true;
+}
+
+// 辅助函数：请求 doc-converter-service 转换，成功时返回二进制产物；timeoutSeconds 为 0 表示不限时
+static void requestConversion(const std::string& path, const Json::Value& payload, const std::string& logTag,
+                              double timeoutSeconds, std::function<void(const std::string&)> onSuccess,
+                              std::function<void(const std::string&)> onError) {
     std::string converterUrl = getConverterServiceUrl();
     auto client = drogon::HttpClient::newHttpClient(converterUrl);
     auto converterReq = drogon::HttpRequest::newHttpRequest();
     converterReq->setMethod(drogon::Post);
-    converterReq->setPath("/convert/html-to-word");
+    converterReq->setPath(path);
     converterReq->setContentTypeCode(drogon::CT_APPLICATION_JSON);
-
-    Json::Value converterPayload;
-    converterPayload["html"] = content;
-    converterPayload["title"] = title;
     Json::StreamWriterBuilder builder;
-    converterReq->setBody(Json::writeString(builder, converterPayload));
-
-    client->sendRequest(converterReq, [=](drogon::ReqResult result, const drogon::HttpResponsePtr& resp) {
-        if (result != drogon::ReqResult::Ok) {
-            std::string errorMsg =
-                    "Failed to connect to converter service: " + std::to_string(static_cast<int>(result));
-            std::cerr << "Word export: Failed to connect to converter service. Result: " << static_cast<int>(result)
-                      << std::endl;
-            ResponseUtils::sendError(*callbackPtr, errorMsg, k500InternalServerError);
-            return;
-        }
-        if (resp->getStatusCode() != k200OK) {
-            std::string errorMsg = "Converter service returned error: " + std::to_string(resp->getStatusCode());
-            auto errorBody = resp->getBody();
-            if (errorBody.length() > 0) {
-                // 尝试解析 JSON 错误信息
-                try {
-                    auto jsonPtr = resp->getJsonObject();
-                    if (jsonPtr && jsonPtr->isMember("error")) {
-                        errorMsg += " - " + (*jsonPtr)["error"].asString();
-                    } else {
-                        // 如果不是 JSON，尝试读取前 500 个字符（可能是文本错误）
-                        std::string responseBody(errorBody.data(), std::min(errorBody.length(), size_t(500)));
-                        if (responseBody.find_first_of('\0') == std::string::npos) {  // 确保是文本
-                            errorMsg += " - " + responseBody;
+    converterReq->setBody(Json::writeString(builder, payload));
+
+    client->sendRequest(
+            converterReq,
+            [=](drogon::ReqResult result, const drogon::HttpResponsePtr& resp) {
+                if (result != drogon::ReqResult::Ok) {
+                    std::cerr << logTag << ": Failed to connect to converter service. Result: "
+                              << static_cast<int>(result) << std::endl;
+                    onError("Failed to connect to converter service: " + std::to_string(static_cast<int>(result)));
+                    return;
+                }
+                if (resp->getStatusCode() != k200OK) {
+                    std::string errorMsg =
+                            "Converter service returned error: " + std::to_string(resp->getStatusCode());
+                    auto errorBody = resp->getBody();
+                    if (errorBody.length() > 0) {
+                        // 尝试解析 JSON 错误信息
+                        try {
+                            auto jsonPtr = resp->getJsonObject();
+                            if (jsonPtr && jsonPtr->isMember("error")) {
+                                errorMsg += " - " + (*jsonPtr)["error"].asString();
+                            } else {
+                                // 如果不是 JSON，尝试读取前 500 个字符（可能是文本错误）
+                                std::string responseBody(errorBody.data(), std::min(errorBody.length(), size_t(500)));
+                                if (responseBody.find_first_of('\0') == std::string::npos) {  // 确保是文本
+                                    errorMsg += " - " + responseBody;
+                                }
+                            }
+                        } catch (...) {
+                            // JSON 解析失败，忽略
                         }
                     }
-                } catch (...) {
-                    // JSON 解析失败，忽略
+                    std::cerr << logTag << ": Converter service error. Status: " << resp->getStatusCode()
+                              << std::endl;
+                    onError(errorMsg);
+                    return;
                 }
-            }
-            std::cerr << "Word export: Converter service error. Status: " << resp->getStatusCode() << std::endl;
-            ResponseUtils::sendError(*callbackPtr, errorMsg, k500InternalServerError);
-            return;
-        }
-
-        // 此时 converter 服务已经返回二进制 DOCX 文件，直接透传给前端
-        auto body = resp->getBody();
-        if (body.empty()) {
-            ResponseUtils::sendError(*callbackPtr, "Converter service returned empty response",
-                                     k500InternalServerError);
-            return;
-        }
 
-        auto fileResp = HttpResponse::newHttpResponse();
-        fileResp->setStatusCode(k200OK);
-
-        // 设置内容类型和下载文件名
-        fileResp->setContentTypeString("application/vnd.openxmlformats-officedocument.wordprocessingml.document");
-        std::string disposition = "attachment; filename=\"" + title + ".docx\"; filename*=UTF-8''" +
-                                  drogon::utils::urlEncode(title + ".docx");
-        fileResp->addHeader("Content-Disposition", disposition);
+                auto body = resp->getBody();
+                if (body.empty()) {
+                    onError("Converter service returned empty response");
+                    return;
+                }
+                onSuccess(std::string(body.data(), body.length()));
+            },
+            timeoutSeconds);
+}
 
-        // 拷贝二进制内容（使用 body.data() 和 body.length()）
-        fileResp->setBody(std::string(body.data(), body.length()));
+// 辅助函数：执行 Word 导出（通过 doc-converter-service 流式生成，再将二进制文件透传给前端）
+static void proceedWithWordExport(std::shared_ptr<std::function<void(const HttpResponsePtr&)>> callbackPtr,
+                                  const std::string& title, const std::string& content) {
+    const std::string contentType = "application/vnd.openxmlformats-officedocument.wordprocessingml.document";
+    // 内容与标题未变化时直接返回缓存的产物
+    std::string cacheKey = ExportCache::makeKey("docx", "/convert/html-to-word", title, content);
+    std::string cachedPath = ExportCache::acquire(cacheKey);
+    if (!cachedPath.empty() &&
+        sendExportAttachment(callbackPtr, cacheKey, cachedPath, nullptr, 0, title + ".docx", contentType)) {
+        return;
+    }
 
-        (*callbackPtr)(fileResp);
-    });
+    Json::Value converterPayload;
+    converterPayload["html"] = content;
+    converterPayload["title"] = title;
+    requestConversion(
+            "/convert/html-to-word", converterPayload, "Word export", 0,
+            [=](const std::string& body) {
+                // 直接返回内存中的内容，缓存在后台写入
+                sendExportAttachment(callbackPtr, "", "", body.data(), body.length(), title + ".docx", contentType);
+                ExportCache::store(cacheKey, body);
+            },
+            [callbackPtr](const std::string& error) {
+                ResponseUtils::sendError(*callbackPtr, error, k500InternalServerError);
+            });
 }
 
 // PDF 文档导出
@@ -2509,146 +2591,41 @@ void DocumentController::exportPdf(const HttpRequestPtr& req, std::function<void
 // 辅助函数：执行 PDF 导出（通过 doc-converter-service 流式生成，再将二进制文件透传给前端）
 static void proceedWithPdfExport(std::shared_ptr<std::function<void(const HttpResponsePtr&)>> callbackPtr,
                                  const std::string& title, const std::string& content) {
-    std::string converterUrl = getConverterServiceUrl();
-    auto client = drogon::HttpClient::newHttpClient(converterUrl);
-    auto converterReq = drogon::HttpRequest::newHttpRequest();
-    converterReq->setMethod(drogon::Post);
-    converterReq->setPath("/convert/text-to-pdf");
-    converterReq->setContentTypeCode(drogon::CT_APPLICATION_JSON);
+    // 内容与标题未变化时直接返回缓存的产物
+    std::string cacheKey = ExportCache::makeKey("pdf", "/convert/text-to-pdf", title, content);
+    std::string cachedPath = ExportCache::acquire(cacheKey);
+    if (!cachedPath.empty() &&
+        sendExportAttachment(callbackPtr, cacheKey, cachedPath, nullptr, 0, title + ".pdf", "application/pdf")) {
+        return;
+    }
 
     Json::Value converterPayload;
     converterPayload["text"] = content;
     converterPayload["title"] = title;
-    Json::StreamWriterBuilder builder;
-    converterReq->setBody(Json::writeString(builder, converterPayload));
-
-    client->sendRequest(converterReq, [=](drogon::ReqResult result, const drogon::HttpResponsePtr& resp) {
-        if (result != drogon::ReqResult::Ok) {
-            std::string errorMsg =
-                    "Failed to connect to converter service: " + std::to_string(static_cast<int>(result));
-            std::cerr << "PDF export: Failed to connect to converter service. Result: " << static_cast<int>(result)
-                      << std::endl;
-            ResponseUtils::sendError(*callbackPtr, errorMsg, k500InternalServerError);
-            return;
-        }
-        if (resp->getStatusCode() != k200OK) {
-            std::string errorMsg = "Converter service returned error: " + std::to_string(resp->getStatusCode());
-            auto errorBody = resp->getBody();
-            if (errorBody.length() > 0) {
-                // 尝试解析 JSON 错误信息
-                try {
-                    auto jsonPtr = resp->getJsonObject();
-                    if (jsonPtr && jsonPtr->isMember("error")) {
-                        errorMsg += " - " + (*jsonPtr)["error"].asString();
-                    } else {
-                        // 如果不是 JSON，尝试读取前 500 个字符（可能是文本错误）
-                        std::string responseBody(errorBody.data(), std::min(errorBody.length(), size_t(500)));
-                        if (responseBody.find_first_of('\0') == std::string::npos) {  // 确保是文本
-                            errorMsg += " - " + responseBody;
-                        }
-                    }
-                } catch (...) {
-                    // JSON 解析失败，忽略
-                }
-            }
-            std::cerr << "PDF export: Converter service error. Status: " << resp->getStatusCode() << std::endl;
-            ResponseUtils::sendError(*callbackPtr, errorMsg, k500InternalServerError);
-            return;
-        }
-
-        // 此时 converter 服务已经返回二进制 PDF 文件，直接透传给前端
-        auto body = resp->getBody();
-        if (body.empty()) {
-            ResponseUtils::sendError(*callbackPtr, "Converter service returned empty response",
-                                     k500InternalServerError);
-            return;
-        }
-
-        auto fileResp = HttpResponse::newHttpResponse();
-        fileResp->setStatusCode(k200OK);
-
-        fileResp->setContentTypeString("application/pdf");
-        std::string disposition = "attachment; filename=\"" + title + ".pdf\"; filename*=UTF-8''" +
-                                  drogon::utils::urlEncode(title + ".pdf");
-        fileResp->addHeader("Content-Disposition", disposition);
-
-        // 拷贝二进制内容（使用 body.data() 和 body.length()）
-        fileResp->setBody(std::string(body.data(), body.length()));
-
-        (*callbackPtr)(fileResp);
-    });
+    requestConversion(
+            "/convert/text-to-pdf", converterPayload, "PDF export", 0,
+            [=](const std::string& body) {
+                // 直接返回内存中的内容，缓存在后台写入
+                sendExportAttachment(callbackPtr, "", "", body.data(), body.length(), title + ".pdf",
+                                     "application/pdf");
+                ExportCache::store(cacheKey, body);
+            },
+            [callbackPtr](const std::string& error) {
+                ResponseUtils::sendError(*callbackPtr, error, k500InternalServerError);
+            });
 }
 
 // 辅助函数：执行 Markdown 导出
 static void proceedWithMarkdownExport(std::shared_ptr<std::function<void(const HttpResponsePtr&)>> callbackPtr,
                                       const std::string& title, const std::string& content) {
-    std::string converterUrl = getConverterServiceUrl();
-    auto client = drogon::HttpClient::newHttpClient(converterUrl);
-    auto converterReq = drogon::HttpRequest::newHttpRequest();
-    converterReq->setMethod(drogon::Post);
-    converterReq->setPath("/convert/html-to-markdown");
-    converterReq->setContentTypeCode(drogon::CT_APPLICATION_JSON);
-
-    Json::Value converterPayload;
-    converterPayload["html"] = content;
-    Json::StreamWriterBuilder builder;
-    converterReq->setBody(Json::writeString(builder, converterPayload));
-
-    client->sendRequest(converterReq, [=](drogon::ReqResult result, const drogon::HttpResponsePtr& resp) {
-        if (result != drogon::ReqResult::Ok) {
-            std::string errorMsg =
-                    "Failed to connect to converter service: " + std::to_string(static_cast<int>(result));
-            std::cerr << "Markdown export: Failed to connect to converter service. Result: " << static_cast<int>(result)
-                      << std::endl;
-            ResponseUtils::sendError(*callbackPtr, errorMsg, k500InternalServerError);
-            return;
-        }
-        if (resp->getStatusCode() != k200OK) {
-            std::string errorMsg = "Converter service returned error: " + std::to_string(resp->getStatusCode());
-            std::string responseBody;
-            if (resp->getBody().size() > 0) {
-                responseBody = std::string(resp->getBody().data(), resp->getBody().size());
-                errorMsg += " - " + responseBody.substr(0, 500);
-            }
-            std::cerr << "Markdown export: Converter service error. Status: " << resp->getStatusCode()
-                      << ", Body: " << responseBody << std::endl;
-            ResponseUtils::sendError(*callbackPtr, errorMsg, k500InternalServerError);
-            return;
-        }
-
-        auto jsonPtr = resp->getJsonObject();
-        if (!jsonPtr) {
-            std::string errorMsg = "Invalid JSON response from converter service";
-            if (resp->getBody().size() > 0) {
-                errorMsg += ": " + std::string(resp->getBody().data(), std::min(resp->getBody().size(), size_t(200)));
-            }
-            ResponseUtils::sendError(*callbackPtr, errorMsg, k500InternalServerError);
-            return;
-        }
-
-        if (jsonPtr->isMember("error")) {
-            std::string errorMsg = "Conversion failed: " + (*jsonPtr)["error"].asString();
-            ResponseUtils::sendError(*callbackPtr, errorMsg, k500InternalServerError);
-            return;
-        }
-
-        if (!jsonPtr->isMember("markdown")) {
-            ResponseUtils::sendError(*callbackPtr, "Invalid conversion response: missing 'markdown' field",
-                                     k500InternalServerError);
-            return;
-        }
-
-        std::string markdown = (*jsonPtr)["markdown"].asString();
-        std::string filename = title + ".md";
-
-        Json::Value responseJson;
-        responseJson["markdown"] = markdown;
-        responseJson["filename"] = filename;
-        responseJson["mime_type"] = "text/markdown";
-        auto fileResp = HttpResponse::newHttpJsonResponse(responseJson);
-        fileResp->setStatusCode(k200OK);
-        (*callbackPtr)(fileResp);
-    });
+    // 在进程内转换，开销很小，无需经过导出缓存
+    Json::Value responseJson;
+    responseJson["markdown"] = MarkdownCodec::toMarkdown(content);
+    responseJson["filename"] = title + ".md";
+    responseJson["mime_type"] = "text/markdown";
+    auto fileResp = HttpResponse::newHttpJsonResponse(responseJson);
+    fileResp->setStatusCode(k200OK);
+    (*callbackPtr)(fileResp);
 }
 
 // Markdown 文档导出
@@ -2770,6 +2747,562 @@ void DocumentController::exportMarkdown(const HttpRequestPtr& req,
     });
 }
 
+// 辅助函数：读取导出内容（最新发布版本，为空时回退到最近一个有内容的版本）；plainText 为 true 时返回纯文本
+static void loadExportContent(int docId, bool plainText,
+                              std::function<void(const std::string&, const std::string&)> onLoaded,
+                              std::function<void(const std::string&)> onError) {
+    auto db = drogon::app().getDbClient();
+    if (!db) {
+        onError("Database not available");
+        return;
+    }
+
+    auto pickContent = [plainText](const drogon::orm::Row& row) {
+        std::string html = row["content_html"].isNull() ? "" : row["content_html"].as<std::string>();
+        std::string text = row["content_text"].isNull() ? "" : row["content_text"].as<std::string>();
+        if (plainText) return text.empty() ? htmlToPlainText(html) : text;
+        return html.empty() ? text : html;
+    };
+    auto onDbError = [onError](const drogon::orm::DrogonDbException& e) {
+        onError("Database error: " + std::string(e.base().what()));
+    };
+
+    db->execSqlAsync(
+            "SELECT d.title, dv.content_html, dv.content_text "
+            "FROM document d "
+            "LEFT JOIN document_version dv ON d.last_published_version_id = dv.id "
+            "WHERE d.id = $1",
+            [=](const drogon::orm::Result& r) {
+                if (r.empty()) {
+                    onError("Document not found");
+                    return;
+                }
+                std::string title = r[0]["title"].as<std::string>();
+                std::string content = pickContent(r[0]);
+                if (!content.empty()) {
+                    onLoaded(title, content);
+                    return;
+                }
+                db->execSqlAsync(
+                        "SELECT content_html, content_text "
+                        "FROM document_version "
+                        "WHERE doc_id = $1 AND (content_html IS NOT NULL OR content_text IS NOT NULL) "
+                        "ORDER BY version_number DESC "
+                        "LIMIT 1",
+                        [=](const drogon::orm::Result& versionResult) {
+                            std::string fallback = versionResult.empty() ? "" : pickContent(versionResult[0]);
+                            if (fallback.empty()) {
+                                onError("Document content is empty. Please save the document first to generate "
+                                        "exportable content.");
+                                return;
+                            }
+                            onLoaded(title, fallback);
+                        },
+                        onDbError, std::to_string(docId));
+            },
+            onDbError, std::to_string(docId));
+}
+
+// 辅助函数：读取导出缓存中的产物，未命中或读取失败时返回 false
+static bool readCachedArtifact(const std::string& cacheKey, std::string& data) {
+    std::string path = ExportCache::acquire(cacheKey);
+    if (path.empty()) return false;
+    std::ifstream file(path, std::ios::binary);
+    data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    bool ok = file.is_open() && !file.bad();
+    ExportCache::release(cacheKey, !ok);
+    return ok;
+}
+
+// 辅助函数：后台执行导出任务，产物写入本地导出缓存并交给 ExportJobQueue 上传
+static void runExportJob(const std::string& jobId, int docId, const std::string& format) {
+    auto onError = [jobId](const std::string& error) { ExportJobQueue::fail(jobId, error); };
+    loadExportContent(
+            docId, format == "pdf",
+            [=](const std::string& title, const std::string& content) {
+                ExportJobQueue::reportProgress(jobId, 30);
+
+                if (format == "markdown") {
+                    std::string cacheKey = ExportCache::makeKey("markdown", "MarkdownCodec", "", content);
+                    std::string markdown = MarkdownCodec::toMarkdown(content);
+                    ExportCache::store(cacheKey, markdown);
+                    ExportJobQueue::complete(jobId, cacheKey, std::move(markdown), title + ".md", "text/markdown");
+                    return;
+                }
+
+                const bool word = format == "word";
+                const std::string converterPath = word ? "/convert/html-to-word" : "/convert/text-to-pdf";
+                const std::string filename = title + (word ? ".docx" : ".pdf");
+                const std::string contentType =
+                        word ? "application/vnd.openxmlformats-officedocument.wordprocessingml.document"
+                             : "application/pdf";
+                // 与同步导出共用缓存键
+                std::string cacheKey = ExportCache::makeKey(word ? "docx" : "pdf", converterPath, title, content);
+                std::string cached;
+                if (readCachedArtifact(cacheKey, cached)) {
+                    ExportJobQueue::complete(jobId, cacheKey, std::move(cached), filename, contentType);
+                    return;
+                }
+
+                Json::Value converterPayload;
+                converterPayload[word ? "html" : "text"] = content;
+                converterPayload["title"] = title;
+                requestConversion(
+                        converterPath, converterPayload, word ? "Word export job" : "PDF export job",
+                        ExportJobQueue::conversionTimeoutSeconds(),
+                        [=](const std::string& body) {
+                            ExportJobQueue::reportProgress(jobId, 90);
+                            ExportCache::store(cacheKey, body);
+                            ExportJobQueue::complete(jobId, cacheKey, body, filename, contentType);
+                        },
+                        onError);
+            },
+            onError);
+}
+
+// 创建异步导出任务
+void DocumentController::createExport(const HttpRequestPtr& req,
+                                      std::function<void(const HttpResponsePtr&)>&& callback) {
+    auto routingParams = req->getRoutingParameters();
+    if (routingParams.empty()) {
+        ResponseUtils::sendError(callback, "Document ID is required", k400BadRequest);
+        return;
+    }
+    int docId = std::stoi(routingParams[0]);
+
+    std::string userIdStr = req->getParameter("user_id");
+    if (userIdStr.empty()) {
+        ResponseUtils::sendError(callback, "Unauthorized", k401Unauthorized);
+        return;
+    }
+    int userId = std::stoi(userIdStr);
+
+    auto json = req->getJsonObject();
+    std::string format = json ? json->get("format", "").asString() : req->getParameter("format");
+    if (format != "word" && format != "pdf" && format != "markdown") {
+        ResponseUtils::sendError(callback, "format must be one of: word, pdf, markdown", k400BadRequest);
+        return;
+    }
+
+    auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr&)>>(std::move(callback));
+    PermissionUtils::hasPermission(docId, userId, "viewer", [=](bool hasPermission) {
+        if (!hasPermission) {
+            ResponseUtils::sendError(*callbackPtr, "Forbidden", k403Forbidden);
+            return;
+        }
+
+        ExportJobQueue::submit(
+                userId, docId, format, [docId, format](const std::string& jobId) { runExportJob(jobId, docId, format); },
+                [callbackPtr](ExportJobQueue::SubmitResult result, const Json::Value& job) {
+                    switch (result) {
+                        case ExportJobQueue::SubmitResult::QueueFull:
+                            ResponseUtils::sendError(*callbackPtr, "Export queue is full, please retry later",
+                                                     k503ServiceUnavailable);
+                            return;
+                        case ExportJobQueue::SubmitResult::UserLimitReached:
+                            ResponseUtils::sendError(*callbackPtr, "Too many export jobs in progress",
+                                                     k429TooManyRequests);
+                            return;
+                        case ExportJobQueue::SubmitResult::Error:
+                            ResponseUtils::sendError(*callbackPtr, "Failed to create export job",
+                                                     k500InternalServerError);
+                            return;
+                        case ExportJobQueue::SubmitResult::Accepted:
+                            ResponseUtils::sendSuccess(*callbackPtr, job, k202Accepted);
+                            return;
+                    }
+                });
+    });
+}
+
+// 查询导出任务状态（任务记录在数据库中，任意实例均可查询）
+void DocumentController::getExport(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback) {
+    auto routingParams = req->getRoutingParameters();
+    if (routingParams.size() < 2) {
+        ResponseUtils::sendError(callback, "Document ID and job ID are required", k400BadRequest);
+        return;
+    }
+    int docId = std::stoi(routingParams[0]);
+    const std::string& jobId = routingParams[1];
+
+    std::string userIdStr = req->getParameter("user_id");
+    if (userIdStr.empty()) {
+        ResponseUtils::sendError(callback, "Unauthorized", k401Unauthorized);
+        return;
+    }
+    int userId = std::stoi(userIdStr);
+
+    auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr&)>>(std::move(callback));
+    ExportJobQueue::getJob(
+            jobId, userId,
+            [callbackPtr, docId](const Json::Value& job, const ExportJobQueue::Artifact&) {
+                if (job.isNull() || job["doc_id"].asInt() != docId) {
+                    ResponseUtils::sendError(*callbackPtr, "Export job not found", k404NotFound);
+                    return;
+                }
+                ResponseUtils::sendSuccess(*callbackPtr, job, k200OK);
+            },
+            [callbackPtr](const std::string& error) {
+                ResponseUtils::sendError(*callbackPtr, error, k500InternalServerError);
+            });
+}
+
+// 下载导出产物：优先使用本实例导出缓存中的文件，否则从 MinIO 读取
+void DocumentController::downloadExport(const HttpRequestPtr& req,
+                                        std::function<void(const HttpResponsePtr&)>&& callback) {
+    auto routingParams = req->getRoutingParameters();
+    if (routingParams.size() < 2) {
+        ResponseUtils::sendError(callback, "Document ID and job ID are required", k400BadRequest);
+        return;
+    }
+    int docId = std::stoi(routingParams[0]);
+    const std::string& jobId = routingParams[1];
+
+    std::string userIdStr = req->getParameter("user_id");
+    if (userIdStr.empty()) {
+        ResponseUtils::sendError(callback, "Unauthorized", k401Unauthorized);
+        return;
+    }
+    int userId = std::stoi(userIdStr);
+
+    auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr&)>>(std::move(callback));
+    ExportJobQueue::getJob(
+            jobId, userId,
+            [callbackPtr, docId](const Json::Value& job, const ExportJobQueue::Artifact& artifact) {
+                if (job.isNull() || job["doc_id"].asInt() != docId) {
+                    ResponseUtils::sendError(*callbackPtr, "Export job not found", k404NotFound);
+                    return;
+                }
+                if (job["status"].asString() != "succeeded") {
+                    ResponseUtils::sendError(*callbackPtr, "Export job is not finished", k409Conflict);
+                    return;
+                }
+
+                if (!artifact.cacheKey.empty()) {
+                    std::string path = ExportCache::acquire(artifact.cacheKey);
+                    if (!path.empty() && sendExportAttachment(callbackPtr, artifact.cacheKey, path, nullptr, 0,
+                                                              artifact.filename, artifact.contentType)) {
+                        return;
+                    }
+                }
+                if (artifact.objectName.empty()) {
+                    ResponseUtils::sendError(*callbackPtr, "Export artifact has expired, please export again",
+                                             k410Gone);
+                    return;
+                }
+                MinIOClient::downloadFile(
+                        artifact.objectName,
+                        [callbackPtr, artifact](const std::vector<char>& data) {
+                            sendExportAttachment(callbackPtr, "", "", data.data(), data.size(), artifact.filename,
+                                                 artifact.contentType);
+                            // 之后在本实例上的下载直接读取缓存
+                            if (!artifact.cacheKey.empty()) {
+                                ExportCache::store(artifact.cacheKey, std::string(data.data(), data.size()));
+                            }
+                        },
+                        [callbackPtr](const std::string& error) {
+                            LOG_WARN << "Export artifact download failed: " << error;
+                            ResponseUtils::sendError(*callbackPtr, "Export artifact has expired, please export again",
+                                                     k410Gone);
+                        });
+            },
+            [callbackPtr](const std::string& error) {
+                ResponseUtils::sendError(*callbackPtr, error, k500InternalServerError);
+            });
+}
+
+// ========== 批量导出（ZIP） ==========
+
+namespace {
+// 批量导出的一页文档（按 id 递增的键集分页），内容取发布版本，为空时取最近一个有内容的版本。参数：
+//   $1 after_id, $2 tag 名称（'' 不过滤）, $3 owner_id（0 不过滤）, $4 可见用户（0 不按 ACL 过滤）, $5 limit
+const char* const kBulkExportPageSql =
+        "SELECT d.id, d.title, "
+        "       COALESCE(dv.content_html, lv.content_html) AS content_html, "
+        "       COALESCE(dv.content_text, lv.content_text) AS content_text "
+        "FROM document d "
+        "LEFT JOIN document_version dv ON d.last_published_version_id = dv.id "
+        "LEFT JOIN LATERAL ("
+        "   SELECT v.content_html, v.content_text FROM document_version v "
+        "   WHERE v.doc_id = d.id AND (v.content_html IS NOT NULL OR v.content_text IS NOT NULL) "
+        "   ORDER BY v.version_number DESC LIMIT 1"
+        ") lv ON dv.content_html IS NULL AND dv.content_text IS NULL "
+        "WHERE d.id > $1::bigint "
+        "  AND ($2::text = '' OR EXISTS (SELECT 1 FROM doc_tag dt JOIN tag t ON t.id = dt.tag_id "
+        "                                 WHERE dt.doc_id = d.id AND t.name = $2::text)) "
+        "  AND ($3::bigint = 0 OR d.owner_id = $3::bigint) "
+        "  AND ($4::bigint = 0 OR EXISTS (SELECT 1 FROM user_doc_access u "
+        "                                 WHERE u.user_id = $4::bigint AND u.doc_id = d.id)) "
+        "ORDER BY d.id "
+        "LIMIT $5::integer";
+
+// 每页读取的文档数；生成当前页时预取下一页
+constexpr int kBulkExportPageSize = 20;
+// 单个归档最多包含的文档数
+constexpr size_t kBulkExportMaxDocs = 10000;
+
+// 一次批量导出的状态。连接可写时由拉取回调逐页生成 ZIP 条目，内存中最多只有一页待发送的条目
+// 与一页预取结果，生成速度跟随客户端的读取速度，慢客户端不会让归档堆积在发送缓冲区或临时文件中。
+// 拉取回调只在连接的事件循环上调用，生成相关的字段无需加锁；预取结果由数据库回调写入，受 mutex 保护。
+struct BulkExportSession {
+    explicit BulkExportSession(bool deflate) : zip(deflate) {}
+
+    ZipStreamWriter zip;
+    std::string format;
+    std::string tag;
+    int64_t ownerId{0};
+    int64_t viewerId{0};  // 0 表示管理员，不按 ACL 过滤
+    std::unordered_set<std::string> names;
+    size_t exported{0};
+    bool truncated{false};
+    bool more{true};       // 还有下一页（已预取或查询中）
+    bool finished{false};  // 中央目录已生成
+    std::string pending;   // 已生成、尚未交给连接的字节
+    size_t pendingOffset{0};
+
+    std::mutex mutex;
+    std::condition_variable pageReady;
+    bool fetching{false};
+    std::shared_ptr<drogon::orm::Result> nextPage;
+    std::string error;
+};
+}  // namespace
+
+// 辅助函数：归档内的文件名，去掉路径分隔符等非法字符，重名时附加文档 ID
+static std::string bulkExportEntryName(BulkExportSession& session, const std::string& title, int64_t docId) {
+    std::string base;
+    for (char c : title) {
+        unsigned char u = static_cast<unsigned char>(c);
+        base += (u < 0x20 || std::string("/\\:*?\"<>|").find(c) != std::string::npos) ? '_' : c;
+    }
+    size_t begin = base.find_first_not_of(" .");
+    base = begin == std::string::npos ? "untitled" : base.substr(begin, 120);
+    const std::string extension = session.format == "html" ? ".html" : ".md";
+    std::string name = base + extension;
+    if (!session.names.insert(name).second) {
+        name = base + " (" + std::to_string(docId) + ")" + extension;
+        session.names.insert(name);
+    }
+    return name;
+}
+
+// 辅助函数：单个文档的导出内容
+static std::string bulkExportContent(const std::string& format, const std::string& title, const std::string& html,
+                                     const std::string& text) {
+    if (format == "markdown") {
+        return MarkdownCodec::toMarkdown(html.empty() ? text : html);
+    }
+    auto escape = [](const std::string& value) {
+        std::string out;
+        for (char c : value) {
+            switch (c) {
+                case '&':
+                    out += "&amp;";
+                    break;
+                case '<':
+                    out += "&lt;";
+                    break;
+                case '>':
+                    out += "&gt;";
+                    break;
+                default:
+                    out += c;
+            }
+        }
+        return out;
+    };
+    return "<!DOCTYPE html>\n<html>\n<head>\n<meta charset=\"utf-8\">\n<title>" + escape(title) +
+           "</title>\n</head>\n<body>\n" + (html.empty() ? "<pre>" + escape(text) + "</pre>" : html) +
+           "\n</body>\n</html>\n";
+}
+
+// 辅助函数：查询 afterId 之后的一页文档
+static void queryBulkExportPage(const std::shared_ptr<BulkExportSession>& session, int64_t afterId,
+                                std::function<void(const drogon::orm::Result&)> onResult,
+                                std::function<void(const std::string&)> onError) {
+    auto db = drogon::app().getDbClient();
+    if (!db) {
+        onError("Database not available");
+        return;
+    }
+    db->execSqlAsync(
+            kBulkExportPageSql, std::move(onResult),
+            [onError](const drogon::orm::DrogonDbException& e) {
+                onError("Database error: " + std::string(e.base().what()));
+            },
+            std::to_string(afterId), session->tag, std::to_string(session->ownerId), std::to_string(session->viewerId),
+            std::to_string(kBulkExportPageSize));
+}
+
+// 辅助函数：预取下一页，结果到达后唤醒等待中的拉取回调
+static void prefetchBulkExportPage(const std::shared_ptr<BulkExportSession>& session, int64_t afterId) {
+    {
+        std::lock_guard<std::mutex> lock(session->mutex);
+        session->fetching = true;
+    }
+    auto deliver = [session](std::shared_ptr<drogon::orm::Result> page, const std::string& error) {
+        std::lock_guard<std::mutex> lock(session->mutex);
+        session->fetching = false;
+        session->nextPage = std::move(page);
+        session->error = error;
+        session->pageReady.notify_all();
+    };
+    queryBulkExportPage(
+            session, afterId,
+            [deliver](const drogon::orm::Result& r) { deliver(std::make_shared<drogon::orm::Result>(r), ""); },
+            [deliver](const std::string& error) { deliver(nullptr, error); });
+}
+
+// 辅助函数：转换、压缩一页文档并追加到 pending；生成前先发出下一页的查询，使数据库读取与转换、压缩并行
+static void appendBulkExportPage(const std::shared_ptr<BulkExportSession>& session, const drogon::orm::Result& page) {
+    session->more = page.size() == static_cast<size_t>(kBulkExportPageSize) &&
+                    session->exported + page.size() < kBulkExportMaxDocs;
+    if (session->more) {
+        prefetchBulkExportPage(session, page[page.size() - 1]["id"].as<int64_t>());
+    } else if (page.size() == static_cast<size_t>(kBulkExportPageSize)) {
+        session->truncated = true;
+    }
+
+    for (const auto& row : page) {
+        int64_t docId = row["id"].as<int64_t>();
+        std::string title = row["title"].as<std::string>();
+        std::string html = row["content_html"].isNull() ? "" : row["content_html"].as<std::string>();
+        std::string text = row["content_text"].isNull() ? "" : row["content_text"].as<std::string>();
+
+        if (session->exported >= kBulkExportMaxDocs ||
+            !session->zip.addEntry(bulkExportEntryName(*session, title, docId),
+                                   bulkExportContent(session->format, title, html, text), session->pending)) {
+            // 已发出的预取结果不再使用
+            session->truncated = true;
+            session->more = false;
+            return;
+        }
+        ++session->exported;
+    }
+}
+
+// 辅助函数：追加结尾说明与中央目录，归档完整
+static void finishBulkExport(BulkExportSession& session, const std::string& error) {
+    if (!error.empty()) {
+        LOG_ERROR << "[BulkExport] Aborted after " << session.exported << " documents: " << error;
+        // 响应头已发出，只能在归档中注明导出不完整
+        session.zip.addEntry("EXPORT_ERROR.txt",
+                             "Export aborted after " + std::to_string(session.exported) + " documents: " + error +
+                                     "\n",
+                             session.pending);
+    } else if (session.truncated) {
+        session.zip.addEntry("EXPORT_TRUNCATED.txt",
+                             "Export stopped after " + std::to_string(session.exported) +
+                                     " documents because the archive limit was reached.\n",
+                             session.pending);
+    }
+    session.pending += session.zip.finish();
+    session.finished = true;
+}
+
+// 辅助函数：连接可写时拉取下一块。已生成的字节发完后才取下一页生成，预取结果未到时等待数据库回调；
+// 数据库客户端使用独立的事件循环（is_fast = false），等待不会阻塞查询本身
+static std::size_t pullBulkExport(const std::shared_ptr<BulkExportSession>& session, char* buffer,
+                                  std::size_t size) {
+    // 连接结束时以空指针通知
+    if (!buffer) return 0;
+    while (session->pendingOffset >= session->pending.size()) {
+        session->pending.clear();
+        session->pendingOffset = 0;
+        if (session->finished) return 0;
+        if (!session->more) {
+            finishBulkExport(*session, "");
+            continue;
+        }
+
+        std::shared_ptr<drogon::orm::Result> page;
+        std::string error;
+        {
+            std::unique_lock<std::mutex> lock(session->mutex);
+            session->pageReady.wait(lock, [&session] { return !session->fetching; });
+            page = std::move(session->nextPage);
+            error = session->error;
+        }
+        if (page) {
+            appendBulkExportPage(session, *page);
+        } else {
+            finishBulkExport(*session, error);
+        }
+    }
+    std::size_t length = std::min(size, session->pending.size() - session->pendingOffset);
+    std::copy_n(session->pending.data() + session->pendingOffset, length, buffer);
+    session->pendingOffset += length;
+    return length;
+}
+
+// 批量导出：按标签 / 所有者筛选文档，以 ZIP 流式返回，随客户端读取逐页读取、转换、压缩
+void DocumentController::exportBulk(const HttpRequestPtr& req,
+                                    std::function<void(const HttpResponsePtr&)>&& callback) {
+    std::string userIdStr = req->getParameter("user_id");
+    if (userIdStr.empty()) {
+        ResponseUtils::sendError(callback, "Unauthorized", k401Unauthorized);
+        return;
+    }
+    int userId = std::stoi(userIdStr);
+
+    std::string format = req->getParameter("format");
+    if (format.empty()) format = "markdown";
+    if (format != "markdown" && format != "html") {
+        ResponseUtils::sendError(callback, "format must be one of: markdown, html", k400BadRequest);
+        return;
+    }
+    std::string compression = req->getParameter("compression");
+    if (compression.empty()) compression = "deflate";
+    if (compression != "deflate" && compression != "store") {
+        ResponseUtils::sendError(callback, "compression must be one of: deflate, store", k400BadRequest);
+        return;
+    }
+    int64_t ownerId = 0;
+    std::string ownerIdStr = req->getParameter("owner_id");
+    if (!ownerIdStr.empty()) {
+        try {
+            ownerId = std::stoll(ownerIdStr);
+        } catch (...) {
+            ResponseUtils::sendError(callback, "Invalid owner_id", k400BadRequest);
+            return;
+        }
+    }
+    std::string tag = req->getParameter("tag");
+
+    auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr&)>>(std::move(callback));
+    // 管理员可导出全部文档，其他用户只能导出自己可访问的文档
+    PermissionUtils::isAdmin(userId, [=](bool isAdmin) {
+        auto session = std::make_shared<BulkExportSession>(compression == "deflate");
+        session->format = format;
+        session->tag = tag;
+        session->ownerId = ownerId;
+        session->viewerId = isAdmin ? 0 : userId;
+
+        char date[16];
+        std::time_t now = std::time(nullptr);
+        std::tm local{};
+        localtime_r(&now, &local);
+        std::strftime(date, sizeof(date), "%Y%m%d", &local);
+        std::string filename = "documents-" + std::string(date) + ".zip";
+
+        // 首页查询成功后再发出响应头，之前的错误仍以 JSON 返回
+        queryBulkExportPage(
+                session, 0,
+                [=](const drogon::orm::Result& firstPage) {
+                    session->nextPage = std::make_shared<drogon::orm::Result>(firstPage);
+                    auto resp = HttpResponse::newStreamResponse([session](char* buffer, std::size_t size) {
+                        return pullBulkExport(session, buffer, size);
+                    });
+                    resp->setContentTypeString("application/zip");
+                    resp->addHeader("Content-Disposition", "attachment; filename=\"" + filename + "\"");
+                    (*callbackPtr)(resp);
+                },
+                [=](const std::string& error) {
+                    ResponseUtils::sendError(*callbackPtr, error, k500InternalServerError);
+                });
+    });
+}
+
 // 获取当前用户在文档上的权限：owner/editor/viewer/none
 void DocumentController::getPermission(const HttpRequestPtr& req,
                                        std::function<void(const HttpResponsePtr&)>&& callback) {
@@ -24,9 +24,15 @@ public:
     ADD_METHOD_TO(DocumentController::getVersionDiff, "/api/docs/{id}/versions/{versionId}/diff", Get, "JwtAuthFilter");
     // 文档导入导出接口
     ADD_METHOD_TO(DocumentController::importMarkdown, "/api/docs/import/markdown", Post, "JwtAuthFilter");
+    ADD_METHOD_TO(DocumentController::importBatch, "/api/docs/import/batch", Post, "JwtAuthFilter");
     ADD_METHOD_TO(DocumentController::exportWord, "/api/docs/{id}/export/word", Get, "JwtAuthFilter");
     ADD_METHOD_TO(DocumentController::exportPdf, "/api/docs/{id}/export/pdf", Get, "JwtAuthFilter");
     ADD_METHOD_TO(DocumentController::exportMarkdown, "/api/docs/{id}/export/markdown", Get, "JwtAuthFilter");
+    ADD_METHOD_TO(DocumentController::createExport, "/api/docs/{id}/exports", Post, "JwtAuthFilter");
+    ADD_METHOD_TO(DocumentController::getExport, "/api/docs/{id}/exports/{jobId}", Get, "JwtAuthFilter");
+    ADD_METHOD_TO(DocumentController::downloadExport, "/api/docs/{id}/exports/{jobId}/download", Get,
+                  "JwtAuthFilter");
+    ADD_METHOD_TO(DocumentController::exportBulk, "/api/docs/export/bulk", Get, "JwtAuthFilter");
     // 查询当前用户在文档上的权限（owner/editor/viewer/none）
     ADD_METHOD_TO(DocumentController::getPermission, "/api/docs/{id}/permission", Get, "JwtAuthFilter");
 
@@ -71,11 +77,22 @@ public:
     // 文档导入接口
     void importMarkdown(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback);
 
+    // 批量导入（ZIP / tar 归档）
+    void importBatch(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback);
+
     // 文档导出接口
     void exportWord(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback);
     void exportPdf(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback);
     void exportMarkdown(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback);
 
+    // 异步导出任务：创建、查询状态、下载产物
+    void createExport(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback);
+    void getExport(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback);
+    void downloadExport(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback);
+
+    // 批量导出为 ZIP（流式响应）
+    void exportBulk(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback);
+
     // 获取当前用户在文档上的权限
     void getPermission(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback);
 };
\ No newline at end of file
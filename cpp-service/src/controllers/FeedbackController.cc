@@ -4,6 +4,8 @@
 
 #include <utility>
 
+#include "../repositories/StatementRegistry.h"
+#include "../utils/PermissionUtils.h"
 #include "../utils/ResponseUtils.h"
 
 using drogon::orm::Result;
@@ -98,7 +100,7 @@ void FeedbackController::getFeedbackStats(const HttpRequestPtr& req,
     int userId = std::stoi(userIdStr);
     auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr&)>>(std::move(callback));
 
-    ensureAdmin(userId, callbackPtr, [=]() {
+    PermissionUtils::ensureAdmin(userId, callbackPtr, [=]() {
         std::string dimension = req->getParameter("dimension");
         std::string limitStr = req->getParameter("limit");
         int limit = 20;
@@ -184,30 +186,3 @@ void FeedbackController::getFeedbackStats(const HttpRequestPtr& req,
     });
 }
 
-bool FeedbackController::ensureAdmin(int userId, std::shared_ptr<std::function<void(const HttpResponsePtr&)>> callback,
-                                     std::function<void()> onSuccess) {
-    auto db = drogon::app().getDbClient();
-    if (!db) {
-        ResponseUtils::sendError(*callback, "Database not available", k500InternalServerError);
-        return false;
-    }
-    db->execSqlAsync(
-            "SELECT role FROM \"user\" WHERE id = $1",
-            [=](const Result& r) {
-                if (r.empty()) {
-                    ResponseUtils::sendError(*callback, "User not found", k404NotFound);
-                    return;
-                }
-                if (r[0]["role"].as<std::string>() != "admin") {
-                    ResponseUtils::sendError(*callback, "Admin privileges required", k403Forbidden);
-                    return;
-                }
-                onSuccess();
-            },
-            [=](const drogon::orm::DrogonDbException& e) {
-                ResponseUtils::sendError(*callback, "Database error: " + std::string(e.base().what()),
-                                         k500InternalServerError);
-            },
-            std::to_string(userId));
-    return true;
-}
@@ -16,11 +16,6 @@ public:
 
     void submitFeedback(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback);
     void getFeedbackStats(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback);
-
-private:
-    bool ensureAdmin(int userId,
-                     std::shared_ptr<std::function<void(const HttpResponsePtr&)>> callback,
-                     std::function<void()> onSuccess);
 };
 
 
@@ -7,6 +7,9 @@
 #include <sstream>
 #include <vector>
 
+#include "../repositories/StatementRegistry.h"
+#include "../services/NotificationBus.h"
+#include "../services/NotificationCounter.h"
 #include "../utils/ResponseUtils.h"
 
 void NotificationController::getNotifications(const HttpRequestPtr& req,
@@ -104,23 +107,8 @@ void NotificationController::getNotifications(const HttpRequestPtr& req,
     auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr&)>>(std::move(callback));
     int offset = (page - 1) * pageSize;
 
-    std::string baseQuery =
-            "FROM notification n "
-            "WHERE n.user_id = $1::bigint "
-            "  AND ($2::boolean = FALSE OR n.is_read = FALSE) "
-            "  AND ($3 = '' OR n.type = $3) "
-            "  AND ($4 = '' OR (n.payload->>'doc_id') = $4) "
-            "  AND ($5 = '' OR n.created_at >= $5::timestamptz) "
-            "  AND ($6 = '' OR n.created_at <= $6::timestamptz) ";
-
-    std::string listSql = "SELECT n.id, n.type, n.payload::text AS payload_text, n.is_read, n.created_at " + baseQuery +
-            "ORDER BY n.created_at DESC "
-            "LIMIT $7::integer OFFSET $8::integer";
-
-    std::string countSql = "SELECT COUNT(*) AS total " + baseQuery;
-
     db->execSqlAsync(
-            listSql,
+            StatementRegistry::notificationList(),
             [=](const drogon::orm::Result& r) {
                 auto responseJson = std::make_shared<Json::Value>();
                 Json::Value notificationsArray(Json::arrayValue);
@@ -158,8 +146,24 @@ void NotificationController::getNotifications(const HttpRequestPtr& req,
                 (*responseJson)["filters"]["end_date"] = endDate;
                 (*responseJson)["filters"]["unread_only"] = unreadOnly;
 
+                // 仅筛选未读且无其他条件时，总数即未读计数，无需再 COUNT
+                bool totalIsUnreadCount = unreadOnly && typeFilter.empty() && docIdFilter.empty() &&
+                                          startDate.empty() && endDate.empty();
+                if (totalIsUnreadCount) {
+                    NotificationCounter::getUnreadCount(
+                            std::stoi(userIdStr),
+                            [=](int unread) {
+                                (*responseJson)["total"] = unread;
+                                ResponseUtils::sendSuccess(*callbackPtr, *responseJson, k200OK);
+                            },
+                            [=](const std::string& error) {
+                                ResponseUtils::sendError(*callbackPtr, error, k500InternalServerError);
+                            });
+                    return;
+                }
+
                 db->execSqlAsync(
-                        countSql,
+                        StatementRegistry::notificationCount(),
                         [=](const drogon::orm::Result& countResult) {
                             int total = 0;
                             if (!countResult.empty()) {
@@ -240,18 +244,37 @@ void NotificationController::markAsRead(const HttpRequestPtr& req,
     }
     arrayBuilder << "}";
 
+    // 只扣减此前确实未读的通知，未读计数与状态在同一语句内更新
     db->execSqlAsync(
-            "UPDATE notification SET is_read = TRUE "
-            "WHERE user_id = $1::bigint AND id = ANY($2::bigint[])",
-            [=](const drogon::orm::Result&) {
+            "WITH upd AS ("
+            "   UPDATE notification SET is_read = TRUE "
+            "   WHERE user_id = $1::bigint AND id = ANY($2::bigint[]) AND is_read = FALSE "
+            "   RETURNING id"
+            "), cnt AS ("
+            "   INSERT INTO notification_counter (user_id, unread) VALUES ($1::bigint, 0) "
+            "   ON CONFLICT (user_id) DO UPDATE "
+            "   SET unread = GREATEST(notification_counter.unread - (SELECT COUNT(*) FROM upd), 0), "
+            "       updated_at = NOW() "
+            "   RETURNING unread"
+            ") "
+            "SELECT cnt.unread, "
+            "       pg_notify($3, json_build_object('origin', $4::text, 'user_id', $1::bigint, "
+            "                                       'unread', cnt.unread)::text) "
+            "FROM cnt",
+            [=](const drogon::orm::Result& r) {
                 Json::Value responseJson;
                 responseJson["message"] = "Notifications marked as read";
+                if (!r.empty()) {
+                    int unread = r[0]["unread"].as<int>();
+                    NotificationCounter::update(std::stoi(userIdStr), unread);
+                    responseJson["unread_count"] = unread;
+                }
                 ResponseUtils::sendSuccess(*callbackPtr, responseJson, k200OK);
             },
             [=](const drogon::orm::DrogonDbException& e) {
                 ResponseUtils::sendError(*callbackPtr, "Database error: " + std::string(e.base().what()));
             },
-            userIdStr, arrayBuilder.str());
+            userIdStr, arrayBuilder.str(), NotificationBus::channel(), NotificationBus::instanceId());
 }
 
 void NotificationController::getUnreadCount(const HttpRequestPtr& req,
@@ -263,25 +286,23 @@ void NotificationController::getUnreadCount(const HttpRequestPtr& req,
         return;
     }
 
-    // 2.查询未读通知数量
-    auto db = drogon::app().getDbClient();
-    if (!db) {
-        ResponseUtils::sendError(callback, "Database not available", k500InternalServerError);
+    // 2.读取未读计数（内存缓存 / notification_counter）
+    int userId;
+    try {
+        userId = std::stoi(userIdStr);
+    } catch (...) {
+        ResponseUtils::sendError(callback, "Invalid user ID", k400BadRequest);
         return;
     }
     auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr&)>>(std::move(callback));
-    db->execSqlAsync(
-            "SELECT COUNT(*) as count "
-            "FROM notification "
-            "WHERE user_id = $1::bigint AND is_read = FALSE",
-            [=](const drogon::orm::Result& r) {
+    NotificationCounter::getUnreadCount(
+            userId,
+            [callbackPtr](int unread) {
                 Json::Value responseJson;
-                responseJson["unread_count"] = r[0]["count"].as<int>();
+                responseJson["unread_count"] = unread;
                 ResponseUtils::sendSuccess(*callbackPtr, responseJson, k200OK);
             },
-            [=](const drogon::orm::DrogonDbException& e) {
-                ResponseUtils::sendError(*callbackPtr, "Database error: " + std::string(e.base().what()),
-                                         k500InternalServerError);
-            },
-            userIdStr);
-}
\ No newline at end of file
+            [callbackPtr](const std::string& error) {
+                ResponseUtils::sendError(*callbackPtr, error, k500InternalServerError);
+            });
+}
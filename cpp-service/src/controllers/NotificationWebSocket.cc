@@ -2,7 +2,12 @@
 
 #include <json/writer.h>
 
+#include <chrono>
+
 namespace {
+// 服务端主动 ping 的间隔；客户端回 pong 即视为已读走此前发送的数据。
+constexpr auto kPingInterval = std::chrono::seconds(15);
+
 struct ConnectionContext {
     size_t connectionId{0};
     int userId{0};
@@ -56,6 +61,7 @@ void NotificationWebSocket::handleNewConnection(const drogon::HttpRequestPtr& re
     ctx->connectionId = connectionId;
     ctx->userId = userId;
     conn->setContext(ctx);
+    conn->setPingMessage("", kPingInterval);
 
     // 连接成功后给客户端一个简单确认消息，便于调试。
     Json::Value ack;
@@ -75,6 +81,12 @@ void NotificationWebSocket::handleConnectionClosed(const drogon::WebSocketConnec
 
 void NotificationWebSocket::handleNewMessage(const drogon::WebSocketConnectionPtr& conn, std::string&& message,
                                              const drogon::WebSocketMessageType& type) {
+    // 任何来自客户端的帧（含 pong）都说明它仍在读取，用于出站背压统计
+    auto ctx = conn->getContext<ConnectionContext>();
+    if (ctx) {
+        NotificationHub::acknowledge(ctx->connectionId);
+    }
+
     // 目前通知通道仅用于服务端推送，客户端消息仅用于心跳
     if (type == drogon::WebSocketMessageType::Ping) {
         conn->send(std::move(message));
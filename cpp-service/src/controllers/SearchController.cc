@@ -3,9 +3,6 @@
 #include <drogon/utils/Utilities.h>  // 用于 urlDecode
 #include <json/json.h>
 
-#include <set>
-#include <vector>
-
 #include "../services/SearchService.h"
 #include "../utils/ResponseUtils.h"
 
@@ -53,89 +50,37 @@ void SearchController::search(const HttpRequestPtr& req, std::function<void(cons
     } catch (...) {
     }
 
-    // 2.执行搜索
+    std::string userIdStr = req->getParameter("user_id");
+    if (userIdStr.empty()) {
+        ResponseUtils::sendError(callback, "User ID not found", k401Unauthorized);
+        return;
+    }
+    int userId;
+    try {
+        userId = std::stoi(userIdStr);
+    } catch (...) {
+        ResponseUtils::sendError(callback, "Invalid user ID", k400BadRequest);
+        return;
+    }
+
+    // 2.执行搜索（权限过滤在索引内完成，当前页再按数据库复核，返回的命中与总数均只包含可访问的文档）
     auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr&)>>(std::move(callback));
 
     SearchService::search(
-            query, page, pageSize,
+            query, page, pageSize, userId,
             [=](const Json::Value& searchResult) {
-                // 3.过滤结果(只返回用户有权限访问的文档)
-                std::string userIdStr = req->getParameter("user_id");
-                if (userIdStr.empty()) {
-                    ResponseUtils::sendError(*callbackPtr, "User ID not found", k401Unauthorized);
-                    return;
-                }
-
-                // 获取搜索结果中的文档 ID
-                Json::Value hits = searchResult["hits"];
-                std::vector<int> docIds;
-                for (const auto& hit : hits) {
-                    docIds.push_back(hit["id"].asInt());
-                }
-
-                // 如果没有搜索结果，直接返回空结果
-                if (docIds.empty()) {
-                    Json::Value responseJson;
-                    responseJson["hits"] = Json::arrayValue;
-                    responseJson["query"] = query;
-                    responseJson["page"] = page;
-                    responseJson["page_size"] = pageSize;
-                    responseJson["total"] = 0;
-                    responseJson["total_hits"] = 0;
-                    ResponseUtils::sendSuccess(*callbackPtr, responseJson, k200OK);
-                    return;
-                }
-
-                // 查询用户有权限访问的文档
-                auto db = drogon::app().getDbClient();
-                if (!db) {
-                    ResponseUtils::sendError(*callbackPtr, "Database not available", k500InternalServerError);
-                    return;
-                }
-
-                // 构建文档ID列表
-                std::string docIdsStr;
-                for (size_t i = 0; i < docIds.size(); i++) {
-                    if (i > 0) docIdsStr += ",";
-                    docIdsStr += std::to_string(docIds[i]);
-                }
-                db->execSqlAsync(
-                        "SELECT DISTINCT d.id "
-                        "FROM document d "
-                        "LEFT JOIN doc_acl da ON d.id = da.doc_id "
-                        "WHERE d.id IN (" +
-                                docIdsStr +
-                                ") "
-                                "AND (d.owner_id = $1 OR da.user_id = $1)",
-                        [=](const drogon::orm::Result& r) {
-                            std::set<int> allowedDocsIds;
-                            for (const auto& row : r) {
-                                allowedDocsIds.insert(row["id"].as<int>());
-                            }
-                            // 过滤搜索结果
-                            Json::Value filteredHits(Json::arrayValue);
-                            for (const auto& hit : hits) {
-                                int docId = hit["id"].asInt();
-                                if (allowedDocsIds.find(docId) != allowedDocsIds.end()) {
-                                    filteredHits.append(hit);
-                                }
-                            }
-
-                            Json::Value responseJson;
-                            responseJson["hits"] = filteredHits;
-                            responseJson["query"] = query;
-                            responseJson["page"] = page;
-                            responseJson["page_size"] = pageSize;
-                            int filteredTotal = static_cast<int>(filteredHits.size());
-                            responseJson["total_hits"] = filteredTotal;
-                            responseJson["total"] = filteredTotal;
-
-                            ResponseUtils::sendSuccess(*callbackPtr, responseJson, k200OK);
-                        },
-                        [=](const drogon::orm::DrogonDbException& e) {
-                            ResponseUtils::sendError(*callbackPtr, "Database error: " + std::string(e.base().what()));
-                        },
-                        userIdStr);
+                Json::Value responseJson;
+                responseJson["hits"] = searchResult["hits"].isArray() ? searchResult["hits"]
+                                                                      : Json::Value(Json::arrayValue);
+                responseJson["query"] = query;
+                responseJson["page"] = page;
+                responseJson["page_size"] = pageSize;
+                int total = searchResult["totalHits"].asInt();
+                responseJson["total_hits"] = total;
+                responseJson["total"] = total;
+                responseJson["total_pages"] = searchResult["totalPages"].asInt();
+
+                ResponseUtils::sendSuccess(*callbackPtr, responseJson, k200OK);
             },
             [=](const std::string& error) {
                 ResponseUtils::sendError(*callbackPtr, "Search error:" + error, k500InternalServerError);
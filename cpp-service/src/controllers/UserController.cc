@@ -3,6 +3,11 @@
 #include <drogon/drogon.h>
 #include <drogon/utils/Utilities.h>  // 用于 urlDecode
 
+#include <algorithm>
+#include <cctype>
+
+#include "../repositories/StatementRegistry.h"
+#include "../services/UserSearchCache.h"
 #include "../utils/ResponseUtils.h"
 
 void UserController::getMe(const HttpRequestPtr& req, std::function<void(const HttpResponsePtr&)>&& callback) {
@@ -271,129 +276,113 @@ void UserController::searchUsers(const HttpRequestPtr& req, std::function<void(c
         return;
     }
 
-    // 4.构建搜索查询
-    // 支持按用户ID、邮箱、昵称搜索
-    std::string searchPattern = "%" + query + "%";
+    // 4.构建搜索模式：转义 LIKE 通配符，关键词按字面匹配
+    std::string escaped;
+    for (char c : query) {
+        if (c == '\\' || c == '%' || c == '_') escaped += '\\';
+        escaped += c;
+    }
+    // 按 UTF-8 字符计数：单个字符按前缀匹配，其余按子串匹配（“小明”也能找到“王小明”）
+    size_t queryChars = std::count_if(query.begin(), query.end(), [](char c) { return (c & 0xC0) != 0x80; });
+    bool shortQuery = queryChars < StatementRegistry::kUserSearchMinTrigram;
+    bool prefixQuery = queryChars < StatementRegistry::kUserSearchMinSubstring;
+    std::string searchPattern = prefixQuery ? escaped + "%" : "%" + escaped + "%";
     int offset = (page - 1) * pageSize;
 
-    // 检查查询是否为纯数字（用户ID搜索）
-    bool isNumericQuery = false;
-    int userIdQuery = 0;
-    try {
-        userIdQuery = std::stoi(query);
-        isNumericQuery = true;
-    } catch (...) {
-        isNumericQuery = false;
-    }
-
-    // 先查询总数
-    std::string countQuery;
-    if (isNumericQuery) {
-        // 如果是数字，同时匹配ID和文本字段
-        countQuery =
-                "SELECT COUNT(*) as total "
-                "FROM \"user\" u "
-                "LEFT JOIN user_profile p ON u.id = p.user_id "
-                "WHERE u.id = $1::integer OR u.email ILIKE $2 OR COALESCE(p.nickname, '') ILIKE $2";
-    } else {
-        // 如果不是数字，只匹配文本字段
-        countQuery =
-                "SELECT COUNT(*) as total "
-                "FROM \"user\" u "
-                "LEFT JOIN user_profile p ON u.id = p.user_id "
-                "WHERE u.email ILIKE $1 OR COALESCE(p.nickname, '') ILIKE $1";
-    }
+    // 纯数字的关键词同时按用户ID匹配
+    bool isNumericQuery = query.size() <= 18 &&
+                          std::all_of(query.begin(), query.end(), [](char c) { return c >= '0' && c <= '9'; });
+    int64_t userIdQuery = isNumericQuery ? std::stoll(query) : 0;
 
     // 创建 callback 的 shared_ptr 以便在 lambda 中使用
     auto callbackPtr = std::make_shared<std::function<void(const HttpResponsePtr&)>>(std::move(callback));
 
-    auto countCallback = [=](const drogon::orm::Result& countResult) mutable {
-        int total = 0;
-        if (!countResult.empty()) {
-            total = countResult[0]["total"].as<int>();
-        }
-
-        // 查询用户列表
-        std::string listQuery;
-        if (isNumericQuery) {
-            listQuery =
-                    "SELECT u.id, u.email, u.role, u.status, u.is_locked, u.remark, u.last_login_at, u.created_at, "
-                    "u.updated_at, p.nickname, p.avatar_url, p.bio "
-                    "FROM \"user\" u "
-                    "LEFT JOIN user_profile p ON u.id = p.user_id "
-                    "WHERE u.id = $1::integer OR u.email ILIKE $2 OR COALESCE(p.nickname, '') ILIKE $2 "
-                    "ORDER BY u.id "
-                    "LIMIT $3::integer OFFSET $4::integer";
-        } else {
-            listQuery =
-                    "SELECT u.id, u.email, u.role, u.status, u.is_locked, u.remark, u.last_login_at, u.created_at, "
-                    "u.updated_at, p.nickname, p.avatar_url, p.bio "
-                    "FROM \"user\" u "
-                    "LEFT JOIN user_profile p ON u.id = p.user_id "
-                    "WHERE u.email ILIKE $1 OR COALESCE(p.nickname, '') ILIKE $1 "
-                    "ORDER BY u.id "
-                    "LIMIT $2::integer OFFSET $3::integer";
+    // 从按 id 排序的结果中自 from 起取一页
+    auto respond = [callbackPtr, page, pageSize](const Json::Value& users, Json::ArrayIndex from, bool hasMore) {
+        Json::Value usersArray(Json::arrayValue);
+        for (Json::ArrayIndex i = from; i < users.size() && i < from + static_cast<Json::ArrayIndex>(pageSize); ++i) {
+            usersArray.append(users[i]);
         }
 
-        auto listCallback = [=](const drogon::orm::Result& r) mutable {
-            Json::Value responseJson;
-            Json::Value usersArray(Json::arrayValue);
-
-            for (const auto& row : r) {
-                Json::Value userJson;
-                userJson["id"] = row["id"].as<int>();
-                userJson["email"] = row["email"].as<std::string>();
-                userJson["role"] = row["role"].as<std::string>();
-                userJson["status"] = row["status"].as<std::string>();
-                userJson["is_locked"] = row["is_locked"].as<bool>();
-                if (!row["remark"].isNull()) {
-                    userJson["remark"] = row["remark"].as<std::string>();
-                }
-                if (!row["last_login_at"].isNull()) {
-                    userJson["last_login_at"] = row["last_login_at"].as<std::string>();
-                }
-                userJson["created_at"] = row["created_at"].as<std::string>();
-                userJson["updated_at"] = row["updated_at"].as<std::string>();
+        Json::Value responseJson;
+        responseJson["users"] = usersArray;
+        responseJson["has_more"] = hasMore;
+        responseJson["page"] = page;
+        responseJson["page_size"] = pageSize;
+        ResponseUtils::sendSuccess(*callbackPtr, responseJson);
+    };
+    // complete 表示缓存的结果已是全部结果，否则其后还有更多
+    auto respondFromEntry = [respond, offset, pageSize](const Json::Value& users, bool complete) {
+        respond(users, static_cast<Json::ArrayIndex>(offset),
+                users.size() > static_cast<Json::ArrayIndex>(offset + pageSize) || !complete);
+    };
 
-                Json::Value profileJson;
-                profileJson["nickname"] = row["nickname"].isNull() ? "" : row["nickname"].as<std::string>();
-                profileJson["avatar_url"] = row["avatar_url"].isNull() ? "" : row["avatar_url"].as<std::string>();
-                profileJson["bio"] = row["bio"].isNull() ? "" : row["bio"].as<std::string>();
-                userJson["profile"] = profileJson;
+    // 5.分页范围在缓存条目内时（输入联想的常见情况）先查缓存，未命中则一次取满一个条目
+    std::string cacheKey = query;
+    std::transform(cacheKey.begin(), cacheKey.end(), cacheKey.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    bool cacheable = static_cast<size_t>(offset + pageSize) <= UserSearchCache::kRowsPerEntry;
+    if (cacheable) {
+        Json::Value cached;
+        bool complete = false;
+        if (UserSearchCache::lookup(cacheKey, cached, complete)) {
+            respondFromEntry(cached, complete);
+            return;
+        }
+    }
 
-                usersArray.append(userJson);
+    // 多取一行用于判断是否还有下一页，不再统计总数
+    int limit = cacheable ? static_cast<int>(UserSearchCache::kRowsPerEntry) + 1 : pageSize + 1;
+    int queryOffset = cacheable ? 0 : offset;
+
+    auto listCallback = [=](const drogon::orm::Result& r) mutable {
+        Json::Value usersArray(Json::arrayValue);
+        for (const auto& row : r) {
+            Json::Value userJson;
+            userJson["id"] = row["id"].as<int>();
+            userJson["email"] = row["email"].as<std::string>();
+            userJson["role"] = row["role"].as<std::string>();
+            userJson["status"] = row["status"].as<std::string>();
+            userJson["is_locked"] = row["is_locked"].as<bool>();
+            if (!row["remark"].isNull()) {
+                userJson["remark"] = row["remark"].as<std::string>();
             }
+            if (!row["last_login_at"].isNull()) {
+                userJson["last_login_at"] = row["last_login_at"].as<std::string>();
+            }
+            userJson["created_at"] = row["created_at"].as<std::string>();
+            userJson["updated_at"] = row["updated_at"].as<std::string>();
 
-            responseJson["users"] = usersArray;
-            responseJson["total"] = total;
-            responseJson["page"] = page;
-            responseJson["page_size"] = pageSize;
-
-            ResponseUtils::sendSuccess(*callbackPtr, responseJson);
-        };
+            Json::Value profileJson;
+            profileJson["nickname"] = row["nickname"].isNull() ? "" : row["nickname"].as<std::string>();
+            profileJson["avatar_url"] = row["avatar_url"].isNull() ? "" : row["avatar_url"].as<std::string>();
+            profileJson["bio"] = row["bio"].isNull() ? "" : row["bio"].as<std::string>();
+            userJson["profile"] = profileJson;
 
-        auto listErrorCallback = [=](const drogon::orm::DrogonDbException& e) mutable {
-            LOG_ERROR << "Database error in searchUsers: " << e.base().what();
-            ResponseUtils::sendError(*callbackPtr, "Database error: " + std::string(e.base().what()),
-                                     drogon::k500InternalServerError);
-        };
+            usersArray.append(userJson);
+        }
 
-        if (isNumericQuery) {
-            db->execSqlAsync(listQuery, listCallback, listErrorCallback, userIdQuery, searchPattern, pageSize, offset);
+        bool complete = r.size() < static_cast<size_t>(limit);
+        if (cacheable) {
+            if (!complete) usersArray.resize(UserSearchCache::kRowsPerEntry);
+            UserSearchCache::store(cacheKey, usersArray, complete);
+            respondFromEntry(usersArray, complete);
         } else {
-            db->execSqlAsync(listQuery, listCallback, listErrorCallback, searchPattern, pageSize, offset);
+            respond(usersArray, 0, !complete);
         }
     };
 
-    auto countErrorCallback = [=](const drogon::orm::DrogonDbException& e) mutable {
-        LOG_ERROR << "Database error in searchUsers (count): " << e.base().what();
+    auto listErrorCallback = [=](const drogon::orm::DrogonDbException& e) mutable {
+        LOG_ERROR << "Database error in searchUsers: " << e.base().what();
         ResponseUtils::sendError(*callbackPtr, "Database error: " + std::string(e.base().what()),
                                  drogon::k500InternalServerError);
     };
 
+    const std::string& listQuery = StatementRegistry::userSearch(isNumericQuery, shortQuery);
     if (isNumericQuery) {
-        db->execSqlAsync(countQuery, countCallback, countErrorCallback, userIdQuery, searchPattern);
+        db->execSqlAsync(listQuery, listCallback, listErrorCallback, searchPattern, limit, queryOffset,
+                         userIdQuery);
     } else {
-        db->execSqlAsync(countQuery, countCallback, countErrorCallback, searchPattern);
+        db->execSqlAsync(listQuery, listCallback, listErrorCallback, searchPattern, limit, queryOffset);
     }
 }
\ No newline at end of file
@@ -6,6 +6,11 @@
 #include <iostream>
 #include <string>
 
+#include "services/AnalyticsRollup.h"
+#include "services/NotificationBus.h"
+#include "services/SearchService.h"
+#include "services/UserActivityStats.h"
+
 int main(int argc, char* argv[]) {
     // 查找配置文件（支持从不同目录运行）
     std::string configPath = "config.json";
@@ -21,7 +26,17 @@ int main(int argc, char* argv[]) {
         std::cout << "Starting Drogon server..." << std::endl;
         std::cout << "检查连接状态请访问: http://localhost:8080/health" << std::endl;
         app.loadConfigFile(configPath);  // 加载配置文件
+        // 事件循环启动后再建立 LISTEN 连接，用于多实例间的通知扇出
+        app.registerBeginningAdvice([]() { NotificationBus::start(); });
+        // 声明搜索索引的可过滤字段，并为已有文档补齐 ACL 字段
+        app.registerBeginningAdvice([]() { SearchService::initialize(); });
+        // 定期校正管理员用户列表使用的活跃度计数
+        app.registerBeginningAdvice([]() { UserActivityStats::start(); });
+        // 管理员统计的分时汇总
+        app.registerBeginningAdvice([]() { AnalyticsRollup::start(); });
         app.run();
+        // 事件循环退出后停止本地索引的落盘线程，内存段写出为段文件
+        SearchService::shutdown();
     } catch (const std::exception& e) {
         std::cerr << "Error starting application: " << e.what() << std::endl;
         return 1;
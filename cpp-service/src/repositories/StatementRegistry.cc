@@ -0,0 +1,222 @@
+#include "StatementRegistry.h"
+
+namespace {
+// 时间戳转为自 epoch 起的微秒数。PG14 之前 EXTRACT 返回 float8，EPOCH * 1000000 可能丢掉末位微秒，
+// 游标与存储值不再相等，翻页边界会重复或跳过行；这里整秒与秒内微秒分开取整再相加，两部分都能被 float8 精确表示
+#define UPDATED_US(expr)                                                    \
+    "(EXTRACT(EPOCH FROM date_trunc('second', " expr "))::bigint * 1000000 + " \
+    "EXTRACT(MICROSECONDS FROM " expr ")::bigint % 1000000)"
+
+std::string buildDocumentList(bool statusFilter, bool cursor) {
+    int nextParam = 2;
+    std::string sql =
+            "SELECT d.id, d.title, d.owner_id, d.is_locked, d.status, d.created_at, d.updated_at, "
+            "       " UPDATED_US("u.updated_at") " AS updated_us "
+            "FROM user_doc_access u "
+            "JOIN document d ON d.id = u.doc_id "
+            "WHERE u.user_id = $1::bigint";
+    if (statusFilter) {
+        sql += " AND d.status = $" + std::to_string(nextParam++) + "::text";
+    }
+    if (cursor) {
+        // 同样拆成整秒与微秒两段还原时间戳，避免大数乘 interval 时经过 float8
+        std::string us = "$" + std::to_string(nextParam) + "::bigint";
+        std::string bound = "TIMESTAMPTZ 'epoch' + (" + us + " / 1000000) * INTERVAL '1 second' + (" + us +
+                            " % 1000000) * INTERVAL '1 microsecond'";
+        sql += " AND (u.updated_at, u.doc_id) < (" + bound + ", $" + std::to_string(nextParam + 1) + "::bigint)";
+        nextParam += 2;
+    }
+    sql += " ORDER BY u.updated_at DESC, u.doc_id DESC LIMIT $" + std::to_string(nextParam) + "::integer OFFSET $" +
+           std::to_string(nextParam + 1) + "::integer";
+    return sql;
+}
+
+std::string buildDocumentCount(bool statusFilter, bool estimate) {
+    std::string visible = statusFilter ? "SELECT 1 FROM user_doc_access u JOIN document d ON d.id = u.doc_id "
+                                         "WHERE u.user_id = $1::bigint AND d.status = $2::text"
+                                       : "SELECT 1 FROM user_doc_access u WHERE u.user_id = $1::bigint";
+    if (estimate) {
+        visible += " LIMIT " + std::to_string(StatementRegistry::kDocumentCountEstimateCap + 1);
+    }
+    return "SELECT COUNT(*) AS total FROM (" + visible + ") v";
+}
+
+std::string buildUserSearch(bool byId, bool shortQuery) {
+    // lower($1) 在按实际参数规划时折叠为常量，LIKE 'a%' 才能转成索引范围扫描；
+    // '%ab%' 用不上任何索引，按 ORDER BY id LIMIT 沿主键扫描，匹配足够多时提前停止
+    std::string email = shortQuery ? "lower(email) LIKE lower($1)" : "email ILIKE $1";
+    std::string nickname = shortQuery ? "lower(nickname) LIKE lower($1)" : "nickname ILIKE $1";
+    std::string candidates =
+            "(SELECT id FROM \"user\" WHERE " + email + " ORDER BY id LIMIT $2::integer + $3::integer) "
+            "UNION "
+            "(SELECT user_id FROM user_profile WHERE " + nickname + " ORDER BY user_id "
+            " LIMIT $2::integer + $3::integer)";
+    if (byId) {
+        candidates += " UNION SELECT $4::bigint";
+    }
+    return "SELECT u.id, u.email, u.role, u.status, u.is_locked, u.remark, u.last_login_at, u.created_at, "
+           "       u.updated_at, p.nickname, p.avatar_url, p.bio "
+           "FROM (" +
+           candidates +
+           ") m(id) "
+           "JOIN \"user\" u ON u.id = m.id "
+           "LEFT JOIN user_profile p ON p.user_id = u.id "
+           "ORDER BY u.id LIMIT $2::integer OFFSET $3::integer";
+}
+
+// 通知列表与计数共用的筛选条件
+const char* const kNotificationFilter =
+        "FROM notification n "
+        "WHERE n.user_id = $1::bigint "
+        "  AND ($2::boolean = FALSE OR n.is_read = FALSE) "
+        "  AND ($3 = '' OR n.type = $3) "
+        "  AND ($4 = '' OR (n.payload->>'doc_id') = $4) "
+        "  AND ($5 = '' OR n.created_at >= $5::timestamptz) "
+        "  AND ($6 = '' OR n.created_at <= $6::timestamptz) ";
+
+}  // namespace
+
+const std::string& StatementRegistry::docPermission() {
+    static const std::string sql =
+            "SELECT permission FROM user_doc_access "
+            "WHERE user_id = $2::bigint AND doc_id = $1::bigint";
+    return sql;
+}
+
+const std::string& StatementRegistry::docAccessExists() {
+    static const std::string sql = "SELECT 1 FROM user_doc_access WHERE user_id = $2::bigint AND doc_id = $1::bigint";
+    return sql;
+}
+
+const std::string& StatementRegistry::userRole() {
+    static const std::string sql = "SELECT role FROM \"user\" WHERE id = $1::bigint";
+    return sql;
+}
+
+const std::string& StatementRegistry::documentWithTags() {
+    static const std::string sql =
+            "SELECT d.id, d.title, d.owner_id, d.is_locked, d.status, d.last_published_version_id, "
+            "       d.created_at, d.updated_at, "
+            "       COALESCE(json_agg(json_build_object('id', t.id, 'name', t.name)) "
+            "                FILTER (WHERE t.id IS NOT NULL), '[]'::json) as tags "
+            "FROM document d "
+            "LEFT JOIN doc_tag dt ON d.id = dt.doc_id "
+            "LEFT JOIN tag t ON dt.tag_id = t.id "
+            "WHERE d.id = $1::integer "
+            "GROUP BY d.id";
+    return sql;
+}
+
+const std::string& StatementRegistry::publishedVersion() {
+    static const std::string sql =
+            "SELECT dv.snapshot_url, dv.snapshot_sha256, dv.id AS version_id, dv.size_bytes, dv.content_html, "
+            "       dv.content_text "
+            "FROM document d "
+            "LEFT JOIN document_version dv ON d.last_published_version_id = dv.id "
+            "WHERE d.id = $1::integer";
+    return sql;
+}
+
+const std::string& StatementRegistry::bootstrapVersion() {
+    static const std::string sql =
+            "SELECT a.permission, dv.snapshot_url, dv.snapshot_sha256, dv.id AS version_id, dv.size_bytes, "
+            "       dv.content_html, dv.content_text "
+            "FROM document d "
+            "LEFT JOIN user_doc_access a ON a.doc_id = d.id AND a.user_id = $2::bigint "
+            "LEFT JOIN document_version dv ON d.last_published_version_id = dv.id "
+            "WHERE d.id = $1::integer";
+    return sql;
+}
+
+const std::string& StatementRegistry::documentList(bool statusFilter, bool cursor) {
+    // 下标：statusFilter * 2 + cursor
+    static const std::string shapes[4] = {buildDocumentList(false, false), buildDocumentList(false, true),
+                                          buildDocumentList(true, false), buildDocumentList(true, true)};
+    return shapes[(statusFilter ? 2 : 0) + (cursor ? 1 : 0)];
+}
+
+const std::string& StatementRegistry::documentCount(bool statusFilter, bool estimate) {
+    // 下标：statusFilter * 2 + estimate
+    static const std::string shapes[4] = {buildDocumentCount(false, false), buildDocumentCount(false, true),
+                                          buildDocumentCount(true, false), buildDocumentCount(true, true)};
+    return shapes[(statusFilter ? 2 : 0) + (estimate ? 1 : 0)];
+}
+
+const std::string& StatementRegistry::versionDocumentInfo() {
+    static const std::string sql =
+            "SELECT owner_id, COALESCE(version_retention_limit, 0) AS retention_limit "
+            "FROM document WHERE id = $1::integer";
+    return sql;
+}
+
+const std::string& StatementRegistry::versionInsert() {
+    static const std::string sql =
+            "WITH next_version AS ("
+            "  SELECT COALESCE(MAX(version_number), 0) + 1 AS next_val "
+            "  FROM document_version WHERE doc_id = $1::bigint"
+            ") "
+            "INSERT INTO document_version "
+            "(doc_id, version_number, snapshot_url, snapshot_sha256, size_bytes, created_by, change_summary, source, "
+            "content_text, content_html) "
+            "SELECT $1::bigint, next_val, $2, $3, $4::bigint, $5::integer, NULLIF($6, ''), $7, NULLIF($8, ''), "
+            "NULLIF($9, '') "
+            "FROM next_version "
+            "RETURNING id, version_number";
+    return sql;
+}
+
+const std::string& StatementRegistry::versionSetPublished() {
+    static const std::string sql =
+            "UPDATE document SET last_published_version_id = $1::bigint, updated_at = NOW() "
+            "WHERE id = $2::integer";
+    return sql;
+}
+
+const std::string& StatementRegistry::versionCleanupAuto() {
+    static const std::string sql =
+            "WITH ordered AS ("
+            "  SELECT id FROM document_version "
+            "  WHERE doc_id = $1::bigint AND source = 'auto' "
+            "  ORDER BY version_number DESC "
+            "  OFFSET $2::integer"
+            ") "
+            "DELETE FROM document_version WHERE id IN (SELECT id FROM ordered)";
+    return sql;
+}
+
+const std::string& StatementRegistry::notificationList() {
+    static const std::string sql = std::string("SELECT n.id, n.type, n.payload::text AS payload_text, n.is_read, "
+                                               "n.created_at ") +
+                                   kNotificationFilter +
+                                   "ORDER BY n.created_at DESC "
+                                   "LIMIT $7::integer OFFSET $8::integer";
+    return sql;
+}
+
+const std::string& StatementRegistry::notificationCount() {
+    static const std::string sql = std::string("SELECT COUNT(*) AS total ") + kNotificationFilter;
+    return sql;
+}
+
+const std::string& StatementRegistry::notificationUnreadCounter() {
+    // 计数行不存在时按 notification 表回填一次；并发回填时保留已有值
+    static const std::string sql =
+            "WITH existing AS ("
+            "   SELECT unread FROM notification_counter WHERE user_id = $1::bigint"
+            "), filled AS ("
+            "   INSERT INTO notification_counter (user_id, unread) "
+            "   SELECT $1::bigint, COUNT(*) FROM notification "
+            "   WHERE user_id = $1::bigint AND is_read = FALSE AND NOT EXISTS (SELECT 1 FROM existing) "
+            "   ON CONFLICT (user_id) DO UPDATE SET unread = notification_counter.unread "
+            "   RETURNING unread"
+            ") "
+            "SELECT unread FROM existing UNION ALL SELECT unread FROM filled";
+    return sql;
+}
+
+const std::string& StatementRegistry::userSearch(bool byId, bool shortQuery) {
+    static const std::string shapes[4] = {buildUserSearch(false, false), buildUserSearch(true, false),
+                                          buildUserSearch(false, true), buildUserSearch(true, true)};
+    return shapes[(shortQuery ? 2 : 0) + (byId ? 1 : 0)];
+}
+
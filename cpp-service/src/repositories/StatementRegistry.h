@@ -0,0 +1,85 @@
+#pragma once
+
+#include <string>
+
+/**
+ * 热点 SQL 的集中登记处。
+ *
+ * drogon 的 PostgreSQL 连接以 SQL 文本为键，在每条连接上首次执行时 PREPARE，之后直接复用
+ * 预编译语句；文本只要有一点不同就会再准备一次。因此热点语句在这里定义为常量，
+ * 按请求拼接的动态查询收敛为固定的几种形态（在首次使用时构建一次），
+ * 让每条连接上的预编译语句数量保持有限。与引入登记处之前按请求拼接 SQL 的路径、每次解析规划的
+ * 延迟对比（p50 / p99）可用 bench/statement_registry_bench 在目标数据库上测量。
+ *
+ * 这里只登记请求路径上的热点语句；批量导入导出、计数校正、分时汇总等低频语句放在各自唯一的调用方旁边。
+ */
+class StatementRegistry {
+public:
+    // ---- 权限 ----
+    // $1 doc_id, $2 user_id -> permission
+    static const std::string& docPermission();
+    // $1 doc_id, $2 user_id -> 1（有任意访问权限时返回一行）
+    static const std::string& docAccessExists();
+    // $1 user_id -> role
+    static const std::string& userRole();
+
+    // ---- 文档 ----
+    // $1 doc_id -> 文档详情与标签
+    static const std::string& documentWithTags();
+
+    // $1 doc_id -> 最新发布版本的快照元数据与内容（无发布版本时各列为 NULL）
+    static const std::string& publishedVersion();
+
+    // $1 doc_id, $2 user_id -> permission（无访问权限时为 NULL）与 publishedVersion 的各列；文档不存在时无结果
+    static const std::string& bootstrapVersion();
+
+    /**
+     * 文档列表的固定形态。参数顺序：
+     *   $1 user_id, [status], [cursor_updated_us, cursor_id], limit, offset
+     * 方括号内的参数只在对应开关为 true 时出现。
+     */
+    static const std::string& documentList(bool statusFilter, bool cursor);
+
+    // 文档总数；estimate 为 true 时最多数到 kDocumentCountEstimateCap + 1 条。参数：$1 user_id, [status]
+    static const std::string& documentCount(bool statusFilter, bool estimate);
+
+    // documentCount(…, true) 的计数上限
+    static constexpr int kDocumentCountEstimateCap = 10000;
+
+    // ---- 版本 ----
+    // $1 doc_id -> owner_id, retention_limit
+    static const std::string& versionDocumentInfo();
+    // $1 doc_id, $2 url, $3 sha256, $4 size, $5 creator, $6 summary, $7 source, $8 text, $9 html -> id, version_number
+    static const std::string& versionInsert();
+    // $1 version_id, $2 doc_id
+    static const std::string& versionSetPublished();
+    // $1 doc_id, $2 retention_limit
+    static const std::string& versionCleanupAuto();
+
+    // ---- 通知 ----
+    /**
+     * 通知列表 / 总数。参数：
+     *   $1 user_id, $2 unread_only, $3 type, $4 doc_id, $5 start_date, $6 end_date[, $7 limit, $8 offset]
+     */
+    static const std::string& notificationList();
+    static const std::string& notificationCount();
+    // $1 user_id -> unread（计数行不存在时回填）
+    static const std::string& notificationUnreadCounter();
+
+    // ---- 用户搜索 ----
+    /**
+     * 按邮箱 / 昵称搜索用户，结果按 id 排序。参数：
+     *   $1 模式（关键词中的 \ % _ 已转义）, $2 limit, $3 offset[, $4 user_id]
+     * 关键词不少于 kUserSearchMinTrigram 个字符时按子串匹配（'%关键词%'，ILIKE 走 pg_trgm 索引）。
+     * 更短的关键词提取不出三元组，shortQuery 为 true，改用 lower() LIKE：单个字符按前缀匹配（'关键词%'，
+     * 走 text_pattern_ops 索引）；两个字符仍按子串匹配，沿主键顺序扫描，取够 limit + offset 个即停止。
+     * byId 为 true 时同时精确匹配用户 ID。两个条件分别在各自的表上取前 limit + offset 个 id 再合并，
+     * 避免跨表 OR 让索引失效。
+     */
+    static const std::string& userSearch(bool byId, bool shortQuery);
+
+    // pg_trgm 按三个字符一组建索引，更短的关键词不走三元组索引
+    static constexpr size_t kUserSearchMinTrigram = 3;
+    // 短于该长度（即单个字符）的关键词按前缀匹配，其余按子串匹配
+    static constexpr size_t kUserSearchMinSubstring = 2;
+};
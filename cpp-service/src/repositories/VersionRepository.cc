@@ -6,6 +6,8 @@
 #include <string>
 #include <vector>
 
+#include "StatementRegistry.h"
+
 namespace {
 std::string sanitizeSource(std::string source) {
     if (source.empty()) return "auto";
@@ -23,13 +25,7 @@ void cleanupAutoVersions(const drogon::orm::DbClientPtr& db, int docId, int rete
         return;
     }
     db->execSqlAsync(
-        "WITH ordered AS ("
-        "  SELECT id FROM document_version "
-        "  WHERE doc_id = $1::bigint AND source = 'auto' "
-        "  ORDER BY version_number DESC "
-        "  OFFSET $2::integer"
-        ") "
-        "DELETE FROM document_version WHERE id IN (SELECT id FROM ordered)",
+        StatementRegistry::versionCleanupAuto(),
         [onSuccess](const drogon::orm::Result&) { onSuccess(); },
         [onFailure](const drogon::orm::DrogonDbException& e) {
             onFailure("Database error: " + std::string(e.base().what()), drogon::k500InternalServerError);
@@ -49,8 +45,7 @@ void VersionRepository::insertVersion(const drogon::orm::DbClientPtr& db, const
     auto paramsPtr = std::make_shared<VersionInsertParams>(params);
 
     db->execSqlAsync(
-        "SELECT owner_id, COALESCE(version_retention_limit, 0) AS retention_limit "
-        "FROM document WHERE id = $1::integer",
+        StatementRegistry::versionDocumentInfo(),
         [db, paramsPtr, onSuccess, onFailure](const drogon::orm::Result& docResult) {
             if (docResult.empty()) {
                 onFailure("Document not found", drogon::k404NotFound);
@@ -67,17 +62,7 @@ void VersionRepository::insertVersion(const drogon::orm::DbClientPtr& db, const
             }
 
             db->execSqlAsync(
-                "WITH next_version AS ("
-                "  SELECT COALESCE(MAX(version_number), 0) + 1 AS next_val "
-                "  FROM document_version WHERE doc_id = $1::bigint"
-                ") "
-                "INSERT INTO document_version "
-                "(doc_id, version_number, snapshot_url, snapshot_sha256, size_bytes, created_by, change_summary, source, "
-                "content_text, content_html) "
-                "SELECT $1::bigint, next_val, $2, $3, $4::bigint, $5::integer, NULLIF($6, ''), $7, NULLIF($8, ''), "
-                "NULLIF($9, '') "
-                "FROM next_version "
-                "RETURNING id, version_number",
+                StatementRegistry::versionInsert(),
                 [db, paramsPtr, onSuccess, onFailure, source, retentionLimit](const drogon::orm::Result& insertResult) {
                     if (insertResult.empty()) {
                         onFailure("Failed to create version", drogon::k500InternalServerError);
@@ -87,8 +72,7 @@ void VersionRepository::insertVersion(const drogon::orm::DbClientPtr& db, const
                     int versionNumber = insertResult[0]["version_number"].as<int>();
 
                     db->execSqlAsync(
-                        "UPDATE document SET last_published_version_id = $1::bigint, updated_at = NOW() "
-                        "WHERE id = $2::integer",
+                        StatementRegistry::versionSetPublished(),
                         [db, paramsPtr, onSuccess, onFailure, versionId, versionNumber, source, retentionLimit](
                             const drogon::orm::Result&) {
                             if (source == "auto" && retentionLimit > 0) {
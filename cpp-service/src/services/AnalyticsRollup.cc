@@ -0,0 +1,141 @@
+#include "AnalyticsRollup.h"
+
+#include <drogon/drogon.h>
+#include <json/json.h>
+
+#include <atomic>
+#include <string>
+
+#include "../utils/ConfigUtils.h"
+#include "../utils/DbTransaction.h"
+
+namespace {
+// 桶边界按 UTC 计算
+#define UTC_TRUNC(unit, expr) "date_trunc('" unit "', (" expr ") AT TIME ZONE 'UTC') AT TIME ZONE 'UTC'"
+
+// 本轮的处理窗口，同时尝试获取事务级咨询锁（多实例只有一个执行）。参数：
+//   $1 单轮最多处理的小时数, $2 重算的小时数（已汇总的最近几个小时重新汇总，收录迟到的写入）
+// -> locked, start_at, end_at, current_hour, caught_up（首次运行时从源表中最早的记录开始）
+const char* const kWindowSql =
+        "SELECT pg_try_advisory_xact_lock(hashtext('analytics_rollup')) AS locked, w.start_at, "
+        "       LEAST(w.start_at + make_interval(hours => $1::integer), w.current_hour + INTERVAL '1 hour') "
+        "           AS end_at, "
+        "       w.current_hour, w.start_at + make_interval(hours => $1::integer) > w.current_hour AS caught_up "
+        "FROM (SELECT c.current_hour, "
+        "             COALESCE((SELECT rolled_until - make_interval(hours => $2::integer) "
+        "                       FROM analytics_rollup_state WHERE name = 'user_activity'), "
+        "                      (SELECT " UTC_TRUNC("hour", "MIN(m.at)") " FROM ("
+        "                           SELECT MIN(created_at) AS at FROM document "
+        "                           UNION ALL SELECT MIN(created_at) FROM comment "
+        "                           UNION ALL SELECT MIN(updated_at) FROM task) m), "
+        "                      c.current_hour) AS start_at "
+        "      FROM (SELECT " UTC_TRUNC("hour", "NOW()") " AS current_hour) c) w";
+
+// 以下四条的参数均为 $1 start_at, $2 end_at（整点，UTC）：清空并重建小时桶，再由小时桶重建涉及的日桶
+const char* const kClearHourlySql =
+        "DELETE FROM user_activity_hourly "
+        "WHERE bucket_start >= $1::timestamptz AND bucket_start < $2::timestamptz";
+
+const char* const kFillHourlySql =
+        "INSERT INTO user_activity_hourly (bucket_start, user_id, documents_created, comments_created, "
+        "                                  tasks_completed, tasks_updated) "
+        "SELECT " UTC_TRUNC("hour", "e.at") ", e.user_id, SUM(e.documents), SUM(e.comments), "
+        "       SUM(e.tasks_completed), SUM(e.tasks_updated) "
+        "FROM ("
+        "   SELECT created_at AS at, owner_id AS user_id, 1 AS documents, 0 AS comments, "
+        "          0 AS tasks_completed, 0 AS tasks_updated "
+        "   FROM document WHERE created_at >= $1::timestamptz AND created_at < $2::timestamptz "
+        "   UNION ALL "
+        "   SELECT created_at, author_id, 0, 1, 0, 0 "
+        "   FROM comment WHERE created_at >= $1::timestamptz AND created_at < $2::timestamptz "
+        "   UNION ALL "
+        "   SELECT completed_at, created_by, 0, 0, 1, 0 "
+        "   FROM task WHERE completed_at >= $1::timestamptz AND completed_at < $2::timestamptz "
+        "   UNION ALL "
+        "   SELECT updated_at, created_by, 0, 0, 0, 1 "
+        "   FROM task WHERE updated_at >= $1::timestamptz AND updated_at < $2::timestamptz"
+        ") e "
+        "GROUP BY 1, 2";
+
+const char* const kClearDailySql =
+        "DELETE FROM user_activity_daily "
+        "WHERE bucket_start >= " UTC_TRUNC("day", "$1::timestamptz") " AND bucket_start < $2::timestamptz";
+
+const char* const kFillDailySql =
+        "INSERT INTO user_activity_daily (bucket_start, user_id, documents_created, comments_created, "
+        "                                 tasks_completed, tasks_updated) "
+        "SELECT " UTC_TRUNC("day", "bucket_start") ", user_id, SUM(documents_created), "
+        "       SUM(comments_created), SUM(tasks_completed), SUM(tasks_updated) "
+        "FROM user_activity_hourly "
+        "WHERE bucket_start >= " UTC_TRUNC("day", "$1::timestamptz") " AND bucket_start < $2::timestamptz "
+        "GROUP BY 1, 2";
+
+// $1 end_at, $2 current_hour：记录汇总进度（当前小时尚未结束，下一轮继续重算）
+const char* const kSaveStateSql =
+        "INSERT INTO analytics_rollup_state (name, rolled_until, updated_at) "
+        "VALUES ('user_activity', LEAST($1::timestamptz, $2::timestamptz), NOW()) "
+        "ON CONFLICT (name) DO UPDATE SET rolled_until = EXCLUDED.rolled_until, updated_at = EXCLUDED.updated_at";
+#undef UTC_TRUNC
+
+std::atomic_bool running{false};
+
+// 本轮结束；还在追赶历史数据时立即开始下一轮
+void finishRun(bool caughtUp) {
+    running = false;
+    if (!caughtUp) {
+        drogon::app().getLoop()->queueInLoop([]() { AnalyticsRollup::runOnce(); });
+    }
+}
+}  // namespace
+
+void AnalyticsRollup::start() {
+    long seconds = 300;
+    try {
+        seconds = std::stol(ConfigUtils::getValue("analytics_rollup_interval_seconds", "300"));
+    } catch (...) {
+    }
+    if (seconds <= 0) seconds = 300;
+    drogon::app().getLoop()->runEvery(static_cast<double>(seconds), []() { runOnce(); });
+    runOnce();
+}
+
+void AnalyticsRollup::runOnce() {
+    if (running.exchange(true)) return;
+
+    auto db = drogon::app().getDbClient();
+    if (!db) {
+        running = false;
+        return;
+    }
+
+    DbTransaction::begin(
+            db,
+            [](const std::shared_ptr<DbTransaction>& tx) {
+                // 窗口查询的结果决定后续语句，这里不能流水线排队
+                tx->exec(
+                        kWindowSql,
+                        [tx](const drogon::orm::Result& r) {
+                            if (r.empty() || !r[0]["locked"].as<bool>()) {
+                                // 其他实例正在汇总
+                                tx->commit([]() { running = false; });
+                                return;
+                            }
+                            std::string startAt = r[0]["start_at"].as<std::string>();
+                            std::string endAt = r[0]["end_at"].as<std::string>();
+                            std::string currentHour = r[0]["current_hour"].as<std::string>();
+                            bool caughtUp = r[0]["caught_up"].as<bool>();
+
+                            tx->exec(kClearHourlySql, nullptr, startAt, endAt);
+                            tx->exec(kFillHourlySql, nullptr, startAt, endAt);
+                            tx->exec(kClearDailySql, nullptr, startAt, endAt);
+                            tx->exec(kFillDailySql, nullptr, startAt, endAt);
+                            tx->exec(kSaveStateSql, nullptr, endAt, currentHour);
+                            tx->commit([caughtUp]() { finishRun(caughtUp); });
+                        },
+                        std::to_string(kMaxHoursPerRun), std::to_string(kRecomputeHours));
+            },
+            [](const std::string& message, drogon::HttpStatusCode) {
+                LOG_ERROR << "[AnalyticsRollup] Rollup failed: " << message;
+                running = false;
+            });
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+/**
+ * AnalyticsRollup 是管理员统计（GET /api/admin/user-analytics）使用的后台聚合器。
+ *
+ * 按 UTC 小时把 document / comment / task 上的活动汇总到 user_activity_hourly（每个小时、每个用户一行），
+ * 再由小时桶汇总出 user_activity_daily；统计接口只读这两张表，开销与时间范围内的桶数成正比。
+ *
+ * - 每 app.analytics_rollup_interval_seconds 秒运行一次，重算进度之前 kRecomputeHours 个小时到当前小时，
+ *   收录迟到提交的写入，当前小时的数据因此最多滞后一个间隔；
+ * - 首次运行（或长时间停机后）从进度处按 kMaxHoursPerRun 小时一段追赶，每段一个事务，追平前连续执行；
+ * - 每轮在事务内获取咨询锁，多实例部署时同一时刻只有一个实例在汇总。
+ *
+ * 超出重算窗口的桶不再改变：之后删除的文档、评论仍计入其创建时所在的桶，
+ * 任务按每次汇总时的最后更新时间计入对应的小时。
+ */
+class AnalyticsRollup {
+public:
+    // 重算最近几个小时的桶
+    static constexpr int kRecomputeHours = 2;
+    // 单轮最多汇总的小时数（追赶历史数据时分段）
+    static constexpr int kMaxHoursPerRun = 24 * 7;
+
+    // 启动定时汇总（在 app 启动后调用一次），并立即运行一轮
+    static void start();
+
+    // 运行一轮；上一轮尚未结束时直接返回
+    static void runOnce();
+};
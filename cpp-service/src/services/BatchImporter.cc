@@ -0,0 +1,308 @@
+#include "BatchImporter.h"
+
+#include <drogon/drogon.h>
+#include <trantor/utils/ConcurrentTaskQueue.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <string>
+#include <vector>
+
+#include "../utils/ConfigUtils.h"
+#include "../utils/DbUtils.h"
+#include "../utils/MarkdownCodec.h"
+#include "SearchService.h"
+
+namespace {
+// 一条语句写入多篇文档及各自的首个版本（并设为发布版本），按输入顺序返回新文档 ID。参数：
+//   $1 标题 text[], $2 HTML text[], $3 owner_id, $4 snapshot_sha256 占位值
+// 文档与版本 ID 预先从序列取得，两张表可在同一语句内互相引用（数据修改 CTE 之间看不到彼此写入的行）；
+// input 引用多次且含 nextval，PostgreSQL 只物化计算一次
+const char* const kBatchImportSql =
+        "WITH input AS ("
+        "   SELECT nextval(pg_get_serial_sequence('document', 'id')) AS doc_id, "
+        "          nextval(pg_get_serial_sequence('document_version', 'id')) AS version_id, "
+        "          t.title, t.html, t.ord "
+        "   FROM unnest($1::text[], $2::text[]) WITH ORDINALITY AS t(title, html, ord)"
+        "), docs AS ("
+        "   INSERT INTO document (id, title, owner_id, last_published_version_id, created_at, updated_at) "
+        "   SELECT doc_id, left(title, 255), $3::bigint, version_id, NOW(), NOW() FROM input"
+        "), versions AS ("
+        "   INSERT INTO document_version (id, doc_id, version_number, snapshot_url, snapshot_sha256, "
+        "   size_bytes, content_html, created_by, source, created_at) "
+        "   SELECT version_id, doc_id, 1, 'import://batch/' || doc_id, $4, octet_length(html), html, "
+        "          $3::bigint, 'import', NOW() "
+        "   FROM input"
+        ") "
+        "SELECT doc_id, ord FROM input ORDER BY ord";
+
+// 单个文件解压后的大小上限（与单文件导入一致）
+constexpr uint64_t kMaxFileBytes = 50 * 1024 * 1024;
+
+// 所有批量导入共享的转换线程池
+trantor::ConcurrentTaskQueue& workerPool() {
+    static trantor::ConcurrentTaskQueue pool(
+            []() -> size_t {
+                try {
+                    long workers = std::stol(ConfigUtils::getValue("import_workers", "4"));
+                    return workers > 0 ? static_cast<size_t>(workers) : 4;
+                } catch (...) {
+                    return 4;
+                }
+            }(),
+            "BatchImport");
+    return pool;
+}
+
+enum class FileKind { Markdown, Html };
+
+// 待转换的文件
+struct Candidate {
+    size_t manifestIndex{0};
+    const ArchiveReader::Entry* entry{nullptr};
+    FileKind kind{FileKind::Markdown};
+};
+
+// 一个文件的转换结果（由工作线程写入各自的槽位）
+struct Converted {
+    std::string title;
+    std::string html;
+    std::string indexText;
+    std::string error;
+};
+
+struct ImportState {
+    int userId{0};
+    std::shared_ptr<const ArchiveReader> archive;
+    std::function<void(const Json::Value&)> onDone;
+    Json::Value files{Json::arrayValue};
+    std::vector<Candidate> candidates;
+    size_t next{0};
+};
+
+std::string lowerExtension(const std::string& name) {
+    size_t slash = name.find_last_of('/');
+    size_t dot = name.find_last_of('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return "";
+    std::string extension = name.substr(dot);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    return extension;
+}
+
+// 系统生成的附带文件（__MACOSX、.DS_Store 等隐藏文件）直接忽略，不写入清单
+bool isIgnored(const std::string& name) {
+    if (name.compare(0, 9, "__MACOSX/") == 0) return true;
+    size_t start = 0;
+    while (start < name.size()) {
+        if (name[start] == '.') return true;
+        size_t slash = name.find('/', start);
+        if (slash == std::string::npos) break;
+        start = slash + 1;
+    }
+    return false;
+}
+
+// 标题取文件名（去掉目录与扩展名）
+std::string titleFromPath(const std::string& name) {
+    size_t slash = name.find_last_of('/');
+    std::string title = slash == std::string::npos ? name : name.substr(slash + 1);
+    size_t dot = title.find_last_of('.');
+    if (dot != std::string::npos && dot > 0) title = title.substr(0, dot);
+    return title.empty() ? "Imported Document" : title;
+}
+
+// HTML 文件只保留 <body> 内的内容
+std::string htmlBody(const std::string& html) {
+    std::string lower = html;
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+    size_t body = lower.find("<body");
+    if (body == std::string::npos) return html;
+    size_t start = lower.find('>', body);
+    if (start == std::string::npos) return html;
+    size_t end = lower.rfind("</body>");
+    if (end == std::string::npos || end < start) end = html.size();
+    return html.substr(start + 1, end - start - 1);
+}
+
+void convert(const ArchiveReader& archive, const Candidate& candidate, Converted& result) {
+    std::string content;
+    if (!archive.read(*candidate.entry, content, kMaxFileBytes, result.error)) return;
+    if (content.find_first_not_of(" \t\r\n") == std::string::npos) {
+        result.error = "File is empty";
+        return;
+    }
+    result.title = titleFromPath(candidate.entry->name);
+    if (candidate.kind == FileKind::Markdown) {
+        result.html = MarkdownCodec::toHtml(content);
+        result.indexText = std::move(content);
+    } else {
+        result.html = htmlBody(content);
+        result.indexText = MarkdownCodec::toMarkdown(result.html);
+    }
+}
+
+void finish(const std::shared_ptr<ImportState>& state) {
+    Json::Value manifest;
+    Json::UInt64 imported = 0, skipped = 0, failed = 0;
+    for (const auto& file : state->files) {
+        const std::string status = file["status"].asString();
+        if (status == "imported") {
+            ++imported;
+        } else if (status == "skipped") {
+            ++skipped;
+        } else {
+            ++failed;
+        }
+    }
+    manifest["total"] = static_cast<Json::UInt64>(state->files.size());
+    manifest["imported"] = imported;
+    manifest["skipped"] = skipped;
+    manifest["failed"] = failed;
+    manifest["files"] = std::move(state->files);
+    LOG_INFO << "[BatchImporter] User " << state->userId << " imported " << imported << " documents (" << skipped
+             << " skipped, " << failed << " failed)";
+    state->onDone(manifest);
+}
+
+void processNextBatch(const std::shared_ptr<ImportState>& state);
+
+// 一条语句写入本批文档，成功后批量交给搜索索引
+void insertBatch(const std::shared_ptr<ImportState>& state, std::vector<Candidate> batch,
+                 std::shared_ptr<std::vector<Converted>> results) {
+    std::vector<size_t> rows;  // 转换成功的结果下标，与语句中的数组顺序一致
+    std::vector<std::string> titles;
+    std::vector<std::string> htmls;
+    for (size_t i = 0; i < batch.size(); ++i) {
+        Json::Value& file = state->files[static_cast<Json::ArrayIndex>(batch[i].manifestIndex)];
+        Converted& result = (*results)[i];
+        if (!result.error.empty()) {
+            file["status"] = "failed";
+            file["error"] = result.error;
+            continue;
+        }
+        rows.push_back(i);
+        titles.push_back(result.title);
+        htmls.push_back(std::move(result.html));
+    }
+    if (rows.empty()) {
+        processNextBatch(state);
+        return;
+    }
+
+    std::string titleArray = DbUtils::buildTextArrayLiteral(titles);
+    std::string htmlArray = DbUtils::buildTextArrayLiteral(htmls);
+    htmls.clear();
+    htmls.shrink_to_fit();
+
+    auto db = drogon::app().getDbClient();
+    if (!db) {
+        for (size_t row : rows) {
+            Json::Value& file = state->files[static_cast<Json::ArrayIndex>(batch[row].manifestIndex)];
+            file["status"] = "failed";
+            file["error"] = "Database not available";
+        }
+        processNextBatch(state);
+        return;
+    }
+    db->execSqlAsync(
+            kBatchImportSql,
+            [state, batch, results, rows](const drogon::orm::Result& r) {
+                std::vector<SearchService::IndexItem> items;
+                items.reserve(r.size());
+                for (const auto& row : r) {
+                    // ord 从 1 开始，对应 rows 中的位置
+                    int64_t ord = row["ord"].as<int64_t>();
+                    if (ord <= 0 || static_cast<size_t>(ord) > rows.size()) continue;
+                    size_t i = rows[static_cast<size_t>(ord - 1)];
+                    int docId = row["doc_id"].as<int>();
+                    Json::Value& file = state->files[static_cast<Json::ArrayIndex>(batch[i].manifestIndex)];
+                    file["status"] = "imported";
+                    file["id"] = docId;
+                    file["title"] = (*results)[i].title;
+                    items.push_back(SearchService::IndexItem{docId, (*results)[i].title,
+                                                             std::move((*results)[i].indexText)});
+                }
+                SearchService::indexDocuments(std::move(items));
+                processNextBatch(state);
+            },
+            [state, batch, rows](const drogon::orm::DrogonDbException& e) {
+                LOG_ERROR << "[BatchImporter] Batch insert failed: " << e.base().what();
+                for (size_t row : rows) {
+                    Json::Value& file = state->files[static_cast<Json::ArrayIndex>(batch[row].manifestIndex)];
+                    file["status"] = "failed";
+                    file["error"] = "Database error";
+                }
+                processNextBatch(state);
+            },
+            std::move(titleArray), std::move(htmlArray), std::to_string(state->userId), std::string(64, '0'));
+}
+
+// 取下一批文件分发到线程池，全部转换完成后回到事件循环写库
+void processNextBatch(const std::shared_ptr<ImportState>& state) {
+    if (state->next >= state->candidates.size()) {
+        finish(state);
+        return;
+    }
+    std::vector<Candidate> batch;
+    uint64_t bytes = 0;
+    while (state->next < state->candidates.size() && batch.size() < BatchImporter::kFilesPerBatch) {
+        const Candidate& candidate = state->candidates[state->next];
+        if (!batch.empty() && bytes + candidate.entry->size > BatchImporter::kBatchBytes) break;
+        bytes += candidate.entry->size;
+        batch.push_back(candidate);
+        ++state->next;
+    }
+
+    auto results = std::make_shared<std::vector<Converted>>(batch.size());
+    auto remaining = std::make_shared<std::atomic_size_t>(batch.size());
+    auto sharedBatch = std::make_shared<std::vector<Candidate>>(std::move(batch));
+    for (size_t i = 0; i < sharedBatch->size(); ++i) {
+        workerPool().runTaskInQueue([state, sharedBatch, results, remaining, i]() {
+            try {
+                convert(*state->archive, (*sharedBatch)[i], (*results)[i]);
+            } catch (const std::exception& e) {
+                (*results)[i].error = std::string("Conversion failed: ") + e.what();
+            }
+            if (--*remaining == 0) {
+                drogon::app().getLoop()->queueInLoop(
+                        [state, sharedBatch, results]() { insertBatch(state, *sharedBatch, results); });
+            }
+        });
+    }
+}
+}  // namespace
+
+void BatchImporter::run(int userId, std::shared_ptr<const ArchiveReader> archive,
+                        std::function<void(const Json::Value& manifest)> onDone) {
+    auto state = std::make_shared<ImportState>();
+    state->userId = userId;
+    state->archive = std::move(archive);
+    state->onDone = std::move(onDone);
+
+    for (const auto& entry : state->archive->entries()) {
+        if (entry.directory || isIgnored(entry.name)) continue;
+        Json::Value file;
+        file["path"] = entry.name;
+        std::string extension = lowerExtension(entry.name);
+        bool markdown = extension == ".md" || extension == ".markdown";
+        bool html = extension == ".html" || extension == ".htm";
+        if (!markdown && !html) {
+            file["status"] = "skipped";
+            file["error"] = "Unsupported file type";
+        } else if (!entry.supported) {
+            file["status"] = "failed";
+            file["error"] = "Unsupported compression method or encrypted entry";
+        } else if (entry.size > kMaxFileBytes) {
+            file["status"] = "failed";
+            file["error"] = "File size exceeds 50MB limit";
+        } else {
+            file["status"] = "pending";
+            state->candidates.push_back(
+                    Candidate{state->files.size(), &entry, markdown ? FileKind::Markdown : FileKind::Html});
+        }
+        state->files.append(file);
+    }
+    processNextBatch(state);
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <json/json.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "../utils/ArchiveReader.h"
+
+/**
+ * BatchImporter 执行批量导入（POST /api/docs/import/batch），把归档中的 Markdown / HTML 文件导入为文档。
+ *
+ * - 文件在共享的工作线程池（app.import_workers 个线程）上并行解压、转换，不占用事件循环；
+ * - 每凑满 kFilesPerBatch 个文件或 kBatchBytes 字节写库一次：文档与首个版本由一条多行语句写入，
+ *   写入成功的文档一次性交给 SearchService 批量索引；
+ * - 同一导入同时只有一个批次在转换或写库，内存占用取决于批次大小而不是归档大小；
+ * - 结果清单逐个文件记录 imported / skipped / failed 及原因，单个文件失败不影响其余文件。
+ */
+class BatchImporter {
+public:
+    // 单批文件数与解压后字节数上限
+    static constexpr size_t kFilesPerBatch = 50;
+    static constexpr uint64_t kBatchBytes = 16 * 1024 * 1024;
+
+    // 导入归档中的全部文件；archive 引用的数据必须在 onDone 调用前保持有效。
+    // onDone 在事件循环上调用，参数为结果清单（total / imported / skipped / failed / files）
+    static void run(int userId, std::shared_ptr<const ArchiveReader> archive,
+                    std::function<void(const Json::Value& manifest)> onDone);
+};
@@ -0,0 +1,62 @@
+#include "DocumentLoader.h"
+
+#include <drogon/drogon.h>
+
+#include "../repositories/StatementRegistry.h"
+#include "../utils/MinIOClient.h"
+#include "../utils/SingleFlight.h"
+
+namespace {
+SingleFlight<drogon::orm::Result> documentFlights;
+SingleFlight<drogon::orm::Result> versionFlights;
+SingleFlight<std::vector<char>> snapshotFlights;
+
+// 以单条 SQL 作为 loader
+SingleFlight<drogon::orm::Result>::Loader queryLoader(const std::string& sql, int docId) {
+    return [&sql, docId](SingleFlight<drogon::orm::Result>::Callback done,
+                         SingleFlight<drogon::orm::Result>::ErrorCallback fail) {
+        auto db = drogon::app().getDbClient();
+        if (!db) {
+            fail("Database not available");
+            return;
+        }
+        db->execSqlAsync(
+                sql, [done](const drogon::orm::Result& r) { done(r); },
+                [fail](const drogon::orm::DrogonDbException& e) {
+                    fail("Database error: " + std::string(e.base().what()));
+                },
+                std::to_string(docId));
+    };
+}
+}  // namespace
+
+void DocumentLoader::loadDocument(int docId, std::function<void(const drogon::orm::Result&)> callback,
+                                  ErrorCallback errorCallback) {
+    documentFlights.run(std::to_string(docId), queryLoader(StatementRegistry::documentWithTags(), docId),
+                        std::move(callback), std::move(errorCallback));
+}
+
+void DocumentLoader::loadPublishedVersion(int docId, std::function<void(const drogon::orm::Result&)> callback,
+                                          ErrorCallback errorCallback) {
+    versionFlights.run(std::to_string(docId), queryLoader(StatementRegistry::publishedVersion(), docId),
+                       std::move(callback), std::move(errorCallback));
+}
+
+void DocumentLoader::loadSnapshot(const std::string& objectName,
+                                  std::function<void(const std::vector<char>&)> callback,
+                                  ErrorCallback errorCallback) {
+    snapshotFlights.run(
+            objectName,
+            [objectName](SingleFlight<std::vector<char>>::Callback done,
+                         SingleFlight<std::vector<char>>::ErrorCallback fail) {
+                MinIOClient::downloadFile(
+                        objectName, [done](const std::vector<char>& data) { done(data); },
+                        [fail](const std::string& error) { fail(error); });
+            },
+            std::move(callback), std::move(errorCallback));
+}
+
+void DocumentLoader::invalidate(int docId) {
+    documentFlights.forget(std::to_string(docId));
+    versionFlights.forget(std::to_string(docId));
+}
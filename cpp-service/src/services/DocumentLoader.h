@@ -0,0 +1,39 @@
+#pragma once
+#include <drogon/orm/Result.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * DocumentLoader 负责热点文档读取的并发合并（single-flight）。
+ *
+ * 团队同时打开同一文档时，/api/docs/{id}、/api/collab/bootstrap/{id} 与快照下载会在同一时刻
+ * 发出大量相同的查询和 MinIO 下载。这里按资源合并进行中的加载：同一时刻只有一次数据库查询 /
+ * 对象下载，结果分发给所有等待者。
+ *
+ * - 快照内容按对象名合并，对象名随版本变化，天然带有版本标记；
+ * - 文档详情与发布版本元数据按文档 ID 合并，写入后由调用方 invalidate，之后的请求重新加载。
+ *
+ * 权限检查仍由各个请求单独完成；bootstrap 把权限与发布版本放在同一条查询中（结果与用户相关），
+ * 不经过这里的元数据合并，只复用快照下载的合并。
+ */
+class DocumentLoader {
+public:
+    using ErrorCallback = std::function<void(const std::string&)>;
+
+    // 文档详情（含标签），列同 StatementRegistry::documentWithTags。
+    static void loadDocument(int docId, std::function<void(const drogon::orm::Result&)> callback,
+                             ErrorCallback errorCallback);
+
+    // 最新发布版本的快照元数据：snapshot_url、snapshot_sha256、version_id、size_bytes、content_html、content_text。
+    static void loadPublishedVersion(int docId, std::function<void(const drogon::orm::Result&)> callback,
+                                     ErrorCallback errorCallback);
+
+    // 从 MinIO 下载快照对象。
+    static void loadSnapshot(const std::string& objectName, std::function<void(const std::vector<char>&)> callback,
+                             ErrorCallback errorCallback);
+
+    // 文档或其发布版本已修改：之后的请求不再复用修改前发起的加载。
+    static void invalidate(int docId);
+};
@@ -0,0 +1,281 @@
+#include "ExportCache.h"
+
+#include <dirent.h>
+#include <drogon/drogon.h>
+#include <sys/stat.h>
+#include <trantor/utils/SerialTaskQueue.h>
+#include <unistd.h>  // for unlink()
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+#include "../utils/ConfigUtils.h"
+#include "../utils/TokenUtils.h"
+
+namespace {
+// 产物文件扩展名
+const char* const kArtifactSuffix = ".bin";
+
+struct Entry {
+    size_t size{0};
+    std::time_t lastAccess{0};
+    int pins{0};  // 正在发送的响应数，大于 0 时不淘汰
+};
+
+struct CacheState {
+    std::mutex mutex;
+    bool loaded{false};  // 目录扫描完成后置位
+    std::string directory;
+    size_t maxBytes{0};
+    std::unordered_map<std::string, Entry> entries;  // key -> 产物
+    size_t totalBytes{0};
+    std::atomic_size_t hits{0};
+    std::atomic_size_t misses{0};
+    std::atomic_size_t evictions{0};
+};
+
+CacheState& cache() {
+    static CacheState state;
+    return state;
+}
+
+// 目录扫描、写文件与淘汰删除都在这个串行队列上执行
+trantor::SerialTaskQueue& ioQueue() {
+    static trantor::SerialTaskQueue queue("ExportCacheIO");
+    return queue;
+}
+
+bool ensureDirectory(const std::string& directory) {
+    std::string current;
+    std::stringstream ss(directory);
+    std::string part;
+    if (!directory.empty() && directory[0] == '/') current = "/";
+    while (std::getline(ss, part, '/')) {
+        if (part.empty()) continue;
+        current += part + "/";
+        if (mkdir(current.c_str(), 0755) != 0 && errno != EEXIST) return false;
+    }
+    return true;
+}
+
+std::string artifactPath(const std::string& directory, const std::string& key) {
+    return directory + "/" + key + kArtifactSuffix;
+}
+
+// 读取配置并扫描已有产物（I/O 线程）
+void loadDirectory() {
+    std::string directory = ConfigUtils::getValue("export_cache_path", "./data/export-cache");
+    size_t maxBytes = 512UL * 1024 * 1024;
+    try {
+        maxBytes = static_cast<size_t>(std::stoul(ConfigUtils::getValue("export_cache_max_mb", "512"))) * 1024 *
+                   1024;
+    } catch (...) {
+        // 保持默认值
+    }
+    if (!ensureDirectory(directory)) {
+        LOG_ERROR << "[ExportCache] Cannot create cache directory " << directory;
+        return;
+    }
+
+    std::unordered_map<std::string, Entry> found;
+    DIR* dir = opendir(directory.c_str());
+    if (dir) {
+        const std::string suffix = kArtifactSuffix;
+        while (auto* item = readdir(dir)) {
+            std::string name = item->d_name;
+            if (name.size() <= suffix.size() ||
+                name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+                continue;
+            }
+            struct stat st;
+            if (stat((directory + "/" + name).c_str(), &st) != 0) continue;
+            Entry entry;
+            entry.size = static_cast<size_t>(st.st_size);
+            entry.lastAccess = st.st_mtime;
+            found[name.substr(0, name.size() - suffix.size())] = entry;
+        }
+        closedir(dir);
+    }
+
+    auto& state = cache();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.directory = directory;
+    state.maxBytes = maxBytes;
+    for (auto& item : found) {
+        state.totalBytes += item.second.size;
+        state.entries.emplace(item.first, item.second);
+    }
+    state.loaded = true;
+    LOG_INFO << "[ExportCache] Loaded " << found.size() << " cached artifacts from " << directory;
+}
+
+// 首次使用时在 I/O 线程上扫描目录
+void ensureLoading() {
+    static std::once_flag once;
+    std::call_once(once, [] { ioQueue().runTaskInQueue(loadDirectory); });
+}
+
+// 按最近访问时间淘汰未固定的条目，直到总大小不超过上限（要求持有锁）；返回待删除的文件
+std::vector<std::string> evictLocked(const std::string& keep) {
+    auto& state = cache();
+    std::vector<std::string> removed;
+    while (state.totalBytes > state.maxBytes && state.entries.size() > 1) {
+        auto oldest = state.entries.end();
+        for (auto it = state.entries.begin(); it != state.entries.end(); ++it) {
+            if (it->first == keep || it->second.pins > 0) continue;
+            if (oldest == state.entries.end() || it->second.lastAccess < oldest->second.lastAccess) oldest = it;
+        }
+        if (oldest == state.entries.end()) break;
+        removed.push_back(artifactPath(state.directory, oldest->first));
+        state.totalBytes -= oldest->second.size;
+        state.entries.erase(oldest);
+        ++state.evictions;
+    }
+    return removed;
+}
+
+// 在 I/O 线程上淘汰并删除文件
+void evict(const std::string& keep) {
+    std::vector<std::string> removed;
+    {
+        auto& state = cache();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        removed = evictLocked(keep);
+    }
+    for (const auto& path : removed) ::unlink(path.c_str());
+}
+
+// 写入产物文件（I/O 线程），返回文件路径，失败时返回空字符串
+std::string writeArtifact(const std::string& key, const std::string& data) {
+    auto& state = cache();
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        if (!state.loaded) return "";
+        path = artifactPath(state.directory, key);
+    }
+
+    // rename 保证读者看到的总是完整文件
+    std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            LOG_ERROR << "[ExportCache] Cannot write " << tmpPath;
+            return "";
+        }
+        file.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!file.good()) {
+            file.close();
+            ::unlink(tmpPath.c_str());
+            return "";
+        }
+    }
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        ::unlink(tmpPath.c_str());
+        return "";
+    }
+
+    std::lock_guard<std::mutex> lock(state.mutex);
+    auto& entry = state.entries[key];
+    state.totalBytes = state.totalBytes - entry.size + data.size();
+    entry.size = data.size();
+    entry.lastAccess = std::time(nullptr);
+    return path;
+}
+}  // namespace
+
+std::string ExportCache::makeKey(const std::string& format, const std::string& options, const std::string& title,
+                                 const std::string& content) {
+    // 各字段带长度前缀，避免拼接歧义
+    std::string material;
+    material.reserve(format.size() + options.size() + title.size() + content.size() + 64);
+    for (const auto* field : {&format, &options, &title, &content}) {
+        material += std::to_string(field->size());
+        material += ':';
+        material += *field;
+    }
+    return TokenUtils::sha256(material);
+}
+
+std::string ExportCache::acquire(const std::string& key) {
+    ensureLoading();
+    auto& state = cache();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    auto it = state.entries.find(key);
+    if (it == state.entries.end()) {
+        ++state.misses;
+        return "";
+    }
+    ++it->second.pins;
+    it->second.lastAccess = std::time(nullptr);
+    ++state.hits;
+    return artifactPath(state.directory, key);
+}
+
+void ExportCache::release(const std::string& key, bool missing) {
+    auto& state = cache();
+    bool overLimit = false;
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        auto it = state.entries.find(key);
+        if (it == state.entries.end()) return;
+        if (it->second.pins > 0) --it->second.pins;
+        if (missing) {
+            // 文件被外部删除
+            LOG_WARN << "[ExportCache] Artifact " << key << " is missing, dropping it";
+            state.totalBytes -= it->second.size;
+            state.entries.erase(it);
+            return;
+        }
+        overLimit = it->second.pins == 0 && state.totalBytes > state.maxBytes;
+    }
+    // 固定期间跳过的淘汰在释放后补做
+    if (overLimit) ioQueue().runTaskInQueue([] { evict(""); });
+}
+
+bool ExportCache::contains(const std::string& key) {
+    ensureLoading();
+    auto& state = cache();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    auto it = state.entries.find(key);
+    if (it == state.entries.end()) {
+        ++state.misses;
+        return false;
+    }
+    it->second.lastAccess = std::time(nullptr);
+    ++state.hits;
+    return true;
+}
+
+void ExportCache::store(const std::string& key, std::string data,
+                        std::function<void(const std::string& path)> onStored) {
+    ensureLoading();
+    auto payload = std::make_shared<std::string>(std::move(data));
+    ioQueue().runTaskInQueue([key, payload, onStored = std::move(onStored)]() {
+        std::string path = writeArtifact(key, *payload);
+        if (!path.empty()) evict(key);
+        if (onStored) onStored(path);
+    });
+}
+
+Json::Value ExportCache::getStats() {
+    ensureLoading();
+    auto& state = cache();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    Json::Value stats;
+    stats["directory"] = state.directory;
+    stats["entries"] = static_cast<Json::UInt64>(state.entries.size());
+    stats["bytes"] = static_cast<Json::UInt64>(state.totalBytes);
+    stats["max_bytes"] = static_cast<Json::UInt64>(state.maxBytes);
+    stats["hits"] = static_cast<Json::UInt64>(state.hits.load());
+    stats["misses"] = static_cast<Json::UInt64>(state.misses.load());
+    stats["evictions"] = static_cast<Json::UInt64>(state.evictions.load());
+    return stats;
+}
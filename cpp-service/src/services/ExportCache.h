@@ -0,0 +1,37 @@
+#pragma once
+#include <json/json.h>
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+/**
+ * ExportCache 缓存导出产物（Word / PDF / Markdown），避免未修改的文档每次导出都请求 doc-converter。
+ *
+ * - 缓存键为 (格式, 选项, 标题, 渲染输入内容) 的 SHA-256：文档内容或标题变化后自然落到新的键上，无需主动失效；
+ * - 产物以文件形式保存在 app.export_cache_path 下（先写临时文件再 rename），命中时直接以文件响应返回；
+ * - 总大小超过 app.export_cache_max_mb 时按最近访问时间淘汰，正在发送（acquire 后尚未 release）的条目不淘汰；
+ * - 目录扫描、写文件与淘汰删除都在缓存自己的 I/O 线程上执行，不阻塞事件循环；首次扫描完成前查询一律未命中。
+ *
+ * 所有方法线程安全。
+ */
+class ExportCache {
+public:
+    // 计算缓存键
+    static std::string makeKey(const std::string& format, const std::string& options, const std::string& title,
+                               const std::string& content);
+
+    // 命中时固定条目并返回产物文件路径、刷新访问时间，未命中返回空字符串；命中后必须调用 release
+    static std::string acquire(const std::string& key);
+    // 解除 acquire 的固定；missing 为 true 表示文件已不可读，同时移除该条目
+    static void release(const std::string& key, bool missing = false);
+    // 是否命中（刷新访问时间，不固定）
+    static bool contains(const std::string& key);
+
+    // 在 I/O 线程上保存产物，完成后在该线程上回调 onStored（参数为文件路径，写入失败时为空字符串）
+    static void store(const std::string& key, std::string data,
+                      std::function<void(const std::string& path)> onStored = nullptr);
+
+    // 条目数、占用字节、命中 / 未命中 / 淘汰次数
+    static Json::Value getStats();
+};
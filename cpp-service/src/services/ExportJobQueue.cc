@@ -0,0 +1,524 @@
+#include "ExportJobQueue.h"
+
+#include <drogon/drogon.h>
+
+#include <algorithm>
+#include <ctime>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "../utils/ConfigUtils.h"
+#include "../utils/DbTransaction.h"
+#include "../utils/DbUtils.h"
+#include "../utils/MinIOClient.h"
+#include "../utils/TokenUtils.h"
+#include "NotificationBus.h"
+
+namespace {
+// 续期与清理周期（秒）
+constexpr double kSweepIntervalSeconds = 60.0;
+
+// 同一用户的提交串行执行，未结束任务数的检查与写入之间不会插入其他提交
+const char* const kLockUserSql = "SELECT pg_advisory_xact_lock(hashtext('export_job'), $1::integer)";
+
+// $1 id, $2 user_id, $3 doc_id, $4 format, $5 instance_id, $6 每个用户未结束任务的上限 -> created_at（超出上限时无结果）
+const char* const kInsertSql =
+        "INSERT INTO export_job (id, user_id, doc_id, format, instance_id) "
+        "SELECT $1, $2::bigint, $3::bigint, $4, $5 "
+        "WHERE (SELECT COUNT(*) FROM export_job "
+        "       WHERE user_id = $2::bigint AND status IN ('queued', 'running')) < $6::integer "
+        "RETURNING EXTRACT(EPOCH FROM created_at)::bigint AS created_at";
+
+const char* const kStartSql =
+        "UPDATE export_job SET status = 'running', progress = 5, updated_at = NOW() "
+        "WHERE id = $1 AND status = 'queued'";
+
+const char* const kProgressSql =
+        "UPDATE export_job SET progress = $2::integer, updated_at = NOW() "
+        "WHERE id = $1 AND status = 'running' AND progress < $2::integer";
+
+// $1 id, $2 status, $3 error, $4 cache_key, $5 artifact_object, $6 filename, $7 content_type
+const char* const kFinishSql =
+        "UPDATE export_job "
+        "SET status = $2, progress = CASE WHEN $2 = 'succeeded' THEN 100 ELSE progress END, error = NULLIF($3, ''), "
+        "    cache_key = NULLIF($4, ''), artifact_object = NULLIF($5, ''), filename = NULLIF($6, ''), "
+        "    content_type = NULLIF($7, ''), finished_at = NOW(), updated_at = NOW() "
+        "WHERE id = $1 AND status IN ('queued', 'running') "
+        "RETURNING EXTRACT(EPOCH FROM finished_at)::bigint AS finished_at";
+
+// 排队中的任务返回在所属实例队列中的位置
+const char* const kSelectSql =
+        "SELECT j.id, j.doc_id, j.format, j.status, j.progress, j.error, j.cache_key, j.artifact_object, j.filename, "
+        "       j.content_type, EXTRACT(EPOCH FROM j.created_at)::bigint AS created_at, "
+        "       EXTRACT(EPOCH FROM j.finished_at)::bigint AS finished_at, "
+        "       CASE WHEN j.status = 'queued' THEN "
+        "           (SELECT COUNT(*) FROM export_job q WHERE q.instance_id = j.instance_id AND q.status = 'queued' "
+        "              AND (q.created_at, q.id) <= (j.created_at, j.id)) END AS queue_position "
+        "FROM export_job j "
+        "WHERE j.id = $1 AND j.user_id = $2::bigint";
+
+// $1 本实例未结束的任务 ID
+const char* const kHeartbeatSql =
+        "UPDATE export_job SET updated_at = NOW() "
+        "WHERE id = ANY($1::text[]) AND status IN ('queued', 'running')";
+
+// $1 续期超时（秒）
+const char* const kExpireStaleSql =
+        "UPDATE export_job "
+        "SET status = 'failed', error = 'Export job was interrupted', finished_at = NOW(), updated_at = NOW() "
+        "WHERE status IN ('queued', 'running') AND updated_at < NOW() - make_interval(secs => $1::integer) "
+        "RETURNING id";
+
+// $1 保留时长（秒）
+const char* const kDeleteExpiredSql =
+        "DELETE FROM export_job WHERE finished_at < NOW() - make_interval(secs => $1::integer) "
+        "RETURNING artifact_object";
+
+// 本实例提交、尚未结束的任务
+struct Job {
+    std::string id;
+    int userId{0};
+    int docId{0};
+    std::string format;
+    std::string status;  // queued / running
+    int progress{0};
+    bool finishing{false};  // 已调用 complete / fail，正在上传产物或写入结果
+    std::time_t createdAt{0};
+    ExportJobQueue::Task task;  // 开始运行后释放
+};
+
+struct QueueState {
+    std::mutex mutex;
+    bool loaded{false};
+    size_t workers{2};
+    size_t queueMax{200};
+    size_t userLimit{3};
+    long ttlSeconds{3600};
+    double timeoutSeconds{120.0};
+    std::unordered_map<std::string, Job> jobs;
+    std::deque<std::string> pending;
+    size_t reserved{0};  // 已通过排队上限检查、正在写入任务记录的提交
+    size_t running{0};
+    size_t submitted{0};
+    size_t rejected{0};
+    size_t succeeded{0};
+    size_t failed{0};
+};
+
+QueueState& queue() {
+    static QueueState state;
+    return state;
+}
+
+long getConfigNumber(const std::string& key, long defaultValue) {
+    try {
+        long value = std::stol(ConfigUtils::getValue(key, std::to_string(defaultValue)));
+        return value > 0 ? value : defaultValue;
+    } catch (...) {
+        return defaultValue;
+    }
+}
+
+void sweep();
+
+// 首次使用时读取配置并启动续期 / 清理定时器（要求持有锁）
+void ensureLoadedLocked() {
+    auto& state = queue();
+    if (state.loaded) return;
+    state.loaded = true;
+    state.workers = static_cast<size_t>(getConfigNumber("export_job_workers", 2));
+    state.queueMax = static_cast<size_t>(getConfigNumber("export_job_queue_max", 200));
+    state.userLimit = static_cast<size_t>(getConfigNumber("export_job_user_limit", 3));
+    state.ttlSeconds = getConfigNumber("export_job_ttl_seconds", 3600);
+    state.timeoutSeconds = static_cast<double>(getConfigNumber("export_job_timeout_seconds", 120));
+    drogon::app().getLoop()->runEvery(kSweepIntervalSeconds, []() { sweep(); });
+}
+
+std::string downloadUrl(int docId, const std::string& jobId) {
+    return "/api/docs/" + std::to_string(docId) + "/exports/" + jobId + "/download";
+}
+
+Json::Value toJson(const Job& job) {
+    Json::Value value;
+    value["job_id"] = job.id;
+    value["doc_id"] = job.docId;
+    value["format"] = job.format;
+    value["status"] = job.status;
+    value["progress"] = job.progress;
+    value["created_at"] = static_cast<Json::Int64>(job.createdAt);
+    return value;
+}
+
+void notify(int userId, const Json::Value& job) {
+    Json::Value message;
+    message["type"] = "export_job";
+    message["job"] = job;
+    NotificationBus::publishEvent(userId, message);
+}
+
+void logDbError(const char* action, const std::string& jobId, const drogon::orm::DrogonDbException& e) {
+    LOG_ERROR << "[ExportJobQueue] Failed to " << action << " job " << jobId << ": " << e.base().what();
+}
+
+void runTask(const std::string& id, const ExportJobQueue::Task& task) {
+    drogon::app().getLoop()->queueInLoop([id, task]() {
+        try {
+            task(id);
+        } catch (const std::exception& e) {
+            ExportJobQueue::fail(id, std::string("Export failed: ") + e.what());
+        }
+    });
+}
+
+// 在工作位空闲时启动排队任务：先记录为运行中，再执行任务体
+void pump() {
+    std::vector<std::pair<std::string, ExportJobQueue::Task>> toStart;
+    std::vector<std::pair<int, Json::Value>> events;
+    {
+        auto& state = queue();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        while (state.running < state.workers && !state.pending.empty()) {
+            std::string id = state.pending.front();
+            state.pending.pop_front();
+            auto it = state.jobs.find(id);
+            if (it == state.jobs.end() || it->second.status != "queued") continue;
+            Job& job = it->second;
+            job.status = "running";
+            job.progress = 5;
+            ++state.running;
+            toStart.emplace_back(id, std::move(job.task));
+            job.task = nullptr;
+            events.emplace_back(job.userId, toJson(job));
+        }
+    }
+    for (const auto& event : events) notify(event.first, event.second);
+
+    auto db = drogon::app().getDbClient();
+    for (auto& item : toStart) {
+        auto id = item.first;
+        auto task = std::move(item.second);
+        if (!db) {
+            runTask(id, task);
+            continue;
+        }
+        // 结束语句同样接受 queued 状态，这里失败时任务仍照常执行
+        db->execSqlAsync(
+                kStartSql, [id, task](const drogon::orm::Result&) { runTask(id, task); },
+                [id, task](const drogon::orm::DrogonDbException& e) {
+                    logDbError("start", id, e);
+                    runTask(id, task);
+                },
+                id);
+    }
+}
+
+// 写入任务结果，之后释放工作位并通知用户
+void finish(const std::string& jobId, bool success, const std::string& error,
+            const ExportJobQueue::Artifact& artifact) {
+    auto release = [jobId, success, error, artifact](std::time_t finishedAt) {
+        int userId = 0;
+        Json::Value snapshot;
+        {
+            auto& state = queue();
+            std::lock_guard<std::mutex> lock(state.mutex);
+            auto it = state.jobs.find(jobId);
+            if (it == state.jobs.end()) return;
+            Job& job = it->second;
+            job.status = success ? "succeeded" : "failed";
+            job.progress = success ? 100 : job.progress;
+            userId = job.userId;
+            snapshot = toJson(job);
+            --state.running;
+            ++(success ? state.succeeded : state.failed);
+            state.jobs.erase(it);
+        }
+        snapshot["finished_at"] = static_cast<Json::Int64>(finishedAt);
+        if (!error.empty()) snapshot["error"] = error;
+        if (success) {
+            snapshot["filename"] = artifact.filename;
+            snapshot["download_url"] = downloadUrl(snapshot["doc_id"].asInt(), jobId);
+        }
+        if (!success) LOG_WARN << "[ExportJobQueue] Job " << jobId << " failed: " << error;
+        notify(userId, snapshot);
+        pump();
+    };
+
+    auto db = drogon::app().getDbClient();
+    if (!db) {
+        LOG_ERROR << "[ExportJobQueue] Database not available, result of job " << jobId << " is not recorded";
+        release(std::time(nullptr));
+        return;
+    }
+    db->execSqlAsync(
+            kFinishSql,
+            [release](const drogon::orm::Result& r) {
+                release(r.empty() ? std::time(nullptr) : static_cast<std::time_t>(r[0]["finished_at"].as<int64_t>()));
+            },
+            [jobId, release](const drogon::orm::DrogonDbException& e) {
+                // 记录停止续期，超时后由清理标记为失败
+                logDbError("finish", jobId, e);
+                release(std::time(nullptr));
+            },
+            jobId, std::string(success ? "succeeded" : "failed"), error, artifact.cacheKey, artifact.objectName,
+            artifact.filename, artifact.contentType);
+}
+
+// 每次只有第一个 complete / fail 生效
+bool beginFinish(const std::string& jobId) {
+    auto& state = queue();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    auto it = state.jobs.find(jobId);
+    if (it == state.jobs.end() || it->second.status != "running" || it->second.finishing) return false;
+    it->second.finishing = true;
+    return true;
+}
+
+// 本实例任务续期；其他实例遗留的任务标记为失败；过期任务连同产物删除。多实例同时执行时各行只会被处理一次
+void sweep() {
+    auto db = drogon::app().getDbClient();
+    if (!db) return;
+    std::vector<std::string> ids;
+    long ttlSeconds;
+    {
+        auto& state = queue();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        for (const auto& entry : state.jobs) ids.push_back(entry.first);
+        ttlSeconds = state.ttlSeconds;
+    }
+
+    if (!ids.empty()) {
+        db->execSqlAsync(
+                kHeartbeatSql, [](const drogon::orm::Result&) {},
+                [](const drogon::orm::DrogonDbException& e) {
+                    LOG_ERROR << "[ExportJobQueue] Heartbeat failed: " << e.base().what();
+                },
+                DbUtils::buildTextArrayLiteral(ids));
+    }
+    db->execSqlAsync(
+            kExpireStaleSql,
+            [](const drogon::orm::Result& r) {
+                if (!r.empty()) LOG_WARN << "[ExportJobQueue] Marked " << r.size() << " interrupted jobs as failed";
+            },
+            [](const drogon::orm::DrogonDbException& e) {
+                LOG_ERROR << "[ExportJobQueue] Failed to expire stale jobs: " << e.base().what();
+            },
+            std::to_string(ExportJobQueue::kStaleSeconds));
+    db->execSqlAsync(
+            kDeleteExpiredSql,
+            [](const drogon::orm::Result& r) {
+                for (const auto& row : r) {
+                    if (row["artifact_object"].isNull()) continue;
+                    std::string objectName = row["artifact_object"].as<std::string>();
+                    MinIOClient::deleteFile(
+                            objectName, []() {},
+                            [objectName](const std::string& error) {
+                                LOG_WARN << "[ExportJobQueue] Failed to delete " << objectName << ": " << error;
+                            });
+                }
+            },
+            [](const drogon::orm::DrogonDbException& e) {
+                LOG_ERROR << "[ExportJobQueue] Failed to delete expired jobs: " << e.base().what();
+            },
+            std::to_string(ttlSeconds));
+}
+}  // namespace
+
+void ExportJobQueue::submit(int userId, int docId, const std::string& format, Task task, SubmitCallback callback) {
+    size_t userLimit;
+    bool queueFull;
+    {
+        auto& state = queue();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        ensureLoadedLocked();
+        queueFull = state.pending.size() + state.reserved >= state.queueMax;
+        ++(queueFull ? state.rejected : state.reserved);
+        userLimit = state.userLimit;
+    }
+    if (queueFull) {
+        callback(SubmitResult::QueueFull, Json::Value());
+        return;
+    }
+    auto unreserve = [](bool rejected) {
+        auto& state = queue();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        --state.reserved;
+        if (rejected) ++state.rejected;
+    };
+
+    auto db = drogon::app().getDbClient();
+    if (!db) {
+        unreserve(false);
+        callback(SubmitResult::Error, Json::Value());
+        return;
+    }
+
+    auto job = std::make_shared<Job>();
+    job->id = TokenUtils::generateRandomHex(16);
+    job->userId = userId;
+    job->docId = docId;
+    job->format = format;
+    job->status = "queued";
+    job->task = std::move(task);
+    auto accepted = std::make_shared<bool>(false);
+    DbTransaction::begin(
+            db,
+            [=](const std::shared_ptr<DbTransaction>& tx) {
+                tx->exec(kLockUserSql, nullptr, std::to_string(userId));
+                tx->exec(
+                        kInsertSql,
+                        [job, accepted](const drogon::orm::Result& r) {
+                            if (r.empty()) return;
+                            *accepted = true;
+                            job->createdAt = static_cast<std::time_t>(r[0]["created_at"].as<int64_t>());
+                        },
+                        job->id, std::to_string(userId), std::to_string(docId), format, NotificationBus::instanceId(),
+                        std::to_string(userLimit));
+                tx->commit([=]() {
+                    if (!*accepted) {
+                        unreserve(true);
+                        callback(SubmitResult::UserLimitReached, Json::Value());
+                        return;
+                    }
+                    Json::Value jobJson;
+                    {
+                        auto& state = queue();
+                        std::lock_guard<std::mutex> lock(state.mutex);
+                        --state.reserved;
+                        ++state.submitted;
+                        jobJson = toJson(*job);
+                        jobJson["queue_position"] = static_cast<Json::UInt64>(state.pending.size() + 1);
+                        state.pending.push_back(job->id);
+                        state.jobs.emplace(job->id, std::move(*job));
+                    }
+                    callback(SubmitResult::Accepted, jobJson);
+                    pump();
+                });
+            },
+            [=](const std::string& message, drogon::HttpStatusCode) {
+                LOG_ERROR << "[ExportJobQueue] Failed to submit job: " << message;
+                unreserve(false);
+                callback(SubmitResult::Error, Json::Value());
+            });
+}
+
+void ExportJobQueue::reportProgress(const std::string& jobId, int percent) {
+    int userId = 0;
+    Json::Value snapshot;
+    {
+        auto& state = queue();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        auto it = state.jobs.find(jobId);
+        if (it == state.jobs.end() || it->second.status != "running" || it->second.finishing) return;
+        percent = std::max(0, std::min(99, percent));
+        if (percent <= it->second.progress) return;
+        it->second.progress = percent;
+        userId = it->second.userId;
+        snapshot = toJson(it->second);
+    }
+    if (auto db = drogon::app().getDbClient()) {
+        db->execSqlAsync(
+                kProgressSql, [](const drogon::orm::Result&) {},
+                [jobId](const drogon::orm::DrogonDbException& e) { logDbError("update progress of", jobId, e); },
+                jobId, std::to_string(percent));
+    }
+    notify(userId, snapshot);
+}
+
+void ExportJobQueue::complete(const std::string& jobId, const std::string& cacheKey, std::string data,
+                              const std::string& filename, const std::string& contentType) {
+    if (!beginFinish(jobId)) return;
+    Artifact artifact{cacheKey, "exports/" + jobId, filename, contentType};
+    auto body = std::make_shared<std::string>(std::move(data));
+    MinIOClient::uploadFile(
+            artifact.objectName, body->data(), body->size(), contentType,
+            [jobId, artifact, body](const std::string&) { finish(jobId, true, "", artifact); },
+            [jobId](const std::string& error) {
+                LOG_ERROR << "[ExportJobQueue] Failed to upload artifact of job " << jobId << ": " << error;
+                finish(jobId, false, "Failed to store export artifact", Artifact());
+            });
+}
+
+void ExportJobQueue::fail(const std::string& jobId, const std::string& error) {
+    if (!beginFinish(jobId)) return;
+    finish(jobId, false, error, Artifact());
+}
+
+void ExportJobQueue::getJob(const std::string& jobId, int userId, JobCallback callback,
+                            std::function<void(const std::string&)> errorCallback) {
+    {
+        // 只处理查询的实例同样参与清理
+        auto& state = queue();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        ensureLoadedLocked();
+    }
+    auto db = drogon::app().getDbClient();
+    if (!db) {
+        errorCallback("Database not available");
+        return;
+    }
+    db->execSqlAsync(
+            kSelectSql,
+            [callback](const drogon::orm::Result& r) {
+                Artifact artifact;
+                if (r.empty()) {
+                    callback(Json::Value(), artifact);
+                    return;
+                }
+                const auto& row = r[0];
+                auto text = [&row](const char* column) {
+                    return row[column].isNull() ? std::string() : row[column].as<std::string>();
+                };
+                Json::Value job;
+                job["job_id"] = row["id"].as<std::string>();
+                job["doc_id"] = row["doc_id"].as<int>();
+                job["format"] = row["format"].as<std::string>();
+                job["status"] = row["status"].as<std::string>();
+                job["progress"] = row["progress"].as<int>();
+                job["created_at"] = static_cast<Json::Int64>(row["created_at"].as<int64_t>());
+                if (!row["finished_at"].isNull()) {
+                    job["finished_at"] = static_cast<Json::Int64>(row["finished_at"].as<int64_t>());
+                }
+                if (!row["error"].isNull()) job["error"] = text("error");
+                if (!row["queue_position"].isNull()) {
+                    job["queue_position"] = static_cast<Json::UInt64>(row["queue_position"].as<int64_t>());
+                }
+                if (job["status"].asString() == "succeeded") {
+                    artifact = Artifact{text("cache_key"), text("artifact_object"), text("filename"),
+                                        text("content_type")};
+                    job["filename"] = artifact.filename;
+                    job["download_url"] = downloadUrl(job["doc_id"].asInt(), job["job_id"].asString());
+                }
+                callback(job, artifact);
+            },
+            [errorCallback](const drogon::orm::DrogonDbException& e) {
+                errorCallback("Database error: " + std::string(e.base().what()));
+            },
+            jobId, std::to_string(userId));
+}
+
+double ExportJobQueue::conversionTimeoutSeconds() {
+    auto& state = queue();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    ensureLoadedLocked();
+    return state.timeoutSeconds;
+}
+
+Json::Value ExportJobQueue::getStats() {
+    auto& state = queue();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    ensureLoadedLocked();
+    Json::Value stats;
+    stats["workers"] = static_cast<Json::UInt64>(state.workers);
+    stats["queue_max"] = static_cast<Json::UInt64>(state.queueMax);
+    stats["user_limit"] = static_cast<Json::UInt64>(state.userLimit);
+    stats["queued"] = static_cast<Json::UInt64>(state.pending.size());
+    stats["running"] = static_cast<Json::UInt64>(state.running);
+    stats["submitted"] = static_cast<Json::UInt64>(state.submitted);
+    stats["rejected"] = static_cast<Json::UInt64>(state.rejected);
+    stats["succeeded"] = static_cast<Json::UInt64>(state.succeeded);
+    stats["failed"] = static_cast<Json::UInt64>(state.failed);
+    return stats;
+}
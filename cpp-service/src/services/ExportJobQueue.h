@@ -0,0 +1,63 @@
+#pragma once
+#include <json/json.h>
+
+#include <functional>
+#include <string>
+
+/**
+ * ExportJobQueue 在后台执行导出任务（POST /api/docs/{id}/exports），HTTP 请求只负责入队并立即返回任务 ID。
+ *
+ * - 任务记录保存在 export_job 表中，任务由提交它的实例执行，状态与下载可以由任意实例处理；
+ * - 每个实例同时运行的任务不超过 app.export_job_workers 个，其余按提交顺序排队，
+ *   实例内排队上限 app.export_job_queue_max；
+ * - 每个用户未结束（排队 + 运行中）的任务不超过 app.export_job_user_limit 个（按数据库统计），超出时拒绝提交；
+ * - 成功后产物上传到 MinIO（exports/<jobId>），同时保留在本实例的 ExportCache 中；
+ * - 状态变化与进度经 NotificationBus 推送到用户所在实例的通知 WebSocket（type = export_job）；
+ * - 执行中的任务定期续期，实例退出后超过 kStaleSeconds 未续期的任务标记为失败；
+ *   已结束的任务保留 app.export_job_ttl_seconds 秒后连同产物一起清理。
+ *
+ * 任务体由调用方提供，在事件循环上执行，必须以 complete 或 fail 结束。所有方法线程安全。
+ */
+class ExportJobQueue {
+public:
+    enum class SubmitResult { Accepted, QueueFull, UserLimitReached, Error };
+
+    // 任务体，参数为任务 ID
+    using Task = std::function<void(const std::string& jobId)>;
+    // 提交结果；接受时 job 为任务信息
+    using SubmitCallback = std::function<void(SubmitResult result, const Json::Value& job)>;
+
+    // 产物位置：本地 ExportCache 的键与 MinIO 对象名
+    struct Artifact {
+        std::string cacheKey;
+        std::string objectName;
+        std::string filename;
+        std::string contentType;
+    };
+    // 任务不存在时 job 为 null；任务成功时 artifact 有效
+    using JobCallback = std::function<void(const Json::Value& job, const Artifact& artifact)>;
+
+    // 提交任务（写入任务记录后回调）
+    static void submit(int userId, int docId, const std::string& format, Task task, SubmitCallback callback);
+
+    // 任务体上报进度（0-100）
+    static void reportProgress(const std::string& jobId, int percent);
+    // 任务成功：上传产物内容后结束任务。cacheKey 为同一产物在 ExportCache 中的键，下载时优先读取本地缓存
+    static void complete(const std::string& jobId, const std::string& cacheKey, std::string data,
+                         const std::string& filename, const std::string& contentType);
+    // 任务失败
+    static void fail(const std::string& jobId, const std::string& error);
+
+    // 按 ID 查询 userId 的任务
+    static void getJob(const std::string& jobId, int userId, JobCallback callback,
+                       std::function<void(const std::string&)> errorCallback);
+
+    // 任务内单次转换请求的超时（秒）
+    static double conversionTimeoutSeconds();
+
+    // 本实例的排队 / 运行中任务数及累计提交、拒绝、成功、失败次数
+    static Json::Value getStats();
+
+    // 未续期超过该时长（秒）的未结束任务视为所在实例已退出
+    static constexpr int kStaleSeconds = 300;
+};
@@ -0,0 +1,1267 @@
+#include "LocalSearchEngine.h"
+
+#include <dirent.h>
+#include <drogon/drogon.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#include "../utils/TextTokenizer.h"
+
+namespace {
+// 段文件格式标识（02：索引词增加中日韩单字，旧版本的段无法服务单字查询，需要重建）
+constexpr char kSegmentMagic[8] = {'C', 'D', 'X', 'S', 'E', 'G', '0', '2'};
+// 段文件头：magic + 4 个 uint32 + 4 个 uint64
+constexpr size_t kHeaderSize = 8 + 4 * 4 + 4 * 8;
+// 内存段文档数达到该值时立即落盘
+constexpr uint32_t kMemFlushDocs = 1000;
+// 定时落盘周期
+constexpr auto kFlushInterval = std::chrono::seconds(5);
+// 磁盘段数量超过该值时触发后台合并
+constexpr size_t kMaxSegments = 8;
+// BM25 参数
+constexpr double kBm25K1 = 1.2;
+constexpr double kBm25B = 0.75;
+// 标题中的词按该倍数计入词频
+constexpr uint32_t kTitleWeight = 2;
+// 搜索结果中 content 摘要的最大字节数
+constexpr size_t kSnippetBytes = 240;
+
+using Document = LocalSearchEngine::Document;
+
+// ---------------- 编码工具 ----------------
+
+void putVarint(std::string& out, uint32_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+bool getVarint(const char*& p, const char* end, uint32_t& value) {
+    value = 0;
+    for (int shift = 0; shift <= 28 && p < end; shift += 7) {
+        uint8_t byte = static_cast<uint8_t>(*p++);
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+template <typename T>
+void putFixed(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+T getFixed(const char* p) {
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+template <typename T>
+void setFixed(std::string& out, size_t pos, T value) {
+    std::memcpy(&out[pos], &value, sizeof(T));
+}
+
+// 写满 size 字节（处理 EINTR 与部分写入）
+bool writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+// ---------------- 预写日志 ----------------
+
+// 记录格式：payload 长度 + FNV-1a 校验和 + payload；payload 以操作类型开头
+enum class WalOp : uint8_t { Upsert = 1, Acl = 2, Delete = 3 };
+
+uint32_t walChecksum(const char* data, size_t size) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<uint8_t>(data[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void appendWalRecord(std::string& out, const std::string& payload) {
+    putFixed<uint32_t>(out, static_cast<uint32_t>(payload.size()));
+    putFixed<uint32_t>(out, walChecksum(payload.data(), payload.size()));
+    out += payload;
+}
+
+void putAcl(std::string& out, int docId, int ownerId, const std::vector<int>& allowedUserIds) {
+    putFixed<int32_t>(out, docId);
+    putFixed<int32_t>(out, ownerId);
+    putFixed<uint32_t>(out, static_cast<uint32_t>(allowedUserIds.size()));
+    for (int userId : allowedUserIds) putFixed<int32_t>(out, userId);
+}
+
+std::string encodeUpsert(const Document& doc) {
+    std::string payload(1, static_cast<char>(WalOp::Upsert));
+    putAcl(payload, doc.id, doc.ownerId, doc.allowedUserIds);
+    putFixed<uint32_t>(payload, static_cast<uint32_t>(doc.title.size()));
+    payload += doc.title;
+    putFixed<uint32_t>(payload, static_cast<uint32_t>(doc.content.size()));
+    payload += doc.content;
+    return payload;
+}
+
+std::string encodeAcl(int docId, int ownerId, const std::vector<int>& allowedUserIds) {
+    std::string payload(1, static_cast<char>(WalOp::Acl));
+    putAcl(payload, docId, ownerId, allowedUserIds);
+    return payload;
+}
+
+std::string encodeDelete(int docId) {
+    std::string payload(1, static_cast<char>(WalOp::Delete));
+    putFixed<int32_t>(payload, docId);
+    return payload;
+}
+
+// 带边界检查的 payload 读取
+class WalReader {
+public:
+    WalReader(const char* data, size_t size) : p_(data), end_(data + size) {}
+
+    template <typename T>
+    bool fixed(T& value) {
+        if (static_cast<size_t>(end_ - p_) < sizeof(T)) return false;
+        value = getFixed<T>(p_);
+        p_ += sizeof(T);
+        return true;
+    }
+
+    bool bytes(std::string& value) {
+        uint32_t size;
+        if (!fixed(size) || static_cast<size_t>(end_ - p_) < size) return false;
+        value.assign(p_, size);
+        p_ += size;
+        return true;
+    }
+
+    bool acl(Document& doc) {
+        uint32_t count;
+        if (!fixed(doc.id) || !fixed(doc.ownerId) || !fixed(count) || static_cast<size_t>(end_ - p_) / 4 < count) {
+            return false;
+        }
+        doc.allowedUserIds.resize(count);
+        for (auto& userId : doc.allowedUserIds) fixed(userId);
+        return true;
+    }
+
+private:
+    const char* p_;
+    const char* end_;
+};
+
+// 内存段对应的预写日志：写入先追加到日志再应用到内存段，内存段落盘（MANIFEST 已更新）后删除
+class WalFile {
+public:
+    static std::shared_ptr<WalFile> create(const std::string& path) {
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+        if (fd < 0) return nullptr;
+        return std::shared_ptr<WalFile>(new WalFile(path, fd));
+    }
+
+    ~WalFile() { ::close(fd_); }
+
+    const std::string& path() const { return path_; }
+    bool append(const std::string& records) { return writeAll(fd_, records.data(), records.size()); }
+    bool sync() { return ::fdatasync(fd_) == 0; }
+
+private:
+    WalFile(std::string path, int fd) : path_(std::move(path)), fd_(fd) {}
+
+    std::string path_;
+    int fd_;
+};
+
+// ---------------- 段 ----------------
+
+// 删除记录：docId 与删除发生时本段已有的文档数（重放时据此确定删除与写入的先后）
+struct DeleteEntry {
+    int docId;
+    uint32_t before;
+};
+
+class Segment {
+public:
+    explicit Segment(uint32_t id) : id_(id) {}
+    virtual ~Segment() = default;
+
+    uint32_t id() const { return id_; }
+    virtual bool onDisk() const = 0;
+    virtual uint32_t docCount() const = 0;
+    virtual int docId(uint32_t ord) const = 0;
+    virtual uint32_t docLength(uint32_t ord) const = 0;
+    virtual bool allows(uint32_t ord, int userId) const = 0;
+    virtual Document document(uint32_t ord) const = 0;
+    // 按文档序号递增遍历词的倒排表
+    virtual void forEachPosting(const std::string& term, const std::function<void(uint32_t, uint32_t)>& fn) const = 0;
+    // 遍历本段全部词（合并时使用）
+    virtual void forEachTerm(const std::function<void(const std::string&)>& fn) const = 0;
+    virtual std::vector<DeleteEntry> deletes() const = 0;
+
+private:
+    uint32_t id_;
+};
+
+// 内存段：接收写入，落盘后由同 id 的磁盘段替换
+class MemSegment : public Segment {
+public:
+    explicit MemSegment(uint32_t id) : Segment(id) {}
+
+    bool onDisk() const override { return false; }
+    uint32_t docCount() const override { return static_cast<uint32_t>(docs_.size()); }
+    int docId(uint32_t ord) const override { return docs_[ord].doc.id; }
+    uint32_t docLength(uint32_t ord) const override { return docs_[ord].length; }
+    bool allows(uint32_t ord, int userId) const override {
+        const auto& doc = docs_[ord].doc;
+        return doc.ownerId == userId ||
+               std::find(doc.allowedUserIds.begin(), doc.allowedUserIds.end(), userId) != doc.allowedUserIds.end();
+    }
+    Document document(uint32_t ord) const override { return docs_[ord].doc; }
+
+    void forEachPosting(const std::string& term, const std::function<void(uint32_t, uint32_t)>& fn) const override {
+        auto it = postings_.find(term);
+        if (it == postings_.end()) return;
+        for (const auto& posting : it->second) fn(posting.first, posting.second);
+    }
+
+    void forEachTerm(const std::function<void(const std::string&)>& fn) const override {
+        for (const auto& entry : postings_) fn(entry.first);
+    }
+
+    std::vector<DeleteEntry> deletes() const override { return deletes_; }
+
+    // 分词并写入，返回文档序号
+    uint32_t add(Document doc) {
+        std::unordered_map<std::string, uint32_t> termFreq;
+        uint32_t length = 0;
+        for (auto& token : TextTokenizer::tokenizeForIndex(doc.title)) {
+            termFreq[token] += kTitleWeight;
+            length += kTitleWeight;
+        }
+        for (auto& token : TextTokenizer::tokenizeForIndex(doc.content)) {
+            ++termFreq[token];
+            ++length;
+        }
+        uint32_t ord = addStored(std::move(doc), length);
+        for (const auto& entry : termFreq) {
+            postings_[entry.first].emplace_back(ord, entry.second);
+        }
+        return ord;
+    }
+
+    // 只写入存储字段，倒排表由调用方通过 addPosting 补齐（合并时使用）
+    uint32_t addStored(Document doc, uint32_t length) {
+        docs_.push_back({std::move(doc), length});
+        return static_cast<uint32_t>(docs_.size() - 1);
+    }
+
+    void addPosting(const std::string& term, uint32_t ord, uint32_t tf) { postings_[term].emplace_back(ord, tf); }
+
+    void markDeleted(int docId) { deletes_.push_back({docId, docCount()}); }
+
+    bool empty() const { return docs_.empty() && deletes_.empty(); }
+
+    // 序列化为段文件内容
+    std::string serialize() const {
+        std::string out(kHeaderSize, '\0');
+        std::memcpy(&out[0], kSegmentMagic, sizeof(kSegmentMagic));
+
+        // 文档：偏移表 + 记录
+        uint64_t docsOffset = out.size();
+        out.resize(out.size() + docs_.size() * sizeof(uint64_t));
+        for (size_t i = 0; i < docs_.size(); ++i) {
+            setFixed<uint64_t>(out, docsOffset + i * sizeof(uint64_t), out.size());
+            const auto& stored = docs_[i];
+            putFixed<int32_t>(out, stored.doc.id);
+            putFixed<int32_t>(out, stored.doc.ownerId);
+            putFixed<uint32_t>(out, stored.length);
+            putFixed<uint32_t>(out, static_cast<uint32_t>(stored.doc.allowedUserIds.size()));
+            for (int userId : stored.doc.allowedUserIds) putFixed<int32_t>(out, userId);
+            putFixed<uint32_t>(out, static_cast<uint32_t>(stored.doc.title.size()));
+            out += stored.doc.title;
+            putFixed<uint32_t>(out, static_cast<uint32_t>(stored.doc.content.size()));
+            out += stored.doc.content;
+        }
+
+        // 倒排表：序号差值 + 词频，varint 编码
+        std::vector<const std::string*> terms;
+        terms.reserve(postings_.size());
+        for (const auto& entry : postings_) terms.push_back(&entry.first);
+        std::sort(terms.begin(), terms.end(), [](const std::string* a, const std::string* b) { return *a < *b; });
+
+        std::string postingsBlob;
+        std::vector<std::pair<uint64_t, uint32_t>> postingRanges;  // 相对 postingsBlob 的偏移与长度
+        postingRanges.reserve(terms.size());
+        for (const auto* term : terms) {
+            size_t start = postingsBlob.size();
+            uint32_t prev = 0;
+            for (const auto& posting : postings_.at(*term)) {
+                putVarint(postingsBlob, posting.first - prev);
+                putVarint(postingsBlob, posting.second);
+                prev = posting.first;
+            }
+            postingRanges.emplace_back(start, static_cast<uint32_t>(postingsBlob.size() - start));
+        }
+
+        // 词典：偏移表 + 条目（词、df、倒排表位置）；倒排表紧跟在词典之后
+        uint64_t dictOffset = out.size();
+        out.resize(out.size() + terms.size() * sizeof(uint64_t));
+        std::vector<size_t> postingFixups;
+        for (size_t i = 0; i < terms.size(); ++i) {
+            setFixed<uint64_t>(out, dictOffset + i * sizeof(uint64_t), out.size());
+            putFixed<uint16_t>(out, static_cast<uint16_t>(terms[i]->size()));
+            out += *terms[i];
+            putFixed<uint32_t>(out, static_cast<uint32_t>(postings_.at(*terms[i]).size()));
+            postingFixups.push_back(out.size());
+            putFixed<uint64_t>(out, 0);
+            putFixed<uint32_t>(out, postingRanges[i].second);
+        }
+        uint64_t postingsOffset = out.size();
+        for (size_t i = 0; i < terms.size(); ++i) {
+            setFixed<uint64_t>(out, postingFixups[i], postingsOffset + postingRanges[i].first);
+        }
+        out += postingsBlob;
+
+        uint64_t deletesOffset = out.size();
+        for (const auto& entry : deletes_) {
+            putFixed<int32_t>(out, entry.docId);
+            putFixed<uint32_t>(out, entry.before);
+        }
+
+        size_t pos = sizeof(kSegmentMagic);
+        setFixed<uint32_t>(out, pos, static_cast<uint32_t>(docs_.size()));
+        setFixed<uint32_t>(out, pos + 4, static_cast<uint32_t>(terms.size()));
+        setFixed<uint32_t>(out, pos + 8, static_cast<uint32_t>(deletes_.size()));
+        setFixed<uint32_t>(out, pos + 12, 0);
+        setFixed<uint64_t>(out, pos + 16, docsOffset);
+        setFixed<uint64_t>(out, pos + 24, dictOffset);
+        setFixed<uint64_t>(out, pos + 32, postingsOffset);
+        setFixed<uint64_t>(out, pos + 40, deletesOffset);
+        return out;
+    }
+
+private:
+    struct StoredDoc {
+        Document doc;
+        uint32_t length;
+    };
+
+    std::vector<StoredDoc> docs_;
+    std::unordered_map<std::string, std::vector<std::pair<uint32_t, uint32_t>>> postings_;
+    std::vector<DeleteEntry> deletes_;
+};
+
+// 磁盘段：只读，通过 mmap 访问
+class DiskSegment : public Segment {
+public:
+    static std::shared_ptr<DiskSegment> open(const std::string& path, uint32_t id) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return nullptr;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < kHeaderSize) {
+            ::close(fd);
+            return nullptr;
+        }
+        size_t size = static_cast<size_t>(st.st_size);
+        void* addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (addr == MAP_FAILED) return nullptr;
+
+        std::shared_ptr<DiskSegment> segment(new DiskSegment(id, path, static_cast<const char*>(addr), size));
+        if (!segment->validate()) return nullptr;
+        return segment;
+    }
+
+    ~DiskSegment() override { munmap(const_cast<char*>(data_), size_); }
+
+    const std::string& path() const { return path_; }
+    bool onDisk() const override { return true; }
+    uint32_t docCount() const override { return docCount_; }
+    int docId(uint32_t ord) const override { return getFixed<int32_t>(docRecord(ord)); }
+    uint32_t docLength(uint32_t ord) const override { return getFixed<uint32_t>(docRecord(ord) + 8); }
+
+    bool allows(uint32_t ord, int userId) const override {
+        const char* p = docRecord(ord);
+        if (getFixed<int32_t>(p + 4) == userId) return true;
+        uint32_t count = getFixed<uint32_t>(p + 12);
+        p += 16;
+        for (uint32_t i = 0; i < count; ++i, p += 4) {
+            if (getFixed<int32_t>(p) == userId) return true;
+        }
+        return false;
+    }
+
+    Document document(uint32_t ord) const override {
+        const char* p = docRecord(ord);
+        Document doc;
+        doc.id = getFixed<int32_t>(p);
+        doc.ownerId = getFixed<int32_t>(p + 4);
+        uint32_t count = getFixed<uint32_t>(p + 12);
+        p += 16;
+        doc.allowedUserIds.reserve(count);
+        for (uint32_t i = 0; i < count; ++i, p += 4) doc.allowedUserIds.push_back(getFixed<int32_t>(p));
+        uint32_t titleLen = getFixed<uint32_t>(p);
+        doc.title.assign(p + 4, titleLen);
+        p += 4 + titleLen;
+        uint32_t contentLen = getFixed<uint32_t>(p);
+        doc.content.assign(p + 4, contentLen);
+        return doc;
+    }
+
+    void forEachPosting(const std::string& term, const std::function<void(uint32_t, uint32_t)>& fn) const override {
+        // 词典有序，二分查找
+        uint32_t lo = 0, hi = termCount_;
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            int cmp = termAt(mid).compare(term);
+            if (cmp == 0) {
+                decodePostings(mid, fn);
+                return;
+            }
+            if (cmp < 0) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+    }
+
+    void forEachTerm(const std::function<void(const std::string&)>& fn) const override {
+        for (uint32_t i = 0; i < termCount_; ++i) fn(std::string(termAt(i)));
+    }
+
+    std::vector<DeleteEntry> deletes() const override {
+        std::vector<DeleteEntry> result;
+        result.reserve(deleteCount_);
+        const char* p = data_ + deletesOffset_;
+        for (uint32_t i = 0; i < deleteCount_; ++i, p += 8) {
+            result.push_back({getFixed<int32_t>(p), getFixed<uint32_t>(p + 4)});
+        }
+        return result;
+    }
+
+private:
+    DiskSegment(uint32_t id, std::string path, const char* data, size_t size)
+        : Segment(id), path_(std::move(path)), data_(data), size_(size) {}
+
+    bool validate() {
+        if (std::memcmp(data_, kSegmentMagic, sizeof(kSegmentMagic)) != 0) return false;
+        const char* p = data_ + sizeof(kSegmentMagic);
+        docCount_ = getFixed<uint32_t>(p);
+        termCount_ = getFixed<uint32_t>(p + 4);
+        deleteCount_ = getFixed<uint32_t>(p + 8);
+        docsOffset_ = getFixed<uint64_t>(p + 16);
+        dictOffset_ = getFixed<uint64_t>(p + 24);
+        postingsOffset_ = getFixed<uint64_t>(p + 32);
+        deletesOffset_ = getFixed<uint64_t>(p + 40);
+        return docsOffset_ + uint64_t(docCount_) * 8 <= size_ && dictOffset_ + uint64_t(termCount_) * 8 <= size_ &&
+               postingsOffset_ <= size_ && deletesOffset_ + uint64_t(deleteCount_) * 8 <= size_;
+    }
+
+    const char* docRecord(uint32_t ord) const {
+        return data_ + getFixed<uint64_t>(data_ + docsOffset_ + uint64_t(ord) * 8);
+    }
+
+    const char* termEntry(uint32_t index) const {
+        return data_ + getFixed<uint64_t>(data_ + dictOffset_ + uint64_t(index) * 8);
+    }
+
+    std::string termAt(uint32_t index) const {
+        const char* p = termEntry(index);
+        return std::string(p + 2, getFixed<uint16_t>(p));
+    }
+
+    void decodePostings(uint32_t index, const std::function<void(uint32_t, uint32_t)>& fn) const {
+        const char* p = termEntry(index);
+        p += 2 + getFixed<uint16_t>(p) + 4;  // 跳过词与 df
+        uint64_t offset = getFixed<uint64_t>(p);
+        uint32_t bytes = getFixed<uint32_t>(p + 8);
+        if (offset + bytes > size_) return;
+        const char* cur = data_ + offset;
+        const char* end = cur + bytes;
+        uint32_t ord = 0;
+        while (cur < end) {
+            uint32_t delta, tf;
+            if (!getVarint(cur, end, delta) || !getVarint(cur, end, tf)) return;
+            ord += delta;
+            fn(ord, tf);
+        }
+    }
+
+    std::string path_;
+    const char* data_;
+    size_t size_;
+    uint32_t docCount_{0};
+    uint32_t termCount_{0};
+    uint32_t deleteCount_{0};
+    uint64_t docsOffset_{0};
+    uint64_t dictOffset_{0};
+    uint64_t postingsOffset_{0};
+    uint64_t deletesOffset_{0};
+};
+
+// ---------------- 引擎状态 ----------------
+
+struct Location {
+    uint32_t segmentId;
+    uint32_t ord;
+};
+
+// 已冻结、等待落盘的内存段及其日志
+struct FrozenSegment {
+    std::shared_ptr<MemSegment> segment;
+    std::shared_ptr<WalFile> wal;
+};
+
+struct EngineState {
+    std::shared_mutex mutex;
+    std::string directory;
+    bool opened{false};
+    // 按写入顺序排列：磁盘段在前，随后是等待落盘的内存段与当前内存段
+    std::vector<std::shared_ptr<Segment>> segments;
+    std::shared_ptr<MemSegment> active;
+    std::shared_ptr<WalFile> wal;            // 当前内存段的日志
+    std::vector<FrozenSegment> frozen;       // 按冻结顺序落盘，失败时保留到下一轮
+    std::unordered_map<int, Location> live;  // docId -> 最新版本的位置
+    uint64_t totalLength{0};                 // 有效文档的词数之和（BM25 平均长度）
+    uint32_t nextSegmentId{1};
+    int64_t lastModified{0};                 // 打开时索引文件的最新修改时间，0 表示需要全量校对
+    std::atomic_bool flushing{false};
+    std::atomic_bool merging{false};
+
+    // 落盘与合并在同一个后台线程中执行
+    std::thread worker;
+    std::mutex workerMutex;
+    std::condition_variable workerCv;
+    bool flushRequested{false};
+    bool stopping{false};
+};
+
+EngineState& engine() {
+    // 有意不析构：后台线程可能在静态对象析构后仍在运行，正常退出时由 close() 停止
+    static EngineState* state = new EngineState;
+    return *state;
+}
+
+// 以下 *Locked 函数要求调用方持有写锁
+Segment* findSegmentLocked(uint32_t id) {
+    for (const auto& segment : engine().segments) {
+        if (segment->id() == id) return segment.get();
+    }
+    return nullptr;
+}
+
+void eraseLiveLocked(int docId) {
+    auto& state = engine();
+    auto it = state.live.find(docId);
+    if (it == state.live.end()) return;
+    if (auto* segment = findSegmentLocked(it->second.segmentId)) {
+        state.totalLength -= segment->docLength(it->second.ord);
+    }
+    state.live.erase(it);
+}
+
+void setLiveLocked(int docId, Location location, uint32_t length) {
+    eraseLiveLocked(docId);
+    engine().live[docId] = location;
+    engine().totalLength += length;
+}
+
+std::string segmentPath(uint32_t id) { return engine().directory + "/segment-" + std::to_string(id) + ".seg"; }
+
+std::string walPath(uint32_t id) { return engine().directory + "/segment-" + std::to_string(id) + ".wal"; }
+
+// rename / unlink 之后同步目录项
+void syncDirectory(const std::string& directory) {
+    int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return;
+    ::fsync(fd);
+    ::close(fd);
+}
+
+// 原子写文件：写临时文件并 fsync 后再 rename，断电后看到的要么是旧文件，要么是完整的新文件
+bool writeFileAtomically(const std::string& path, const std::string& content) {
+    std::string tmpPath = path + ".tmp";
+    int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    bool ok = writeAll(fd, content.data(), content.size()) && ::fsync(fd) == 0;
+    ok = ::close(fd) == 0 && ok;
+    if (!ok || std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        ::unlink(tmpPath.c_str());
+        return false;
+    }
+    syncDirectory(engine().directory);
+    return true;
+}
+
+// 新建当前内存段及其日志（要求持有写锁）
+void startActiveLocked() {
+    auto& state = engine();
+    state.active = std::make_shared<MemSegment>(state.nextSegmentId++);
+    state.segments.push_back(state.active);
+    state.wal = WalFile::create(walPath(state.active->id()));
+    if (!state.wal) {
+        LOG_ERROR << "[LocalSearchEngine] Cannot create " << walPath(state.active->id())
+                  << ", writes are not durable until the next flush";
+    }
+}
+
+// 追加日志记录（要求持有写锁），返回的日志由调用方在释放锁后 sync
+std::shared_ptr<WalFile> appendWalLocked(const std::string& records) {
+    auto& state = engine();
+    if (!state.wal || records.empty()) return nullptr;
+    if (!state.wal->append(records)) {
+        LOG_ERROR << "[LocalSearchEngine] Failed to append to " << state.wal->path();
+        return nullptr;
+    }
+    return state.wal;
+}
+
+void syncWal(const std::shared_ptr<WalFile>& wal) {
+    if (wal && !wal->sync()) LOG_ERROR << "[LocalSearchEngine] Failed to sync " << wal->path();
+}
+
+// 以下三个函数将一次写入应用到内存段（要求持有写锁），打开索引时的日志重放也使用它们
+void upsertLocked(Document doc) {
+    auto& state = engine();
+    int docId = doc.id;
+    uint32_t ord = state.active->add(std::move(doc));
+    setLiveLocked(docId, {state.active->id(), ord}, state.active->docLength(ord));
+}
+
+// 文档不存在时返回 false
+bool updateAclLocked(int docId, int ownerId, const std::vector<int>& allowedUserIds) {
+    auto& state = engine();
+    auto it = state.live.find(docId);
+    if (it == state.live.end()) return false;
+    Segment* segment = findSegmentLocked(it->second.segmentId);
+    if (!segment) return false;
+    // 以新 ACL 写入新版本，旧版本在合并时清理
+    Document doc = segment->document(it->second.ord);
+    doc.ownerId = ownerId;
+    doc.allowedUserIds = allowedUserIds;
+    upsertLocked(std::move(doc));
+    return true;
+}
+
+bool removeLocked(int docId) {
+    auto& state = engine();
+    if (state.live.find(docId) == state.live.end()) return false;
+    eraseLiveLocked(docId);
+    state.active->markDeleted(docId);
+    return true;
+}
+
+// 重放一个日志文件中的有效记录；遇到截断或校验失败的记录即停止（进程崩溃时最后一条可能只写了一半）
+void replayWalLocked(const std::string& path, std::string& relog) {
+    std::ifstream file(path, std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    size_t pos = 0;
+    size_t applied = 0;
+    while (data.size() - pos >= 8) {
+        uint32_t size = getFixed<uint32_t>(data.data() + pos);
+        uint32_t checksum = getFixed<uint32_t>(data.data() + pos + 4);
+        if (size == 0 || data.size() - pos - 8 < size || walChecksum(data.data() + pos + 8, size) != checksum) break;
+        WalReader reader(data.data() + pos + 8, size);
+        uint8_t op = 0;
+        Document doc;
+        bool ok = reader.fixed(op);
+        if (ok && op == static_cast<uint8_t>(WalOp::Upsert)) {
+            ok = reader.acl(doc) && reader.bytes(doc.title) && reader.bytes(doc.content);
+            if (ok) upsertLocked(std::move(doc));
+        } else if (ok && op == static_cast<uint8_t>(WalOp::Acl)) {
+            ok = reader.acl(doc);
+            if (ok) updateAclLocked(doc.id, doc.ownerId, doc.allowedUserIds);
+        } else if (ok && op == static_cast<uint8_t>(WalOp::Delete)) {
+            ok = reader.fixed(doc.id);
+            if (ok) removeLocked(doc.id);
+        } else {
+            ok = false;
+        }
+        if (!ok) break;
+        relog.append(data, pos, 8 + size);
+        pos += 8 + size;
+        ++applied;
+    }
+    if (pos < data.size()) {
+        LOG_WARN << "[LocalSearchEngine] Ignored " << data.size() - pos << " trailing bytes in " << path;
+    }
+    LOG_INFO << "[LocalSearchEngine] Replayed " << applied << " writes from " << path;
+}
+
+// 记录磁盘段顺序（要求持有锁）
+bool writeManifestLocked() {
+    std::string content;
+    for (const auto& segment : engine().segments) {
+        if (segment->onDisk()) content += std::to_string(segment->id()) + "\n";
+    }
+    return writeFileAtomically(engine().directory + "/MANIFEST", content);
+}
+
+bool ensureDirectory(const std::string& directory) {
+    std::string current;
+    std::stringstream ss(directory);
+    std::string part;
+    if (!directory.empty() && directory[0] == '/') current = "/";
+    while (std::getline(ss, part, '/')) {
+        if (part.empty()) continue;
+        current += part + "/";
+        if (mkdir(current.c_str(), 0755) != 0 && errno != EEXIST) return false;
+    }
+    return true;
+}
+
+// 截取 content 中第一个命中词附近的片段
+std::string buildSnippet(const std::string& content, const std::vector<std::string>& terms) {
+    if (content.size() <= kSnippetBytes) return content;
+    std::string lower = content;
+    std::transform(lower.begin(), lower.end(), lower.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    size_t hit = std::string::npos;
+    for (const auto& term : terms) {
+        hit = std::min(hit, lower.find(term));
+    }
+    size_t start = (hit == std::string::npos || hit < kSnippetBytes / 4) ? 0 : hit - kSnippetBytes / 4;
+    // 对齐到 UTF-8 字符边界
+    auto isContinuation = [&](size_t pos) {
+        return pos < content.size() && (static_cast<unsigned char>(content[pos]) & 0xC0) == 0x80;
+    };
+    while (start > 0 && isContinuation(start)) --start;
+    size_t end = std::min(content.size(), start + kSnippetBytes);
+    while (end < content.size() && isContinuation(end)) --end;
+    std::string snippet = content.substr(start, end - start);
+    if (start > 0) snippet = "…" + snippet;
+    if (end < content.size()) snippet += "…";
+    return snippet;
+}
+
+// 冻结当前内存段并按顺序落盘等待中的内存段；写入失败的段与日志保留，下一轮重试
+void flushActive() {
+    auto& state = engine();
+    std::vector<FrozenSegment> pending;
+    {
+        std::unique_lock<std::shared_mutex> lock(state.mutex);
+        if (!state.opened) return;
+        if (!state.active->empty()) {
+            // 冻结当前内存段（仍可被查询），新写入进入新的内存段
+            state.frozen.push_back({state.active, state.wal});
+            startActiveLocked();
+        }
+        pending = state.frozen;
+    }
+    if (pending.empty()) return;
+    state.flushing = true;
+
+    for (const auto& frozen : pending) {
+        std::string path = segmentPath(frozen.segment->id());
+        std::shared_ptr<DiskSegment> disk;
+        if (writeFileAtomically(path, frozen.segment->serialize())) {
+            disk = DiskSegment::open(path, frozen.segment->id());
+        }
+        if (!disk) {
+            LOG_ERROR << "[LocalSearchEngine] Failed to write segment " << path;
+            break;
+        }
+        {
+            // 同 id 的磁盘段替换内存段，文档序号不变，live 无需调整
+            std::unique_lock<std::shared_mutex> lock(state.mutex);
+            for (auto& segment : state.segments) {
+                if (segment == frozen.segment) segment = disk;
+            }
+            state.frozen.erase(state.frozen.begin());
+            if (!writeManifestLocked()) {
+                // 日志保留，重启时重放；多出的段文件在打开时清理
+                LOG_ERROR << "[LocalSearchEngine] Failed to write manifest in " << state.directory;
+                continue;
+            }
+        }
+        if (frozen.wal) ::unlink(frozen.wal->path().c_str());
+    }
+    state.flushing = false;
+}
+
+// 合并最早的连续磁盘段，只保留其中仍有效的文档
+void mergeSegments() {
+    auto& state = engine();
+    std::vector<std::shared_ptr<DiskSegment>> inputs;
+    std::vector<std::vector<int64_t>> ordMaps;  // 输入段序号 -> 合并段序号（-1 表示丢弃）
+    uint32_t mergedId;
+    {
+        std::shared_lock<std::shared_mutex> lock(state.mutex);
+        for (const auto& segment : state.segments) {
+            if (!segment->onDisk()) break;
+            inputs.push_back(std::static_pointer_cast<DiskSegment>(segment));
+        }
+        if (inputs.size() < 2) return;
+        for (const auto& segment : inputs) {
+            std::vector<int64_t> ordMap(segment->docCount(), -1);
+            for (uint32_t ord = 0; ord < segment->docCount(); ++ord) {
+                auto it = state.live.find(segment->docId(ord));
+                if (it != state.live.end() && it->second.segmentId == segment->id() && it->second.ord == ord) {
+                    ordMap[ord] = 0;  // 先标记有效，序号稍后分配
+                }
+            }
+            ordMaps.push_back(std::move(ordMap));
+        }
+    }
+    {
+        std::unique_lock<std::shared_mutex> lock(state.mutex);
+        mergedId = state.nextSegmentId++;
+    }
+
+    // 1.复制有效文档的存储字段
+    MemSegment merged(mergedId);
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        for (uint32_t ord = 0; ord < inputs[i]->docCount(); ++ord) {
+            if (ordMaps[i][ord] < 0) continue;
+            ordMaps[i][ord] = merged.addStored(inputs[i]->document(ord), inputs[i]->docLength(ord));
+        }
+    }
+    // 2.按段顺序重映射倒排表，序号保持递增
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        const auto& ordMap = ordMaps[i];
+        inputs[i]->forEachTerm([&](const std::string& term) {
+            inputs[i]->forEachPosting(term, [&](uint32_t ord, uint32_t tf) {
+                if (ordMap[ord] >= 0) merged.addPosting(term, static_cast<uint32_t>(ordMap[ord]), tf);
+            });
+        });
+    }
+
+    std::string path = segmentPath(mergedId);
+    std::shared_ptr<DiskSegment> disk;
+    if (writeFileAtomically(path, merged.serialize())) {
+        disk = DiskSegment::open(path, mergedId);
+    }
+    if (!disk) {
+        LOG_ERROR << "[LocalSearchEngine] Failed to write merged segment " << path;
+        return;
+    }
+
+    std::vector<std::string> obsolete;
+    {
+        std::unique_lock<std::shared_mutex> lock(state.mutex);
+        // 合并期间未被更新 / 删除的文档指向合并段
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            for (uint32_t ord = 0; ord < inputs[i]->docCount(); ++ord) {
+                if (ordMaps[i][ord] < 0) continue;
+                auto it = state.live.find(inputs[i]->docId(ord));
+                if (it != state.live.end() && it->second.segmentId == inputs[i]->id() && it->second.ord == ord) {
+                    it->second = {mergedId, static_cast<uint32_t>(ordMaps[i][ord])};
+                }
+            }
+        }
+        // 合并段取代输入段（位于最前）
+        std::vector<std::shared_ptr<Segment>> segments{disk};
+        for (size_t i = inputs.size(); i < state.segments.size(); ++i) segments.push_back(state.segments[i]);
+        state.segments = std::move(segments);
+        if (!writeManifestLocked()) {
+            LOG_ERROR << "[LocalSearchEngine] Failed to write manifest in " << state.directory;
+            return;
+        }
+        for (const auto& segment : inputs) obsolete.push_back(segment->path());
+    }
+    // 已打开的映射在最后一个查询释放后才解除，文件可以先删除
+    for (const auto& file : obsolete) ::unlink(file.c_str());
+    LOG_INFO << "[LocalSearchEngine] Merged " << inputs.size() << " segments into segment " << mergedId;
+}
+
+void maybeMerge() {
+    auto& state = engine();
+    size_t diskSegments = 0;
+    {
+        std::shared_lock<std::shared_mutex> lock(state.mutex);
+        for (const auto& segment : state.segments) {
+            if (segment->onDisk()) ++diskSegments;
+        }
+    }
+    if (diskSegments <= kMaxSegments) return;
+    state.merging = true;
+    mergeSegments();
+    state.merging = false;
+}
+
+// 后台线程：定时或被唤醒时落盘，随后按需合并；停止前最后落盘一次
+void workerLoop() {
+    auto& state = engine();
+    std::unique_lock<std::mutex> lock(state.workerMutex);
+    while (true) {
+        state.workerCv.wait_for(lock, kFlushInterval, [&]() { return state.flushRequested || state.stopping; });
+        bool stopping = state.stopping;
+        state.flushRequested = false;
+        lock.unlock();
+        flushActive();
+        if (!stopping) maybeMerge();
+        lock.lock();
+        if (stopping) return;
+    }
+}
+
+void requestFlush() {
+    auto& state = engine();
+    {
+        std::lock_guard<std::mutex> lock(state.workerMutex);
+        state.flushRequested = true;
+    }
+    state.workerCv.notify_one();
+}
+
+// 文件名形如 segment-<id>.<suffix> 时解析出 id
+bool parseSegmentFile(const std::string& name, const std::string& suffix, uint32_t& id) {
+    const std::string prefix = "segment-";
+    if (name.size() <= prefix.size() + suffix.size() || name.compare(0, prefix.size(), prefix) != 0 ||
+        name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+        return false;
+    }
+    std::string digits = name.substr(prefix.size(), name.size() - prefix.size() - suffix.size());
+    if (digits.empty() || digits.size() > 9 || digits.find_first_not_of("0123456789") != std::string::npos) {
+        return false;
+    }
+    id = static_cast<uint32_t>(std::stoul(digits));
+    return true;
+}
+}  // namespace
+
+bool LocalSearchEngine::open(const std::string& directory) {
+    auto& state = engine();
+    std::unique_lock<std::shared_mutex> lock(state.mutex);
+    if (state.opened) return true;
+    if (!ensureDirectory(directory)) {
+        LOG_ERROR << "[LocalSearchEngine] Cannot create index directory " << directory;
+        return false;
+    }
+    state.directory = directory;
+
+    // 1.按 MANIFEST 顺序加载磁盘段；无法读取的段删除，并要求按数据库全量校对
+    bool damaged = false;
+    std::unordered_set<uint32_t> manifestIds;
+    std::ifstream manifest(directory + "/MANIFEST");
+    uint32_t id;
+    while (manifest >> id) {
+        manifestIds.insert(id);
+        state.nextSegmentId = std::max(state.nextSegmentId, id + 1);
+        auto segment = DiskSegment::open(segmentPath(id), id);
+        if (!segment) {
+            LOG_ERROR << "[LocalSearchEngine] Unreadable segment " << segmentPath(id)
+                      << ", the index will be reconciled with the database";
+            ::unlink(segmentPath(id).c_str());
+            damaged = true;
+            continue;
+        }
+        state.segments.push_back(segment);
+    }
+
+    // 2.扫描目录：未落盘内存段的日志待重放；不在 MANIFEST 中的段文件（落盘后未来得及更新 MANIFEST）
+    //   与残留的临时文件删除，其内容仍在日志中
+    std::vector<uint32_t> walIds;
+    int64_t lastModified = 0;
+    if (DIR* dir = ::opendir(directory.c_str())) {
+        while (dirent* entry = ::readdir(dir)) {
+            std::string name = entry->d_name;
+            std::string path = directory + "/" + name;
+            struct stat st;
+            if (::stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) continue;
+            uint32_t fileId;
+            if (parseSegmentFile(name, ".wal", fileId)) {
+                state.nextSegmentId = std::max(state.nextSegmentId, fileId + 1);
+                if (manifestIds.count(fileId)) {
+                    ::unlink(path.c_str());  // 对应的段已落盘
+                    continue;
+                }
+                walIds.push_back(fileId);
+            } else if (parseSegmentFile(name, ".seg", fileId)) {
+                state.nextSegmentId = std::max(state.nextSegmentId, fileId + 1);
+                if (!manifestIds.count(fileId)) {
+                    ::unlink(path.c_str());
+                    continue;
+                }
+            } else if (name.size() > 4 && name.compare(name.size() - 4, 4, ".tmp") == 0) {
+                ::unlink(path.c_str());
+                continue;
+            }
+            lastModified = std::max<int64_t>(lastModified, st.st_mtime);
+        }
+        ::closedir(dir);
+    }
+    std::sort(walIds.begin(), walIds.end());
+
+    // 3.重放磁盘段中的写入与删除，得到每个文档的最新位置
+    for (const auto& segment : state.segments) {
+        auto deletes = segment->deletes();
+        size_t next = 0;
+        for (uint32_t ord = 0; ord <= segment->docCount(); ++ord) {
+            for (; next < deletes.size() && deletes[next].before <= ord; ++next) {
+                eraseLiveLocked(deletes[next].docId);
+            }
+            if (ord == segment->docCount()) break;
+            setLiveLocked(segment->docId(ord), {segment->id(), ord}, segment->docLength(ord));
+        }
+    }
+
+    // 4.按顺序重放日志：记录重新写入新内存段的日志，同步后删除旧日志
+    startActiveLocked();
+    std::string relog;
+    for (uint32_t walId : walIds) replayWalLocked(walPath(walId), relog);
+    if (!walIds.empty()) {
+        auto wal = appendWalLocked(relog);
+        syncWal(wal);
+        if (wal || relog.empty()) {
+            for (uint32_t walId : walIds) ::unlink(walPath(walId).c_str());
+        }
+    }
+
+    state.lastModified = damaged ? 0 : lastModified;
+    state.opened = true;
+    LOG_INFO << "[LocalSearchEngine] Opened " << directory << ", segments=" << state.segments.size() - 1
+             << ", documents=" << state.live.size();
+
+    state.worker = std::thread(workerLoop);
+    return true;
+}
+
+void LocalSearchEngine::close() {
+    auto& state = engine();
+    if (!state.worker.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(state.workerMutex);
+        state.stopping = true;
+    }
+    state.workerCv.notify_one();
+    state.worker.join();
+}
+
+void LocalSearchEngine::upsert(const std::vector<Document>& documents) {
+    auto& state = engine();
+    std::shared_ptr<WalFile> wal;
+    bool flushNow;
+    {
+        std::unique_lock<std::shared_mutex> lock(state.mutex);
+        if (!state.opened) return;
+        std::string records;
+        for (const auto& doc : documents) appendWalRecord(records, encodeUpsert(doc));
+        wal = appendWalLocked(records);
+        for (const auto& doc : documents) upsertLocked(doc);
+        flushNow = state.active->docCount() >= kMemFlushDocs;
+    }
+    syncWal(wal);
+    if (flushNow) requestFlush();
+}
+
+void LocalSearchEngine::updateAcl(int docId, int ownerId, const std::vector<int>& allowedUserIds) {
+    auto& state = engine();
+    std::shared_ptr<WalFile> wal;
+    {
+        std::unique_lock<std::shared_mutex> lock(state.mutex);
+        if (!state.opened || state.live.find(docId) == state.live.end()) return;
+        std::string records;
+        appendWalRecord(records, encodeAcl(docId, ownerId, allowedUserIds));
+        wal = appendWalLocked(records);
+        updateAclLocked(docId, ownerId, allowedUserIds);
+    }
+    syncWal(wal);
+}
+
+void LocalSearchEngine::remove(const std::vector<int>& docIds) {
+    auto& state = engine();
+    std::shared_ptr<WalFile> wal;
+    {
+        std::unique_lock<std::shared_mutex> lock(state.mutex);
+        if (!state.opened) return;
+        std::string records;
+        for (int docId : docIds) {
+            if (state.live.count(docId)) appendWalRecord(records, encodeDelete(docId));
+        }
+        wal = appendWalLocked(records);
+        for (int docId : docIds) removeLocked(docId);
+    }
+    syncWal(wal);
+}
+
+bool LocalSearchEngine::find(int docId, Document& document) {
+    auto& state = engine();
+    std::shared_lock<std::shared_mutex> lock(state.mutex);
+    auto it = state.live.find(docId);
+    if (it == state.live.end()) return false;
+    for (const auto& segment : state.segments) {
+        if (segment->id() != it->second.segmentId) continue;
+        document = segment->document(it->second.ord);
+        return true;
+    }
+    return false;
+}
+
+std::vector<int> LocalSearchEngine::documentIds() {
+    auto& state = engine();
+    std::shared_lock<std::shared_mutex> lock(state.mutex);
+    std::vector<int> ids;
+    ids.reserve(state.live.size());
+    for (const auto& entry : state.live) ids.push_back(entry.first);
+    return ids;
+}
+
+int64_t LocalSearchEngine::lastModified() {
+    auto& state = engine();
+    std::shared_lock<std::shared_mutex> lock(state.mutex);
+    return state.lastModified;
+}
+
+Json::Value LocalSearchEngine::search(const std::string& query, int page, int pageSize, int userId) {
+    Json::Value response;
+    response["hits"] = Json::Value(Json::arrayValue);
+    response["page"] = page;
+    response["hitsPerPage"] = pageSize;
+    response["totalHits"] = 0;
+    response["totalPages"] = 0;
+
+    // 查询词去重，保留顺序
+    std::vector<std::string> terms;
+    std::unordered_set<std::string> seen;
+    for (auto& token : TextTokenizer::tokenize(query)) {
+        if (seen.insert(token).second) terms.push_back(std::move(token));
+    }
+    if (terms.empty() || pageSize <= 0) return response;
+
+    auto& state = engine();
+    std::shared_lock<std::shared_mutex> lock(state.mutex);
+    if (!state.opened || state.live.empty()) return response;
+
+    struct Candidate {
+        const Segment* segment;
+        uint32_t ord;
+        uint32_t length;
+        std::vector<uint32_t> tf;
+        size_t matched;
+        double score;
+    };
+    std::unordered_map<int, Candidate> candidates;
+    std::vector<uint32_t> df(terms.size(), 0);
+
+    // 所有查询词都需命中（AND）；df 统计全部有效文档，与权限无关
+    for (size_t i = 0; i < terms.size(); ++i) {
+        for (const auto& segment : state.segments) {
+            segment->forEachPosting(terms[i], [&](uint32_t ord, uint32_t tf) {
+                int docId = segment->docId(ord);
+                auto live = state.live.find(docId);
+                if (live == state.live.end() || live->second.segmentId != segment->id() || live->second.ord != ord) {
+                    return;
+                }
+                ++df[i];
+                if (i == 0) {
+                    if (!segment->allows(ord, userId)) return;
+                    Candidate candidate{segment.get(), ord, segment->docLength(ord),
+                                        std::vector<uint32_t>(terms.size(), 0), 1, 0.0};
+                    candidate.tf[0] = tf;
+                    candidates.emplace(docId, std::move(candidate));
+                    return;
+                }
+                auto it = candidates.find(docId);
+                if (it != candidates.end() && it->second.tf[i] == 0) {
+                    it->second.tf[i] = tf;
+                    ++it->second.matched;
+                }
+            });
+        }
+    }
+
+    // BM25
+    double docCount = static_cast<double>(state.live.size());
+    double avgLength = std::max(1.0, static_cast<double>(state.totalLength) / docCount);
+    std::vector<std::pair<int, Candidate*>> results;
+    for (auto& entry : candidates) {
+        Candidate& candidate = entry.second;
+        if (candidate.matched != terms.size()) continue;
+        for (size_t i = 0; i < terms.size(); ++i) {
+            double idf = std::log(1.0 + (docCount - df[i] + 0.5) / (df[i] + 0.5));
+            double tf = candidate.tf[i];
+            double norm = kBm25K1 * (1.0 - kBm25B + kBm25B * candidate.length / avgLength);
+            candidate.score += idf * tf * (kBm25K1 + 1.0) / (tf + norm);
+        }
+        results.emplace_back(entry.first, &candidate);
+    }
+    std::sort(results.begin(), results.end(), [](const auto& a, const auto& b) {
+        if (a.second->score != b.second->score) return a.second->score > b.second->score;
+        return a.first > b.first;
+    });
+
+    size_t total = results.size();
+    response["totalHits"] = static_cast<Json::UInt64>(total);
+    response["totalPages"] = static_cast<Json::UInt64>((total + pageSize - 1) / pageSize);
+    size_t start = static_cast<size_t>(std::max(0, page - 1)) * static_cast<size_t>(pageSize);
+    for (size_t i = start; i < total && i < start + static_cast<size_t>(pageSize); ++i) {
+        Document doc = results[i].second->segment->document(results[i].second->ord);
+        Json::Value hit;
+        hit["id"] = doc.id;
+        hit["title"] = doc.title;
+        hit["content"] = buildSnippet(doc.content, terms);
+        hit["_formatted"]["title"] = hit["title"];
+        hit["_formatted"]["content"] = hit["content"];
+        hit["_rankingScore"] = results[i].second->score;
+        response["hits"].append(hit);
+    }
+    return response;
+}
+
+size_t LocalSearchEngine::documentCount() {
+    auto& state = engine();
+    std::shared_lock<std::shared_mutex> lock(state.mutex);
+    return state.live.size();
+}
+
+Json::Value LocalSearchEngine::getStats() {
+    auto& state = engine();
+    std::shared_lock<std::shared_mutex> lock(state.mutex);
+    Json::Value stats;
+    stats["opened"] = state.opened;
+    stats["directory"] = state.directory;
+    stats["documents"] = static_cast<Json::UInt64>(state.live.size());
+    size_t diskSegments = 0;
+    size_t memoryDocs = 0;
+    for (const auto& segment : state.segments) {
+        if (segment->onDisk()) {
+            ++diskSegments;
+        } else {
+            memoryDocs += segment->docCount();
+        }
+    }
+    stats["disk_segments"] = static_cast<Json::UInt64>(diskSegments);
+    stats["memory_documents"] = static_cast<Json::UInt64>(memoryDocs);
+    stats["flushing"] = state.flushing.load();
+    stats["merging"] = state.merging.load();
+    return stats;
+}
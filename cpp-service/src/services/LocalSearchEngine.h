@@ -0,0 +1,59 @@
+#pragma once
+#include <json/json.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * LocalSearchEngine 是进程内的全文索引，用于无法部署 Meilisearch 的环境（app.search_engine = "local"）。
+ *
+ * - 分词见 TextTokenizer（中日韩文字按二元组切分，另为每个字建立单字词）；排序使用 BM25，标题中的词权重加倍；
+ * - 写入先进入内存段，定期或攒够一定数量后落盘为不可变的段文件，查询时通过 mmap 直接读取；
+ *   倒排表按文档序号差值 + 词频做 varint 压缩；
+ * - 更新与删除只追加：每个 docId 只有最新位置有效，旧位置在后台合并时清理；
+ *   段数量超过上限时由后台线程合并最早的若干段；
+ * - 每个文档同时保存 owner_id / allowed_user_ids，搜索只返回当前用户可见的文档。
+ *
+ * 每次写入在应用到内存段之前先追加到该内存段的预写日志并 fdatasync，段文件与 MANIFEST 先 fsync 再 rename；
+ * 打开索引时重放尚未落盘的日志。落盘与合并由 open 启动的一个后台线程执行，进程退出前调用 close 停止。
+ * 无法读取的段会被删除并将 lastModified 置 0，由调用方（SearchService）按数据库校对后补齐。
+ *
+ * 接口均为线程安全的静态方法；未 open 前写入与搜索均被忽略 / 返回空结果。
+ */
+class LocalSearchEngine {
+public:
+    struct Document {
+        int id{0};
+        int ownerId{0};
+        std::vector<int> allowedUserIds;
+        std::string title;
+        std::string content;
+    };
+
+    // 打开（或创建）索引目录，加载已有段文件、重放日志并启动落盘 / 合并线程。
+    static bool open(const std::string& directory);
+    // 停止后台线程，停止前将内存段落盘
+    static void close();
+
+    // 写入或替换文档
+    static void upsert(const std::vector<Document>& documents);
+    // 只更新 ACL 字段，文档不存在时忽略
+    static void updateAcl(int docId, int ownerId, const std::vector<int>& allowedUserIds);
+    // 删除文档
+    static void remove(const std::vector<int>& docIds);
+
+    // 搜索 userId 可访问的文档，返回结构与 Meilisearch 的分页搜索响应一致（hits、totalHits、totalPages）
+    static Json::Value search(const std::string& query, int page, int pageSize, int userId);
+
+    // 按 docId 读取当前版本，不存在时返回 false
+    static bool find(int docId, Document& document);
+    // 全部有效文档的 docId
+    static std::vector<int> documentIds();
+    // 打开时索引文件的最新修改时间（Unix 秒）；新建的索引或有段文件损坏时为 0，需要按数据库全量校对
+    static int64_t lastModified();
+    // 当前有效文档数
+    static size_t documentCount();
+    // 段数量、内存段大小、合并状态等
+    static Json::Value getStats();
+};
@@ -0,0 +1,154 @@
+#include "NotificationBus.h"
+
+#include <drogon/drogon.h>
+#include <drogon/utils/Utilities.h>
+#include <json/json.h>
+
+#include <sstream>
+
+#include "../utils/ConfigUtils.h"
+#include "../utils/NotificationUtils.h"
+#include "NotificationCounter.h"
+#include "NotificationHub.h"
+
+std::mutex NotificationBus::mutex_;
+std::shared_ptr<drogon::orm::DbListener> NotificationBus::listener_;
+
+namespace {
+// libpq 连接串中的值需要用单引号包裹并转义。
+std::string quoteConnValue(const std::string& value) {
+    std::string quoted = "'";
+    for (char c : value) {
+        if (c == '\'' || c == '\\') quoted.push_back('\\');
+        quoted.push_back(c);
+    }
+    quoted.push_back('\'');
+    return quoted;
+}
+}  // namespace
+
+const std::string& NotificationBus::channel() {
+    static const std::string kChannel = "codox_notifications";
+    return kChannel;
+}
+
+const std::string& NotificationBus::instanceId() {
+    static const std::string kInstanceId = drogon::utils::getUuid();
+    return kInstanceId;
+}
+
+std::string NotificationBus::buildConnInfo() {
+    const Json::Value& config = ConfigUtils::root();
+    if (!config.isMember("db_clients") || !config["db_clients"].isArray() || config["db_clients"].empty()) {
+        return "";
+    }
+
+    const Json::Value* dbConfig = &config["db_clients"][0];
+    for (const auto& item : config["db_clients"]) {
+        if (item.get("name", "default").asString() == "default") {
+            dbConfig = &item;
+            break;
+        }
+    }
+
+    std::ostringstream oss;
+    oss << "host=" << quoteConnValue((*dbConfig).get("host", "127.0.0.1").asString())
+        << " port=" << (*dbConfig).get("port", 5432).asInt()
+        << " dbname=" << quoteConnValue((*dbConfig).get("dbname", "").asString())
+        << " user=" << quoteConnValue((*dbConfig).get("user", "").asString())
+        << " password=" << quoteConnValue((*dbConfig).get("passwd", "").asString());
+    return oss.str();
+}
+
+void NotificationBus::start() {
+    const Json::Value& config = ConfigUtils::root();
+    if (config.isMember("app") && !config["app"].get("notification_bus_enabled", true).asBool()) {
+        LOG_INFO << "[NotificationBus] Disabled by config";
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (listener_) return;
+
+    std::string connInfo = buildConnInfo();
+    if (connInfo.empty()) {
+        LOG_ERROR << "[NotificationBus] No db_clients configured, cross-instance fan-out disabled";
+        return;
+    }
+
+    // 使用独立的事件循环与连接，避免占用业务连接池
+    listener_ = drogon::orm::DbListener::newPgListener(connInfo);
+    if (!listener_) {
+        LOG_ERROR << "[NotificationBus] Failed to create LISTEN connection";
+        return;
+    }
+    listener_->listen(channel(), [](const std::string&, const std::string& message) { handleMessage(message); });
+    LOG_INFO << "[NotificationBus] Listening on channel " << channel() << ", instance=" << instanceId();
+}
+
+void NotificationBus::publishEvent(int userId, const Json::Value& message) {
+    NotificationHub::pushEvent(userId, message);
+
+    auto db = drogon::app().getDbClient();
+    if (!db) return;
+    Json::Value event;
+    event["origin"] = instanceId();
+    event["user_id"] = userId;
+    event["event"] = message;
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "";
+    db->execSqlAsync(
+            "SELECT pg_notify($1, $2)", [](const drogon::orm::Result&) {},
+            [userId](const drogon::orm::DrogonDbException& e) {
+                LOG_ERROR << "[NotificationBus] Failed to publish event for user " << userId << ": " << e.base().what();
+            },
+            channel(), Json::writeString(builder, event));
+}
+
+void NotificationBus::handleMessage(const std::string& message) {
+    Json::Value event;
+    Json::CharReaderBuilder readerBuilder;
+    std::unique_ptr<Json::CharReader> reader(readerBuilder.newCharReader());
+    JSONCPP_STRING errs;
+    if (!reader->parse(message.data(), message.data() + message.size(), &event, &errs)) {
+        LOG_WARN << "[NotificationBus] Ignoring malformed message: " << message;
+        return;
+    }
+
+    // 本实例写入的通知已经在本地推送过
+    if (event.get("origin", "").asString() == instanceId()) return;
+
+    int userId = event.get("user_id", 0).asInt();
+    if (userId <= 0) return;
+
+    // 其他实例写入或标记已读后，同步本地未读数缓存
+    if (event.isMember("unread")) {
+        NotificationCounter::update(userId, event["unread"].asInt());
+    }
+
+    // 不落库的事件直接推送
+    if (event.isMember("event")) {
+        NotificationHub::pushEvent(userId, event["event"]);
+        return;
+    }
+
+    // 目标用户不在本实例时无需查库
+    Json::Int64 notificationId = event.get("notification_id", 0).asInt64();
+    if (notificationId <= 0 || !NotificationHub::hasLocalConnections(userId)) return;
+
+    auto db = drogon::app().getDbClient();
+    if (!db) return;
+
+    db->execSqlAsync(
+            "SELECT id, user_id, type, payload::text AS payload, is_read, created_at "
+            "FROM notification WHERE id = $1::bigint",
+            [userId](const drogon::orm::Result& r) {
+                if (r.empty()) return;
+                NotificationHub::pushNotification(userId, NotificationUtils::buildNotificationJson(r[0]));
+            },
+            [notificationId](const drogon::orm::DrogonDbException& e) {
+                LOG_ERROR << "[NotificationBus] Failed to load notification " << notificationId << ": "
+                          << e.base().what();
+            },
+            std::to_string(notificationId));
+}
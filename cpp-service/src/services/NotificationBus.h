@@ -0,0 +1,43 @@
+#pragma once
+#include <drogon/orm/DbListener.h>
+#include <json/json.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+/**
+ * NotificationBus 负责多实例之间的通知扇出。
+ *
+ * 写入通知的 SQL 在同一语句中调用 pg_notify(channel, {origin, user_id, notification_id, unread})，
+ * 标记已读时只携带 {origin, user_id, unread}；
+ * 每个实例持有一条专用 LISTEN 连接，收到其他实例发布的消息后，若目标用户在本实例有
+ * WebSocket 连接，则按 id 读取通知并交给本地 NotificationHub 推送；未读数同步到本地缓存。
+ *
+ * 不落库的事件（如导出任务进度）由 publishEvent 在本地推送后以 {origin, user_id, event} 发布，
+ * 其他实例收到后直接推送给本地连接。
+ */
+class NotificationBus {
+public:
+    // 启动 LISTEN 连接（在 app 启动后调用一次）。
+    static void start();
+
+    // pg_notify 使用的频道名。
+    static const std::string& channel();
+
+    // 当前进程的实例标识，用于忽略自己发布的消息。
+    static const std::string& instanceId();
+
+    // 推送不落库的事件：本实例的连接直接推送，其他实例经 pg_notify 转发。
+    static void publishEvent(int userId, const Json::Value& message);
+
+private:
+    // 处理来自其他实例的消息。
+    static void handleMessage(const std::string& message);
+
+    // 由 config.json 中的 db_clients 构建 libpq 连接串。
+    static std::string buildConnInfo();
+
+    static std::mutex mutex_;
+    static std::shared_ptr<drogon::orm::DbListener> listener_;
+};
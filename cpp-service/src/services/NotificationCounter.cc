@@ -0,0 +1,69 @@
+#include "NotificationCounter.h"
+
+#include <drogon/drogon.h>
+#include <json/json.h>
+
+#include "../repositories/StatementRegistry.h"
+#include "NotificationHub.h"
+
+namespace {
+// 缓存有效期：其他实例的更新通过 NotificationBus 同步，过期后回源兜底。
+constexpr auto kCacheTtl = std::chrono::minutes(5);
+// 缓存用户数上限，超过后整体清空重建。
+constexpr size_t kMaxCachedUsers = 100000;
+}  // namespace
+
+std::mutex NotificationCounter::mutex_;
+std::unordered_map<int, NotificationCounter::CacheEntry> NotificationCounter::cache_;
+
+void NotificationCounter::storeLocked(int userId, int unread) {
+    if (cache_.size() >= kMaxCachedUsers && cache_.find(userId) == cache_.end()) {
+        cache_.clear();
+    }
+    cache_[userId] = {unread, std::chrono::steady_clock::now()};
+}
+
+void NotificationCounter::getUnreadCount(int userId, std::function<void(int)> callback,
+                                         std::function<void(const std::string&)> errorCallback) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = cache_.find(userId);
+        if (it != cache_.end() && std::chrono::steady_clock::now() - it->second.updatedAt < kCacheTtl) {
+            callback(it->second.unread);
+            return;
+        }
+    }
+
+    auto db = drogon::app().getDbClient();
+    if (!db) {
+        errorCallback("Database not available");
+        return;
+    }
+
+    db->execSqlAsync(
+            StatementRegistry::notificationUnreadCounter(),
+            [userId, callback](const drogon::orm::Result& r) {
+                int unread = r.empty() ? 0 : r[0]["unread"].as<int>();
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    storeLocked(userId, unread);
+                }
+                callback(unread);
+            },
+            [errorCallback](const drogon::orm::DrogonDbException& e) {
+                errorCallback("Database error: " + std::string(e.base().what()));
+            },
+            std::to_string(userId));
+}
+
+void NotificationCounter::update(int userId, int unread) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        storeLocked(userId, unread);
+    }
+
+    Json::Value message;
+    message["type"] = "unread_count";
+    message["unread_count"] = unread;
+    NotificationHub::pushEvent(userId, message);
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/**
+ * NotificationCounter 维护每个用户的未读通知数。
+ *
+ * 数据库中 notification_counter 表与 notification 在同一条语句内更新（写入通知、标记已读），
+ * 本类在内存中缓存最近读取/写入的值，未读数变化时通过通知 WebSocket 推送 unread_count 消息，
+ * 客户端据此更新角标而无需轮询。
+ */
+class NotificationCounter {
+public:
+    // 获取未读数：优先读缓存，未命中时查询 notification_counter（不存在则按 notification 表回填）。
+    static void getUnreadCount(int userId, std::function<void(int)> callback,
+                               std::function<void(const std::string&)> errorCallback);
+
+    // 数据库中的未读数已更新：刷新缓存，并推送给本实例上该用户的连接。
+    static void update(int userId, int unread);
+
+private:
+    struct CacheEntry {
+        int unread{0};
+        std::chrono::steady_clock::time_point updatedAt;
+    };
+
+    static void storeLocked(int userId, int unread);
+
+    static std::mutex mutex_;                                  // 保护 cache_
+    static std::unordered_map<int, CacheEntry> cache_;         // userId -> 未读数
+};
@@ -1,20 +1,56 @@
 #include "NotificationHub.h"
 
+#include <drogon/drogon.h>
 #include <json/writer.h>
 
+#include <algorithm>
+#include <mutex>
 #include <vector>
 
+namespace {
+// 同一连接的消息合并窗口（秒）。
+constexpr double kCoalesceWindowSeconds = 0.02;
+// 单连接出站高水位：待发送 + 未确认字节超过该值后折叠为 resync 标记。
+constexpr size_t kHighWaterMarkBytes = 256 * 1024;
+// 折叠状态持续超过该时长仍未确认，视为慢消费者并断开。
+constexpr auto kSlowConsumerTimeout = std::chrono::seconds(45);
+// 慢消费者巡检周期（秒）。
+constexpr double kSweepIntervalSeconds = 5.0;
+// 指标接口最多返回的连接明细条数。
+constexpr size_t kMaxMetricsConnections = 50;
+
+std::once_flag sweepTimerOnce;
+
+std::string buildResyncMarker(size_t missed) {
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "";
+    Json::Value marker;
+    marker["type"] = "notifications_resync";
+    marker["missed"] = static_cast<Json::UInt64>(missed);
+    marker["message"] = "You have " + std::to_string(missed) + " unread notifications, please refetch";
+    return Json::writeString(builder, marker);
+}
+}  // namespace
+
 std::mutex NotificationHub::mutex_;
-std::unordered_map<size_t, std::pair<int, NotificationHub::ConnectionWeakPtr>> NotificationHub::connections_;
+std::unordered_map<size_t, NotificationHub::ConnectionEntry> NotificationHub::connections_;
 std::unordered_map<int, std::unordered_set<size_t>> NotificationHub::userConnections_;
 std::atomic_size_t NotificationHub::nextConnectionId_{1};
+std::atomic_size_t NotificationHub::slowConsumerDisconnects_{0};
 
 // 记录新连接并返回内部 ID。
 size_t NotificationHub::registerConnection(int userId, const drogon::WebSocketConnectionPtr& conn) {
+    std::call_once(sweepTimerOnce, []() {
+        drogon::app().getLoop()->runEvery(kSweepIntervalSeconds, []() { sweepSlowConsumers(); });
+    });
+
     size_t connectionId = nextConnectionId_.fetch_add(1);
     {
         std::lock_guard<std::mutex> lock(mutex_);
-        connections_[connectionId] = {userId, conn};
+        ConnectionEntry entry;
+        entry.userId = userId;
+        entry.conn = conn;
+        connections_[connectionId] = std::move(entry);
         userConnections_[userId].insert(connectionId);
     }
     return connectionId;
@@ -27,7 +63,7 @@ void NotificationHub::unregisterConnection(size_t connectionId) {
     if (it == connections_.end()) {
         return;
     }
-    int userId = it->second.first;
+    int userId = it->second.userId;
     connections_.erase(it);
     auto userIt = userConnections_.find(userId);
     if (userIt != userConnections_.end()) {
@@ -38,35 +74,254 @@ void NotificationHub::unregisterConnection(size_t connectionId) {
     }
 }
 
-// 将通知推送给指定用户的所有在线连接。
+// 将通知推送给指定用户的所有在线连接：只序列化一次，各连接共享同一份缓冲区。
 void NotificationHub::pushNotification(int userId, const Json::Value& notification) {
-    std::vector<drogon::WebSocketConnectionPtr> targets;
+    // 没有在线连接时跳过序列化。
+    if (!hasLocalConnections(userId)) return;
+
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "";
+    Json::Value payload;
+    payload["type"] = "notification";
+    payload["data"] = notification;
+    auto message = std::make_shared<const std::string>(Json::writeString(builder, payload));
+
+    dispatch(userId, message);
+}
+
+void NotificationHub::pushEvent(int userId, const Json::Value& message) {
+    if (!hasLocalConnections(userId)) return;
+
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "";
+    dispatch(userId, std::make_shared<const std::string>(Json::writeString(builder, message)));
+}
+
+bool NotificationHub::hasLocalConnections(int userId) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return userConnections_.count(userId) > 0;
+}
+
+// 客户端读回后清空未确认字节；若此前处于折叠状态，则解除折叠并补发遗漏数量。
+void NotificationHub::acknowledge(size_t connectionId) {
+    std::vector<size_t> toSchedule;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = connections_.find(connectionId);
+        if (it == connections_.end()) return;
+        auto& entry = it->second;
+        entry.unackedBytes = 0;
+        if (!entry.collapsed) return;
+
+        entry.collapsed = false;
+        if (entry.missed > entry.reportedMissed) {
+            // 上一个标记发出后又有通知被丢弃，再发一次让客户端拉取最新数据
+            entry.markerPending = true;
+            scheduleFlushLocked(connectionId, entry, toSchedule);
+        } else if (!entry.markerPending) {
+            entry.missed = 0;
+            entry.reportedMissed = 0;
+        }
+    }
+
+    for (auto id : toSchedule) {
+        drogon::app().getLoop()->runAfter(kCoalesceWindowSeconds, [id]() { flushConnection(id); });
+    }
+}
+
+Json::Value NotificationHub::getQueueMetrics() {
+    Json::Value metrics;
+    Json::Value connectionsJson(Json::arrayValue);
+
+    struct Snapshot {
+        size_t connectionId;
+        int userId;
+        size_t pendingMessages;
+        size_t pendingBytes;
+        size_t unackedBytes;
+        bool collapsed;
+        size_t missed;
+    };
+    std::vector<Snapshot> snapshots;
+    size_t totalPendingBytes = 0;
+    size_t totalUnackedBytes = 0;
+    size_t collapsedCount = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        snapshots.reserve(connections_.size());
+        for (const auto& item : connections_) {
+            const auto& entry = item.second;
+            snapshots.push_back({item.first, entry.userId, entry.pending.size(), entry.pendingBytes,
+                                 entry.unackedBytes, entry.collapsed, entry.missed});
+            totalPendingBytes += entry.pendingBytes;
+            totalUnackedBytes += entry.unackedBytes;
+            if (entry.collapsed) ++collapsedCount;
+        }
+    }
+
+    // 按占用字节降序，只返回最“重”的连接
+    std::sort(snapshots.begin(), snapshots.end(), [](const Snapshot& a, const Snapshot& b) {
+        return a.pendingBytes + a.unackedBytes > b.pendingBytes + b.unackedBytes;
+    });
+    for (size_t i = 0; i < snapshots.size() && i < kMaxMetricsConnections; ++i) {
+        const auto& s = snapshots[i];
+        Json::Value item;
+        item["connection_id"] = static_cast<Json::UInt64>(s.connectionId);
+        item["user_id"] = s.userId;
+        item["pending_messages"] = static_cast<Json::UInt64>(s.pendingMessages);
+        item["pending_bytes"] = static_cast<Json::UInt64>(s.pendingBytes);
+        item["unacked_bytes"] = static_cast<Json::UInt64>(s.unackedBytes);
+        item["collapsed"] = s.collapsed;
+        item["missed"] = static_cast<Json::UInt64>(s.missed);
+        connectionsJson.append(item);
+    }
+
+    metrics["connection_count"] = static_cast<Json::UInt64>(snapshots.size());
+    metrics["total_pending_bytes"] = static_cast<Json::UInt64>(totalPendingBytes);
+    metrics["total_unacked_bytes"] = static_cast<Json::UInt64>(totalUnackedBytes);
+    metrics["collapsed_connections"] = static_cast<Json::UInt64>(collapsedCount);
+    metrics["slow_consumer_disconnects"] = static_cast<Json::UInt64>(slowConsumerDisconnects_.load());
+    metrics["high_water_mark_bytes"] = static_cast<Json::UInt64>(kHighWaterMarkBytes);
+    metrics["connections"] = connectionsJson;
+    return metrics;
+}
+
+// 将消息挂到目标连接的待发队列，并在队列首次非空时安排一次延迟 flush。
+void NotificationHub::dispatch(int userId, const MessagePtr& message) {
+    std::vector<size_t> toSchedule;
     {
         std::lock_guard<std::mutex> lock(mutex_);
         pruneExpiredConnectionsLocked(userId);
         auto userIt = userConnections_.find(userId);
-        if (userIt == userConnections_.end()) {
+        if (userIt != userConnections_.end()) {
+            for (auto connectionId : userIt->second) {
+                auto connIt = connections_.find(connectionId);
+                if (connIt == connections_.end()) continue;
+                auto& entry = connIt->second;
+
+                if (entry.collapsed) {
+                    ++entry.missed;
+                    continue;
+                }
+
+                if (entry.pendingBytes + entry.unackedBytes + message->size() > kHighWaterMarkBytes) {
+                    // 超过高水位：丢弃排队中的具体通知，改为发送一条 resync 标记
+                    entry.missed += entry.pending.size() + 1;
+                    entry.pending.clear();
+                    entry.pendingBytes = 0;
+                    entry.collapsed = true;
+                    entry.markerPending = true;
+                    entry.collapsedSince = std::chrono::steady_clock::now();
+                    LOG_WARN << "[NotificationHub] Connection " << connectionId << " of user " << userId
+                             << " exceeded high-water mark, collapsing notifications";
+                    scheduleFlushLocked(connectionId, entry, toSchedule);
+                    continue;
+                }
+
+                entry.pending.push_back(message);
+                entry.pendingBytes += message->size();
+                scheduleFlushLocked(connectionId, entry, toSchedule);
+            }
+        }
+    }
+
+    if (toSchedule.empty()) return;
+
+    auto loop = drogon::app().getLoop();
+    for (auto connectionId : toSchedule) {
+        loop->runAfter(kCoalesceWindowSeconds, [connectionId]() { flushConnection(connectionId); });
+    }
+}
+
+void NotificationHub::scheduleFlushLocked(size_t connectionId, ConnectionEntry& entry,
+                                          std::vector<size_t>& toSchedule) {
+    if (entry.flushScheduled) return;
+    entry.flushScheduled = true;
+    toSchedule.push_back(connectionId);
+}
+
+// 发送合并窗口内的消息：单条原样发送，多条拼接为 JSON 数组帧（不再重新序列化）。
+void NotificationHub::flushConnection(size_t connectionId) {
+    drogon::WebSocketConnectionPtr conn;
+    std::vector<MessagePtr> batch;
+    std::string marker;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = connections_.find(connectionId);
+        if (it == connections_.end()) return;
+        auto& entry = it->second;
+        entry.flushScheduled = false;
+        conn = entry.conn.lock();
+        if (!conn || !conn->connected()) {
+            entry.pending.clear();
+            entry.pendingBytes = 0;
             return;
         }
-        for (auto connectionId : userIt->second) {
-            auto connIt = connections_.find(connectionId);
-            if (connIt == connections_.end()) continue;
-            if (auto conn = connIt->second.second.lock()) {
-                targets.push_back(conn);
+
+        if (entry.markerPending) {
+            marker = buildResyncMarker(entry.missed);
+            entry.markerPending = false;
+            entry.reportedMissed = entry.missed;
+            entry.unackedBytes += marker.size();
+            if (!entry.collapsed) {
+                entry.missed = 0;
+                entry.reportedMissed = 0;
             }
         }
+
+        batch.swap(entry.pending);
+        for (const auto& message : batch) {
+            entry.unackedBytes += message->size();
+        }
+        entry.pendingBytes = 0;
     }
 
-    if (targets.empty()) return;
+    if (!marker.empty()) {
+        conn->send(marker);
+    }
 
-    Json::StreamWriterBuilder builder;
-    Json::Value payload;
-    payload["type"] = "notification";
-    payload["data"] = notification;
-    std::string message = Json::writeString(builder, payload);
+    if (batch.empty()) return;
+
+    if (batch.size() == 1) {
+        conn->send(*batch.front());
+        return;
+    }
+
+    size_t totalSize = batch.size() + 1;
+    for (const auto& message : batch) {
+        totalSize += message->size();
+    }
+    std::string frame;
+    frame.reserve(totalSize);
+    frame.push_back('[');
+    for (size_t i = 0; i < batch.size(); ++i) {
+        if (i > 0) frame.push_back(',');
+        frame.append(*batch[i]);
+    }
+    frame.push_back(']');
+    conn->send(frame);
+}
+
+// 断开长时间处于折叠状态的连接，释放其占用的发送缓冲。
+void NotificationHub::sweepSlowConsumers() {
+    std::vector<drogon::WebSocketConnectionPtr> toClose;
+    auto now = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& item : connections_) {
+            const auto& entry = item.second;
+            if (!entry.collapsed || now - entry.collapsedSince < kSlowConsumerTimeout) continue;
+            if (auto conn = entry.conn.lock()) {
+                LOG_WARN << "[NotificationHub] Disconnecting slow consumer, connection " << item.first << " of user "
+                         << entry.userId << ", unacked bytes=" << entry.unackedBytes;
+                toClose.push_back(conn);
+            }
+        }
+    }
 
-    for (auto& conn : targets) {
-        conn->send(message);
+    for (auto& conn : toClose) {
+        slowConsumerDisconnects_.fetch_add(1);
+        conn->forceClose();
     }
 }
 
@@ -82,7 +337,7 @@ void NotificationHub::pruneExpiredConnectionsLocked(int userId) {
             expiredIds.push_back(connectionId);
             continue;
         }
-        if (connIt->second.second.expired()) {
+        if (connIt->second.conn.expired()) {
             expiredIds.push_back(connectionId);
         }
     }
@@ -3,14 +3,25 @@
 #include <json/json.h>
 
 #include <atomic>
+#include <chrono>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 /**
  * NotificationHub 负责维护所有通知 WebSocket 连接，并提供推送接口。
  * 该类为纯静态实现，便于在任意业务代码中直接调用。
+ *
+ * 推送时消息只序列化一次，以共享只读缓冲区的形式挂到该用户各连接（多个标签页）的待发队列上；
+ * 同一连接在合并窗口（约 20ms）内收到的多条消息会合并成一个 JSON 数组帧发送。
+ * 每条通知行只属于一个用户，因此没有跨用户共享负载的推送接口。
+ *
+ * 每个连接记录待发送字节和“已发送但未确认”字节（收到 pong 或客户端消息即视为确认）。
+ * 超过高水位后不再排队具体通知，而是折叠成一条 notifications_resync 标记让客户端重新拉取；
+ * 长时间处于折叠状态的慢消费者会被断开。
  */
 class NotificationHub {
 public:
@@ -23,14 +34,54 @@ public:
     // 向指定用户推送通知（如果存在 WebSocket 连接）。
     static void pushNotification(int userId, const Json::Value& notification);
 
+    // 向指定用户推送一条控制类消息（如未读数变化），消息按原样序列化，不包装成 notification。
+    static void pushEvent(int userId, const Json::Value& message);
+
+    // 用户在本实例是否有在线连接。
+    static bool hasLocalConnections(int userId);
+
+    // 客户端有读回（pong/任意消息）时调用，清空未确认字节并解除折叠状态。
+    static void acknowledge(size_t connectionId);
+
+    // 返回各连接的出站队列深度等指标，便于定位占用内存的客户端。
+    static Json::Value getQueueMetrics();
+
 private:
+    using ConnectionWeakPtr = std::weak_ptr<drogon::WebSocketConnection>;
+    using MessagePtr = std::shared_ptr<const std::string>;
+
+    struct ConnectionEntry {
+        int userId{0};
+        ConnectionWeakPtr conn;
+        std::vector<MessagePtr> pending;  // 合并窗口内等待发送的消息
+        bool flushScheduled{false};       // 是否已安排定时 flush
+        size_t pendingBytes{0};           // pending 中的字节数
+        size_t unackedBytes{0};           // 已交给连接、但客户端尚未确认读走的字节数
+        bool collapsed{false};            // 是否处于折叠（只发送 resync 标记）状态
+        bool markerPending{false};        // 下一次 flush 是否需要发送 resync 标记
+        size_t missed{0};                 // 折叠期间丢弃的通知数
+        size_t reportedMissed{0};         // 最近一次 resync 标记中报告的数量
+        std::chrono::steady_clock::time_point collapsedSince;
+    };
+
+    // 将已序列化的消息投递给用户的所有连接。
+    static void dispatch(int userId, const MessagePtr& message);
+
+    // 发送某个连接在合并窗口内积累的消息。
+    static void flushConnection(size_t connectionId);
+
+    // 需在持锁状态下调用：为连接安排一次 flush（若尚未安排）。
+    static void scheduleFlushLocked(size_t connectionId, ConnectionEntry& entry, std::vector<size_t>& toSchedule);
+
+    // 定期检查并断开长时间不读取的慢消费者。
+    static void sweepSlowConsumers();
+
     // 清理已失效的连接，内部调用前需加锁。
     static void pruneExpiredConnectionsLocked(int userId);
 
-    static std::mutex mutex_;  // 保护所有静态容器
-    using ConnectionWeakPtr = std::weak_ptr<drogon::WebSocketConnection>;
-    static std::unordered_map<size_t, std::pair<int, ConnectionWeakPtr>>
-            connections_;                                                         // connectionId -> (userId, conn)
+    static std::mutex mutex_;                                                     // 保护所有静态容器
+    static std::unordered_map<size_t, ConnectionEntry> connections_;              // connectionId -> 连接状态
     static std::unordered_map<int, std::unordered_set<size_t>> userConnections_;  // userId -> connectionId set
     static std::atomic_size_t nextConnectionId_;                                  // 自增连接 ID
+    static std::atomic_size_t slowConsumerDisconnects_;                           // 因慢消费被断开的连接数
 };
@@ -0,0 +1,307 @@
+#include "NotificationWriter.h"
+
+#include <drogon/drogon.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <unordered_map>
+
+#include "../utils/ConfigUtils.h"
+#include "../utils/DbUtils.h"
+#include "../utils/NotificationUtils.h"
+#include "NotificationBus.h"
+#include "NotificationCounter.h"
+#include "NotificationHub.h"
+
+namespace {
+// 队列上限，超过后落盘或丢弃。
+constexpr size_t kMaxQueueSize = 10000;
+// 单批最多写入的条数。
+constexpr size_t kMaxBatchSize = 500;
+// 定时 flush 周期（秒）。
+constexpr double kFlushIntervalSeconds = 0.05;
+// 写入失败后的最大尝试次数。
+constexpr int kMaxAttempts = 3;
+
+std::once_flag startOnce;
+
+}  // namespace
+
+std::mutex NotificationWriter::mutex_;
+std::deque<NotificationWriter::PendingNotification> NotificationWriter::queue_;
+bool NotificationWriter::flushing_ = false;
+std::mutex NotificationWriter::spillMutex_;
+std::atomic_size_t NotificationWriter::spilledCount_{0};
+std::atomic_size_t NotificationWriter::droppedCount_{0};
+std::atomic_size_t NotificationWriter::writtenCount_{0};
+std::atomic_size_t NotificationWriter::batchCount_{0};
+
+const std::string& NotificationWriter::spillPath() {
+    static const std::string kSpillPath = ConfigUtils::getValue("notification_spill_path", "");
+    return kSpillPath;
+}
+
+void NotificationWriter::ensureStarted() {
+    std::call_once(startOnce, []() {
+        // 上次退出前遗留的落盘通知，计入待回放数量
+        if (!spillPath().empty()) {
+            std::lock_guard<std::mutex> lock(spillMutex_);
+            std::ifstream file(spillPath());
+            std::string line;
+            size_t count = 0;
+            while (std::getline(file, line)) {
+                if (!line.empty()) ++count;
+            }
+            spilledCount_ = count;
+        }
+        drogon::app().getLoop()->runEvery(kFlushIntervalSeconds, []() { flush(); });
+    });
+}
+
+void NotificationWriter::enqueue(int userId, const std::string& type, const Json::Value& payload) {
+    ensureStarted();
+
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "";
+    PendingNotification item;
+    item.userId = userId;
+    item.type = type;
+    item.payload = Json::writeString(builder, payload);
+
+    bool overflow = false;
+    bool flushNow = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (queue_.size() >= kMaxQueueSize) {
+            overflow = true;
+        } else {
+            queue_.push_back(std::move(item));
+            flushNow = queue_.size() >= kMaxBatchSize && !flushing_;
+        }
+    }
+
+    if (overflow) {
+        if (!spill({item})) {
+            ++droppedCount_;
+            LOG_WARN << "[NotificationWriter] Queue full, dropping notification for user " << userId;
+        }
+        return;
+    }
+    if (flushNow) {
+        // 攒够一批时不必等待定时器
+        drogon::app().getLoop()->queueInLoop([]() { flush(); });
+    }
+}
+
+void NotificationWriter::flush() {
+    auto batch = std::make_shared<std::vector<PendingNotification>>();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (flushing_) return;
+        size_t count = std::min(queue_.size(), kMaxBatchSize);
+        batch->reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            batch->push_back(std::move(queue_.front()));
+            queue_.pop_front();
+        }
+        if (!batch->empty()) flushing_ = true;
+    }
+
+    if (batch->empty()) {
+        if (spilledCount_ > 0) replaySpill();
+        return;
+    }
+
+    auto db = drogon::app().getDbClient();
+    if (!db) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            flushing_ = false;
+        }
+        handleFailure(std::move(*batch));
+        return;
+    }
+
+    std::vector<int64_t> userIds;
+    std::vector<std::string> types;
+    std::vector<std::string> payloads;
+    userIds.reserve(batch->size());
+    types.reserve(batch->size());
+    payloads.reserve(batch->size());
+    for (const auto& item : *batch) {
+        userIds.push_back(item.userId);
+        types.push_back(item.type);
+        payloads.push_back(item.payload);
+    }
+
+    // 单条语句自动提交，回调执行时数据已落库，pg_notify 也已随提交发出；
+    // 已删除的用户直接跳过，避免单条外键错误拖垮整批。
+    // notification_counter 在同一语句内累加，保证未读数与通知表一致。
+    db->execSqlAsync(
+            "WITH ins AS ("
+            "   INSERT INTO notification (user_id, type, payload) "
+            "   SELECT t.user_id, t.type, t.payload "
+            "   FROM unnest($1::bigint[], $2::varchar[], $3::jsonb[]) AS t(user_id, type, payload) "
+            "   WHERE EXISTS (SELECT 1 FROM \"user\" u WHERE u.id = t.user_id) "
+            "   RETURNING id, user_id, type, payload, is_read, created_at"
+            "), cnt AS ("
+            "   INSERT INTO notification_counter (user_id, unread) "
+            "   SELECT user_id, COUNT(*) FROM ins GROUP BY user_id "
+            "   ON CONFLICT (user_id) DO UPDATE "
+            "   SET unread = notification_counter.unread + EXCLUDED.unread, updated_at = NOW() "
+            "   RETURNING user_id, unread"
+            ") "
+            "SELECT ins.id, ins.user_id, ins.type, ins.payload::text AS payload, ins.is_read, ins.created_at, "
+            "       cnt.unread, "
+            "       pg_notify($4, json_build_object('origin', $5::text, 'user_id', ins.user_id, "
+            "                                       'notification_id', ins.id, 'unread', cnt.unread)::text) "
+            "FROM ins JOIN cnt ON cnt.user_id = ins.user_id "
+            "ORDER BY ins.id",
+            [](const drogon::orm::Result& r) {
+                bool more;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    flushing_ = false;
+                    more = queue_.size() >= kMaxBatchSize;
+                }
+                writtenCount_ += r.size();
+                ++batchCount_;
+
+                std::unordered_map<int, int> unreadByUser;
+                for (const auto& row : r) {
+                    int userId = row["user_id"].as<int>();
+                    NotificationHub::pushNotification(userId, NotificationUtils::buildNotificationJson(row));
+                    unreadByUser[userId] = row["unread"].as<int>();
+                }
+                for (const auto& item : unreadByUser) {
+                    NotificationCounter::update(item.first, item.second);
+                }
+                if (more) {
+                    drogon::app().getLoop()->queueInLoop([]() { flush(); });
+                }
+            },
+            [batch](const drogon::orm::DrogonDbException& e) {
+                LOG_ERROR << "[NotificationWriter] Batch insert of " << batch->size()
+                          << " notifications failed: " << e.base().what();
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    flushing_ = false;
+                }
+                handleFailure(std::move(*batch));
+            },
+            DbUtils::buildIntArrayLiteral(userIds), DbUtils::buildTextArrayLiteral(types),
+            DbUtils::buildTextArrayLiteral(payloads), NotificationBus::channel(), NotificationBus::instanceId());
+}
+
+void NotificationWriter::handleFailure(std::vector<PendingNotification>&& batch) {
+    std::vector<PendingNotification> giveUp;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // 倒序放回队首，保持原有顺序
+        for (auto it = batch.rbegin(); it != batch.rend(); ++it) {
+            if (++it->attempts < kMaxAttempts && queue_.size() < kMaxQueueSize) {
+                queue_.push_front(std::move(*it));
+            } else {
+                giveUp.push_back(std::move(*it));
+            }
+        }
+    }
+
+    if (giveUp.empty()) return;
+    if (!spill(giveUp)) {
+        droppedCount_ += giveUp.size();
+        LOG_ERROR << "[NotificationWriter] Dropping " << giveUp.size() << " notifications after repeated failures";
+    }
+}
+
+bool NotificationWriter::spill(const std::vector<PendingNotification>& items) {
+    if (spillPath().empty()) return false;
+
+    std::lock_guard<std::mutex> lock(spillMutex_);
+    std::ofstream file(spillPath(), std::ios::app);
+    if (!file.is_open()) {
+        LOG_ERROR << "[NotificationWriter] Cannot open spill file " << spillPath();
+        return false;
+    }
+
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "";
+    for (const auto& item : items) {
+        Json::Value line;
+        line["user_id"] = item.userId;
+        line["type"] = item.type;
+        line["payload"] = item.payload;
+        file << Json::writeString(builder, line) << "\n";
+    }
+    file.flush();
+    if (!file) {
+        LOG_ERROR << "[NotificationWriter] Failed to write spill file " << spillPath();
+        return false;
+    }
+    spilledCount_ += items.size();
+    return true;
+}
+
+void NotificationWriter::replaySpill() {
+    if (spillPath().empty()) return;
+
+    std::lock_guard<std::mutex> spillLock(spillMutex_);
+    std::vector<std::string> lines;
+    {
+        std::ifstream file(spillPath());
+        std::string line;
+        while (std::getline(file, line)) {
+            if (!line.empty()) lines.push_back(std::move(line));
+        }
+    }
+
+    size_t replayed = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Json::CharReaderBuilder readerBuilder;
+        std::unique_ptr<Json::CharReader> reader(readerBuilder.newCharReader());
+        for (; replayed < lines.size() && queue_.size() < kMaxQueueSize; ++replayed) {
+            const auto& text = lines[replayed];
+            Json::Value line;
+            JSONCPP_STRING errs;
+            if (!reader->parse(text.data(), text.data() + text.size(), &line, &errs)) {
+                LOG_WARN << "[NotificationWriter] Skipping malformed spill line";
+                continue;
+            }
+            PendingNotification item;
+            item.userId = line.get("user_id", 0).asInt();
+            item.type = line.get("type", "").asString();
+            item.payload = line.get("payload", "{}").asString();
+            queue_.push_back(std::move(item));
+        }
+    }
+
+    // 重写落盘文件，只保留尚未回放的部分
+    std::ofstream file(spillPath(), std::ios::trunc);
+    for (size_t i = replayed; i < lines.size(); ++i) {
+        file << lines[i] << "\n";
+    }
+    spilledCount_ = lines.size() - replayed;
+    if (replayed > 0) {
+        LOG_INFO << "[NotificationWriter] Replayed " << replayed << " spilled notifications";
+    }
+}
+
+Json::Value NotificationWriter::getMetrics() {
+    Json::Value metrics;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        metrics["queue_depth"] = static_cast<Json::UInt64>(queue_.size());
+        metrics["flushing"] = flushing_;
+    }
+    metrics["max_queue_size"] = static_cast<Json::UInt64>(kMaxQueueSize);
+    metrics["batch_size"] = static_cast<Json::UInt64>(kMaxBatchSize);
+    metrics["written"] = static_cast<Json::UInt64>(writtenCount_.load());
+    metrics["batches"] = static_cast<Json::UInt64>(batchCount_.load());
+    metrics["dropped"] = static_cast<Json::UInt64>(droppedCount_.load());
+    metrics["spill_enabled"] = !spillPath().empty();
+    metrics["spilled_pending"] = static_cast<Json::UInt64>(spilledCount_.load());
+    return metrics;
+}
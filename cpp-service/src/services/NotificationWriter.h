@@ -0,0 +1,62 @@
+#pragma once
+#include <json/json.h>
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * NotificationWriter 负责异步批量写入通知。
+ *
+ * 业务代码调用 enqueue 后立即返回；后台定时任务每次取出一批，通过
+ * INSERT ... SELECT unnest(...) 一条语句写入，并在同一语句中 pg_notify 其他实例。
+ * 同一语句还会累加 notification_counter 中的未读数。语句提交后再交给 NotificationHub
+ * 推送给本实例的在线连接，并通过 NotificationCounter 推送最新未读数。
+ *
+ * 队列有上限：超出上限或重试多次仍失败的通知，若配置了 app.notification_spill_path
+ * 则追加写入本地落盘文件，待队列空闲时回放；未配置时丢弃并记录日志。
+ */
+class NotificationWriter {
+public:
+    // 将一条通知加入写入队列。
+    static void enqueue(int userId, const std::string& type, const Json::Value& payload);
+
+    // 返回队列深度、批次数等指标。
+    static Json::Value getMetrics();
+
+private:
+    struct PendingNotification {
+        int userId{0};
+        std::string type;
+        std::string payload;  // 已序列化的 JSON
+        int attempts{0};
+    };
+
+    // 启动后台定时 flush（首次 enqueue 时调用一次）。
+    static void ensureStarted();
+
+    // 取出一批写入数据库。
+    static void flush();
+
+    // 写入失败时：未超过重试次数的放回队首，其余落盘或丢弃。
+    static void handleFailure(std::vector<PendingNotification>&& batch);
+
+    // 追加到落盘文件；未启用落盘时返回 false。
+    static bool spill(const std::vector<PendingNotification>& items);
+
+    // 队列空闲时将落盘文件中的通知重新入队。
+    static void replaySpill();
+
+    static const std::string& spillPath();
+
+    static std::mutex mutex_;                          // 保护 queue_ 与 flushing_
+    static std::deque<PendingNotification> queue_;     // 待写入的通知
+    static bool flushing_;                             // 是否有批次正在写入
+    static std::mutex spillMutex_;                     // 保护落盘文件
+    static std::atomic_size_t spilledCount_;           // 落盘文件中尚未回放的条数
+    static std::atomic_size_t droppedCount_;           // 因队列满或写入失败被丢弃的条数
+    static std::atomic_size_t writtenCount_;           // 已成功写入的条数
+    static std::atomic_size_t batchCount_;             // 已执行的批次数
+};
@@ -1,35 +1,457 @@
 #include "SearchService.h"
 
-#include <drogon/HttpClient.h>
 #include <drogon/drogon.h>
 #include <json/json.h>
-#include <unistd.h>  // for access()
 
-#include <fstream>
-#include <sstream>
+#include <algorithm>
+#include <atomic>
+#include <unordered_set>
 
-void SearchService::indexDocument(int docId, const std::string& title, const std::string& content) {
-    Json::Value document;
-    document["id"] = docId;
-    document["title"] = title;
-    document["content"] = content;
+#include "../repositories/StatementRegistry.h"
+#include "../utils/ConfigUtils.h"
+#include "../utils/DbUtils.h"
+#include "LocalSearchEngine.h"
+
+namespace {
+// 单批最多处理的文档数
+constexpr size_t kMaxBatchSize = 100;
+// 定时 flush 周期（秒），同时起到防抖作用：周期内的多次更新只发送最后一次
+constexpr double kFlushIntervalSeconds = 0.5;
+// 发送失败后的最大尝试次数
+constexpr int kMaxAttempts = 8;
+// 重试退避：首次 1 秒，逐次翻倍，最长 60 秒
+constexpr auto kRetryBaseDelay = std::chrono::seconds(1);
+constexpr auto kRetryMaxDelay = std::chrono::seconds(60);
+// 保留的最近任务数
+constexpr size_t kMaxRecentTasks = 50;
+// 每批补齐 ACL 的文档数
+constexpr int kAclBackfillBatch = 500;
+// 本地索引校对时每次从数据库读取的文档数
+constexpr int kLocalReconcileBatch = 500;
+// 索引文件最后修改时间之前这段时间内更新过的文档也重新索引（覆盖进程退出时仍在队列中的写入）
+constexpr int64_t kLocalReconcileMarginSeconds = 300;
+
+std::once_flag startOnce;
+
+// 文档 ACL：owner_id 与 user_doc_access 中的全部用户（已包含 owner）
+const char* const kAclColumns =
+        "SELECT d.id, d.owner_id, "
+        "       COALESCE(json_agg(u.user_id ORDER BY u.user_id) FILTER (WHERE u.user_id IS NOT NULL), '[]')::text "
+        "           AS allowed_user_ids "
+        "FROM document d "
+        "LEFT JOIN user_doc_access u ON u.doc_id = d.id ";
 
+Json::Value buildAclFields(const drogon::orm::Row& row) {
+    Json::Value fields;
+    fields["id"] = row["id"].as<int>();
+    fields["owner_id"] = row["owner_id"].as<int>();
+    Json::Value allowed(Json::arrayValue);
+    Json::CharReaderBuilder readerBuilder;
+    std::unique_ptr<Json::CharReader> reader(readerBuilder.newCharReader());
+    const std::string text = row["allowed_user_ids"].as<std::string>();
+    JSONCPP_STRING errs;
+    if (!reader->parse(text.data(), text.data() + text.size(), &allowed, &errs) || !allowed.isArray()) {
+        allowed = Json::Value(Json::arrayValue);
+    }
+    fields["allowed_user_ids"] = allowed;
+    return fields;
+}
+
+std::string toJson(const Json::Value& value) {
     Json::StreamWriterBuilder builder;
-    std::string body = Json::writeString(builder, document);
-    // 发送获取请求
-    auto client = drogon::HttpClient::newHttpClient(getMeilisearchUrl());
+    builder["indentation"] = "";
+    return Json::writeString(builder, value);
+}
+
+// 将 ACL 字段与正文组装为本地索引文档
+LocalSearchEngine::Document toLocalDocument(const Json::Value& aclFields, const std::string& title,
+                                            const std::string& content) {
+    LocalSearchEngine::Document document;
+    document.id = aclFields["id"].asInt();
+    document.ownerId = aclFields["owner_id"].asInt();
+    for (const auto& userId : aclFields["allowed_user_ids"]) {
+        document.allowedUserIds.push_back(userId.asInt());
+    }
+    document.title = title;
+    document.content = content;
+    return document;
+}
+
+// 一批发送完成（所有请求都已返回）时清除 flushing_ 标记
+struct FlushCompletion {
+    std::function<void()> onComplete;
+    ~FlushCompletion() { onComplete(); }
+};
+
+// 返回的这一页逐条按 user_doc_access 复核：索引中的 ACL 异步更新，权限刚被收回的文档在索引追上之前
+// 仍会命中，这里将其丢弃（总数同步扣减）。只查当前页，每条命中一次主键查询
+struct HitRecheck {
+    Json::Value result;
+    std::vector<char> allowed;
+    std::atomic_size_t remaining{0};
+    std::atomic_bool failed{false};
+    std::function<void(const Json::Value&)> callback;
+    std::function<void(const std::string&)> errorCallback;
+
+    void finishOne() {
+        if (--remaining > 0) return;
+        if (failed) {
+            errorCallback("Permission check failed");
+            return;
+        }
+        Json::Value kept(Json::arrayValue);
+        Json::ArrayIndex dropped = 0;
+        for (Json::ArrayIndex i = 0; i < result["hits"].size(); ++i) {
+            if (allowed[i]) {
+                kept.append(result["hits"][i]);
+            } else {
+                ++dropped;
+            }
+        }
+        result["hits"] = kept;
+        if (dropped > 0 && result["totalHits"].isNumeric()) {
+            result["totalHits"] = std::max<Json::Int64>(0, result["totalHits"].asInt64() - dropped);
+        }
+        callback(result);
+    }
+};
+
+void recheckHits(Json::Value result, int userId, std::function<void(const Json::Value&)> callback,
+                 std::function<void(const std::string&)> errorCallback) {
+    if (!result["hits"].isArray() || result["hits"].empty()) {
+        callback(result);
+        return;
+    }
+    auto db = drogon::app().getDbClient();
+    if (!db) {
+        errorCallback("Database not available");
+        return;
+    }
+    auto recheck = std::make_shared<HitRecheck>();
+    recheck->result = std::move(result);
+    recheck->allowed.assign(recheck->result["hits"].size(), 0);
+    recheck->remaining = recheck->allowed.size();
+    recheck->callback = std::move(callback);
+    recheck->errorCallback = std::move(errorCallback);
+    for (Json::ArrayIndex i = 0; i < recheck->result["hits"].size(); ++i) {
+        db->execSqlAsync(
+                StatementRegistry::docPermission(),
+                [recheck, i](const drogon::orm::Result& r) {
+                    recheck->allowed[i] = !r.empty();
+                    recheck->finishOne();
+                },
+                [recheck](const drogon::orm::DrogonDbException& e) {
+                    LOG_ERROR << "[SearchService] Hit permission check failed: " << e.base().what();
+                    recheck->failed = true;
+                    recheck->finishOne();
+                },
+                std::to_string(recheck->result["hits"][i]["id"].asInt()), std::to_string(userId));
+    }
+}
+}  // namespace
+
+std::mutex SearchService::mutex_;
+std::unordered_map<int, SearchService::PendingOp> SearchService::pending_;
+bool SearchService::flushing_ = false;
+std::deque<SearchService::TaskRecord> SearchService::recentTasks_;
+std::atomic_size_t SearchService::indexedCount_{0};
+std::atomic_size_t SearchService::deletedCount_{0};
+std::atomic_size_t SearchService::retriedCount_{0};
+std::atomic_size_t SearchService::failedCount_{0};
+std::atomic_size_t SearchService::batchCount_{0};
+
+drogon::HttpClientPtr SearchService::indexClient() {
+    static const drogon::HttpClientPtr client =
+            drogon::HttpClient::newHttpClient(getMeilisearchUrl(), drogon::app().getLoop());
+    return client;
+}
+
+bool SearchService::useLocalEngine() {
+    static const bool local = ConfigUtils::getValue("search_engine", "meilisearch") == "local";
+    return local;
+}
+
+void SearchService::initialize() {
+    if (useLocalEngine()) {
+        // 本地索引：打开索引目录后按数据库校对（首次启用或段文件损坏时相当于全量重建）
+        if (!LocalSearchEngine::open(ConfigUtils::getValue("local_search_path", "./data/search"))) return;
+        int64_t lastModified = LocalSearchEngine::lastModified();
+        int64_t since = lastModified > kLocalReconcileMarginSeconds ? lastModified - kLocalReconcileMarginSeconds : 0;
+        auto ids = LocalSearchEngine::documentIds();
+        reconcileLocalIndex(0, since, std::make_shared<std::unordered_set<int>>(ids.begin(), ids.end()));
+        return;
+    }
+
+    // 1.声明可过滤字段（Meilisearch 只能对声明过的字段使用 filter）
+    //   title 用于清理 ACL 部分更新误建的残缺文档（见 sendAclUpdate）
+    Json::Value attributes(Json::arrayValue);
+    attributes.append("owner_id");
+    attributes.append("allowed_user_ids");
+    attributes.append("title");
+    sendIndexRequest(drogon::Put, "/indexes/documents/settings/filterable-attributes", toJson(attributes),
+                     "settings", 0, [](bool ok) {
+                         if (!ok) return;
+                         // 2.为已有文档补齐 ACL 字段（部分更新，重复执行无副作用）
+                         backfillAcl(0);
+                     });
+}
+
+void SearchService::shutdown() {
+    if (useLocalEngine()) LocalSearchEngine::close();
+}
+
+void SearchService::ensureStarted() {
+    std::call_once(startOnce, []() { drogon::app().getLoop()->runEvery(kFlushIntervalSeconds, []() { flush(); }); });
+}
+
+void SearchService::indexDocument(int docId, const std::string& title, const std::string& content) {
+    PendingOp op;
+    op.kind = OpKind::Upsert;
+    op.title = title;
+    op.content = content;
+    enqueue(docId, std::move(op));
+}
+
+void SearchService::indexDocuments(std::vector<IndexItem> items) {
+    if (items.empty()) return;
+    ensureStarted();
+    bool flushNow;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& item : items) {
+            PendingOp op;
+            op.kind = OpKind::Upsert;
+            op.title = std::move(item.title);
+            op.content = std::move(item.content);
+            pending_[item.docId] = std::move(op);
+        }
+        flushNow = pending_.size() >= kMaxBatchSize && !flushing_;
+    }
+    if (flushNow) {
+        drogon::app().getLoop()->queueInLoop([]() { flush(); });
+    }
+}
+
+void SearchService::updateDocumentAcl(int docId) {
+    PendingOp op;
+    op.kind = OpKind::AclOnly;
+    enqueue(docId, std::move(op));
+}
+
+void SearchService::deleteDocument(int docId) {
+    PendingOp op;
+    op.kind = OpKind::Delete;
+    enqueue(docId, std::move(op));
+}
+
+void SearchService::enqueue(int docId, PendingOp op) {
+    ensureStarted();
+    bool flushNow = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = pending_.find(docId);
+        if (it != pending_.end() && op.kind == OpKind::AclOnly && it->second.kind != OpKind::AclOnly) {
+            // 待写入的整篇文档会在发送前重新读取 ACL；已待删除的文档无需再更新 ACL
+            it->second.attempts = 0;
+            it->second.notBefore = {};
+            return;
+        }
+        // 其余情况后写覆盖先写
+        pending_[docId] = std::move(op);
+        flushNow = pending_.size() >= kMaxBatchSize && !flushing_;
+    }
+    if (flushNow) {
+        // 攒够一批时不必等待定时器
+        drogon::app().getLoop()->queueInLoop([]() { flush(); });
+    }
+}
+
+void SearchService::flush() {
+    auto batch = std::make_shared<std::vector<std::pair<int, PendingOp>>>();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (flushing_ || pending_.empty()) return;
+        auto now = std::chrono::steady_clock::now();
+        for (auto it = pending_.begin(); it != pending_.end() && batch->size() < kMaxBatchSize;) {
+            if (it->second.notBefore <= now) {
+                batch->emplace_back(it->first, std::move(it->second));
+                it = pending_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        if (batch->empty()) return;
+        flushing_ = true;
+    }
+    ++batchCount_;
+
+    // 所有请求返回后（guard 析构）才允许下一批，并在队列仍有积压时立即继续
+    auto completion = std::make_shared<FlushCompletion>();
+    completion->onComplete = []() {
+        bool more;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            flushing_ = false;
+            more = pending_.size() >= kMaxBatchSize;
+        }
+        if (more) drogon::app().getLoop()->queueInLoop([]() { flush(); });
+    };
+
+    // 1.批量删除
+    auto deletes = std::make_shared<std::vector<std::pair<int, PendingOp>>>();
+    std::vector<int64_t> aclDocIds;
+    Json::Value deleteIds(Json::arrayValue);
+    for (auto& entry : *batch) {
+        if (entry.second.kind == OpKind::Delete) {
+            deleteIds.append(entry.first);
+            deletes->push_back(std::move(entry));
+        } else {
+            aclDocIds.push_back(entry.first);
+        }
+    }
+    if (!deletes->empty() && useLocalEngine()) {
+        std::vector<int> docIds;
+        for (const auto& entry : *deletes) docIds.push_back(entry.first);
+        LocalSearchEngine::remove(docIds);
+        deletedCount_ += docIds.size();
+    } else if (!deletes->empty()) {
+        sendIndexRequest(drogon::Post, "/indexes/documents/documents/delete-batch", toJson(deleteIds), "delete",
+                         deletes->size(), [deletes, completion](bool ok) {
+                             if (ok) {
+                                 deletedCount_ += deletes->size();
+                             } else {
+                                 requeue(std::move(*deletes));
+                             }
+                         });
+    }
+    if (aclDocIds.empty()) return;
+
+    // 2.写入与 ACL 更新：一次查询取回整批文档的 ACL
+    loadAcl(
+            aclDocIds,
+            [batch, completion](const std::unordered_map<int, Json::Value>& aclByDoc) {
+                if (useLocalEngine()) {
+                    // 本地索引同步写入，不会失败，无需重试
+                    std::vector<LocalSearchEngine::Document> upsertDocs;
+                    for (auto& entry : *batch) {
+                        if (entry.second.kind == OpKind::Delete) continue;
+                        auto it = aclByDoc.find(entry.first);
+                        if (it == aclByDoc.end()) continue;  // 文档已被删除
+                        if (entry.second.kind == OpKind::Upsert) {
+                            upsertDocs.push_back(toLocalDocument(it->second, entry.second.title, entry.second.content));
+                        } else {
+                            std::vector<int> allowed;
+                            for (const auto& userId : it->second["allowed_user_ids"]) allowed.push_back(userId.asInt());
+                            LocalSearchEngine::updateAcl(entry.first, it->second["owner_id"].asInt(), allowed);
+                        }
+                    }
+                    LocalSearchEngine::upsert(upsertDocs);
+                    indexedCount_ += upsertDocs.size();
+                    return;
+                }
+                auto upserts = std::make_shared<std::vector<std::pair<int, PendingOp>>>();
+                auto aclUpdates = std::make_shared<std::vector<std::pair<int, PendingOp>>>();
+                Json::Value upsertDocs(Json::arrayValue);
+                Json::Value aclDocs(Json::arrayValue);
+                for (auto& entry : *batch) {
+                    if (entry.second.kind == OpKind::Delete) continue;
+                    auto it = aclByDoc.find(entry.first);
+                    if (it == aclByDoc.end()) continue;  // 文档已被删除
+                    if (entry.second.kind == OpKind::Upsert) {
+                        Json::Value document = it->second;
+                        document["title"] = entry.second.title;
+                        document["content"] = entry.second.content;
+                        upsertDocs.append(document);
+                        upserts->push_back(std::move(entry));
+                    } else {
+                        aclDocs.append(it->second);
+                        aclUpdates->push_back(std::move(entry));
+                    }
+                }
+                if (!upserts->empty()) {
+                    // POST 整体替换文档
+                    sendIndexRequest(drogon::Post, "/indexes/documents/documents", toJson(upsertDocs), "upsert",
+                                     upserts->size(), [upserts, completion](bool ok) {
+                                         if (ok) {
+                                             indexedCount_ += upserts->size();
+                                         } else {
+                                             requeue(std::move(*upserts));
+                                         }
+                                     });
+                }
+                if (!aclUpdates->empty()) {
+                    sendAclUpdate(aclDocs, "acl", [aclUpdates, completion](bool ok) {
+                        if (!ok) requeue(std::move(*aclUpdates));
+                    });
+                }
+            },
+            [batch, completion](const std::string& error) {
+                LOG_ERROR << "[SearchService] Failed to load ACL for index batch: " << error;
+                std::vector<std::pair<int, PendingOp>> retry;
+                for (auto& entry : *batch) {
+                    if (entry.second.kind != OpKind::Delete) retry.push_back(std::move(entry));
+                }
+                requeue(std::move(retry));
+            });
+}
+
+void SearchService::requeue(std::vector<std::pair<int, PendingOp>>&& ops) {
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& entry : ops) {
+        PendingOp& op = entry.second;
+        auto existing = pending_.find(entry.first);
+        if (existing != pending_.end()) {
+            // 发送期间又有仅 ACL 的更新：升级为整篇写入（发送前会重新读取 ACL），否则正文的更新会丢失
+            if (op.kind == OpKind::Upsert && existing->second.kind == OpKind::AclOnly) {
+                existing->second.kind = OpKind::Upsert;
+                existing->second.title = std::move(op.title);
+                existing->second.content = std::move(op.content);
+            }
+            // 其余情况新的操作（整篇写入 / 删除）已覆盖旧操作
+            continue;
+        }
+        if (++op.attempts >= kMaxAttempts) {
+            ++failedCount_;
+            LOG_ERROR << "[SearchService] Giving up indexing docId=" << entry.first << " after " << op.attempts
+                      << " attempts";
+            continue;
+        }
+        auto delay = std::min<std::chrono::steady_clock::duration>(kRetryBaseDelay * (1 << (op.attempts - 1)),
+                                                                   kRetryMaxDelay);
+        op.notBefore = now + delay;
+        ++retriedCount_;
+        pending_.emplace(entry.first, std::move(op));
+    }
+}
+
+void SearchService::recordTask(const drogon::HttpResponsePtr& resp, const std::string& type, size_t documents) {
+    auto jsonPtr = resp->getJsonObject();
+    if (!jsonPtr || !jsonPtr->isMember("taskUid")) return;
+    TaskRecord record;
+    record.taskUid = (*jsonPtr)["taskUid"].asInt64();
+    record.type = type;
+    record.documents = documents;
+    record.enqueuedAt = std::chrono::system_clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    recentTasks_.push_back(record);
+    while (recentTasks_.size() > kMaxRecentTasks) recentTasks_.pop_front();
+}
+
+void SearchService::sendIndexRequest(drogon::HttpMethod method, const std::string& path, const std::string& body,
+                                     const std::string& taskType, size_t documents, std::function<void(bool)> onDone) {
     auto req = drogon::HttpRequest::newHttpRequest();
-    req->setMethod(drogon::Post);
-    req->setPath("/indexes/documents/documents");
+    req->setMethod(method);
+    req->setPath(path);
     req->addHeader("Authorization", "Bearer " + getMasterKey());
     req->setContentTypeCode(drogon::CT_APPLICATION_JSON);
     req->setBody(body);
-    // 异步处理：记录索引结果，便于排查问题
-    LOG_INFO << "[SearchService] indexDocument called for docId=" << docId << ", title=" << title;
-    client->sendRequest(req, [docId](drogon::ReqResult result, const drogon::HttpResponsePtr& resp) {
+    indexClient()->sendRequest(req, [taskType, documents, onDone](drogon::ReqResult result,
+                                                                  const drogon::HttpResponsePtr& resp) {
         if (result != drogon::ReqResult::Ok) {
-            LOG_ERROR << "[SearchService] Failed to index document (network error). docId=" << docId
-                      << ", result=" << static_cast<int>(result);
+            LOG_ERROR << "[SearchService] Index request failed (network error). type=" << taskType
+                      << ", documents=" << documents << ", result=" << static_cast<int>(result);
+            onDone(false);
             return;
         }
 
@@ -40,32 +462,152 @@ void SearchService::indexDocument(int docId, const std::string& title, const std
             if (!bodyView.empty()) {
                 bodyStr.assign(bodyView.data(), std::min<size_t>(bodyView.length(), 500));  // 只打印前 500 字符
             }
-            LOG_ERROR << "[SearchService] Meilisearch returned status " << status << " when indexing docId=" << docId
-                      << ", body=" << bodyStr;
-        } else {
-            LOG_INFO << "[SearchService] Indexed document successfully. docId=" << docId << ", status=" << status;
+            LOG_ERROR << "[SearchService] Meilisearch returned status " << status << ". type=" << taskType
+                      << ", documents=" << documents << ", body=" << bodyStr;
+            onDone(false);
+            return;
         }
+        recordTask(resp, taskType, documents);
+        onDone(true);
     });
 }
 
-void SearchService::deleteDocument(int docId) {
-    // 发送 DELETE 请求
-    auto client = drogon::HttpClient::newHttpClient(getMeilisearchUrl());
-    auto req = drogon::HttpRequest::newHttpRequest();
-    req->setMethod(drogon::Delete);
-    req->setPath("/indexes/documents/documents/" + std::to_string(docId));
-    req->addHeader("Authorization", "Bearer " + getMasterKey());
-    // 异步处理：失败时记录错误日志
-    client->sendRequest(req, [=](drogon::ReqResult result, const drogon::HttpResponsePtr& resp) {
-        if (result != drogon::ReqResult::Ok) {
-            LOG_ERROR << "Failed to delete document from index";
-        }
-    });
+void SearchService::sendAclUpdate(const Json::Value& documents, const std::string& taskType,
+                                  std::function<void(bool)> onDone) {
+    // PUT 为部分更新，只覆盖 owner_id / allowed_user_ids；但索引中不存在的 id 会被新建成只有 ACL 字段的文档。
+    // 随后按 title NOT EXISTS 删除这些残缺文档：Meilisearch 按入队顺序执行任务，已写入的文档带有 title 不受影响，
+    // 之后才到达的整篇写入会重新创建文档，因此不需要事先查询哪些 id 已在索引中
+    size_t count = documents.size();
+    sendIndexRequest(drogon::Put, "/indexes/documents/documents", toJson(documents), taskType, count,
+                     [count, onDone](bool ok) {
+                         if (ok) {
+                             Json::Value filter;
+                             filter["filter"] = "title NOT EXISTS";
+                             sendIndexRequest(drogon::Post, "/indexes/documents/documents/delete", toJson(filter),
+                                              "acl_cleanup", count, [](bool cleaned) {
+                                                  if (!cleaned) {
+                                                      LOG_WARN << "[SearchService] Failed to remove ACL-only "
+                                                                  "documents, retrying with the next ACL update";
+                                                  }
+                                              });
+                         }
+                         onDone(ok);
+                     });
+}
+
+void SearchService::loadAcl(const std::vector<int64_t>& docIds,
+                            std::function<void(const std::unordered_map<int, Json::Value>&)> callback,
+                            std::function<void(const std::string&)> errorCallback) {
+    auto db = drogon::app().getDbClient();
+    if (!db) {
+        errorCallback("Database not available");
+        return;
+    }
+    db->execSqlAsync(
+            std::string(kAclColumns) + "WHERE d.id = ANY($1::bigint[]) GROUP BY d.id",
+            [callback](const drogon::orm::Result& r) {
+                std::unordered_map<int, Json::Value> aclByDoc;
+                for (const auto& row : r) {
+                    aclByDoc[row["id"].as<int>()] = buildAclFields(row);
+                }
+                callback(aclByDoc);
+            },
+            [errorCallback](const drogon::orm::DrogonDbException& e) {
+                errorCallback("Database error: " + std::string(e.base().what()));
+            },
+            DbUtils::buildIntArrayLiteral(docIds));
+}
+
+void SearchService::backfillAcl(int afterDocId) {
+    auto db = drogon::app().getDbClient();
+    if (!db) return;
+    db->execSqlAsync(
+            std::string(kAclColumns) + "WHERE d.id > $1::bigint GROUP BY d.id ORDER BY d.id LIMIT " +
+                    std::to_string(kAclBackfillBatch),
+            [](const drogon::orm::Result& r) {
+                if (r.empty()) {
+                    LOG_INFO << "[SearchService] ACL backfill finished";
+                    return;
+                }
+                Json::Value documents(Json::arrayValue);
+                for (const auto& row : r) {
+                    documents.append(buildAclFields(row));
+                }
+                int lastDocId = r[r.size() - 1]["id"].as<int>();
+                bool more = r.size() == static_cast<size_t>(kAclBackfillBatch);
+                // 上一批提交成功后再取下一批；失败时停止，下次启动重新补齐
+                sendAclUpdate(documents, "acl_backfill", [lastDocId, more](bool ok) {
+                    if (!ok) {
+                        LOG_ERROR << "[SearchService] ACL backfill stopped at docId > " << lastDocId;
+                        return;
+                    }
+                    if (more) backfillAcl(lastDocId);
+                });
+            },
+            [](const drogon::orm::DrogonDbException& e) {
+                LOG_ERROR << "[SearchService] ACL backfill failed: " << e.base().what();
+            },
+            std::to_string(afterDocId));
+}
+
+void SearchService::reconcileLocalIndex(int afterDocId, int64_t since,
+                                        std::shared_ptr<std::unordered_set<int>> unseen) {
+    auto db = drogon::app().getDbClient();
+    if (!db) return;
+    // 正文取已发布版本的纯文本，未发布的文档以标题作为正文（与创建文档时一致）
+    db->execSqlAsync(
+            "SELECT d.id, d.owner_id, d.title, COALESCE(NULLIF(dv.content_text, ''), d.title) AS content, "
+            "       d.updated_at >= to_timestamp($2::double precision) AS changed, "
+            "       COALESCE(json_agg(u.user_id ORDER BY u.user_id) FILTER (WHERE u.user_id IS NOT NULL), '[]')::text "
+            "           AS allowed_user_ids "
+            "FROM document d "
+            "LEFT JOIN document_version dv ON dv.id = d.last_published_version_id "
+            "LEFT JOIN user_doc_access u ON u.doc_id = d.id "
+            "WHERE d.id > $1::bigint "
+            "GROUP BY d.id, dv.content_text "
+            "ORDER BY d.id LIMIT " +
+                    std::to_string(kLocalReconcileBatch),
+            [since, unseen](const drogon::orm::Result& r) {
+                for (const auto& row : r) {
+                    int docId = row["id"].as<int>();
+                    unseen->erase(docId);
+                    LocalSearchEngine::Document indexed;
+                    bool found = LocalSearchEngine::find(docId, indexed);
+                    std::string title = row["title"].as<std::string>();
+                    // 索引中缺失、标题不同或可能有未写入的更新：重新索引（发送前会重新读取 ACL）
+                    if (!found || row["changed"].as<bool>() || indexed.title != title) {
+                        indexDocument(docId, title, row["content"].as<std::string>());
+                        continue;
+                    }
+                    LocalSearchEngine::Document expected = toLocalDocument(buildAclFields(row), title, "");
+                    std::sort(indexed.allowedUserIds.begin(), indexed.allowedUserIds.end());
+                    if (indexed.ownerId != expected.ownerId || indexed.allowedUserIds != expected.allowedUserIds) {
+                        updateDocumentAcl(docId);
+                    }
+                }
+                if (r.size() == static_cast<size_t>(kLocalReconcileBatch)) {
+                    reconcileLocalIndex(r[r.size() - 1]["id"].as<int>(), since, unseen);
+                    return;
+                }
+                // 数据库中已不存在的文档
+                for (int docId : *unseen) deleteDocument(docId);
+                LOG_INFO << "[SearchService] Local index reconciled, removed " << unseen->size() << " documents";
+            },
+            [](const drogon::orm::DrogonDbException& e) {
+                LOG_ERROR << "[SearchService] Local index reconcile failed: " << e.base().what();
+            },
+            std::to_string(afterDocId), std::to_string(since));
 }
 
-void SearchService::search(const std::string& query, int page, int pageSize,
+void SearchService::search(const std::string& query, int page, int pageSize, int userId,
                            std::function<void(const Json::Value&)> callback,
                            std::function<void(const std::string&)> errorCallback) {
+    if (useLocalEngine()) {
+        recheckHits(LocalSearchEngine::search(query, page, pageSize, userId), userId, std::move(callback),
+                    std::move(errorCallback));
+        return;
+    }
+
     auto client = drogon::HttpClient::newHttpClient(getMeilisearchUrl());
     auto req = drogon::HttpRequest::newHttpRequest();
 
@@ -78,10 +620,17 @@ void SearchService::search(const std::string& query, int page, int pageSize,
     payload["q"] = query;
     payload["page"] = page;
     payload["hitsPerPage"] = pageSize;
+    // 权限过滤下推到索引：只返回 userId 可访问的文档，totalHits 即为可见总数
+    payload["filter"] = "allowed_user_ids = " + std::to_string(userId);
+    // ACL 字段只用于过滤，不随结果返回
+    Json::Value attributes(Json::arrayValue);
+    for (const char* name : {"id", "title", "content", "updated_at"}) attributes.append(name);
+    payload["attributesToRetrieve"] = attributes;
     Json::StreamWriterBuilder builder;
     req->setBody(Json::writeString(builder, payload));
 
-    client->sendRequest(req, [callback, errorCallback](drogon::ReqResult result, const drogon::HttpResponsePtr& resp) {
+    client->sendRequest(req, [userId, callback, errorCallback](drogon::ReqResult result,
+                                                               const drogon::HttpResponsePtr& resp) {
         if (result != drogon::ReqResult::Ok) {
             errorCallback("Search request failed");
             return;
@@ -98,39 +647,86 @@ void SearchService::search(const std::string& query, int page, int pageSize,
             return;
         }
 
-        callback(*jsonPtr);
+        recheckHits(*jsonPtr, userId, callback, errorCallback);
     });
 }
 
-// 辅助函数：从配置文件读取配置值（直接读取配置文件）
-static std::string getConfigValue(const std::string& key, const std::string& defaultValue = "") {
-    std::string configPath = "config.json";
-    if (access("config.json", F_OK) != 0) {
-        configPath = "../config.json";
+void SearchService::getIndexStatus(std::function<void(const Json::Value&)> callback) {
+    Json::Value status;
+    std::vector<TaskRecord> tasks;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t retrying = 0;
+        for (const auto& entry : pending_) {
+            if (entry.second.attempts > 0) ++retrying;
+        }
+        status["queue_depth"] = static_cast<Json::UInt64>(pending_.size());
+        status["retrying"] = static_cast<Json::UInt64>(retrying);
+        status["flushing"] = flushing_;
+        tasks.assign(recentTasks_.begin(), recentTasks_.end());
+    }
+    status["batch_size"] = static_cast<Json::UInt64>(kMaxBatchSize);
+    status["flush_interval_ms"] = static_cast<int>(kFlushIntervalSeconds * 1000);
+    status["indexed"] = static_cast<Json::UInt64>(indexedCount_.load());
+    status["deleted"] = static_cast<Json::UInt64>(deletedCount_.load());
+    status["retries"] = static_cast<Json::UInt64>(retriedCount_.load());
+    status["failed"] = static_cast<Json::UInt64>(failedCount_.load());
+    status["batches"] = static_cast<Json::UInt64>(batchCount_.load());
+    status["engine"] = useLocalEngine() ? "local" : "meilisearch";
+    if (useLocalEngine()) {
+        status["local_index"] = LocalSearchEngine::getStats();
     }
 
-    try {
-        std::ifstream file(configPath);
-        if (file.is_open()) {
-            std::stringstream buffer;
-            buffer << file.rdbuf();
-            file.close();
+    Json::Value taskArray(Json::arrayValue);
+    std::string uids;
+    for (auto it = tasks.rbegin(); it != tasks.rend(); ++it) {
+        Json::Value task;
+        task["task_uid"] = static_cast<Json::Int64>(it->taskUid);
+        task["type"] = it->type;
+        task["documents"] = static_cast<Json::UInt64>(it->documents);
+        task["enqueued_at"] = static_cast<Json::Int64>(
+                std::chrono::duration_cast<std::chrono::seconds>(it->enqueuedAt.time_since_epoch()).count());
+        taskArray.append(task);
+        if (!uids.empty()) uids += ",";
+        uids += std::to_string(it->taskUid);
+    }
+    status["recent_tasks"] = taskArray;
+    if (uids.empty()) {
+        callback(status);
+        return;
+    }
 
-            Json::Value root;
-            Json::Reader reader;
-            if (reader.parse(buffer.str(), root)) {
-                if (root.isMember("app") && root["app"].isMember(key)) {
-                    return root["app"][key].asString();
-                }
+    // 向 Meilisearch 查询这些任务的最新状态；失败时只返回本地记录
+    auto client = drogon::HttpClient::newHttpClient(getMeilisearchUrl());
+    auto req = drogon::HttpRequest::newHttpRequest();
+    req->setMethod(drogon::Get);
+    req->setPath("/tasks");
+    req->setParameter("uids", uids);
+    req->addHeader("Authorization", "Bearer " + getMasterKey());
+    client->sendRequest(req, [status, callback](drogon::ReqResult result, const drogon::HttpResponsePtr& resp) mutable {
+        if (result != drogon::ReqResult::Ok || resp->getStatusCode() != drogon::k200OK || !resp->getJsonObject()) {
+            status["task_status_error"] = "Failed to query Meilisearch tasks";
+            callback(status);
+            return;
+        }
+        std::unordered_map<int64_t, Json::Value> remote;
+        for (const auto& task : (*resp->getJsonObject())["results"]) {
+            remote[task["uid"].asInt64()] = task;
+        }
+        for (auto& task : status["recent_tasks"]) {
+            auto it = remote.find(task["task_uid"].asInt64());
+            if (it == remote.end()) continue;
+            task["status"] = it->second["status"];
+            if (!it->second["error"].isNull()) {
+                task["error"] = it->second["error"]["message"];
             }
         }
-    } catch (...) {
-        // 忽略异常
-    }
-
-    return defaultValue;
+        callback(status);
+    });
 }
 
-std::string SearchService::getMeilisearchUrl() { return getConfigValue("meilisearch_url", "http://localhost:7700"); }
+std::string SearchService::getMeilisearchUrl() {
+    return ConfigUtils::getValue("meilisearch_url", "http://localhost:7700");
+}
 
-std::string SearchService::getMasterKey() { return getConfigValue("meilisearch_master_key", ""); }
+std::string SearchService::getMasterKey() { return ConfigUtils::getValue("meilisearch_master_key", ""); }
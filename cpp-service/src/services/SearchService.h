@@ -1,21 +1,123 @@
 #pragma once
+#include <drogon/HttpClient.h>
+#include <drogon/HttpTypes.h>
 #include <json/json.h>
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
+/**
+ * SearchService 封装 Meilisearch 的索引与搜索。
+ *
+ * 每个索引文档都带有 owner_id 与 allowed_user_ids（来自 user_doc_access，包含 owner），
+ * 搜索时以 allowed_user_ids 过滤，Meilisearch 只返回当前用户可见的结果，分页与总数因此准确。
+ * 索引中的 ACL 落后于数据库，返回的一页再按 user_doc_access 复核，丢弃权限已收回的命中。
+ *
+ * 索引写入走异步队列：同一文档的多次更新按 docId 合并（后写覆盖先写），
+ * 后台定时将一批文档合并为一次 Meilisearch 请求（写入 / 仅更新 ACL / 批量删除各一次），
+ * 失败时按指数退避重试，并记录 Meilisearch 返回的 taskUid 便于排查。
+ *
+ * app.search_engine = "local" 时改用进程内的 LocalSearchEngine（索引目录为 app.local_search_path），
+ * 队列与合并规则不变，只是批次直接写入本地索引；搜索接口与返回结构保持一致。
+ */
 class SearchService {
 public:
-    // 索引文档
+    struct IndexItem {
+        int docId{0};
+        std::string title;
+        std::string content;
+    };
+
+    // 启动时调用：声明可过滤字段，并为已有索引文档补齐 ACL 字段；本地索引模式下打开索引并按数据库校对
+    static void initialize();
+    // 进程退出前调用：本地索引模式下停止后台线程并将内存段落盘
+    static void shutdown();
+    // 索引文档（同时写入 ACL 字段）
     static void indexDocument(int docId, const std::string &title, const std::string &content);
+    // 批量索引（批量导入使用）：一次入队，攒够一批时立即发送
+    static void indexDocuments(std::vector<IndexItem> items);
+    // ACL 变更后更新索引中的 owner_id / allowed_user_ids
+    static void updateDocumentAcl(int docId);
     // 删除文档索引
     static void deleteDocument(int docId);
-    // 搜索文档
-    static void search(const std::string &query, int page, int pageSize,
+    // 搜索 userId 可访问的文档
+    static void search(const std::string &query, int page, int pageSize, int userId,
                        std::function<void(const Json::Value &)> callback,
                        std::function<void(const std::string &)> errorCallback);
 
+    // 索引队列状态与最近的 Meilisearch 任务（附带任务的最新状态）
+    static void getIndexStatus(std::function<void(const Json::Value &)> callback);
+
 private:
+    enum class OpKind { Upsert, AclOnly, Delete };
+
+    struct PendingOp {
+        OpKind kind{OpKind::Upsert};
+        std::string title;
+        std::string content;
+        int attempts{0};
+        std::chrono::steady_clock::time_point notBefore;  // 重试退避期间不参与 flush
+    };
+
+    struct TaskRecord {
+        int64_t taskUid{0};
+        std::string type;  // upsert / acl / delete / acl_backfill / acl_cleanup
+        size_t documents{0};
+        std::chrono::system_clock::time_point enqueuedAt;
+    };
+
+    // 将操作放入队列；同一 docId 的待处理操作按规则合并
+    static void enqueue(int docId, PendingOp op);
+    // 启动后台定时 flush（首次入队时调用一次）
+    static void ensureStarted();
+    // 取出一批到期的操作发送给 Meilisearch
+    static void flush();
+    // 发送失败：未被新操作覆盖的放回队列并退避（被仅 ACL 的更新覆盖时升级为整篇写入），超过重试次数的丢弃
+    static void requeue(std::vector<std::pair<int, PendingOp>> &&ops);
+    // 记录 Meilisearch 返回的任务
+    static void recordTask(const drogon::HttpResponsePtr &resp, const std::string &type, size_t documents);
+
+    // 批量查询文档的 owner_id 与可访问用户列表，结果按 docId 索引
+    static void loadAcl(const std::vector<int64_t> &docIds,
+                        std::function<void(const std::unordered_map<int, Json::Value> &)> callback,
+                        std::function<void(const std::string &)> errorCallback);
+    // 部分更新 ACL 字段，并清理因此误建的只有 ACL 字段的文档
+    static void sendAclUpdate(const Json::Value &documents, const std::string &taskType,
+                              std::function<void(bool)> onDone);
+    // 分批为已有文档补齐 ACL 字段（按 id 递增翻页）
+    static void backfillAcl(int afterDocId);
+    // 按数据库分批校对本地索引（按 id 递增翻页，经队列写入）：补齐缺失或 since（Unix 秒）之后更新过的文档，
+    // 修正 ACL 不一致的文档，最后删除 unseen 中剩余（数据库中已不存在）的文档
+    static void reconcileLocalIndex(int afterDocId, int64_t since, std::shared_ptr<std::unordered_set<int>> unseen);
+    // 发送一次索引写入请求，onDone 参数表示是否成功（2xx）
+    static void sendIndexRequest(drogon::HttpMethod method, const std::string &path, const std::string &body,
+                                 const std::string &taskType, size_t documents, std::function<void(bool)> onDone);
+
+    // 索引写入共用的 HTTP 客户端（保持长连接）
+    static drogon::HttpClientPtr indexClient();
+
+    // 是否使用本地索引（app.search_engine = "local"）
+    static bool useLocalEngine();
     static std::string getMeilisearchUrl();
     static std::string getMasterKey();
-};
\ No newline at end of file
+
+    static std::mutex mutex_;                                // 保护 pending_、flushing_、recentTasks_
+    static std::unordered_map<int, PendingOp> pending_;      // docId -> 待处理操作
+    static bool flushing_;                                   // 是否有批次正在发送
+    static std::deque<TaskRecord> recentTasks_;              // 最近的 Meilisearch 任务
+    static std::atomic_size_t indexedCount_;                 // 已提交写入的文档数
+    static std::atomic_size_t deletedCount_;                 // 已提交删除的文档数
+    static std::atomic_size_t retriedCount_;                 // 重试次数
+    static std::atomic_size_t failedCount_;                  // 超过重试次数被丢弃的操作数
+    static std::atomic_size_t batchCount_;                   // 已发送的批次数
+};
@@ -0,0 +1,113 @@
+#include "UserActivityStats.h"
+
+#include <drogon/drogon.h>
+#include <json/json.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "../utils/ConfigUtils.h"
+#include "../utils/DbTransaction.h"
+
+namespace {
+// $1 上一批最后的用户 id, $2 批大小 -> last_id（本批最后的用户 id，没有更多用户时为 NULL）
+const char* const kReconcileRangeSql =
+        "SELECT MAX(id) AS last_id FROM (SELECT id FROM \"user\" WHERE id > $1::bigint ORDER BY id "
+        "LIMIT $2::integer) b";
+
+// 以下三条的参数均为 $1 < user_id <= $2：补齐缺失的计数行，按 user_id 顺序锁定计数行，
+// 再按源表重新统计并只写入不一致的行 -> 被校正的 user_id
+const char* const kReconcileEnsureRowsSql =
+        "INSERT INTO user_activity_stats (user_id) "
+        "SELECT id FROM \"user\" WHERE id > $1::bigint AND id <= $2::bigint "
+        "ON CONFLICT (user_id) DO NOTHING";
+
+const char* const kReconcileLockRowsSql =
+        "SELECT user_id FROM user_activity_stats WHERE user_id > $1::bigint AND user_id <= $2::bigint "
+        "ORDER BY user_id FOR UPDATE";
+
+const char* const kReconcileUpdateSql =
+        "UPDATE user_activity_stats s "
+        "SET document_count = n.documents, comment_count = n.comments, completed_task_count = n.tasks, "
+        "    updated_at = NOW() "
+        "FROM (SELECT u.id, "
+        "             (SELECT COUNT(*) FROM document d WHERE d.owner_id = u.id) AS documents, "
+        "             (SELECT COUNT(*) FROM comment c WHERE c.author_id = u.id) AS comments, "
+        "             (SELECT COUNT(*) FROM task t WHERE t.created_by = u.id AND t.status = 'done') AS tasks "
+        "      FROM \"user\" u WHERE u.id > $1::bigint AND u.id <= $2::bigint) n "
+        "WHERE s.user_id = n.id "
+        "  AND (s.document_count, s.comment_count, s.completed_task_count) "
+        "      IS DISTINCT FROM (n.documents, n.comments, n.tasks) "
+        "RETURNING s.user_id";
+
+// 每个事务校正的用户数：只锁定这些用户的计数行，其余用户的触发器增量不受影响
+constexpr int kReconcileBatch = 500;
+
+std::atomic_bool running{false};
+
+}  // namespace
+
+void UserActivityStats::start() {
+    long minutes = 60;
+    try {
+        minutes = std::stol(ConfigUtils::getValue("user_stats_reconcile_minutes", "60"));
+    } catch (...) {
+    }
+    if (minutes <= 0) {
+        LOG_INFO << "[UserActivityStats] Periodic reconciliation disabled by config";
+        return;
+    }
+    drogon::app().getLoop()->runEvery(static_cast<double>(minutes) * 60, []() { reconcile(); });
+}
+
+void UserActivityStats::reconcile() {
+    if (running.exchange(true)) return;
+    reconcileBatch(0, std::make_shared<size_t>(0));
+}
+
+void UserActivityStats::reconcileBatch(int64_t afterUserId, std::shared_ptr<size_t> corrected) {
+    auto db = drogon::app().getDbClient();
+    if (!db) {
+        running = false;
+        return;
+    }
+    auto fail = [](const std::string& message) {
+        LOG_ERROR << "[UserActivityStats] Reconciliation failed: " << message;
+        running = false;
+    };
+
+    // 1.确定本批的用户 id 范围（事务外查询，事务内的语句可以一次性排队）
+    db->execSqlAsync(
+            kReconcileRangeSql,
+            [db, afterUserId, corrected, fail](const drogon::orm::Result& r) {
+                if (r.empty() || r[0]["last_id"].isNull()) {
+                    if (*corrected > 0) LOG_INFO << "[UserActivityStats] Reconciled " << *corrected << " users";
+                    running = false;
+                    return;
+                }
+                int64_t lastUserId = r[0]["last_id"].as<int64_t>();
+                std::string from = std::to_string(afterUserId);
+                std::string to = std::to_string(lastUserId);
+                DbTransaction::begin(
+                        db,
+                        [=](const std::shared_ptr<DbTransaction>& tx) {
+                            // 等不到行锁时放弃本轮，避免排在长事务之后
+                            tx->exec("SET LOCAL lock_timeout = '5s'", nullptr);
+                            // 2.锁定本批的计数行：已提交的增量都已可见，未提交的写入在触发器处等待本事务提交，
+                            //   之后的统计语句（READ COMMITTED 下取新快照）与这些行的当前值一致，不会覆盖并发增量
+                            tx->exec(kReconcileEnsureRowsSql, nullptr, from, to);
+                            tx->exec(kReconcileLockRowsSql, nullptr, from, to);
+                            // 3.按源表重新统计，只写入不一致的行
+                            tx->exec(
+                                    kReconcileUpdateSql,
+                                    [corrected](const drogon::orm::Result& updated) { *corrected += updated.size(); },
+                                    from, to);
+                            tx->commit([lastUserId, corrected]() { reconcileBatch(lastUserId, corrected); });
+                        },
+                        [fail](const std::string& message, drogon::HttpStatusCode) { fail(message); });
+            },
+            [fail](const drogon::orm::DrogonDbException& e) { fail(e.base().what()); },
+            std::to_string(afterUserId), std::to_string(kReconcileBatch));
+}
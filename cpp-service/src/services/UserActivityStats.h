@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/**
+ * UserActivityStats 负责 user_activity_stats（管理员用户列表中的文档数、评论数、已完成任务数）的定期校正。
+ *
+ * 计数本身由 document / comment / task 上的触发器在同一事务内增量维护；
+ * 校正按源表重新统计一次，只改写不一致的行，用于修复绕过触发器的写入（如手工导入、禁用触发器的维护操作）。
+ * 校正按用户 id 分批，每批一个事务：先锁定这批用户的计数行（等待进行中的写事务提交，新的写入等到本批提交），
+ * 再重新统计，避免用旧快照覆盖并发的增量；不锁整张表，每批只按索引统计这批用户的数据。
+ * 间隔为 app.user_stats_reconcile_minutes 分钟，0 表示不做定期校正。
+ */
+class UserActivityStats {
+public:
+    // 启动定期校正（在 app 启动后调用一次）
+    static void start();
+
+    // 立即执行一次校正；上一次尚未结束时直接返回
+    static void reconcile();
+
+private:
+    // 校正 afterUserId 之后的一批用户，完成后继续下一批；corrected 累计被校正的用户数
+    static void reconcileBatch(int64_t afterUserId, std::shared_ptr<size_t> corrected);
+};
@@ -0,0 +1,164 @@
+#include "UserSearchCache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include "../repositories/StatementRegistry.h"
+#include "../utils/ConfigUtils.h"
+
+namespace {
+struct Entry {
+    Json::Value users;
+    bool complete{false};
+    std::chrono::steady_clock::time_point expiresAt;
+    std::list<std::string>::iterator lru;
+};
+
+struct CacheState {
+    std::mutex mutex;
+    bool loaded{false};
+    std::chrono::seconds ttl{30};
+    std::unordered_map<std::string, Entry> entries;
+    std::list<std::string> lru;  // 最近使用的在前
+    std::atomic_size_t hits{0};
+    std::atomic_size_t prefixHits{0};
+    std::atomic_size_t misses{0};
+};
+
+CacheState& cache() {
+    static CacheState state;
+    return state;
+}
+
+// 首次使用时读取配置（要求持有锁）
+void ensureLoadedLocked() {
+    auto& state = cache();
+    if (state.loaded) return;
+    state.loaded = true;
+    try {
+        long seconds = std::stol(ConfigUtils::getValue("user_search_cache_ttl_seconds", "30"));
+        state.ttl = std::chrono::seconds(std::max(0L, seconds));
+    } catch (...) {
+        state.ttl = std::chrono::seconds(30);
+    }
+}
+
+bool isAscii(const std::string& value) {
+    return std::all_of(value.begin(), value.end(), [](char c) { return static_cast<unsigned char>(c) < 0x80; });
+}
+
+bool isDigits(const std::string& value) {
+    return !value.empty() && std::all_of(value.begin(), value.end(), [](char c) { return c >= '0' && c <= '9'; });
+}
+
+// ASCII 大小写不敏感的子串匹配（needle 已是小写）
+bool containsIgnoreCase(const std::string& haystack, const std::string& needle) {
+    auto it = std::search(haystack.begin(), haystack.end(), needle.begin(), needle.end(),
+                          [](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) == b; });
+    return it != haystack.end();
+}
+
+// 取出未过期的条目并刷新最近使用顺序（要求持有锁）
+const Entry* findLocked(const std::string& key, std::chrono::steady_clock::time_point now) {
+    auto& state = cache();
+    auto it = state.entries.find(key);
+    if (it == state.entries.end()) return nullptr;
+    if (it->second.expiresAt <= now) {
+        state.lru.erase(it->second.lru);
+        state.entries.erase(it);
+        return nullptr;
+    }
+    state.lru.splice(state.lru.begin(), state.lru, it->second.lru);
+    return &it->second;
+}
+
+void storeLocked(const std::string& key, Json::Value users, bool complete, std::chrono::steady_clock::time_point now) {
+    auto& state = cache();
+    auto it = state.entries.find(key);
+    if (it == state.entries.end()) {
+        state.lru.push_front(key);
+        it = state.entries.emplace(key, Entry{}).first;
+        it->second.lru = state.lru.begin();
+    } else {
+        state.lru.splice(state.lru.begin(), state.lru, it->second.lru);
+    }
+    it->second.users = std::move(users);
+    it->second.complete = complete;
+    it->second.expiresAt = now + state.ttl;
+    while (state.entries.size() > UserSearchCache::kMaxEntries) {
+        state.entries.erase(state.lru.back());
+        state.lru.pop_back();
+    }
+}
+}  // namespace
+
+bool UserSearchCache::lookup(const std::string& query, Json::Value& users, bool& complete) {
+    auto& state = cache();
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    ensureLoadedLocked();
+    if (state.ttl.count() == 0) return false;
+
+    if (const Entry* entry = findLocked(query, now)) {
+        users = entry->users;
+        complete = entry->complete;
+        ++state.hits;
+        return true;
+    }
+
+    if (query.size() > 1 && isAscii(query) && !isDigits(query)) {
+        for (size_t length = query.size() - 1; length >= StatementRegistry::kUserSearchMinSubstring; --length) {
+            const Entry* prefix = findLocked(query.substr(0, length), now);
+            if (!prefix || !prefix->complete) continue;
+            Json::Value filtered(Json::arrayValue);
+            for (const auto& user : prefix->users) {
+                if (containsIgnoreCase(user["email"].asString(), query) ||
+                    containsIgnoreCase(user["profile"]["nickname"].asString(), query)) {
+                    filtered.append(user);
+                }
+            }
+            users = filtered;
+            complete = true;
+            // 派生结果的有效期不超过来源条目
+            auto expiresAt = prefix->expiresAt;
+            storeLocked(query, std::move(filtered), true, now);
+            state.entries[query].expiresAt = expiresAt;
+            ++state.prefixHits;
+            return true;
+        }
+    }
+    ++state.misses;
+    return false;
+}
+
+void UserSearchCache::store(const std::string& query, const Json::Value& users, bool complete) {
+    auto& state = cache();
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    ensureLoadedLocked();
+    if (state.ttl.count() == 0) return;
+
+    Json::Value rows(Json::arrayValue);
+    for (Json::ArrayIndex i = 0; i < users.size() && i < kRowsPerEntry; ++i) {
+        rows.append(users[i]);
+    }
+    storeLocked(query, std::move(rows), complete && users.size() <= kRowsPerEntry, now);
+}
+
+Json::Value UserSearchCache::getStats() {
+    auto& state = cache();
+    Json::Value stats;
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        stats["entries"] = static_cast<Json::UInt64>(state.entries.size());
+    }
+    stats["hits"] = static_cast<Json::UInt64>(state.hits.load());
+    stats["prefix_hits"] = static_cast<Json::UInt64>(state.prefixHits.load());
+    stats["misses"] = static_cast<Json::UInt64>(state.misses.load());
+    return stats;
+}
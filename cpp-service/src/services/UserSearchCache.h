@@ -0,0 +1,34 @@
+#pragma once
+#include <json/json.h>
+
+#include <cstddef>
+#include <string>
+
+/**
+ * UserSearchCache 是用户搜索（GET /api/users/search，分享对话框的输入联想）的进程内缓存。
+ *
+ * - 每个条目保存一个关键词按 id 排序的前 kRowsPerEntry 个结果，以及这是否已是全部结果（complete）；
+ * - 关键词未命中时，若它的某个前缀已有完整结果，直接在内存中按邮箱 / 昵称过滤得到结果，不再查库：
+ *   继续输入时结果只会变少，完整的前缀结果必然包含新关键词的全部结果；
+ *   单个字符的关键词按前缀而不是子串匹配，不作为过滤来源；
+ * - 纯数字关键词还会按用户 ID 匹配，结果不是前缀结果的子集，只做精确命中；
+ *   含非 ASCII 字符的关键词与数据库 ILIKE 的大小写规则可能不一致，同样只做精确命中；
+ * - 条目在 app.user_search_cache_ttl_seconds 秒后过期（0 表示不缓存），超过 kMaxEntries 个时淘汰最久未用的。
+ *
+ * 所有方法线程安全。
+ */
+class UserSearchCache {
+public:
+    // 每个条目缓存的结果数；分页范围超出时调用方直接查库
+    static constexpr size_t kRowsPerEntry = 100;
+    static constexpr size_t kMaxEntries = 1024;
+
+    // 查找关键词（已转为小写）的结果；命中时返回 true，users 按 id 排序
+    static bool lookup(const std::string& query, Json::Value& users, bool& complete);
+
+    // 保存关键词的结果（最多 kRowsPerEntry 个）
+    static void store(const std::string& query, const Json::Value& users, bool complete);
+
+    // 条目数、命中 / 前缀命中 / 未命中次数
+    static Json::Value getStats();
+};
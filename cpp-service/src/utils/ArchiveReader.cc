@@ -0,0 +1,275 @@
+#include "ArchiveReader.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+
+namespace {
+constexpr uint32_t kZipLocalSignature = 0x04034b50;
+constexpr uint32_t kZipCentralSignature = 0x02014b50;
+constexpr uint32_t kZipEndSignature = 0x06054b50;
+constexpr size_t kZipEndSize = 22;
+constexpr size_t kTarBlock = 512;
+
+uint16_t get16(std::string_view data, size_t pos) {
+    return static_cast<uint16_t>(static_cast<unsigned char>(data[pos]) |
+                                 (static_cast<unsigned char>(data[pos + 1]) << 8));
+}
+
+uint32_t get32(std::string_view data, size_t pos) {
+    return static_cast<uint32_t>(get16(data, pos)) | (static_cast<uint32_t>(get16(data, pos + 2)) << 16);
+}
+
+// tar 头部中的数字字段：八进制文本，或首字节最高位为 1 的 base-256 编码
+bool tarNumber(std::string_view field, uint64_t& value) {
+    value = 0;
+    if (!field.empty() && (static_cast<unsigned char>(field[0]) & 0x80)) {
+        for (size_t i = 1; i < field.size(); ++i) value = (value << 8) | static_cast<unsigned char>(field[i]);
+        return true;
+    }
+    size_t i = 0;
+    while (i < field.size() && field[i] == ' ') ++i;
+    bool digits = false;
+    for (; i < field.size() && field[i] >= '0' && field[i] <= '7'; ++i) {
+        value = value * 8 + static_cast<uint64_t>(field[i] - '0');
+        digits = true;
+    }
+    return digits || i == field.size() || field[i] == '\0';
+}
+
+// 以 NUL 结尾的定长字段
+std::string tarString(std::string_view field) {
+    size_t end = field.find('\0');
+    return std::string(field.substr(0, end == std::string_view::npos ? field.size() : end));
+}
+
+bool tarChecksumValid(std::string_view header) {
+    uint64_t expected;
+    if (!tarNumber(header.substr(148, 8), expected)) return false;
+    uint64_t sum = 0;
+    for (size_t i = 0; i < kTarBlock; ++i) {
+        sum += (i >= 148 && i < 156) ? ' ' : static_cast<unsigned char>(header[i]);
+    }
+    return sum == expected;
+}
+
+// pax 扩展头中的 path 记录（"长度 path=值\n"）
+std::string paxPath(std::string_view records) {
+    size_t pos = 0;
+    while (pos < records.size()) {
+        size_t space = records.find(' ', pos);
+        if (space == std::string_view::npos) break;
+        size_t length = 0;
+        for (size_t i = pos; i < space; ++i) {
+            if (records[i] < '0' || records[i] > '9') return "";
+            length = length * 10 + static_cast<size_t>(records[i] - '0');
+        }
+        if (length == 0 || pos + length > records.size()) break;
+        std::string_view record = records.substr(space + 1, pos + length - space - 1);
+        if (!record.empty() && record.back() == '\n') record.remove_suffix(1);
+        if (record.compare(0, 5, "path=") == 0) return std::string(record.substr(5));
+        pos += length;
+    }
+    return "";
+}
+}  // namespace
+
+bool ArchiveReader::open(std::string_view data, std::string& error) {
+    data_ = data;
+    entries_.clear();
+    if (data.size() >= 4 && data.compare(0, 2, "PK") == 0) return openZip(error);
+    if (data.size() >= 2 && static_cast<unsigned char>(data[0]) == 0x1f && static_cast<unsigned char>(data[1]) == 0x8b) {
+        error = "Compressed tar archives are not supported, please upload a .zip or an uncompressed .tar";
+        return false;
+    }
+    if (data.size() >= kTarBlock && data.compare(257, 5, "ustar") == 0) return openTar(error);
+    // 旧式 tar 没有 magic，只能靠校验和识别
+    if (data.size() >= kTarBlock && data.size() % kTarBlock == 0 && tarChecksumValid(data.substr(0, kTarBlock))) {
+        return openTar(error);
+    }
+    error = "Unrecognized archive format, please upload a .zip or .tar file";
+    return false;
+}
+
+bool ArchiveReader::openZip(std::string& error) {
+    if (data_.size() < kZipEndSize) {
+        error = "Corrupted ZIP archive";
+        return false;
+    }
+    // 结尾记录之后最多有 65535 字节的注释
+    size_t end = std::string_view::npos;
+    size_t lowest = data_.size() > kZipEndSize + 0xFFFF ? data_.size() - kZipEndSize - 0xFFFF : 0;
+    for (size_t pos = data_.size() - kZipEndSize + 1; pos-- > lowest;) {
+        if (get32(data_, pos) == kZipEndSignature) {
+            end = pos;
+            break;
+        }
+    }
+    if (end == std::string_view::npos) {
+        error = "Corrupted ZIP archive: end of central directory not found";
+        return false;
+    }
+    uint16_t count = get16(data_, end + 10);
+    uint32_t centralSize = get32(data_, end + 12);
+    uint32_t centralOffset = get32(data_, end + 16);
+    if (count == 0xFFFF || centralSize == 0xFFFFFFFF || centralOffset == 0xFFFFFFFF) {
+        error = "ZIP64 archives are not supported";
+        return false;
+    }
+    if (static_cast<uint64_t>(centralOffset) + centralSize > end) {
+        error = "Corrupted ZIP archive: invalid central directory";
+        return false;
+    }
+
+    size_t pos = centralOffset;
+    for (uint16_t i = 0; i < count; ++i) {
+        if (pos + 46 > end || get32(data_, pos) != kZipCentralSignature) {
+            error = "Corrupted ZIP archive: invalid central directory entry";
+            return false;
+        }
+        uint16_t flags = get16(data_, pos + 8);
+        Entry entry;
+        entry.method = get16(data_, pos + 10);
+        entry.crc = get32(data_, pos + 16);
+        entry.hasCrc = true;
+        entry.storedSize = get32(data_, pos + 20);
+        entry.size = get32(data_, pos + 24);
+        uint16_t nameLength = get16(data_, pos + 28);
+        uint16_t extraLength = get16(data_, pos + 30);
+        uint16_t commentLength = get16(data_, pos + 32);
+        uint32_t localOffset = get32(data_, pos + 42);
+        if (pos + 46 + nameLength > end) {
+            error = "Corrupted ZIP archive: invalid central directory entry";
+            return false;
+        }
+        entry.name = std::string(data_.substr(pos + 46, nameLength));
+        std::replace(entry.name.begin(), entry.name.end(), '\\', '/');
+        entry.directory = !entry.name.empty() && entry.name.back() == '/';
+        entry.supported = !(flags & 0x0001) && (entry.method == 0 || entry.method == 8);
+        pos += 46 + nameLength + extraLength + commentLength;
+
+        // 正文位置以本地文件头为准（其扩展字段长度可能与中央目录不同）
+        if (static_cast<uint64_t>(localOffset) + 30 > data_.size() ||
+            get32(data_, localOffset) != kZipLocalSignature) {
+            error = "Corrupted ZIP archive: invalid local header for " + entry.name;
+            return false;
+        }
+        entry.dataOffset = localOffset + 30 + get16(data_, localOffset + 26) + get16(data_, localOffset + 28);
+        if (entry.dataOffset + entry.storedSize > data_.size()) {
+            error = "Corrupted ZIP archive: truncated data for " + entry.name;
+            return false;
+        }
+        entries_.push_back(std::move(entry));
+    }
+    return true;
+}
+
+bool ArchiveReader::openTar(std::string& error) {
+    size_t pos = 0;
+    std::string pendingName;  // GNU 长文件名 / pax path，作用于下一个条目
+    while (pos + kTarBlock <= data_.size()) {
+        std::string_view header = data_.substr(pos, kTarBlock);
+        if (header.find_first_not_of('\0') == std::string_view::npos) break;  // 结束块
+        if (!tarChecksumValid(header)) {
+            error = "Corrupted tar archive: checksum mismatch";
+            return false;
+        }
+        uint64_t size;
+        if (!tarNumber(header.substr(124, 12), size)) {
+            error = "Corrupted tar archive: invalid size field";
+            return false;
+        }
+        size_t dataOffset = pos + kTarBlock;
+        // base-256 编码的 size 可以接近 2^64，先比较剩余长度，避免 dataOffset + size 回绕
+        if (size > data_.size() - dataOffset) {
+            error = "Corrupted tar archive: truncated data";
+            return false;
+        }
+        char type = header[156];
+        std::string_view body = data_.substr(dataOffset, size);
+        size_t next = dataOffset + (size + kTarBlock - 1) / kTarBlock * kTarBlock;
+        if (next <= pos) {
+            error = "Corrupted tar archive: invalid entry size";
+            return false;
+        }
+        pos = next;
+
+        if (type == 'L') {
+            pendingName = tarString(body);
+            continue;
+        }
+        if (type == 'x') {
+            std::string path = paxPath(body);
+            if (!path.empty()) pendingName = path;
+            continue;
+        }
+        if (type == 'g') continue;
+
+        Entry entry;
+        if (!pendingName.empty()) {
+            entry.name = std::move(pendingName);
+            pendingName.clear();
+        } else {
+            entry.name = tarString(header.substr(0, 100));
+            if (header.compare(257, 5, "ustar") == 0) {
+                std::string prefix = tarString(header.substr(345, 155));
+                if (!prefix.empty()) entry.name = prefix + "/" + entry.name;
+            }
+        }
+        entry.directory = type == '5';
+        // 只读取普通文件，链接、设备等条目标记为不支持
+        entry.supported = type == '0' || type == '\0' || type == '7' || entry.directory;
+        entry.size = size;
+        entry.storedSize = size;
+        entry.dataOffset = dataOffset;
+        entries_.push_back(std::move(entry));
+    }
+    return true;
+}
+
+bool ArchiveReader::read(const Entry& entry, std::string& out, uint64_t maxBytes, std::string& error) const {
+    out.clear();
+    if (!entry.supported || entry.directory) {
+        error = "Unsupported archive entry";
+        return false;
+    }
+    if (entry.size > maxBytes) {
+        error = "File exceeds size limit";
+        return false;
+    }
+    std::string_view stored = data_.substr(entry.dataOffset, entry.storedSize);
+    if (entry.method == 0) {
+        if (stored.size() != entry.size) {
+            error = "Corrupted archive entry";
+            return false;
+        }
+        out.assign(stored.data(), stored.size());
+    } else if (entry.size > 0) {
+        // 以目录中记录的大小为准分配输出，解压结果必须恰好填满
+        z_stream stream{};
+        if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+            error = "Failed to initialize decompression";
+            return false;
+        }
+        out.resize(entry.size);
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(stored.data()));
+        stream.avail_in = static_cast<uInt>(stored.size());
+        stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+        stream.avail_out = static_cast<uInt>(out.size());
+        int result = inflate(&stream, Z_FINISH);
+        bool complete = result == Z_STREAM_END && stream.total_out == entry.size;
+        inflateEnd(&stream);
+        if (!complete) {
+            out.clear();
+            error = "Corrupted archive entry";
+            return false;
+        }
+    }
+    if (entry.hasCrc &&
+        crc32(0L, reinterpret_cast<const Bytef*>(out.data()), static_cast<uInt>(out.size())) != entry.crc) {
+        out.clear();
+        error = "Archive entry checksum mismatch";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * ArchiveReader 读取内存中的 ZIP 或 tar 归档（批量导入使用）。
+ *
+ * - open 只解析目录，不解压；条目正文由 read 按需解压，read 为 const，可在多个线程上并发调用；
+ * - ZIP 支持 store / deflate，解压后校验长度与 CRC；不支持 ZIP64 与加密条目；
+ * - tar 支持 ustar 前缀、GNU 长文件名与 pax path 记录；不支持 gzip 压缩的 tar；
+ * - 归档数据由调用方持有，ArchiveReader 存续期间必须保持有效。
+ */
+class ArchiveReader {
+public:
+    struct Entry {
+        std::string name;
+        uint64_t size{0};        // 解压后大小
+        bool directory{false};
+        bool supported{true};    // 加密或压缩方式不支持时为 false
+
+        uint64_t dataOffset{0};
+        uint64_t storedSize{0};  // 归档中的大小（压缩后）
+        uint16_t method{0};      // 0 store，8 deflate
+        uint32_t crc{0};
+        bool hasCrc{false};
+    };
+
+    // 解析归档目录；格式无法识别或目录损坏时返回 false 并给出原因
+    bool open(std::string_view data, std::string& error);
+
+    const std::vector<Entry>& entries() const { return entries_; }
+
+    // 读取条目正文；解压后超过 maxBytes 或数据损坏时返回 false
+    bool read(const Entry& entry, std::string& out, uint64_t maxBytes, std::string& error) const;
+
+private:
+    bool openZip(std::string& error);
+    bool openTar(std::string& error);
+
+    std::string_view data_;
+    std::vector<Entry> entries_;
+};
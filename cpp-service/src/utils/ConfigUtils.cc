@@ -0,0 +1,44 @@
+#include "ConfigUtils.h"
+
+#include <unistd.h>  // for access()
+
+#include <fstream>
+
+namespace {
+Json::Value loadConfigFile() {
+    std::string configPath = "config.json";
+    if (access("config.json", F_OK) != 0) {
+        configPath = "../config.json";
+    }
+
+    Json::Value root;
+    std::ifstream file(configPath);
+    if (!file.is_open()) {
+        return root;
+    }
+    Json::CharReaderBuilder builder;
+    std::string errs;
+    if (!Json::parseFromStream(builder, file, &root, &errs)) {
+        return Json::Value();
+    }
+    return root;
+}
+}  // namespace
+
+const Json::Value& ConfigUtils::root() {
+    static const Json::Value config = loadConfigFile();
+    return config;
+}
+
+std::string ConfigUtils::getValue(const std::string& key, const std::string& defaultValue) {
+    const Json::Value& app = root()["app"];
+    if (!app.isObject() || !app.isMember(key)) {
+        return defaultValue;
+    }
+    try {
+        return app[key].asString();
+    } catch (...) {
+        // 数组 / 对象无法转为字符串
+        return defaultValue;
+    }
+}
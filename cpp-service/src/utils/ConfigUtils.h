@@ -0,0 +1,22 @@
+#pragma once
+
+#include <json/json.h>
+
+#include <string>
+
+/**
+ * 读取 config.json（当前目录不存在时查找上一级目录）。
+ * 文件只在首次调用时解析一次，之后从内存返回；读取或解析失败时视为空配置。
+ */
+class ConfigUtils {
+public:
+    /**
+     * 整个配置文件
+     */
+    static const Json::Value& root();
+
+    /**
+     * app 节点下的配置值（数字、布尔值转为字符串），不存在时返回 defaultValue
+     */
+    static std::string getValue(const std::string& key, const std::string& defaultValue = "");
+};
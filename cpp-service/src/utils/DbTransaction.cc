@@ -0,0 +1,49 @@
+#include "DbTransaction.h"
+
+#include <drogon/drogon.h>
+
+void DbTransaction::begin(const drogon::orm::DbClientPtr& db,
+                          std::function<void(const std::shared_ptr<DbTransaction>&)> onReady, ErrorHandler onError) {
+    if (!db) {
+        onError("Database not available", drogon::k500InternalServerError);
+        return;
+    }
+
+    std::shared_ptr<DbTransaction> tx(new DbTransaction(onError));
+    db->newTransactionAsync([tx, onReady = std::move(onReady)](const std::shared_ptr<drogon::orm::Transaction>& trans) {
+        if (!trans) {
+            tx->fail("Failed to start transaction", drogon::k500InternalServerError);
+            return;
+        }
+        tx->trans_ = trans;
+        onReady(tx);
+    });
+}
+
+void DbTransaction::rollback(const std::string& message, drogon::HttpStatusCode code) { fail(message, code); }
+
+void DbTransaction::commit(std::function<void()> onCommitted) {
+    if (finished_ || !trans_) return;
+    auto self = shared_from_this();
+    trans_->setCommitCallback([self, onCommitted = std::move(onCommitted)](bool committed) {
+        if (self->finished_) return;
+        self->finished_ = true;
+        if (committed) {
+            onCommitted();
+        } else {
+            self->onError_("Transaction commit failed", drogon::k500InternalServerError);
+        }
+    });
+    // drogon 在最后一个引用释放、已排队语句执行完后发送 COMMIT
+    trans_.reset();
+}
+
+void DbTransaction::fail(const std::string& message, drogon::HttpStatusCode code) {
+    if (finished_) return;
+    finished_ = true;
+    if (trans_) {
+        trans_->rollback();
+        trans_.reset();
+    }
+    onError_(message, code);
+}
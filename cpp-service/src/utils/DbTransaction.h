@@ -0,0 +1,64 @@
+#pragma once
+#include <drogon/HttpTypes.h>
+#include <drogon/orm/DbClient.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+
+/**
+ * DbTransaction 是对 drogon 事务的轻量封装，用于多语句写操作。
+ *
+ * - exec 只负责排队：语句在同一事务连接上依次发送，不必等待上一条返回（流水线）；
+ *   语句之间没有数据依赖时可以一次性全部排队，省去逐条回调的往返。
+ * - 任一语句失败或调用 rollback，整个事务回滚，onError 只会被调用一次。
+ * - commit 在已排队的语句全部成功后提交，提交成功才调用 onCommitted，
+ *   因此通知推送、索引更新等副作用应放在 onCommitted 中。
+ *
+ * 项目使用 C++17，无法使用 drogon::Task/co_await，这里以回调方式提供同样的事务语义。
+ */
+class DbTransaction : public std::enable_shared_from_this<DbTransaction> {
+public:
+    using ResultHandler = std::function<void(const drogon::orm::Result&)>;
+    using ErrorHandler = std::function<void(const std::string& message, drogon::HttpStatusCode code)>;
+
+    // 开启事务，成功后调用 onReady；数据库不可用或开启失败时调用 onError。
+    static void begin(const drogon::orm::DbClientPtr& db,
+                      std::function<void(const std::shared_ptr<DbTransaction>&)> onReady, ErrorHandler onError);
+
+    // 排队执行一条语句；onResult 可为空。
+    template <typename... Args>
+    void exec(const std::string& sql, ResultHandler onResult, Args&&... args) {
+        if (finished_ || !trans_) return;
+        auto self = shared_from_this();
+        trans_->execSqlAsync(
+                sql,
+                [self, onResult = std::move(onResult)](const drogon::orm::Result& r) {
+                    if (self->finished_) return;
+                    if (onResult) onResult(r);
+                },
+                [self](const drogon::orm::DrogonDbException& e) {
+                    self->fail("Database error: " + std::string(e.base().what()), drogon::k500InternalServerError);
+                },
+                std::forward<Args>(args)...);
+    }
+
+    // 业务校验失败时主动回滚，并以给定的错误结束。
+    void rollback(const std::string& message, drogon::HttpStatusCode code);
+
+    // 已排队的语句全部执行后提交。调用后不能再 exec。
+    void commit(std::function<void()> onCommitted);
+
+    // 底层事务（drogon::orm::Transaction 本身也是 DbClient，可直接传给 Repository）。
+    drogon::orm::DbClientPtr client() const { return trans_; }
+
+private:
+    explicit DbTransaction(ErrorHandler onError) : onError_(std::move(onError)) {}
+
+    void fail(const std::string& message, drogon::HttpStatusCode code);
+
+    std::shared_ptr<drogon::orm::Transaction> trans_;
+    ErrorHandler onError_;
+    bool finished_{false};  // 已提交、回滚或出错
+};
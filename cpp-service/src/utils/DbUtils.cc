@@ -4,6 +4,31 @@
 
 drogon::orm::DbClientPtr DbUtils::getDbClient() { return drogon::app().getDbClient(); }
 
+std::string DbUtils::buildIntArrayLiteral(const std::vector<int64_t>& values) {
+    std::string literal = "{";
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (i > 0) literal += ",";
+        literal += std::to_string(values[i]);
+    }
+    literal += "}";
+    return literal;
+}
+
+std::string DbUtils::buildTextArrayLiteral(const std::vector<std::string>& values) {
+    std::string literal = "{";
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (i > 0) literal += ",";
+        literal += "\"";
+        for (char c : values[i]) {
+            if (c == '"' || c == '\\') literal += '\\';
+            literal += c;
+        }
+        literal += "\"";
+    }
+    literal += "}";
+    return literal;
+}
+
 void DbUtils::getUserByEmail(const std::string& email, std::function<void(const drogon::orm::Result&)> successCallback,
                              std::function<void(const drogon::orm::DrogonDbException&)> errorCallback) {
     auto db = getDbClient();
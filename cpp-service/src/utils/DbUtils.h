@@ -1,8 +1,11 @@
 #pragma once
 #include <drogon/orm/DbClient.h>
 
+#include <cstdint>
 #include <functional>
 #include <memory>
+#include <string>
+#include <vector>
 
 class DbUtils {
 public:
@@ -11,6 +14,12 @@ public:
 
     // 执行查询等需求 ......
 
+    // 构建 PostgreSQL 数组字面量（如 {1,2,3}），用于 unnest($n::bigint[]) 等批量参数
+    static std::string buildIntArrayLiteral(const std::vector<int64_t>& values);
+
+    // 构建文本数组字面量，元素统一加双引号并对引号、反斜杠转义
+    static std::string buildTextArrayLiteral(const std::vector<std::string>& values);
+
     // 查询单个用户（异步）
     static void getUserByEmail(const std::string& email,
                                std::function<void(const drogon::orm::Result&)> successCallback,
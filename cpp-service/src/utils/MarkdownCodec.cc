@@ -0,0 +1,2180 @@
+#include "MarkdownCodec.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+// ================= 通用工具 =================
+
+bool isAsciiSpace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v'; }
+
+bool isAsciiPunct(char c) {
+    unsigned char u = static_cast<unsigned char>(c);
+    return u < 0x80 && std::ispunct(u);
+}
+
+bool isBlank(const std::string& line) {
+    return std::all_of(line.begin(), line.end(), [](char c) { return c == ' ' || c == '\t'; });
+}
+
+size_t leadingSpaces(const std::string& line) {
+    size_t n = 0;
+    while (n < line.size() && line[n] == ' ') ++n;
+    return n;
+}
+
+std::string trim(const std::string& s) {
+    size_t begin = 0;
+    size_t end = s.size();
+    while (begin < end && isAsciiSpace(s[begin])) ++begin;
+    while (end > begin && isAsciiSpace(s[end - 1])) --end;
+    return s.substr(begin, end - begin);
+}
+
+std::string trimRight(const std::string& s) {
+    size_t end = s.size();
+    while (end > 0 && (s[end - 1] == ' ' || s[end - 1] == '\t')) --end;
+    return s.substr(0, end);
+}
+
+std::string toLower(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return s;
+}
+
+std::string escapeHtml(const std::string& text) {
+    std::string out;
+    out.reserve(text.size());
+    for (char c : text) {
+        switch (c) {
+            case '&':
+                out += "&amp;";
+                break;
+            case '<':
+                out += "&lt;";
+                break;
+            case '>':
+                out += "&gt;";
+                break;
+            case '"':
+                out += "&quot;";
+                break;
+            default:
+                out += c;
+        }
+    }
+    return out;
+}
+
+// 去掉反斜杠转义（链接地址、标题、代码块语言）
+std::string unescapeBackslash(const std::string& s) {
+    std::string out;
+    out.reserve(s.size());
+    for (size_t i = 0; i < s.size(); ++i) {
+        if (s[i] == '\\' && i + 1 < s.size() && isAsciiPunct(s[i + 1])) {
+            out += s[++i];
+        } else {
+            out += s[i];
+        }
+    }
+    return out;
+}
+
+// 链接地址：百分号编码空白与非 ASCII 字节，并屏蔽脚本协议
+std::string normalizeUrl(const std::string& url, bool image) {
+    std::string lower = toLower(trim(url));
+    if (lower.compare(0, 11, "javascript:") == 0 || lower.compare(0, 9, "vbscript:") == 0 ||
+        (lower.compare(0, 5, "data:") == 0 && !(image && lower.compare(0, 11, "data:image/") == 0))) {
+        return "";
+    }
+    static const char* const kHex = "0123456789ABCDEF";
+    std::string out;
+    for (size_t i = 0; i < url.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(url[i]);
+        bool validPercent = c == '%' && i + 2 < url.size() && std::isxdigit(static_cast<unsigned char>(url[i + 1])) &&
+                            std::isxdigit(static_cast<unsigned char>(url[i + 2]));
+        if (c <= 0x20 || c >= 0x7F || c == '"' || c == '<' || c == '>' || c == '\\' || c == '^' || c == '`' ||
+            c == '{' || c == '|' || c == '}' || (c == '%' && !validPercent)) {
+            out += '%';
+            out += kHex[c >> 4];
+            out += kHex[c & 0x0F];
+        } else if (c == '&') {
+            out += "&amp;";
+        } else {
+            out += static_cast<char>(c);
+        }
+    }
+    return out;
+}
+
+// 链接引用标签比较：去首尾空白、折叠内部空白、忽略大小写
+std::string normalizeLabel(const std::string& label) {
+    std::string out;
+    bool space = false;
+    for (char c : trim(label)) {
+        if (isAsciiSpace(c)) {
+            space = true;
+            continue;
+        }
+        if (space && !out.empty()) out += ' ';
+        space = false;
+        out += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return out;
+}
+
+std::string stripTags(const std::string& html) {
+    std::string out;
+    bool inTag = false;
+    for (char c : html) {
+        if (c == '<') {
+            inTag = true;
+        } else if (c == '>' && inTag) {
+            inTag = false;
+        } else if (!inTag) {
+            out += c;
+        }
+    }
+    return out;
+}
+
+struct LinkRef {
+    std::string url;
+    std::string title;
+};
+using RefMap = std::unordered_map<std::string, LinkRef>;
+
+// ================= 行内解析 =================
+
+// 同时未闭合的 '[' / '![' 最多记录这么多个，更深的按普通文本处理；
+// 链接在闭合时渲染其内容，嵌套层数有上限才能保证整体线性
+constexpr size_t kMaxBrackets = 32;
+// CommonMark 规定链接标签最长 999 个字符，更长的方括号文本不可能匹配引用定义
+constexpr size_t kMaxLabelLength = 999;
+// 链接地址中未配对括号的嵌套上限（与 cmark 相同），超过时不构成链接
+constexpr int kMaxLinkParens = 32;
+
+// 以 pos 处的 '<' 开始解析行内 HTML 标签，成功时返回结束位置（不含）。
+// missing 记录已确认其后不再出现的结束标记（如 "-->"），同一文本上反复调用时不必每次扫描到文末
+size_t scanInlineHtml(const std::string& s, size_t pos, std::unordered_set<std::string>* missing = nullptr) {
+    size_t n = s.size();
+    size_t p = pos + 1;
+    if (p >= n) return 0;
+    auto findEnd = [&](const char* marker, size_t from) -> size_t {
+        if (missing && missing->count(marker)) return 0;
+        size_t found = s.find(marker, from);
+        if (found == std::string::npos) {
+            if (missing) missing->insert(marker);
+            return 0;
+        }
+        return found + std::char_traits<char>::length(marker);
+    };
+    if (s.compare(p, 3, "!--") == 0) return findEnd("-->", p + 3);
+    if (s[p] == '?') return findEnd("?>", p + 1);
+    if (s.compare(p, 8, "![CDATA[") == 0) return findEnd("]]>", p + 8);
+    if (s[p] == '!' && p + 1 < n && std::isalpha(static_cast<unsigned char>(s[p + 1]))) return findEnd(">", p + 1);
+
+    bool closing = false;
+    if (s[p] == '/') {
+        closing = true;
+        ++p;
+    }
+    if (p >= n || !std::isalpha(static_cast<unsigned char>(s[p]))) return 0;
+    while (p < n && (std::isalnum(static_cast<unsigned char>(s[p])) || s[p] == '-')) ++p;
+    if (closing) {
+        while (p < n && isAsciiSpace(s[p])) ++p;
+        return p < n && s[p] == '>' ? p + 1 : 0;
+    }
+    // 属性
+    while (true) {
+        size_t ws = p;
+        while (p < n && isAsciiSpace(s[p])) ++p;
+        if (p >= n) return 0;
+        if (s[p] == '>') return p + 1;
+        if (s[p] == '/' && p + 1 < n && s[p + 1] == '>') return p + 2;
+        if (p == ws) return 0;  // 属性之间必须有空白
+        if (!(std::isalpha(static_cast<unsigned char>(s[p])) || s[p] == '_' || s[p] == ':')) return 0;
+        while (p < n && (std::isalnum(static_cast<unsigned char>(s[p])) || s[p] == '_' || s[p] == '.' || s[p] == ':' ||
+                         s[p] == '-')) {
+            ++p;
+        }
+        size_t q = p;
+        while (q < n && isAsciiSpace(s[q])) ++q;
+        if (q < n && s[q] == '=') {
+            ++q;
+            while (q < n && isAsciiSpace(s[q])) ++q;
+            if (q >= n) return 0;
+            if (s[q] == '"' || s[q] == '\'') {
+                size_t close = s.find(s[q], q + 1);
+                if (close == std::string::npos) return 0;
+                p = close + 1;
+            } else {
+                size_t start = q;
+                while (q < n && !isAsciiSpace(s[q]) && std::string("\"'=<>`").find(s[q]) == std::string::npos) ++q;
+                if (q == start) return 0;
+                p = q;
+            }
+        }
+    }
+}
+
+class InlineParser {
+public:
+    InlineParser(const std::string& src, const RefMap& refs) : src_(src), refs_(refs) {}
+
+    std::string render() {
+        size_t pos = 0;
+        while (pos < src_.size()) {
+            char c = src_[pos];
+            switch (c) {
+                case '\n':
+                    pos = lineBreak(pos);
+                    break;
+                case '\\':
+                    if (pos + 1 < src_.size() && src_[pos + 1] == '\n') {
+                        pushRaw("<br />\n");
+                        pos = skipLeadingSpaces(pos + 2);
+                    } else if (pos + 1 < src_.size() && isAsciiPunct(src_[pos + 1])) {
+                        pushText(escapeHtml(std::string(1, src_[pos + 1])));
+                        pos += 2;
+                    } else {
+                        pushText("\\");
+                        ++pos;
+                    }
+                    break;
+                case '`':
+                    pos = codeSpan(pos);
+                    break;
+                case '*':
+                case '_':
+                case '~':
+                    pos = delimiterRun(pos);
+                    break;
+                case '!':
+                    if (pos + 1 < src_.size() && src_[pos + 1] == '[') {
+                        openBracket(pos + 2, true, "![");
+                        pos += 2;
+                    } else {
+                        pushText("!");
+                        ++pos;
+                    }
+                    break;
+                case '[':
+                    openBracket(pos + 1, false, "[");
+                    ++pos;
+                    break;
+                case ']':
+                    pos = closeBracket(pos);
+                    break;
+                case '<':
+                    pos = angle(pos);
+                    break;
+                case '&':
+                    pos = entity(pos);
+                    break;
+                default: {
+                    size_t end = pos;
+                    while (end < src_.size() && std::string("\n\\`*_~![]<&").find(src_[end]) == std::string::npos) {
+                        ++end;
+                    }
+                    pushText(escapeHtml(src_.substr(pos, end - pos)));
+                    pos = end;
+                }
+            }
+        }
+        processEmphasis(0);
+        return renderRange(0, nodes_.size());
+    }
+
+private:
+    enum class Kind { Text, Raw, Delim };
+
+    struct Node {
+        Kind kind;
+        std::string text;  // Text / Raw 为已转义的 HTML
+        bool mergeable{true};
+        char ch{0};
+        int count{0};
+        int origCount{0};
+        bool canOpen{false};
+        bool canClose{false};
+        std::string openTags;   // 作为开分隔符时，剩余字符之后输出
+        std::string closeTags;  // 作为闭分隔符时，剩余字符之前输出
+    };
+
+    struct Bracket {
+        size_t nodeIndex;
+        size_t textStart;  // '[' 之后的原文位置
+        bool image;
+        bool active;
+    };
+
+    void pushText(const std::string& text) {
+        if (!nodes_.empty() && nodes_.back().kind == Kind::Text && nodes_.back().mergeable) {
+            nodes_.back().text += text;
+            return;
+        }
+        Node node;
+        node.kind = Kind::Text;
+        node.text = text;
+        nodes_.push_back(std::move(node));
+    }
+
+    void pushRaw(const std::string& html) {
+        Node node;
+        node.kind = Kind::Raw;
+        node.text = html;
+        nodes_.push_back(std::move(node));
+    }
+
+    size_t skipLeadingSpaces(size_t pos) const {
+        while (pos < src_.size() && src_[pos] == ' ') ++pos;
+        return pos;
+    }
+
+    // 行尾两个以上空格为硬换行，否则为软换行
+    size_t lineBreak(size_t pos) {
+        size_t spaces = 0;
+        if (!nodes_.empty() && nodes_.back().kind == Kind::Text) {
+            std::string& text = nodes_.back().text;
+            while (spaces < text.size() && text[text.size() - 1 - spaces] == ' ') ++spaces;
+            text.erase(text.size() - spaces);
+        }
+        if (spaces >= 2) {
+            pushRaw("<br />\n");
+        } else {
+            pushText("\n");
+        }
+        return skipLeadingSpaces(pos + 1);
+    }
+
+    size_t codeSpan(size_t pos) {
+        size_t run = 0;
+        while (pos + run < src_.size() && src_[pos + run] == '`') ++run;
+        size_t search = unmatchedRuns_.count(run) ? src_.size() : pos + run;
+        while (search < src_.size()) {
+            size_t open = src_.find('`', search);
+            if (open == std::string::npos) break;
+            size_t closeRun = 0;
+            while (open + closeRun < src_.size() && src_[open + closeRun] == '`') ++closeRun;
+            if (closeRun == run) {
+                std::string content = src_.substr(pos + run, open - pos - run);
+                std::replace(content.begin(), content.end(), '\n', ' ');
+                if (content.size() >= 2 && content.front() == ' ' && content.back() == ' ' &&
+                    content.find_first_not_of(' ') != std::string::npos) {
+                    content = content.substr(1, content.size() - 2);
+                }
+                pushRaw("<code>" + escapeHtml(content) + "</code>");
+                return open + closeRun;
+            }
+            search = open + closeRun;
+        }
+        // 之后同长度的反引号串也不会再有闭合串，不必重复扫描
+        unmatchedRuns_.insert(run);
+        pushText(std::string(run, '`'));
+        return pos + run;
+    }
+
+    size_t delimiterRun(size_t pos) {
+        char c = src_[pos];
+        size_t run = 0;
+        while (pos + run < src_.size() && src_[pos + run] == c) ++run;
+        if (c == '~' && run > 2) {
+            pushText(std::string(run, '~'));
+            return pos + run;
+        }
+        // 行首 / 行尾视为空白；非 ASCII 字节视为普通字符
+        char before = pos == 0 ? '\n' : src_[pos - 1];
+        char after = pos + run >= src_.size() ? '\n' : src_[pos + run];
+        bool beforeSpace = isAsciiSpace(before);
+        bool afterSpace = isAsciiSpace(after);
+        bool beforePunct = isAsciiPunct(before);
+        bool afterPunct = isAsciiPunct(after);
+        bool leftFlanking = !afterSpace && (!afterPunct || beforeSpace || beforePunct);
+        bool rightFlanking = !beforeSpace && (!beforePunct || afterSpace || afterPunct);
+
+        Node node;
+        node.kind = Kind::Delim;
+        node.ch = c;
+        node.count = node.origCount = static_cast<int>(run);
+        if (c == '_') {
+            node.canOpen = leftFlanking && (!rightFlanking || beforePunct);
+            node.canClose = rightFlanking && (!leftFlanking || afterPunct);
+        } else {
+            node.canOpen = leftFlanking;
+            node.canClose = rightFlanking;
+        }
+        nodes_.push_back(std::move(node));
+        return pos + run;
+    }
+
+    void openBracket(size_t textStart, bool image, const std::string& literal) {
+        // 超出上限时放弃最外层的括号（保持字面文本），内层的链接仍能匹配
+        if (brackets_.size() >= kMaxBrackets) brackets_.erase(brackets_.begin());
+        Node node;
+        node.kind = Kind::Text;
+        node.text = literal;
+        node.mergeable = false;
+        nodes_.push_back(std::move(node));
+        brackets_.push_back({nodes_.size() - 1, textStart, image, true});
+    }
+
+    bool parseLinkLabel(size_t pos, std::string& label, size_t& end) const {
+        // pos 指向 '['
+        for (size_t p = pos + 1; p < src_.size() && p - pos <= 1000; ++p) {
+            if (src_[p] == '\\' && p + 1 < src_.size()) {
+                ++p;
+            } else if (src_[p] == '[') {
+                return false;
+            } else if (src_[p] == ']') {
+                label = src_.substr(pos + 1, p - pos - 1);
+                end = p + 1;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool parseInlineLink(size_t pos, std::string& url, std::string& title, size_t& end) {
+        // pos 指向 '('
+        size_t n = src_.size();
+        size_t p = pos + 1;
+        auto skipSpace = [&]() {
+            while (p < n && isAsciiSpace(src_[p])) ++p;
+        };
+        skipSpace();
+        if (p < n && src_[p] == '<') {
+            size_t q = p + 1;
+            while (q < n && src_[q] != '>' && src_[q] != '\n' && src_[q] != '<') {
+                if (src_[q] == '\\' && q + 1 < n) ++q;
+                ++q;
+            }
+            if (q >= n || src_[q] != '>') return false;
+            url = src_.substr(p + 1, q - p - 1);
+            p = q + 1;
+        } else {
+            size_t q = p;
+            int depth = 0;
+            while (q < n && !isAsciiSpace(src_[q]) && static_cast<unsigned char>(src_[q]) >= 0x20) {
+                if (src_[q] == '\\' && q + 1 < n && isAsciiPunct(src_[q + 1])) {
+                    q += 2;
+                    continue;
+                }
+                if (src_[q] == '(' && ++depth > kMaxLinkParens) return false;
+                if (src_[q] == ')') {
+                    if (depth == 0) break;
+                    --depth;
+                }
+                ++q;
+            }
+            if (depth != 0) return false;
+            url = src_.substr(p, q - p);
+            p = q;
+        }
+        size_t beforeTitle = p;
+        skipSpace();
+        if (p < n && (src_[p] == '"' || src_[p] == '\'' || src_[p] == '(') && (p > beforeTitle || url.empty())) {
+            char close = src_[p] == '(' ? ')' : src_[p];
+            auto missing = unclosedTitleFrom_.find(close);
+            if (missing != unclosedTitleFrom_.end() && p >= missing->second) return false;
+            size_t q = p + 1;
+            while (q < n && src_[q] != close) {
+                if (src_[q] == '\\' && q + 1 < n) ++q;
+                ++q;
+            }
+            if (q >= n) {
+                // 其后的标题也找不到结束符
+                unclosedTitleFrom_[close] = p;
+                return false;
+            }
+            title = src_.substr(p + 1, q - p - 1);
+            p = q + 1;
+            skipSpace();
+        }
+        if (p >= n || src_[p] != ')') return false;
+        url = unescapeBackslash(url);
+        title = unescapeBackslash(title);
+        end = p + 1;
+        return true;
+    }
+
+    size_t closeBracket(size_t pos) {
+        if (brackets_.empty()) {
+            pushText("]");
+            return pos + 1;
+        }
+        Bracket bracket = brackets_.back();
+        if (!bracket.active) {
+            brackets_.pop_back();
+            pushText("]");
+            return pos + 1;
+        }
+
+        std::string url;
+        std::string title;
+        size_t end = pos + 1;
+        bool matched = false;
+        size_t after = pos + 1;
+        if (after < src_.size() && src_[after] == '(') {
+            matched = parseInlineLink(after, url, title, end);
+        }
+        if (!matched) {
+            std::string label;
+            size_t labelEnd;
+            bool hasLabel = after < src_.size() && src_[after] == '[' && parseLinkLabel(after, label, labelEnd);
+            if (!hasLabel || label.empty()) {
+                // 折叠式 [text][] 与简写式 [text] 使用方括号内的文本作为标签
+                label = pos - bracket.textStart <= kMaxLabelLength
+                                ? src_.substr(bracket.textStart, pos - bracket.textStart)
+                                : std::string();
+                labelEnd = hasLabel ? labelEnd : after;
+            }
+            auto it = label.empty() ? refs_.end() : refs_.find(normalizeLabel(label));
+            if (it != refs_.end()) {
+                url = it->second.url;
+                title = it->second.title;
+                end = labelEnd;
+                matched = true;
+            }
+        }
+        if (!matched) {
+            brackets_.pop_back();
+            pushText("]");
+            return pos + 1;
+        }
+
+        processEmphasis(bracket.nodeIndex + 1);
+        std::string inner = renderRange(bracket.nodeIndex + 1, nodes_.size());
+        nodes_.erase(nodes_.begin() + static_cast<std::ptrdiff_t>(bracket.nodeIndex), nodes_.end());
+        std::string titleAttr = title.empty() ? "" : " title=\"" + escapeHtml(title) + "\"";
+        if (bracket.image) {
+            pushRaw("<img src=\"" + normalizeUrl(url, true) + "\" alt=\"" + stripTags(inner) + "\"" + titleAttr +
+                    " />");
+        } else {
+            pushRaw("<a href=\"" + normalizeUrl(url, false) + "\"" + titleAttr + ">" + inner + "</a>");
+        }
+        brackets_.pop_back();
+        if (!bracket.image) {
+            // 链接内不能再嵌套链接
+            for (auto& b : brackets_) {
+                if (!b.image) b.active = false;
+            }
+        }
+        return end;
+    }
+
+    size_t angle(size_t pos) {
+        // 自动链接与行内 HTML 都以 '>' 结束；记住下一个 '>' 的位置，避免每个 '<' 都扫描到文末
+        if (nextGt_ != std::string::npos && nextGt_ <= pos) nextGt_ = src_.find('>', pos + 1);
+        size_t close = nextGt_;
+        if (close == std::string::npos) {
+            pushText("&lt;");
+            return pos + 1;
+        }
+        // 自动链接内不能有空白与 '<'：先扫到第一个这样的字符，不满足时不必复制整段
+        size_t stop = pos + 1;
+        while (stop < close && std::string(" \t\n<").find(src_[stop]) == std::string::npos) ++stop;
+        if (stop == close) {
+            std::string inner = src_.substr(pos + 1, close - pos - 1);
+            // URI 自动链接：scheme:...
+            size_t colon = inner.find(':');
+            if (colon != std::string::npos && colon >= 2 && colon <= 32 &&
+                std::isalpha(static_cast<unsigned char>(inner[0])) &&
+                std::all_of(inner.begin(), inner.begin() + static_cast<std::ptrdiff_t>(colon), [](char c) {
+                    return std::isalnum(static_cast<unsigned char>(c)) || c == '+' || c == '.' || c == '-';
+                })) {
+                pushRaw("<a href=\"" + normalizeUrl(inner, false) + "\">" + escapeHtml(inner) + "</a>");
+                return close + 1;
+            }
+            // 邮箱自动链接
+            size_t at = inner.find('@');
+            if (at != std::string::npos && at > 0 && at + 1 < inner.size() &&
+                inner.find('@', at + 1) == std::string::npos && inner.find('.', at) != std::string::npos &&
+                inner.find('\\') == std::string::npos) {
+                pushRaw("<a href=\"mailto:" + escapeHtml(inner) + "\">" + escapeHtml(inner) + "</a>");
+                return close + 1;
+            }
+        }
+        size_t end = scanInlineHtml(src_, pos, &missingMarkers_);
+        if (end) {
+            pushRaw(src_.substr(pos, end - pos));
+            return end;
+        }
+        pushText("&lt;");
+        return pos + 1;
+    }
+
+    size_t entity(size_t pos) {
+        size_t p = pos + 1;
+        size_t n = src_.size();
+        size_t digits = 0;
+        if (p < n && src_[p] == '#') {
+            ++p;
+            bool hex = p < n && (src_[p] == 'x' || src_[p] == 'X');
+            if (hex) ++p;
+            while (p < n && (hex ? std::isxdigit(static_cast<unsigned char>(src_[p]))
+                                 : std::isdigit(static_cast<unsigned char>(src_[p])))) {
+                ++p;
+                ++digits;
+            }
+            if (digits >= 1 && digits <= (hex ? 6u : 7u) && p < n && src_[p] == ';') {
+                pushText(src_.substr(pos, p + 1 - pos));
+                return p + 1;
+            }
+        } else {
+            while (p < n && std::isalnum(static_cast<unsigned char>(src_[p]))) {
+                ++p;
+                ++digits;
+            }
+            if (digits >= 2 && digits <= 32 && std::isalpha(static_cast<unsigned char>(src_[pos + 1])) && p < n &&
+                src_[p] == ';') {
+                pushText(src_.substr(pos, p + 1 - pos));
+                return p + 1;
+            }
+        }
+        pushText("&amp;");
+        return pos + 1;
+    }
+
+    // CommonMark 强调处理：只处理下标 >= bottom 的分隔符。
+    // 分隔符串成双向链表，匹配后直接摘掉两者之间的分隔符，找不到开分隔符的闭分隔符记录查找下界，整体线性
+    void processEmphasis(size_t bottom) {
+        std::vector<size_t> delims;
+        for (size_t i = bottom; i < nodes_.size(); ++i) {
+            if (nodes_[i].kind == Kind::Delim) delims.push_back(i);
+        }
+        long count = static_cast<long>(delims.size());
+        std::vector<long> prev(delims.size());
+        std::vector<long> next(delims.size());
+        for (long d = 0; d < count; ++d) {
+            prev[d] = d - 1;
+            next[d] = d + 1 < count ? d + 1 : -1;
+        }
+        auto unlink = [&](long d) {
+            if (prev[d] >= 0) next[prev[d]] = next[d];
+            if (next[d] >= 0) prev[next[d]] = prev[d];
+        };
+        std::map<int, long> openersBottom;
+
+        long current = count > 0 ? 0 : -1;
+        while (current >= 0) {
+            Node& closer = nodes_[delims[current]];
+            if (!closer.canClose || closer.count == 0) {
+                current = next[current];
+                continue;
+            }
+            int key = closer.ch * 100 + (closer.canOpen ? 10 : 0) + closer.origCount % 3;
+            auto bottomIt = openersBottom.find(key);
+            long lower = bottomIt == openersBottom.end() ? -1 : bottomIt->second;
+
+            long found = -1;
+            for (long k = prev[current]; k > lower; k = prev[k]) {
+                const Node& opener = nodes_[delims[k]];
+                if (opener.ch != closer.ch || !opener.canOpen || opener.count == 0) continue;
+                if (closer.ch == '~') {
+                    if (opener.count == closer.count) {
+                        found = k;
+                        break;
+                    }
+                    continue;
+                }
+                bool ruleOfThree = (opener.canClose || closer.canOpen) &&
+                                   (opener.origCount + closer.origCount) % 3 == 0 &&
+                                   !(opener.origCount % 3 == 0 && closer.origCount % 3 == 0);
+                if (!ruleOfThree) {
+                    found = k;
+                    break;
+                }
+            }
+            if (found < 0) {
+                openersBottom[key] = prev[current];
+                long following = next[current];
+                if (!closer.canOpen) unlink(current);
+                current = following;
+                continue;
+            }
+
+            Node& opener = nodes_[delims[found]];
+            int use = closer.ch == '~' ? closer.count : (closer.count >= 2 && opener.count >= 2 ? 2 : 1);
+            std::string tag = closer.ch == '~' ? "del" : (use == 2 ? "strong" : "em");
+            opener.count -= use;
+            closer.count -= use;
+            opener.openTags = "<" + tag + ">" + opener.openTags;
+            closer.closeTags += "</" + tag + ">";
+            // 两者之间的分隔符不再参与匹配
+            next[found] = current;
+            prev[current] = found;
+            if (opener.count == 0) unlink(found);
+            if (closer.count == 0) {
+                long following = next[current];
+                unlink(current);
+                current = following;
+            }
+        }
+    }
+
+    std::string renderRange(size_t begin, size_t end) const {
+        std::string out;
+        for (size_t i = begin; i < end; ++i) {
+            const Node& node = nodes_[i];
+            if (node.kind == Kind::Delim) {
+                out += node.closeTags;
+                out.append(static_cast<size_t>(node.count), node.ch);
+                out += node.openTags;
+            } else {
+                out += node.text;
+            }
+        }
+        return out;
+    }
+
+    const std::string& src_;
+    const RefMap& refs_;
+    std::vector<Node> nodes_;
+    std::vector<Bracket> brackets_;
+    std::unordered_set<size_t> unmatchedRuns_;  // 已确认没有闭合串的反引号串长度
+    size_t nextGt_{0};                          // 最近一次查找到的 '>' 位置（npos 表示其后没有）
+    std::unordered_set<std::string> missingMarkers_;  // 其后不再出现的 HTML 注释 / 指令结束标记
+    std::unordered_map<char, size_t> unclosedTitleFrom_;  // 自该位置起找不到对应结束符的链接标题
+};
+
+std::string renderInline(const std::string& text, const RefMap& refs) { return InlineParser(text, refs).render(); }
+
+// ================= 块级解析 =================
+
+// 引用与列表的最大嵌套层数；更深的 '>' 与列表标记按段落文本处理，块级解析、渲染与析构的递归深度因此有上限
+constexpr int kMaxNesting = 32;
+
+enum class BlockType { Container, Paragraph, Heading, ThematicBreak, CodeBlock, HtmlBlock, BlockQuote, List, Table };
+
+struct Block {
+    BlockType type{BlockType::Container};
+    int level{0};           // 标题级别
+    std::string text;       // 段落 / 标题原文、代码内容、HTML 原文
+    std::string info;       // 代码块语言
+    std::string checkbox;   // 任务列表项首段之前的复选框
+    bool ordered{false};    // 列表
+    int start{1};           // 有序列表起始编号
+    bool tight{true};       // 紧凑列表
+    bool blankBetween{false};  // 子块之间出现过空行（用于判断松散列表）
+    std::vector<std::string> aligns;                 // 表格列对齐
+    std::vector<std::vector<std::string>> rows;      // 表格，首行为表头
+    std::vector<std::unique_ptr<Block>> children;    // 引用、列表（子块为列表项）、列表项
+};
+
+struct ListMarker {
+    bool ordered{false};
+    char ch{0};        // 无序列表符号或有序列表分隔符
+    int start{1};
+    size_t width{0};   // 标记与其后空格的宽度
+    bool empty{false};  // 标记后没有内容
+};
+
+bool parseListMarker(const std::string& line, size_t indent, ListMarker& marker) {
+    size_t p = indent;
+    if (p >= line.size()) return false;
+    size_t markerLen;
+    if (line[p] == '-' || line[p] == '+' || line[p] == '*') {
+        marker.ordered = false;
+        marker.ch = line[p];
+        markerLen = 1;
+    } else {
+        size_t digits = 0;
+        while (p + digits < line.size() && std::isdigit(static_cast<unsigned char>(line[p + digits])) && digits < 10) {
+            ++digits;
+        }
+        if (digits == 0 || digits > 9 || p + digits >= line.size()) return false;
+        char delim = line[p + digits];
+        if (delim != '.' && delim != ')') return false;
+        marker.ordered = true;
+        marker.ch = delim;
+        marker.start = std::stoi(line.substr(p, digits));
+        markerLen = digits + 1;
+    }
+    size_t after = p + markerLen;
+    if (after < line.size() && line[after] != ' ') return false;
+    std::string rest = after < line.size() ? line.substr(after) : "";
+    marker.empty = isBlank(rest);
+    size_t spaces = leadingSpaces(rest);
+    marker.width = (marker.empty || spaces >= 5) ? markerLen + 1 : markerLen + spaces;
+    return true;
+}
+
+bool isThematicBreak(const std::string& line) {
+    size_t indent = leadingSpaces(line);
+    if (indent >= 4 || indent >= line.size()) return false;
+    char c = line[indent];
+    if (c != '*' && c != '-' && c != '_') return false;
+    int count = 0;
+    for (size_t i = indent; i < line.size(); ++i) {
+        if (line[i] == c) {
+            ++count;
+        } else if (line[i] != ' ' && line[i] != '\t') {
+            return false;
+        }
+    }
+    return count >= 3;
+}
+
+bool parseAtxHeading(const std::string& line, int& level, std::string& content) {
+    size_t indent = leadingSpaces(line);
+    if (indent >= 4) return false;
+    size_t p = indent;
+    int hashes = 0;
+    while (p < line.size() && line[p] == '#' && hashes <= 6) {
+        ++p;
+        ++hashes;
+    }
+    if (hashes == 0 || hashes > 6 || (p < line.size() && line[p] != ' ' && line[p] != '\t')) return false;
+    level = hashes;
+    content = trim(line.substr(p));
+    // 去掉结尾的 # 序列
+    size_t end = content.size();
+    while (end > 0 && content[end - 1] == '#') --end;
+    if (end == 0) {
+        content.clear();
+    } else if (end < content.size() && (content[end - 1] == ' ' || content[end - 1] == '\t')) {
+        content = trim(content.substr(0, end));
+    }
+    return true;
+}
+
+bool parseFenceStart(const std::string& line, char& ch, size_t& len, std::string& info) {
+    size_t indent = leadingSpaces(line);
+    if (indent >= 4 || indent >= line.size()) return false;
+    ch = line[indent];
+    if (ch != '`' && ch != '~') return false;
+    len = 0;
+    while (indent + len < line.size() && line[indent + len] == ch) ++len;
+    if (len < 3) return false;
+    info = trim(line.substr(indent + len));
+    if (ch == '`' && info.find('`') != std::string::npos) return false;
+    return true;
+}
+
+bool isFenceClose(const std::string& line, char ch, size_t len) {
+    size_t indent = leadingSpaces(line);
+    if (indent >= 4) return false;
+    size_t run = 0;
+    while (indent + run < line.size() && line[indent + run] == ch) ++run;
+    return run >= len && isBlank(line.substr(indent + run));
+}
+
+bool isSetextUnderline(const std::string& line, int& level) {
+    size_t indent = leadingSpaces(line);
+    if (indent >= 4 || indent >= line.size()) return false;
+    std::string s = trimRight(line.substr(indent));
+    if (s.empty()) return false;
+    char c = s[0];
+    if (c != '=' && c != '-') return false;
+    if (!std::all_of(s.begin(), s.end(), [c](char x) { return x == c; })) return false;
+    level = c == '=' ? 1 : 2;
+    return true;
+}
+
+// HTML 块的 7 种起始条件，返回 0 表示不是 HTML 块
+int htmlBlockKind(const std::string& line) {
+    size_t indent = leadingSpaces(line);
+    if (indent >= 4 || indent >= line.size() || line[indent] != '<') return 0;
+    std::string s = line.substr(indent);
+    std::string lower = toLower(s);
+    for (const char* tag : {"<script", "<pre", "<style", "<textarea"}) {
+        size_t len = std::char_traits<char>::length(tag);
+        if (lower.compare(0, len, tag) == 0 &&
+            (lower.size() == len || lower[len] == ' ' || lower[len] == '>' || lower[len] == '\t')) {
+            return 1;
+        }
+    }
+    if (s.compare(0, 4, "<!--") == 0) return 2;
+    if (s.compare(0, 2, "<?") == 0) return 3;
+    if (s.size() > 2 && s[1] == '!' && std::isalpha(static_cast<unsigned char>(s[2]))) return 4;
+    if (s.compare(0, 9, "<![CDATA[") == 0) return 5;
+
+    static const std::unordered_set<std::string> kBlockTags = {
+            "address", "article",  "aside",    "base",     "basefont", "blockquote", "body",    "caption", "center",
+            "col",     "colgroup", "dd",       "details",  "dialog",   "dir",        "div",     "dl",      "dt",
+            "fieldset", "figcaption", "figure", "footer",  "form",     "frame",      "frameset", "h1",     "h2",
+            "h3",      "h4",       "h5",       "h6",       "head",     "header",     "hr",      "html",    "iframe",
+            "legend",  "li",       "link",     "main",     "menu",     "menuitem",   "nav",     "noframes", "ol",
+            "optgroup", "option",  "p",        "param",    "search",   "section",    "summary", "table",   "tbody",
+            "td",      "tfoot",    "th",       "thead",    "title",    "tr",         "track",   "ul"};
+    size_t p = lower[1] == '/' ? 2 : 1;
+    size_t nameEnd = p;
+    while (nameEnd < lower.size() && std::isalnum(static_cast<unsigned char>(lower[nameEnd]))) ++nameEnd;
+    std::string name = lower.substr(p, nameEnd - p);
+    if (kBlockTags.count(name) &&
+        (nameEnd == lower.size() || lower[nameEnd] == ' ' || lower[nameEnd] == '\t' || lower[nameEnd] == '>' ||
+         lower.compare(nameEnd, 2, "/>") == 0)) {
+        return 6;
+    }
+    // 单独成行的完整标签
+    size_t end = scanInlineHtml(s, 0);
+    if (end && isBlank(s.substr(end))) return 7;
+    return 0;
+}
+
+bool htmlBlockEnds(int kind, const std::string& line) {
+    std::string lower = toLower(line);
+    switch (kind) {
+        case 1:
+            return lower.find("</script>") != std::string::npos || lower.find("</pre>") != std::string::npos ||
+                   lower.find("</style>") != std::string::npos || lower.find("</textarea>") != std::string::npos;
+        case 2:
+            return line.find("-->") != std::string::npos;
+        case 3:
+            return line.find("?>") != std::string::npos;
+        case 4:
+            return line.find('>') != std::string::npos;
+        case 5:
+            return line.find("]]>") != std::string::npos;
+        default:
+            return false;
+    }
+}
+
+// 能打断段落的块起始
+bool interruptsParagraph(const std::string& line) {
+    size_t indent = leadingSpaces(line);
+    if (indent >= 4 || indent >= line.size()) return false;
+    int level;
+    std::string content;
+    char ch;
+    size_t len;
+    if (parseAtxHeading(line, level, content) || parseFenceStart(line, ch, len, content) || isThematicBreak(line)) {
+        return true;
+    }
+    if (line[indent] == '>') return true;
+    int kind = htmlBlockKind(line);
+    if (kind >= 1 && kind <= 6) return true;
+    ListMarker marker;
+    if (parseListMarker(line, indent, marker)) {
+        return !marker.empty && (!marker.ordered || marker.start == 1);
+    }
+    return false;
+}
+
+// 拆分表格行，去掉首尾的 '|'，保留单元格内的 \| 以外的原文
+std::vector<std::string> splitTableRow(const std::string& line) {
+    std::string s = trim(line);
+    if (!s.empty() && s.front() == '|') s.erase(0, 1);
+    if (!s.empty() && s.back() == '|' && (s.size() < 2 || s[s.size() - 2] != '\\')) s.pop_back();
+    std::vector<std::string> cells;
+    std::string cell;
+    for (size_t i = 0; i < s.size(); ++i) {
+        if (s[i] == '\\' && i + 1 < s.size() && s[i + 1] == '|') {
+            cell += '|';
+            ++i;
+        } else if (s[i] == '|') {
+            cells.push_back(trim(cell));
+            cell.clear();
+        } else {
+            cell += s[i];
+        }
+    }
+    cells.push_back(trim(cell));
+    return cells;
+}
+
+bool parseTableDelimiter(const std::string& line, size_t columns, std::vector<std::string>& aligns) {
+    if (leadingSpaces(line) >= 4 || line.find('-') == std::string::npos) return false;
+    std::string s = trim(line);
+    if (s.find('|') == std::string::npos && columns > 1) return false;
+    auto cells = splitTableRow(s);
+    if (cells.size() != columns) return false;
+    aligns.clear();
+    for (const auto& cell : cells) {
+        if (cell.empty()) return false;
+        bool left = cell.front() == ':';
+        bool right = cell.back() == ':';
+        std::string dashes = cell.substr(left ? 1 : 0, cell.size() - (left ? 1 : 0) - (right ? 1 : 0));
+        if (dashes.empty() || dashes.find_first_not_of('-') != std::string::npos) return false;
+        aligns.push_back(left && right ? "center" : right ? "right" : left ? "left" : "");
+    }
+    return true;
+}
+
+// 单行链接引用定义：[label]: url "title"
+bool parseReferenceDefinition(const std::string& line, RefMap& refs) {
+    std::string s = trim(line);
+    if (s.empty() || s[0] != '[') return false;
+    size_t close = std::string::npos;
+    for (size_t i = 1; i < s.size(); ++i) {
+        if (s[i] == '\\') {
+            ++i;
+        } else if (s[i] == '[') {
+            return false;
+        } else if (s[i] == ']') {
+            close = i;
+            break;
+        }
+    }
+    if (close == std::string::npos || close + 1 >= s.size() || s[close + 1] != ':') return false;
+    std::string label = normalizeLabel(s.substr(1, close - 1));
+    if (label.empty()) return false;
+
+    size_t p = close + 2;
+    while (p < s.size() && isAsciiSpace(s[p])) ++p;
+    if (p >= s.size()) return false;
+    std::string url;
+    if (s[p] == '<') {
+        size_t end = s.find('>', p);
+        if (end == std::string::npos) return false;
+        url = s.substr(p + 1, end - p - 1);
+        p = end + 1;
+    } else {
+        size_t end = p;
+        while (end < s.size() && !isAsciiSpace(s[end])) ++end;
+        url = s.substr(p, end - p);
+        p = end;
+    }
+    size_t beforeTitle = p;
+    while (p < s.size() && isAsciiSpace(s[p])) ++p;
+    std::string title;
+    if (p < s.size()) {
+        if (p == beforeTitle) return false;
+        char open = s[p];
+        char closeCh = open == '(' ? ')' : open;
+        if ((open != '"' && open != '\'' && open != '(') || s.back() != closeCh || s.size() - p < 2) return false;
+        title = s.substr(p + 1, s.size() - p - 2);
+    }
+    refs.emplace(label, LinkRef{unescapeBackslash(url), unescapeBackslash(title)});
+    return true;
+}
+
+void parseBlocks(const std::vector<std::string>& lines, Block& parent, RefMap& refs, int depth = 0);
+
+std::unique_ptr<Block> makeBlock(BlockType type) {
+    auto block = std::make_unique<Block>();
+    block->type = type;
+    return block;
+}
+
+// GFM 任务列表项：首段以 [ ] / [x] 加空白开头时去掉该标记，换成复选框
+void applyTaskMarker(Block& item) {
+    if (item.children.empty() || item.children[0]->type != BlockType::Paragraph) return;
+    Block& paragraph = *item.children[0];
+    const std::string& text = paragraph.text;
+    if (text.size() < 4 || text[0] != '[' || text[2] != ']' || (text[3] != ' ' && text[3] != '\t')) return;
+    bool checked = text[1] == 'x' || text[1] == 'X';
+    if (!checked && text[1] != ' ') return;
+    size_t begin = 4;
+    while (begin < text.size() && (text[begin] == ' ' || text[begin] == '\t')) ++begin;
+    if (begin == text.size()) return;
+    paragraph.text.erase(0, begin);
+    paragraph.checkbox = checked ? "<input checked=\"\" disabled=\"\" type=\"checkbox\" /> "
+                                 : "<input disabled=\"\" type=\"checkbox\" /> ";
+}
+
+void parseBlocks(const std::vector<std::string>& lines, Block& parent, RefMap& refs, int depth) {
+    std::vector<std::string> para;
+    bool sawBlank = false;
+
+    auto addChild = [&](std::unique_ptr<Block> block) {
+        if (sawBlank && !parent.children.empty()) parent.blankBetween = true;
+        sawBlank = false;
+        parent.children.push_back(std::move(block));
+    };
+    auto closeParagraph = [&]() {
+        if (para.empty()) return;
+        // 段落开头的链接引用定义不输出
+        size_t first = 0;
+        while (first < para.size() && parseReferenceDefinition(para[first], refs)) ++first;
+        if (first < para.size()) {
+            std::string text;
+            for (size_t i = first; i < para.size(); ++i) {
+                if (i > first) text += '\n';
+                text += para[i];
+            }
+            auto block = makeBlock(BlockType::Paragraph);
+            block->text = trimRight(text);
+            addChild(std::move(block));
+        }
+        para.clear();
+    };
+
+    size_t i = 0;
+    while (i < lines.size()) {
+        const std::string& line = lines[i];
+        if (isBlank(line)) {
+            closeParagraph();
+            if (!parent.children.empty()) sawBlank = true;
+            ++i;
+            continue;
+        }
+        size_t indent = leadingSpaces(line);
+
+        if (!para.empty()) {
+            int level;
+            std::vector<std::string> aligns;
+            if (isSetextUnderline(line, level)) {
+                std::string text;
+                for (size_t k = 0; k < para.size(); ++k) text += (k ? "\n" : "") + para[k];
+                para.clear();
+                auto block = makeBlock(BlockType::Heading);
+                block->level = level;
+                block->text = trim(text);
+                addChild(std::move(block));
+                ++i;
+                continue;
+            }
+            if (parseTableDelimiter(line, splitTableRow(para.back()).size(), aligns)) {
+                // 段落最后一行是表头
+                std::string header = para.back();
+                para.pop_back();
+                closeParagraph();
+                auto table = makeBlock(BlockType::Table);
+                table->aligns = aligns;
+                table->rows.push_back(splitTableRow(header));
+                ++i;
+                while (i < lines.size() && !isBlank(lines[i]) && !interruptsParagraph(lines[i])) {
+                    table->rows.push_back(splitTableRow(lines[i++]));
+                }
+                addChild(std::move(table));
+                continue;
+            }
+            if (indent >= 4 || !interruptsParagraph(line)) {
+                para.push_back(line.substr(indent));
+                ++i;
+                continue;
+            }
+            closeParagraph();
+        }
+
+        // 缩进代码块
+        if (indent >= 4) {
+            std::vector<std::string> code;
+            while (i < lines.size() && (isBlank(lines[i]) || leadingSpaces(lines[i]) >= 4)) {
+                code.push_back(lines[i].size() > 4 ? lines[i].substr(4) : "");
+                ++i;
+            }
+            while (!code.empty() && isBlank(code.back())) code.pop_back();
+            auto block = makeBlock(BlockType::CodeBlock);
+            for (const auto& codeLine : code) block->text += codeLine + "\n";
+            addChild(std::move(block));
+            continue;
+        }
+
+        // 围栏代码块
+        char fenceChar;
+        size_t fenceLen;
+        std::string info;
+        if (parseFenceStart(line, fenceChar, fenceLen, info)) {
+            auto block = makeBlock(BlockType::CodeBlock);
+            std::string language = unescapeBackslash(info.substr(0, info.find_first_of(" \t")));
+            block->info = language;
+            ++i;
+            while (i < lines.size() && !isFenceClose(lines[i], fenceChar, fenceLen)) {
+                const std::string& codeLine = lines[i++];
+                size_t strip = std::min(indent, leadingSpaces(codeLine));
+                block->text += codeLine.substr(strip) + "\n";
+            }
+            if (i < lines.size()) ++i;  // 跳过结束围栏
+            addChild(std::move(block));
+            continue;
+        }
+
+        int level;
+        std::string content;
+        if (parseAtxHeading(line, level, content)) {
+            auto block = makeBlock(BlockType::Heading);
+            block->level = level;
+            block->text = content;
+            addChild(std::move(block));
+            ++i;
+            continue;
+        }
+
+        if (isThematicBreak(line)) {
+            addChild(makeBlock(BlockType::ThematicBreak));
+            ++i;
+            continue;
+        }
+
+        // 引用：去掉 '>' 后递归解析，支持段落的惰性延续行
+        if (line[indent] == '>' && depth < kMaxNesting) {
+            std::vector<std::string> inner;
+            while (i < lines.size()) {
+                const std::string& l = lines[i];
+                size_t li = leadingSpaces(l);
+                if (li < 4 && li < l.size() && l[li] == '>') {
+                    std::string rest = l.substr(li + 1);
+                    if (!rest.empty() && rest[0] == ' ') rest.erase(0, 1);
+                    inner.push_back(rest);
+                    ++i;
+                    continue;
+                }
+                if (!inner.empty() && !isBlank(inner.back()) && !isBlank(l) && !interruptsParagraph(l)) {
+                    inner.push_back(l);
+                    ++i;
+                    continue;
+                }
+                break;
+            }
+            auto block = makeBlock(BlockType::BlockQuote);
+            parseBlocks(inner, *block, refs, depth + 1);
+            addChild(std::move(block));
+            continue;
+        }
+
+        ListMarker marker;
+        if (depth < kMaxNesting && parseListMarker(line, indent, marker)) {
+            auto list = makeBlock(BlockType::List);
+            list->ordered = marker.ordered;
+            list->start = marker.start;
+            bool loose = false;
+            bool endedWithBlank = false;
+            while (i < lines.size()) {
+                size_t itemIndent = leadingSpaces(lines[i]);
+                ListMarker item;
+                if (itemIndent >= 4 || !parseListMarker(lines[i], itemIndent, item) || item.ordered != marker.ordered ||
+                    item.ch != marker.ch || isThematicBreak(lines[i])) {
+                    break;
+                }
+                if (endedWithBlank) loose = true;
+                size_t contentIndent = itemIndent + item.width;
+                std::vector<std::string> itemLines;
+                itemLines.push_back(item.empty ? "" : lines[i].substr(std::min(contentIndent, lines[i].size())));
+                ++i;
+                while (i < lines.size()) {
+                    const std::string& l = lines[i];
+                    if (isBlank(l)) {
+                        if (item.empty && itemLines.size() == 1) break;  // 以空行开始的列表项最多只有一个空行
+                        itemLines.push_back("");
+                        ++i;
+                        continue;
+                    }
+                    size_t li = leadingSpaces(l);
+                    if (li >= contentIndent) {
+                        itemLines.push_back(l.substr(contentIndent));
+                        ++i;
+                        continue;
+                    }
+                    ListMarker next;
+                    if (!isBlank(itemLines.back()) && !interruptsParagraph(l) && !parseListMarker(l, li, next)) {
+                        itemLines.push_back(l.substr(li));  // 惰性延续行
+                        ++i;
+                        continue;
+                    }
+                    break;
+                }
+                endedWithBlank = false;
+                while (!itemLines.empty() && isBlank(itemLines.back())) {
+                    itemLines.pop_back();
+                    endedWithBlank = true;
+                }
+                if (i < lines.size() && isBlank(lines[i])) endedWithBlank = true;
+                while (i < lines.size() && isBlank(lines[i])) ++i;
+
+                auto itemBlock = makeBlock(BlockType::Container);
+                parseBlocks(itemLines, *itemBlock, refs, depth + 1);
+                applyTaskMarker(*itemBlock);
+                if (itemBlock->blankBetween) loose = true;
+                list->children.push_back(std::move(itemBlock));
+            }
+            list->tight = !loose;
+            addChild(std::move(list));
+            if (endedWithBlank) sawBlank = true;
+            continue;
+        }
+
+        int kind = htmlBlockKind(line);
+        if (kind) {
+            auto block = makeBlock(BlockType::HtmlBlock);
+            std::string html;
+            if (kind <= 5) {
+                while (i < lines.size()) {
+                    html += lines[i] + "\n";
+                    if (htmlBlockEnds(kind, lines[i++])) break;
+                }
+            } else {
+                while (i < lines.size() && !isBlank(lines[i])) html += lines[i++] + "\n";
+            }
+            block->text = html;
+            addChild(std::move(block));
+            continue;
+        }
+
+        std::vector<std::string> aligns;
+        if (i + 1 < lines.size() && line.find('|') != std::string::npos &&
+            parseTableDelimiter(lines[i + 1], splitTableRow(line).size(), aligns)) {
+            auto table = makeBlock(BlockType::Table);
+            table->aligns = aligns;
+            table->rows.push_back(splitTableRow(line));
+            i += 2;
+            while (i < lines.size() && !isBlank(lines[i]) && !interruptsParagraph(lines[i])) {
+                table->rows.push_back(splitTableRow(lines[i++]));
+            }
+            addChild(std::move(table));
+            continue;
+        }
+
+        // 段落开始
+        if (sawBlank && !parent.children.empty()) parent.blankBetween = true;
+        sawBlank = false;
+        para.push_back(line.substr(indent));
+        ++i;
+    }
+    closeParagraph();
+}
+
+void renderBlock(const Block& block, const RefMap& refs, bool tight, std::string& out);
+
+void renderChildren(const Block& block, const RefMap& refs, bool tight, std::string& out) {
+    for (const auto& child : block.children) renderBlock(*child, refs, tight, out);
+}
+
+void renderBlock(const Block& block, const RefMap& refs, bool tight, std::string& out) {
+    switch (block.type) {
+        case BlockType::Paragraph:
+            if (tight) {
+                out += block.checkbox + renderInline(block.text, refs);
+            } else {
+                out += "<p>" + block.checkbox + renderInline(block.text, refs) + "</p>\n";
+            }
+            break;
+        case BlockType::Heading: {
+            std::string level = std::to_string(block.level);
+            out += "<h" + level + ">" + renderInline(block.text, refs) + "</h" + level + ">\n";
+            break;
+        }
+        case BlockType::ThematicBreak:
+            out += "<hr />\n";
+            break;
+        case BlockType::CodeBlock:
+            out += "<pre><code";
+            if (!block.info.empty()) out += " class=\"language-" + escapeHtml(block.info) + "\"";
+            out += ">" + escapeHtml(block.text) + "</code></pre>\n";
+            break;
+        case BlockType::HtmlBlock:
+            out += block.text;
+            break;
+        case BlockType::BlockQuote:
+            out += "<blockquote>\n";
+            renderChildren(block, refs, false, out);
+            out += "</blockquote>\n";
+            break;
+        case BlockType::List: {
+            if (block.ordered) {
+                out += block.start == 1 ? "<ol>\n" : "<ol start=\"" + std::to_string(block.start) + "\">\n";
+            } else {
+                out += "<ul>\n";
+            }
+            for (const auto& item : block.children) {
+                out += "<li>";
+                bool prevTightParagraph = false;
+                for (size_t k = 0; k < item->children.size(); ++k) {
+                    const Block& child = *item->children[k];
+                    bool tightParagraph = block.tight && child.type == BlockType::Paragraph;
+                    if ((k == 0 && !tightParagraph) || (k > 0 && prevTightParagraph)) out += "\n";
+                    renderBlock(child, refs, block.tight, out);
+                    prevTightParagraph = tightParagraph;
+                }
+                out += "</li>\n";
+            }
+            out += block.ordered ? "</ol>\n" : "</ul>\n";
+            break;
+        }
+        case BlockType::Table: {
+            auto renderRow = [&](const std::vector<std::string>& row, const char* cellTag) {
+                out += "<tr>\n";
+                for (size_t c = 0; c < block.aligns.size(); ++c) {
+                    out += std::string("<") + cellTag;
+                    if (!block.aligns[c].empty()) out += " align=\"" + block.aligns[c] + "\"";
+                    out += ">" + (c < row.size() ? renderInline(row[c], refs) : "") + "</" + cellTag + ">\n";
+                }
+                out += "</tr>\n";
+            };
+            out += "<table>\n<thead>\n";
+            renderRow(block.rows[0], "th");
+            out += "</thead>\n";
+            if (block.rows.size() > 1) {
+                out += "<tbody>\n";
+                for (size_t r = 1; r < block.rows.size(); ++r) renderRow(block.rows[r], "td");
+                out += "</tbody>\n";
+            }
+            out += "</table>\n";
+            break;
+        }
+        case BlockType::Container:
+            renderChildren(block, refs, tight, out);
+            break;
+    }
+}
+
+// 行预处理：统一换行符，制表符按 4 列展开
+std::vector<std::string> splitLines(const std::string& text) {
+    std::vector<std::string> lines;
+    std::string line;
+    size_t column = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        char c = text[i];
+        if (c == '\r' || c == '\n') {
+            if (c == '\r' && i + 1 < text.size() && text[i + 1] == '\n') ++i;
+            lines.push_back(std::move(line));
+            line.clear();
+            column = 0;
+        } else if (c == '\t') {
+            size_t spaces = 4 - column % 4;
+            line.append(spaces, ' ');
+            column += spaces;
+        } else if (c == '\0') {
+            line += "\xEF\xBF\xBD";
+            ++column;
+        } else {
+            line += c;
+            if ((static_cast<unsigned char>(c) & 0xC0) != 0x80) ++column;
+        }
+    }
+    if (!line.empty()) lines.push_back(std::move(line));
+    return lines;
+}
+
+// ================= HTML -> Markdown =================
+
+// DOM 的最大深度；更深的元素不再入栈，其内容并入最深的一层，序列化时的递归深度因此有上限
+constexpr size_t kMaxHtmlDepth = 64;
+
+struct HtmlNode {
+    std::string tag;  // 为空表示文本节点
+    std::string text;
+    std::map<std::string, std::string> attrs;
+    std::vector<std::unique_ptr<HtmlNode>> children;
+
+    std::string attr(const std::string& name) const {
+        auto it = attrs.find(name);
+        return it == attrs.end() ? "" : it->second;
+    }
+};
+
+void appendUtf8(std::string& out, uint32_t cp) {
+    if (cp == 0 || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) cp = 0xFFFD;
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+std::string decodeEntities(const std::string& s) {
+    static const std::unordered_map<std::string, std::string> kNamed = {
+            {"amp", "&"},  {"lt", "<"},     {"gt", ">"},      {"quot", "\""},        {"apos", "'"},
+            {"nbsp", " "}, {"copy", "\xC2\xA9"}, {"reg", "\xC2\xAE"}, {"hellip", "\xE2\x80\xA6"},
+            {"mdash", "\xE2\x80\x94"}, {"ndash", "\xE2\x80\x93"}};
+    std::string out;
+    out.reserve(s.size());
+    for (size_t i = 0; i < s.size(); ++i) {
+        if (s[i] != '&') {
+            out += s[i];
+            continue;
+        }
+        size_t semi = s.find(';', i + 1);
+        if (semi == std::string::npos || semi - i > 33) {
+            out += '&';
+            continue;
+        }
+        std::string name = s.substr(i + 1, semi - i - 1);
+        if (name.size() > 1 && name[0] == '#') {
+            try {
+                bool hex = name[1] == 'x' || name[1] == 'X';
+                uint32_t cp = static_cast<uint32_t>(std::stoul(name.substr(hex ? 2 : 1), nullptr, hex ? 16 : 10));
+                appendUtf8(out, cp);
+                i = semi;
+                continue;
+            } catch (...) {
+            }
+        } else {
+            auto it = kNamed.find(name);
+            if (it != kNamed.end()) {
+                out += it->second;
+                i = semi;
+                continue;
+            }
+        }
+        out += '&';
+    }
+    return out;
+}
+
+bool isVoidTag(const std::string& tag) {
+    static const std::unordered_set<std::string> kVoid = {"area", "base", "br",   "col",   "embed",  "hr",  "img",
+                                                          "input", "link", "meta", "source", "track", "wbr"};
+    return kVoid.count(tag) > 0;
+}
+
+bool isBlockTag(const std::string& tag) {
+    static const std::unordered_set<std::string> kBlock = {
+            "address", "article", "aside", "blockquote", "body", "dd",     "details", "div",   "dl",    "dt",
+            "fieldset", "figcaption", "figure", "footer", "form", "h1", "h2",      "h3",    "h4",    "h5",
+            "h6",      "header",  "hr",    "html",       "li",   "main",   "nav",     "ol",    "p",     "pre",
+            "section", "summary", "table", "tbody",      "td",   "tfoot",  "th",      "thead", "tr",    "ul"};
+    return kBlock.count(tag) > 0;
+}
+
+std::unique_ptr<HtmlNode> parseHtml(const std::string& html) {
+    auto root = std::make_unique<HtmlNode>();
+    root->tag = "#root";
+    std::vector<HtmlNode*> stack{root.get()};
+    size_t flattened = 0;  // 超过深度上限、未入栈的未闭合元素数
+    std::string lowerHtml;  // 查找 </script> / </style> 时按需生成
+
+    auto appendText = [&](const std::string& text) {
+        if (text.empty()) return;
+        auto& children = stack.back()->children;
+        if (!children.empty() && children.back()->tag.empty()) {
+            children.back()->text += text;
+            return;
+        }
+        auto node = std::make_unique<HtmlNode>();
+        node->text = text;
+        children.push_back(std::move(node));
+    };
+    auto closeTo = [&](const std::string& tag) {
+        for (size_t k = stack.size(); k-- > 1;) {
+            if (stack[k]->tag == tag) {
+                stack.resize(k);
+                return true;
+            }
+        }
+        return false;
+    };
+    // 打开新元素前隐式关闭的元素（p 遇到块级元素、li / tr / td 遇到同级元素）
+    auto implicitClose = [&](const std::string& tag) {
+        if (isBlockTag(tag) && stack.back()->tag == "p") stack.pop_back();
+        auto closeSibling = [&](const std::string& sibling, std::initializer_list<const char*> boundaries) {
+            for (size_t k = stack.size(); k-- > 1;) {
+                const std::string& open = stack[k]->tag;
+                if (open == sibling) {
+                    stack.resize(k);
+                    return;
+                }
+                for (const char* boundary : boundaries) {
+                    if (open == boundary) return;
+                }
+            }
+        };
+        if (tag == "li") closeSibling("li", {"ul", "ol"});
+        if (tag == "tr") closeSibling("tr", {"table", "thead", "tbody", "tfoot"});
+        if (tag == "td" || tag == "th") {
+            closeSibling("td", {"tr", "table"});
+            closeSibling("th", {"tr", "table"});
+        }
+    };
+
+    size_t pos = 0;
+    size_t n = html.size();
+    while (pos < n) {
+        size_t lt = html.find('<', pos);
+        if (lt == std::string::npos) {
+            appendText(decodeEntities(html.substr(pos)));
+            break;
+        }
+        appendText(decodeEntities(html.substr(pos, lt - pos)));
+        pos = lt;
+        if (html.compare(pos, 4, "<!--") == 0) {
+            size_t end = html.find("-->", pos + 4);
+            pos = end == std::string::npos ? n : end + 3;
+            continue;
+        }
+        if (pos + 1 < n && (html[pos + 1] == '!' || html[pos + 1] == '?')) {
+            size_t end = html.find('>', pos);
+            pos = end == std::string::npos ? n : end + 1;
+            continue;
+        }
+        bool closing = pos + 1 < n && html[pos + 1] == '/';
+        size_t nameStart = pos + (closing ? 2 : 1);
+        size_t nameEnd = nameStart;
+        while (nameEnd < n && (std::isalnum(static_cast<unsigned char>(html[nameEnd])) || html[nameEnd] == '-')) {
+            ++nameEnd;
+        }
+        if (nameEnd == nameStart) {
+            appendText("<");
+            ++pos;
+            continue;
+        }
+        std::string tag = toLower(html.substr(nameStart, nameEnd - nameStart));
+
+        // 解析属性直到 '>'
+        std::map<std::string, std::string> attrs;
+        size_t p = nameEnd;
+        bool selfClosing = false;
+        while (p < n && html[p] != '>') {
+            if (isAsciiSpace(html[p])) {
+                ++p;
+                continue;
+            }
+            if (html[p] == '/') {
+                selfClosing = true;
+                ++p;
+                continue;
+            }
+            size_t attrStart = p;
+            while (p < n && !isAsciiSpace(html[p]) && html[p] != '=' && html[p] != '>' && html[p] != '/') ++p;
+            std::string name = toLower(html.substr(attrStart, p - attrStart));
+            std::string value;
+            while (p < n && isAsciiSpace(html[p])) ++p;
+            if (p < n && html[p] == '=') {
+                ++p;
+                while (p < n && isAsciiSpace(html[p])) ++p;
+                if (p < n && (html[p] == '"' || html[p] == '\'')) {
+                    size_t close = html.find(html[p], p + 1);
+                    if (close == std::string::npos) close = n;
+                    value = html.substr(p + 1, close - p - 1);
+                    p = std::min(n, close + 1);
+                } else {
+                    size_t valueStart = p;
+                    while (p < n && !isAsciiSpace(html[p]) && html[p] != '>') ++p;
+                    value = html.substr(valueStart, p - valueStart);
+                }
+            }
+            if (!name.empty()) attrs[name] = decodeEntities(value);
+            if (p == attrStart) ++p;
+        }
+        pos = std::min(n, p + 1);
+
+        if (closing) {
+            if (flattened > 0) {
+                --flattened;
+            } else {
+                closeTo(tag);
+            }
+            continue;
+        }
+        if (tag == "script" || tag == "style") {
+            if (lowerHtml.empty()) lowerHtml = toLower(html);
+            size_t end = lowerHtml.find("</" + tag, pos);
+            if (end == std::string::npos) break;
+            size_t gt = html.find('>', end);
+            pos = gt == std::string::npos ? n : gt + 1;
+            continue;
+        }
+        if (flattened == 0) implicitClose(tag);
+        auto node = std::make_unique<HtmlNode>();
+        node->tag = tag;
+        node->attrs = std::move(attrs);
+        HtmlNode* raw = node.get();
+        stack.back()->children.push_back(std::move(node));
+        if (!selfClosing && !isVoidTag(tag)) {
+            if (stack.size() < kMaxHtmlDepth) {
+                stack.push_back(raw);
+            } else {
+                ++flattened;
+            }
+        }
+    }
+    return root;
+}
+
+std::string escapeMarkdownText(const std::string& text) {
+    std::string out;
+    out.reserve(text.size());
+    bool space = false;
+    for (size_t i = 0; i < text.size(); ++i) {
+        char c = text[i];
+        // 折叠空白
+        if (isAsciiSpace(c)) {
+            space = true;
+            continue;
+        }
+        if (space) out += ' ';
+        space = false;
+        // '&' 后跟字母数字或 '#' 时可能被当作实体
+        bool entityLike = c == '&' && i + 1 < text.size() &&
+                          (text[i + 1] == '#' || std::isalnum(static_cast<unsigned char>(text[i + 1])));
+        if (entityLike || std::string("\\`*_[]<>~").find(c) != std::string::npos) out += '\\';
+        out += c;
+    }
+    if (space) out += ' ';
+    return out;
+}
+
+// 节点的纯文本（用于代码块与行内代码）
+std::string textContent(const HtmlNode& node) {
+    if (node.tag.empty()) return node.text;
+    if (node.tag == "br") return "\n";
+    std::string out;
+    for (const auto& child : node.children) out += textContent(*child);
+    return out;
+}
+
+std::string backtickFence(const std::string& content, size_t minimum) {
+    size_t longest = 0;
+    size_t run = 0;
+    for (char c : content) {
+        run = c == '`' ? run + 1 : 0;
+        longest = std::max(longest, run);
+    }
+    return std::string(std::max(minimum, longest + 1), '`');
+}
+
+std::string inlineMarkdown(const HtmlNode& node);
+
+std::string inlineChildren(const HtmlNode& node) {
+    std::string out;
+    for (const auto& child : node.children) out += inlineMarkdown(*child);
+    return out;
+}
+
+// 把强调标记内侧的空白移到外侧：** a ** 不是合法强调
+std::string wrapInline(const std::string& inner, const std::string& marker) {
+    size_t begin = inner.find_first_not_of(' ');
+    if (begin == std::string::npos) return inner;
+    size_t end = inner.find_last_not_of(' ') + 1;
+    return inner.substr(0, begin) + marker + inner.substr(begin, end - begin) + marker + inner.substr(end);
+}
+
+// 链接 / 图片的 title 部分（含前导空格），没有 title 时为空
+std::string linkTitle(const HtmlNode& node) {
+    std::string title = node.attr("title");
+    if (title.empty()) return "";
+    std::string out = " \"";
+    for (char c : title) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+std::string inlineMarkdown(const HtmlNode& node) {
+    const std::string& tag = node.tag;
+    if (tag.empty()) return escapeMarkdownText(node.text);
+    if (tag == "br") return "\\\n";
+    if (tag == "strong" || tag == "b") return wrapInline(inlineChildren(node), "**");
+    if (tag == "em" || tag == "i") return wrapInline(inlineChildren(node), "*");
+    if (tag == "del" || tag == "s" || tag == "strike") return wrapInline(inlineChildren(node), "~~");
+    if (tag == "code") {
+        std::string content = textContent(node);
+        std::replace(content.begin(), content.end(), '\n', ' ');
+        std::string fence = backtickFence(content, 1);
+        bool pad = !content.empty() && (content.front() == '`' || content.back() == '`');
+        return fence + (pad ? " " : "") + content + (pad ? " " : "") + fence;
+    }
+    if (tag == "a") {
+        std::string text = inlineChildren(node);
+        if (!node.attrs.count("href")) return text;
+        std::string href = node.attr("href");
+        std::string url;
+        for (char c : href) {
+            if (c == ' ') {
+                url += "%20";
+            } else {
+                if (c == '(' || c == ')') url += '\\';
+                url += c;
+            }
+        }
+        return "[" + text + "](" + url + linkTitle(node) + ")";
+    }
+    if (tag == "img") {
+        std::string src = node.attr("src");
+        std::string url;
+        for (char c : src) url += c == ' ' ? std::string("%20") : std::string(1, c);
+        return "![" + escapeMarkdownText(node.attr("alt")) + "](" + url + linkTitle(node) + ")";
+    }
+    if (tag == "input") {
+        // 任务列表项的复选框
+        if (toLower(node.attr("type")) != "checkbox") return "";
+        return node.attrs.count("checked") ? "[x]" : "[ ]";
+    }
+    if (tag == "hr") return " ";
+    // 行内上下文中的块级元素与其他标签只保留内容
+    std::string inner = inlineChildren(node);
+    return isBlockTag(tag) ? " " + inner + " " : inner;
+}
+
+// 段落文本：去掉每行首尾空白，并转义行首会被误认为块结构的字符
+std::string formatParagraph(const std::string& text) {
+    std::string out;
+    std::stringstream ss(text);
+    std::string line;
+    bool first = true;
+    while (std::getline(ss, line)) {
+        std::string t = trim(line);
+        bool hardBreak = !t.empty() && t.back() == '\\' && (t.size() < 2 || t[t.size() - 2] != '\\');
+        if (t.empty() || t == "\\") continue;
+        if (hardBreak) {
+            t = trimRight(t.substr(0, t.size() - 1)) + "\\";
+        }
+        if (t[0] == '#' || t[0] == '=' || t[0] == '|' ||
+            ((t[0] == '-' || t[0] == '+') && (t.size() == 1 || t[1] == ' '))) {
+            t = "\\" + t;
+        } else if (std::isdigit(static_cast<unsigned char>(t[0]))) {
+            size_t d = 0;
+            while (d < t.size() && std::isdigit(static_cast<unsigned char>(t[d]))) ++d;
+            if (d < t.size() && (t[d] == '.' || t[d] == ')') && (d + 1 == t.size() || t[d + 1] == ' ')) {
+                t.insert(d, "\\");
+            }
+        }
+        if (!first) out += '\n';
+        out += t;
+        first = false;
+    }
+    // 最后一行的硬换行没有意义
+    if (!out.empty() && out.back() == '\\' && (out.size() < 2 || out[out.size() - 2] != '\\')) out.pop_back();
+    return out;
+}
+
+std::string joinBlocks(const std::vector<std::string>& blocks, const char* separator) {
+    std::string out;
+    for (const auto& block : blocks) {
+        if (block.empty()) continue;
+        if (!out.empty()) out += separator;
+        out += block;
+    }
+    return out;
+}
+
+std::vector<std::string> markdownBlocks(const HtmlNode& node);
+std::string blockMarkdown(const HtmlNode& node);
+
+std::string prefixLines(const std::string& text, const std::string& first, const std::string& rest) {
+    std::string out;
+    std::stringstream ss(text);
+    std::string line;
+    bool isFirst = true;
+    while (std::getline(ss, line)) {
+        const std::string& prefix = isFirst ? first : rest;
+        if (line.empty()) {
+            out += trimRight(prefix) + "\n";
+        } else {
+            out += prefix + line + "\n";
+        }
+        isFirst = false;
+    }
+    if (!out.empty()) out.pop_back();
+    return out;
+}
+
+std::string listMarkdown(const HtmlNode& list) {
+    bool ordered = list.tag == "ol";
+    int number = 1;
+    if (ordered && !list.attr("start").empty()) {
+        try {
+            number = std::stoi(list.attr("start"));
+        } catch (...) {
+        }
+    }
+    std::vector<std::string> items;
+    bool loose = false;
+    auto addItem = [&](const std::string& content) {
+        std::string marker = ordered ? std::to_string(number++) + ". " : "- ";
+        items.push_back(content.empty() ? trimRight(marker)
+                                        : prefixLines(content, marker, std::string(marker.size(), ' ')));
+    };
+    // 直接挂在列表下的非 li 内容（不规范的 HTML，或超过嵌套上限被展平）单独成项，避免丢失文本
+    std::vector<std::string> strayBlocks;
+    std::string strayInline;
+    auto flushInline = [&]() {
+        std::string paragraph = formatParagraph(strayInline);
+        if (!trim(paragraph).empty()) strayBlocks.push_back(paragraph);
+        strayInline.clear();
+    };
+    auto flushStray = [&]() {
+        flushInline();
+        if (!strayBlocks.empty()) addItem(joinBlocks(strayBlocks, "\n\n"));
+        strayBlocks.clear();
+    };
+    for (const auto& child : list.children) {
+        if (child->tag != "li") {
+            if (!child->tag.empty() && isBlockTag(child->tag)) {
+                flushInline();
+                std::string block = blockMarkdown(*child);
+                if (!block.empty()) strayBlocks.push_back(block);
+            } else {
+                strayInline += inlineMarkdown(*child);
+            }
+            continue;
+        }
+        flushStray();
+        // 编辑器中每个列表项通常包一层 <p>；只有多个段落时才是松散列表
+        size_t paragraphs = 0;
+        for (const auto& grandChild : child->children) {
+            if (grandChild->tag == "p") ++paragraphs;
+        }
+        if (paragraphs > 1) loose = true;
+        addItem(joinBlocks(markdownBlocks(*child), paragraphs > 1 ? "\n\n" : "\n"));
+    }
+    flushStray();
+    return joinBlocks(items, loose ? "\n\n" : "\n");
+}
+
+std::string tableMarkdown(const HtmlNode& table) {
+    std::vector<const HtmlNode*> rows;
+    // 按文档顺序收集 tr（包括 thead / tbody / tfoot 中的）
+    std::function<void(const HtmlNode&)> collect = [&](const HtmlNode& node) {
+        for (const auto& child : node.children) {
+            if (child->tag == "tr") {
+                rows.push_back(child.get());
+            } else if (child->tag == "thead" || child->tag == "tbody" || child->tag == "tfoot") {
+                collect(*child);
+            }
+        }
+    };
+    collect(table);
+    if (rows.empty()) return "";
+
+    std::vector<std::vector<std::string>> cells;
+    std::vector<std::string> aligns;
+    size_t columns = 0;
+    for (const auto* row : rows) {
+        std::vector<std::string> rowCells;
+        for (const auto& cell : row->children) {
+            if (cell->tag != "td" && cell->tag != "th") continue;
+            std::string text = trim(inlineChildren(*cell));
+            std::string escaped;
+            for (char c : text) {
+                if (c == '\n') {
+                    // 单元格内不能换行：硬换行标记改为空格
+                    if (!escaped.empty() && escaped.back() == '\\') escaped.back() = ' ';
+                    continue;
+                }
+                if (c == '|') escaped += '\\';
+                escaped += c;
+            }
+            rowCells.push_back(escaped);
+            if (cells.empty()) {
+                std::string align = toLower(cell->attr("align"));
+                std::string style = toLower(cell->attr("style"));
+                if (align.empty() && style.find("text-align") != std::string::npos) {
+                    for (const char* value : {"center", "right", "left"}) {
+                        if (style.find(value) != std::string::npos) {
+                            align = value;
+                            break;
+                        }
+                    }
+                }
+                aligns.push_back(align);
+            }
+        }
+        columns = std::max(columns, rowCells.size());
+        cells.push_back(std::move(rowCells));
+    }
+    if (columns == 0) return "";
+    aligns.resize(columns);
+
+    std::string out;
+    auto appendRow = [&](const std::vector<std::string>& row) {
+        out += "|";
+        for (size_t c = 0; c < columns; ++c) out += " " + (c < row.size() ? row[c] : "") + " |";
+        out += "\n";
+    };
+    appendRow(cells[0]);
+    out += "|";
+    for (const auto& align : aligns) {
+        out += align == "center" ? " :---: |" : align == "right" ? " ---: |" : align == "left" ? " :--- |" : " --- |";
+    }
+    out += "\n";
+    for (size_t r = 1; r < cells.size(); ++r) appendRow(cells[r]);
+    out.pop_back();
+    return out;
+}
+
+std::string blockMarkdown(const HtmlNode& node) {
+    const std::string& tag = node.tag;
+    if (tag == "p") return formatParagraph(inlineChildren(node));
+    if (tag.size() == 2 && tag[0] == 'h' && tag[1] >= '1' && tag[1] <= '6') {
+        std::string text = trim(inlineChildren(node));
+        std::replace(text.begin(), text.end(), '\n', ' ');
+        // 标题中的硬换行标记无意义
+        std::string cleaned;
+        for (size_t i = 0; i < text.size(); ++i) {
+            if (text[i] == '\\' && i + 1 < text.size() && text[i + 1] == ' ') continue;
+            cleaned += text[i];
+        }
+        // 结尾的 # 会被当作闭合序列去掉
+        if (!cleaned.empty() && cleaned.back() == '#') cleaned.insert(cleaned.find_last_not_of('#') + 1, "\\");
+        std::string hashes(static_cast<size_t>(tag[1] - '0'), '#');
+        return cleaned.empty() ? hashes : hashes + " " + cleaned;
+    }
+    // 用 *** 而不是 ---：紧跟在段落行之后的 --- 会变成 Setext 标题，"- ---" 也不是列表项
+    if (tag == "hr") return "***";
+    if (tag == "pre") {
+        std::string language;
+        for (const auto& child : node.children) {
+            if (child->tag != "code") continue;
+            std::string cls = child->attr("class");
+            for (const char* prefix : {"language-", "lang-"}) {
+                size_t at = cls.find(prefix);
+                if (at != std::string::npos) {
+                    size_t start = at + std::char_traits<char>::length(prefix);
+                    language = cls.substr(start, cls.find(' ', start) - start);
+                    break;
+                }
+            }
+        }
+        std::string code = textContent(node);
+        if (!code.empty() && code.back() == '\n') code.pop_back();
+        std::string fence = backtickFence(code, 3);
+        return fence + language + "\n" + (code.empty() ? "" : code + "\n") + fence;
+    }
+    if (tag == "blockquote") {
+        std::string inner = joinBlocks(markdownBlocks(node), "\n\n");
+        return inner.empty() ? ">" : prefixLines(inner, "> ", "> ");
+    }
+    if (tag == "ul" || tag == "ol") return listMarkdown(node);
+    if (tag == "table") return tableMarkdown(node);
+    return joinBlocks(markdownBlocks(node), "\n\n");
+}
+
+// 子节点序列化为块；连续的行内内容构成隐式段落
+std::vector<std::string> markdownBlocks(const HtmlNode& node) {
+    std::vector<std::string> blocks;
+    std::string inlineBuffer;
+    auto flushInline = [&]() {
+        std::string paragraph = formatParagraph(inlineBuffer);
+        if (!trim(paragraph).empty()) blocks.push_back(paragraph);
+        inlineBuffer.clear();
+    };
+    for (const auto& child : node.children) {
+        if (!child->tag.empty() && isBlockTag(child->tag)) {
+            flushInline();
+            std::string block = blockMarkdown(*child);
+            if (!block.empty()) blocks.push_back(block);
+        } else {
+            inlineBuffer += inlineMarkdown(*child);
+        }
+    }
+    flushInline();
+    return blocks;
+}
+}  // namespace
+
+std::string MarkdownCodec::toHtml(const std::string& markdown) {
+    RefMap refs;
+    Block document;
+    parseBlocks(splitLines(markdown), document, refs);
+    // 链接引用定义可以出现在使用之后：先完成块级解析再渲染行内内容
+    std::string html;
+    renderBlock(document, refs, false, html);
+    return html;
+}
+
+std::string MarkdownCodec::toMarkdown(const std::string& html) {
+    if (html.find('<') == std::string::npos) return html;  // 纯文本内容原样返回
+    auto root = parseHtml(html);
+    std::string markdown = joinBlocks(markdownBlocks(*root), "\n\n");
+    return trim(markdown);
+}
+
+struct MarkdownStreamRenderer::State {
+    size_t segmentBytes;
+    RefMap refs;            // 跨分段保留，后续分段可以引用前面的定义
+    std::string partial;    // 尚未以换行结束的输入
+    std::string segment;    // 当前分段的原文
+    bool previousBlank{false};
+    bool inFence{false};
+    char fenceChar{0};
+    size_t fenceLength{0};
+    int htmlKind{0};        // 进行中的 HTML 块（1-5 类可以包含空行）
+    bool collecting{false};  // 第一遍只解析不渲染
+
+    void render(std::string& html) {
+        if (segment.empty()) return;
+        Block document;
+        // 同名定义以第一次出现为准，第二遍重复解析不会改变第一遍收集的结果
+        parseBlocks(splitLines(segment), document, refs);
+        if (!collecting) renderBlock(document, refs, false, html);
+        segment.clear();
+    }
+
+    // 按行切分输入，不完整的最后一行留到下次
+    void consume(const char* data, size_t length, std::string& html) {
+        size_t start = 0;
+        for (size_t i = 0; i < length; ++i) {
+            if (data[i] != '\n') continue;
+            if (partial.empty()) {
+                addLine(data + start, i + 1 - start, html);
+            } else {
+                partial.append(data + start, i + 1 - start);
+                addLine(partial.data(), partial.size(), html);
+                partial.clear();
+            }
+            start = i + 1;
+        }
+        partial.append(data + start, length - start);
+    }
+
+    void flush(std::string& html) {
+        if (!partial.empty()) {
+            addLine(partial.data(), partial.size(), html);
+            partial.clear();
+        }
+        render(html);
+    }
+
+    void addLine(const char* data, size_t length, std::string& html) {
+        std::string line(data, length);
+        while (!line.empty() && (line.back() == '\n' || line.back() == '\r')) line.pop_back();
+        bool blank = isBlank(line);
+
+        // 空行之后的顶格行开始新的顶层块：列表、引用、段落都已在空行处结束（列表项除外，可能延续松散列表）
+        ListMarker marker;
+        if (segment.size() >= segmentBytes && previousBlank && !blank && !inFence && htmlKind == 0 &&
+            line[0] != ' ' && line[0] != '\t' && !parseListMarker(line, 0, marker)) {
+            render(html);
+        }
+
+        std::string info;
+        if (inFence) {
+            if (isFenceClose(line, fenceChar, fenceLength)) inFence = false;
+        } else if (htmlKind) {
+            if (htmlBlockEnds(htmlKind, line)) htmlKind = 0;
+        } else if (parseFenceStart(line, fenceChar, fenceLength, info)) {
+            inFence = true;
+        } else {
+            int kind = htmlBlockKind(line);
+            if (kind >= 1 && kind <= 5 && !htmlBlockEnds(kind, line)) htmlKind = kind;
+        }
+        previousBlank = blank;
+        segment.append(data, length);
+    }
+};
+
+MarkdownStreamRenderer::MarkdownStreamRenderer(size_t segmentBytes) : state_(std::make_unique<State>()) {
+    state_->segmentBytes = segmentBytes;
+}
+
+MarkdownStreamRenderer::~MarkdownStreamRenderer() = default;
+
+void MarkdownStreamRenderer::collect(const char* data, size_t length) {
+    state_->collecting = true;
+    std::string unused;
+    state_->consume(data, length, unused);
+}
+
+void MarkdownStreamRenderer::endCollect() {
+    auto& state = *state_;
+    std::string unused;
+    state.flush(unused);
+    // 保留 refs，分段状态回到输入开头
+    state.collecting = false;
+    state.previousBlank = false;
+    state.inFence = false;
+    state.fenceChar = 0;
+    state.fenceLength = 0;
+    state.htmlKind = 0;
+}
+
+void MarkdownStreamRenderer::feed(const char* data, size_t length, std::string& html) {
+    state_->consume(data, length, html);
+}
+
+void MarkdownStreamRenderer::finish(std::string& html) {
+    state_->flush(html);
+}
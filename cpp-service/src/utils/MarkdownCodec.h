@@ -0,0 +1,56 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+/**
+ * MarkdownCodec 在进程内完成 Markdown 与 HTML 的互相转换，取代 doc-converter 的
+ * /convert/markdown-to-html 与 /convert/html-to-markdown。
+ *
+ * toHtml 按 CommonMark 规则渲染，并支持 GFM 表格、删除线与任务列表：
+ * - 块级：ATX / Setext 标题、分隔线、缩进与围栏代码块、引用、有序 / 无序列表（区分紧凑与松散）、
+ *   HTML 块、链接引用定义、表格、段落；
+ * - 行内：反斜杠转义、实体、代码片段、强调（分隔符栈算法）、链接 / 图片（行内与引用式）、
+ *   自动链接、行内 HTML、硬换行；
+ * - 与 marked 一致，原始 HTML 原样保留；链接中的 javascript: / vbscript: / data:（图片除外）地址会被清空；
+ * - 引用 / 列表嵌套超过 32 层后按段落处理；强调与链接括号的处理均为线性时间，未闭合的 [ ( < 不会导致回溯。
+ *
+ * toMarkdown 将编辑器产生的 HTML 序列化为 Markdown：标题、段落、强调、删除线、代码、链接、图片、
+ * 列表（可嵌套，含任务列表复选框）、引用、代码块、表格、分隔线；其余标签只保留文本。
+ * 超过 64 层的元素嵌套会被展平到上一层。输入不含 HTML 标签时原样返回。
+ */
+class MarkdownCodec {
+public:
+    static std::string toHtml(const std::string& markdown);
+    static std::string toMarkdown(const std::string& html);
+};
+
+/**
+ * MarkdownStreamRenderer 分段渲染大文档：输入按顶层块边界切成约 segmentBytes 的分段，逐段解析渲染，
+ * 解析期间的内存占用取决于分段大小而不是文档大小。
+ *
+ * 切分点只选在空行之后、顶格且不是列表项的行前，并避开围栏代码块与可跨空行的 HTML 块，
+ * 因此每个块的解析与 toHtml 相同。
+ *
+ * 链接引用定义可以出现在使用之后：先用 collect / endCollect 把整份输入过一遍收集定义（同样按分段解析，不产生输出），
+ * 再用 feed / finish 渲染，结果与 toHtml 一致。跳过第一遍时定义只对所在分段及其后的分段生效。
+ */
+class MarkdownStreamRenderer {
+public:
+    explicit MarkdownStreamRenderer(size_t segmentBytes = 256 * 1024);
+    ~MarkdownStreamRenderer();
+
+    // 第一遍：追加输入，只收集链接引用定义
+    void collect(const char* data, size_t length);
+    // 第一遍结束；之后从头 feed 同一份输入
+    void endCollect();
+
+    // 追加输入；已完成分段的 HTML 追加到 html
+    void feed(const char* data, size_t length, std::string& html);
+    // 输入结束，渲染剩余内容
+    void finish(std::string& html);
+
+private:
+    struct State;
+    std::unique_ptr<State> state_;
+};
@@ -222,3 +222,43 @@ void MinIOClient::downloadFile(const std::string& objectName,
         }
     });
 }
+
+void MinIOClient::deleteFile(const std::string& objectName, std::function<void()>&& callback,
+                             std::function<void(const std::string& error)>&& errorCallback) {
+    // 1. 获取配置
+    std::string endpoint = getConfigValue("minio_endpoint", "localhost:9000");
+    std::string accessKey = getConfigValue("minio_access_key", "minioadmin");
+    std::string secretKey = getConfigValue("minio_secret_key", "minioadmin");
+    std::string bucket = getConfigValue("minio_bucket", "documents");
+
+    // 2. 创建 HTTP 客户端
+    auto client = drogon::HttpClient::newHttpClient("http://" + endpoint);
+    auto req = drogon::HttpRequest::newHttpRequest();
+    req->setMethod(drogon::Delete);
+    req->setPath("/" + bucket + "/" + objectName);
+
+    // 3. 添加认证头（使用 AWS Signature Version 4）
+    std::string date = getCurrentTimestamp();
+    req->addHeader("x-amz-date", date);
+    req->addHeader("x-amz-content-sha256", "UNSIGNED-PAYLOAD");
+
+    std::string fullPath = bucket + "/" + objectName;
+    std::string authorization = generateSignature("DELETE", fullPath, date, accessKey, secretKey);
+    req->addHeader("Authorization", authorization);
+
+    // 4. 发送请求（S3 删除不存在的对象同样返回 204）
+    client->sendRequest(req, [callback = std::move(callback), errorCallback = std::move(errorCallback)](
+                                     drogon::ReqResult result, const drogon::HttpResponsePtr& resp) {
+        if (result != drogon::ReqResult::Ok) {
+            errorCallback("Failed to connect to MinIO: " + std::to_string(static_cast<int>(result)));
+            return;
+        }
+
+        int statusCode = resp->getStatusCode();
+        if (statusCode == drogon::k200OK || statusCode == drogon::k204NoContent || statusCode == drogon::k404NotFound) {
+            callback();
+        } else {
+            errorCallback("MinIO delete failed: HTTP " + std::to_string(statusCode));
+        }
+    });
+}
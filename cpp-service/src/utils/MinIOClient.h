@@ -45,6 +45,19 @@ public:
         std::function<void(const std::string& error)>&& errorCallback
     );
 
+    /**
+     * 删除 MinIO 中的对象（对象不存在也视为成功）
+     *
+     * @param objectName 对象名称（路径）
+     * @param callback 成功回调
+     * @param errorCallback 错误回调
+     */
+    static void deleteFile(
+        const std::string& objectName,
+        std::function<void()>&& callback,
+        std::function<void(const std::string& error)>&& errorCallback
+    );
+
     /**
      * 从配置获取 MinIO 配置值
      */
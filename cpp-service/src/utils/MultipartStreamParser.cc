@@ -0,0 +1,186 @@
+#include "MultipartStreamParser.h"
+
+#include <algorithm>
+#include <cctype>
+
+namespace {
+std::string toLower(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return std::tolower(c); });
+    return s;
+}
+
+std::string trim(const std::string& s) {
+    size_t begin = s.find_first_not_of(" \t");
+    if (begin == std::string::npos) return "";
+    size_t end = s.find_last_not_of(" \t");
+    return s.substr(begin, end - begin + 1);
+}
+
+// 头部参数值：支持带引号（含反斜杠转义）与不带引号两种写法
+std::string headerParam(const std::string& header, const std::string& key) {
+    std::string lower = toLower(header);
+    size_t pos = 0;
+    while ((pos = lower.find(key + "=", pos)) != std::string::npos) {
+        // 要求是完整的参数名，避免 name= 匹配到 filename=
+        if (pos > 0 && lower[pos - 1] != ';' && lower[pos - 1] != ' ' && lower[pos - 1] != '\t') {
+            pos += key.size();
+            continue;
+        }
+        size_t p = pos + key.size() + 1;
+        std::string value;
+        if (p < header.size() && header[p] == '"') {
+            for (++p; p < header.size() && header[p] != '"'; ++p) {
+                if (header[p] == '\\' && p + 1 < header.size()) ++p;
+                value += header[p];
+            }
+        } else {
+            while (p < header.size() && header[p] != ';' && header[p] != ' ' && header[p] != '\t') value += header[p++];
+        }
+        return value;
+    }
+    return "";
+}
+}  // namespace
+
+std::string MultipartStreamParser::boundaryFrom(const std::string& contentType) {
+    std::string lower = toLower(contentType);
+    if (lower.compare(0, 19, "multipart/form-data") != 0) return "";
+    std::string boundary = headerParam(contentType, "boundary");
+    // RFC 2046：边界长度 1-70
+    if (boundary.empty() || boundary.size() > 70) return "";
+    return boundary;
+}
+
+MultipartStreamParser::MultipartStreamParser(const std::string& boundary, PartHandler onPart, DataHandler onData,
+                                             EndHandler onPartEnd)
+    : delimiter_("\r\n--" + boundary),
+      onPart_(std::move(onPart)),
+      onData_(std::move(onData)),
+      onPartEnd_(std::move(onPartEnd)) {}
+
+bool MultipartStreamParser::fail(const std::string& message) {
+    state_ = State::Failed;
+    error_ = message;
+    buffer_.clear();
+    return false;
+}
+
+bool MultipartStreamParser::parseHeaders(const std::string& block) {
+    part_ = PartInfo();
+    size_t start = 0;
+    while (start < block.size()) {
+        size_t end = block.find("\r\n", start);
+        if (end == std::string::npos) end = block.size();
+        std::string line = block.substr(start, end - start);
+        start = end + 2;
+        size_t colon = line.find(':');
+        if (colon == std::string::npos) continue;
+        std::string name = toLower(trim(line.substr(0, colon)));
+        std::string value = trim(line.substr(colon + 1));
+        if (name == "content-disposition") {
+            part_.name = headerParam(value, "name");
+            part_.filename = headerParam(value, "filename");
+        } else if (name == "content-type") {
+            part_.contentType = value;
+        }
+    }
+    return true;
+}
+
+bool MultipartStreamParser::feed(const char* data, size_t length) {
+    if (state_ == State::Failed) return false;
+    if (state_ == State::Done) return true;  // 忽略结束边界之后的内容
+    buffer_.append(data, length);
+
+    auto consume = [this](size_t n) {
+        buffer_.erase(0, n);
+        consumed_ += n;
+    };
+
+    while (true) {
+        switch (state_) {
+            case State::Preamble: {
+                // 请求体通常直接以 "--boundary" 开头，前面没有换行
+                const std::string first = delimiter_.substr(2);
+                if (consumed_ == 0 && buffer_.size() < first.size() && first.compare(0, buffer_.size(), buffer_) == 0) {
+                    return true;
+                }
+                if (consumed_ == 0 && buffer_.compare(0, first.size(), first) == 0) {
+                    consume(first.size());
+                    state_ = State::AfterBoundary;
+                    break;
+                }
+                size_t pos = buffer_.find(delimiter_);
+                if (pos == std::string::npos) {
+                    // 丢弃前导内容，保留可能是边界前缀的尾部
+                    if (buffer_.size() >= delimiter_.size()) consume(buffer_.size() - delimiter_.size() + 1);
+                    return true;
+                }
+                consume(pos + delimiter_.size());
+                state_ = State::AfterBoundary;
+                break;
+            }
+            case State::AfterBoundary: {
+                size_t spaces = 0;
+                while (spaces < buffer_.size() && (buffer_[spaces] == ' ' || buffer_[spaces] == '\t')) ++spaces;
+                if (spaces) consume(spaces);
+                if (buffer_.size() < 2) return true;
+                if (buffer_.compare(0, 2, "--") == 0) {
+                    state_ = State::Done;
+                    consumed_ += buffer_.size();
+                    buffer_.clear();
+                    return true;
+                }
+                if (buffer_.compare(0, 2, "\r\n") != 0) return fail("Malformed multipart boundary");
+                consume(2);
+                state_ = State::Headers;
+                break;
+            }
+            case State::Headers: {
+                size_t headerEnd;
+                size_t separator;
+                if (buffer_.compare(0, 2, "\r\n") == 0) {
+                    headerEnd = 0;  // 没有头部
+                    separator = 2;
+                } else {
+                    headerEnd = buffer_.find("\r\n\r\n");
+                    separator = 4;
+                }
+                if (headerEnd == std::string::npos || buffer_.size() < 2) {
+                    if (buffer_.size() > kMaxHeaderBytes) return fail("Multipart headers too large");
+                    return true;
+                }
+                parseHeaders(buffer_.substr(0, headerEnd));
+                consume(headerEnd + separator);
+                part_.dataOffset = consumed_;
+                state_ = State::Body;
+                if (onPart_ && !onPart_(part_)) return fail("Aborted");
+                break;
+            }
+            case State::Body: {
+                size_t pos = buffer_.find(delimiter_);
+                if (pos == std::string::npos) {
+                    // 保留可能是边界前缀的尾部，其余全部交给调用方
+                    size_t keep = delimiter_.size() - 1;
+                    if (buffer_.size() > keep) {
+                        size_t emit = buffer_.size() - keep;
+                        if (onData_ && !onData_(buffer_.data(), emit)) return fail("Aborted");
+                        consume(emit);
+                    }
+                    return true;
+                }
+                if (pos > 0 && onData_ && !onData_(buffer_.data(), pos)) return fail("Aborted");
+                if (onPartEnd_ && !onPartEnd_()) return fail("Aborted");
+                consume(pos + delimiter_.size());
+                state_ = State::AfterBoundary;
+                break;
+            }
+            case State::Done:
+                consumed_ += buffer_.size();
+                buffer_.clear();
+                return true;
+            case State::Failed:
+                return false;
+        }
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+/**
+ * MultipartStreamParser 增量解析 multipart/form-data 请求体，输入可以按任意大小分块。
+ *
+ * - 每个部分的头部解析完成后回调 onPart，正文分片回调 onData（一个部分可能被切成多片），结束时回调 onPartEnd；
+ * - 只缓存边界匹配所需的尾部字节与单个部分的头部（上限 kMaxHeaderBytes），内存占用与请求体大小无关；
+ * - 回调返回 false 时中止解析。
+ */
+class MultipartStreamParser {
+public:
+    struct PartInfo {
+        std::string name;
+        std::string filename;
+        std::string contentType;
+        uint64_t dataOffset{0};  // 正文在整个请求体中的起始偏移
+    };
+
+    using PartHandler = std::function<bool(const PartInfo& part)>;
+    using DataHandler = std::function<bool(const char* data, size_t length)>;
+    using EndHandler = std::function<bool()>;
+
+    static constexpr size_t kMaxHeaderBytes = 16 * 1024;
+
+    // 从 Content-Type 中取出 boundary，不是 multipart/form-data 时返回空串
+    static std::string boundaryFrom(const std::string& contentType);
+
+    MultipartStreamParser(const std::string& boundary, PartHandler onPart, DataHandler onData, EndHandler onPartEnd);
+
+    // 输入下一块数据；格式错误或回调中止时返回 false，之后的输入都会被拒绝
+    bool feed(const char* data, size_t length);
+
+    // 是否已读到结束边界
+    bool done() const { return state_ == State::Done; }
+    const std::string& error() const { return error_; }
+
+private:
+    enum class State { Preamble, AfterBoundary, Headers, Body, Done, Failed };
+
+    bool fail(const std::string& message);
+    bool parseHeaders(const std::string& block);
+
+    std::string delimiter_;  // "\r\n--" + boundary
+    PartHandler onPart_;
+    DataHandler onData_;
+    EndHandler onPartEnd_;
+
+    State state_{State::Preamble};
+    std::string buffer_;      // 尚未消费的输入
+    uint64_t consumed_{0};    // buffer_ 首字节在请求体中的偏移
+    PartInfo part_;
+    std::string error_;
+};
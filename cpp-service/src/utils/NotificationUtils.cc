@@ -6,7 +6,7 @@
 #include <memory>
 #include <unordered_set>
 
-#include "../services/NotificationHub.h"
+#include "../services/NotificationWriter.h"
 
 void NotificationUtils::createCommentNotification(int docId, int commentId, int authorId, int targetUserId) {
     Json::Value payload;
@@ -129,43 +129,28 @@ void NotificationUtils::createPermissionChangeNotification(int docId, int userId
     insertNotification(userId, "permission_changed", payload);
 }
 
-// 根据用户偏好写入通知并触发实时推送。
-void NotificationUtils::insertNotification(int userId, const std::string& type, const Json::Value& payload) {
-    auto db = drogon::app().getDbClient();
-    if (!db) return;
-    auto dbClient = db;
+Json::Value NotificationUtils::buildNotificationJson(const drogon::orm::Row& row) {
+    Json::Value notificationJson;
+    notificationJson["id"] = row["id"].as<int>();
+    notificationJson["user_id"] = row["user_id"].as<int>();
+    notificationJson["type"] = row["type"].as<std::string>();
+    notificationJson["is_read"] = row["is_read"].as<bool>();
+    notificationJson["created_at"] = row["created_at"].as<std::string>();
+
+    Json::Value payloadJson;
+    const std::string payloadText = row["payload"].as<std::string>();
+    Json::CharReaderBuilder readerBuilder;
+    std::unique_ptr<Json::CharReader> reader(readerBuilder.newCharReader());
+    JSONCPP_STRING errs;
+    if (reader->parse(payloadText.data(), payloadText.data() + payloadText.size(), &payloadJson, &errs)) {
+        notificationJson["payload"] = payloadJson;
+    } else {
+        notificationJson["payload_raw"] = payloadText;
+    }
+    return notificationJson;
+}
 
-    Json::StreamWriterBuilder builder;
-    std::string payloadStr = Json::writeString(builder, payload);
-    std::string userIdStr = std::to_string(userId);
-
-        dbClient->execSqlAsync(
-                "INSERT INTO notification (user_id, type, payload) VALUES ($1::bigint, $2, $3::jsonb) "
-                "RETURNING id, user_id, type, payload, is_read, created_at",
-                [=](const drogon::orm::Result& r) {
-                    if (r.empty()) {
-                        return;
-                    }
-
-                    Json::Value notificationJson;
-                    notificationJson["id"] = r[0]["id"].as<int>();
-                    notificationJson["user_id"] = r[0]["user_id"].as<int>();
-                    notificationJson["type"] = r[0]["type"].as<std::string>();
-                    notificationJson["is_read"] = r[0]["is_read"].as<bool>();
-                    notificationJson["created_at"] = r[0]["created_at"].as<std::string>();
-
-                    Json::Value payloadJson;
-                    const std::string payloadText = r[0]["payload"].as<std::string>();
-                    Json::CharReaderBuilder readerBuilder;
-                    std::unique_ptr<Json::CharReader> reader(readerBuilder.newCharReader());
-                    JSONCPP_STRING errs;
-                    if (reader->parse(payloadText.data(), payloadText.data() + payloadText.size(), &payloadJson, &errs)) {
-                        notificationJson["payload"] = payloadJson;
-                    } else {
-                        notificationJson["payload_raw"] = payloadText;
-                    }
-
-                    NotificationHub::pushNotification(userId, notificationJson);
-                },
-            [](const drogon::orm::DrogonDbException&) {}, userIdStr, type, payloadStr);
-}
\ No newline at end of file
+// 写入通知并触发实时推送：交给 NotificationWriter 异步批量落库，调用方立即返回。
+void NotificationUtils::insertNotification(int userId, const std::string& type, const Json::Value& payload) {
+    NotificationWriter::enqueue(userId, type, payload);
+}
@@ -1,5 +1,6 @@
 // 在创建评论、任务等操作时，需要触发通知
 #pragma once
+#include <drogon/orm/Row.h>
 #include <json/json.h>
 
 #include <string>
@@ -18,6 +19,9 @@ public:
     // 创建文档权限变更通知
     static void createPermissionChangeNotification(int docId, int userId, const std::string& permission);
 
+    // 将 notification 行（id, user_id, type, payload, is_read, created_at）转换为推送用 JSON
+    static Json::Value buildNotificationJson(const drogon::orm::Row& row);
+
 private:
     static void insertNotification(int userId, const std::string& type, const Json::Value& payload);
 };
@@ -2,6 +2,9 @@
 
 #include <drogon/drogon.h>
 
+#include "../repositories/StatementRegistry.h"
+#include "ResponseUtils.h"
+
 void PermissionUtils::checkPermission(int docId, int userId, std::function<void(const std::string&)> successCallback,
                                       std::function<void(const std::string&)> errorCallback) {
     auto db = drogon::app().getDbClient();
@@ -10,16 +13,9 @@ void PermissionUtils::checkPermission(int docId, int userId, std::function<void(
         return;
     }
 
-    // 检查权限
+    // 检查权限：user_doc_access 中已是 owner 优先合并后的有效权限
     db->execSqlAsync(
-            "SELECT COALESCE(MAX(permission), 'none') as permission "
-            "FROM ("
-            "  SELECT permission FROM doc_acl "
-            "  WHERE doc_id = $1::integer AND user_id = $2::integer "
-            "  UNION ALL "
-            "  SELECT 'owner'::VARCHAR(16) FROM document "
-            "  WHERE id = $1::integer AND owner_id = $2::integer"
-            ") perm",
+            StatementRegistry::docPermission(),
             [=](const drogon::orm::Result& r) {
                 if (r.empty()) {
                     successCallback("none");
@@ -69,3 +65,66 @@ void PermissionUtils::hasPermission(int docId, int userId, const std::string& re
                 callback(false);
             });
 }
+
+// 辅助函数：查询用户角色，用户不存在时 role 为空字符串
+static void queryRole(int userId, std::function<void(const std::string&)> onRole,
+                      std::function<void(const std::string&)> onError) {
+    auto db = drogon::app().getDbClient();
+    if (!db) {
+        onError("Database not available");
+        return;
+    }
+
+    db->execSqlAsync(
+            StatementRegistry::userRole(),
+            [=](const drogon::orm::Result& r) { onRole(r.empty() ? "" : r[0]["role"].as<std::string>()); },
+            [=](const drogon::orm::DrogonDbException& e) {
+                onError("Database error: " + std::string(e.base().what()));
+            },
+            std::to_string(userId));
+}
+
+void PermissionUtils::isAdmin(int userId, std::function<void(bool)> callback) {
+    queryRole(
+            userId, [callback](const std::string& role) { callback(role == "admin"); },
+            [callback](const std::string&) { callback(false); });
+}
+
+void PermissionUtils::ensureAdmin(int userId,
+                                  const std::shared_ptr<std::function<void(const drogon::HttpResponsePtr&)>>& callback,
+                                  std::function<void()> onSuccess) {
+    queryRole(
+            userId,
+            [callback, onSuccess](const std::string& role) {
+                if (role.empty()) {
+                    ResponseUtils::sendError(*callback, "User not found", drogon::k404NotFound);
+                    return;
+                }
+                if (role != "admin") {
+                    ResponseUtils::sendError(*callback, "Admin privileges required", drogon::k403Forbidden);
+                    return;
+                }
+                onSuccess();
+            },
+            [callback](const std::string& error) {
+                ResponseUtils::sendError(*callback, error, drogon::k500InternalServerError);
+            });
+}
+
+void PermissionUtils::ensureAdmin(const drogon::HttpRequestPtr& req,
+                                  const std::shared_ptr<std::function<void(const drogon::HttpResponsePtr&)>>& callback,
+                                  std::function<void()> onSuccess) {
+    std::string userIdStr = req->getParameter("user_id");
+    if (userIdStr.empty()) {
+        ResponseUtils::sendError(*callback, "Unauthorized", drogon::k401Unauthorized);
+        return;
+    }
+    int userId;
+    try {
+        userId = std::stoi(userIdStr);
+    } catch (...) {
+        ResponseUtils::sendError(*callback, "Invalid user ID", drogon::k400BadRequest);
+        return;
+    }
+    ensureAdmin(userId, callback, std::move(onSuccess));
+}
@@ -2,6 +2,7 @@
 #include <drogon/drogon.h>
 
 #include <functional>
+#include <memory>
 #include <string>
 
 class PermissionUtils {
@@ -16,4 +17,17 @@ public:
     // 检查是否有指定权限
     static void hasPermission(int docId, int userId, const std::string& requiredPermission,
                               std::function<void(bool)> callback);
+
+    // 检查用户是否为系统管理员（role = admin）
+    static void isAdmin(int userId, std::function<void(bool)> callback);
+
+    // 管理员接口的前置校验：通过后执行 onSuccess，否则直接返回错误响应
+    // （用户不存在 404，非管理员 403，数据库错误 500）
+    static void ensureAdmin(int userId,
+                            const std::shared_ptr<std::function<void(const drogon::HttpResponsePtr&)>>& callback,
+                            std::function<void()> onSuccess);
+    // 同上，user_id 取自请求参数（缺失 401，非数字 400）
+    static void ensureAdmin(const drogon::HttpRequestPtr& req,
+                            const std::shared_ptr<std::function<void(const drogon::HttpResponsePtr&)>>& callback,
+                            std::function<void()> onSuccess);
 };
\ No newline at end of file
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * SingleFlight 合并同一时刻对同一资源的重复加载。
+ *
+ * 同一 key 在加载期间再次请求时不会发起新的数据库查询 / 对象下载，而是挂到正在进行的加载上，
+ * 加载完成后把同一份结果分发给所有等待者。只合并“进行中”的请求，完成后不缓存结果。
+ *
+ * key 应包含资源标识与版本标记（如快照对象名），内容变化后新请求自然落到新的 key 上；
+ * 无法在 key 中体现版本的资源，写入后调用 forget，之后的请求会重新加载。
+ * 权限检查等与请求者相关的逻辑不应放在 loader 中。
+ */
+template <typename T>
+class SingleFlight {
+public:
+    using Callback = std::function<void(const T&)>;
+    using ErrorCallback = std::function<void(const std::string&)>;
+    // loader 必须且只能调用 done 或 fail 其中之一一次
+    using Loader = std::function<void(Callback done, ErrorCallback fail)>;
+
+    void run(const std::string& key, Loader loader, Callback onDone, ErrorCallback onError) {
+        std::shared_ptr<Flight> flight;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = inFlight_.find(key);
+            if (it != inFlight_.end()) {
+                it->second->waiters.push_back({std::move(onDone), std::move(onError)});
+                return;
+            }
+            flight = std::make_shared<Flight>();
+            flight->waiters.push_back({std::move(onDone), std::move(onError)});
+            inFlight_[key] = flight;
+        }
+
+        // 在锁外启动加载：loader 可能同步完成
+        loader([this, key, flight](const T& value) { finish(key, flight, &value, nullptr); },
+               [this, key, flight](const std::string& error) { finish(key, flight, nullptr, &error); });
+    }
+
+    // 资源已被修改：正在进行的加载仍交付给已有等待者，新请求不再加入它
+    void forget(const std::string& key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        inFlight_.erase(key);
+    }
+
+private:
+    struct Waiter {
+        Callback onDone;
+        ErrorCallback onError;
+    };
+
+    struct Flight {
+        std::vector<Waiter> waiters;
+    };
+
+    void finish(const std::string& key, const std::shared_ptr<Flight>& flight, const T* value,
+                const std::string* error) {
+        std::vector<Waiter> waiters;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = inFlight_.find(key);
+            if (it != inFlight_.end() && it->second == flight) {
+                inFlight_.erase(it);
+            }
+            waiters = std::move(flight->waiters);
+            flight->waiters.clear();
+        }
+        for (auto& waiter : waiters) {
+            if (value) {
+                waiter.onDone(*value);
+            } else {
+                waiter.onError(*error);
+            }
+        }
+    }
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::shared_ptr<Flight>> inFlight_;
+};
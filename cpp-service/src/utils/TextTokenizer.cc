@@ -0,0 +1,142 @@
+#include "TextTokenizer.h"
+
+namespace {
+// 单个拉丁词的最大长度（字节），超出部分截断
+constexpr size_t kMaxWordLength = 64;
+
+enum class CharClass { Separator, Word, Cjk };
+
+// 解码一个 UTF-8 字符，返回码点并前移 pos；非法字节按单字节分隔符处理
+char32_t decodeUtf8(const std::string& text, size_t& pos) {
+    unsigned char c = static_cast<unsigned char>(text[pos]);
+    int extra = 0;
+    char32_t cp = 0;
+    if (c < 0x80) {
+        cp = c;
+    } else if ((c & 0xE0) == 0xC0) {
+        cp = c & 0x1F;
+        extra = 1;
+    } else if ((c & 0xF0) == 0xE0) {
+        cp = c & 0x0F;
+        extra = 2;
+    } else if ((c & 0xF8) == 0xF0) {
+        cp = c & 0x07;
+        extra = 3;
+    } else {
+        ++pos;
+        return 0xFFFD;
+    }
+    if (pos + extra >= text.size()) {
+        ++pos;
+        return 0xFFFD;
+    }
+    for (int i = 1; i <= extra; ++i) {
+        unsigned char cc = static_cast<unsigned char>(text[pos + i]);
+        if ((cc & 0xC0) != 0x80) {
+            ++pos;
+            return 0xFFFD;
+        }
+        cp = (cp << 6) | (cc & 0x3F);
+    }
+    pos += extra + 1;
+    return cp;
+}
+
+void appendUtf8(std::string& out, char32_t cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+// 全角字母数字转半角，大写转小写
+char32_t normalize(char32_t cp) {
+    if ((cp >= 0xFF10 && cp <= 0xFF19) || (cp >= 0xFF21 && cp <= 0xFF3A) || (cp >= 0xFF41 && cp <= 0xFF5A)) {
+        cp -= 0xFEE0;
+    }
+    if (cp >= 'A' && cp <= 'Z') cp += 'a' - 'A';
+    return cp;
+}
+
+CharClass classify(char32_t cp) {
+    if ((cp >= '0' && cp <= '9') || (cp >= 'a' && cp <= 'z')) return CharClass::Word;
+    if ((cp >= 0x4E00 && cp <= 0x9FFF) ||    // CJK 统一汉字
+        (cp >= 0x3400 && cp <= 0x4DBF) ||    // 扩展 A
+        (cp >= 0x20000 && cp <= 0x2A6DF) ||  // 扩展 B
+        (cp >= 0xF900 && cp <= 0xFAFF) ||    // 兼容汉字
+        (cp >= 0x3040 && cp <= 0x30FF) ||    // 平假名、片假名
+        (cp >= 0xAC00 && cp <= 0xD7AF)) {    // 韩文音节
+        return CharClass::Cjk;
+    }
+    // 带变音符号的拉丁字母、西里尔字母等按普通词处理
+    if ((cp >= 0x00C0 && cp <= 0x024F && cp != 0x00D7 && cp != 0x00F7) || (cp >= 0x0370 && cp <= 0x052F)) {
+        return CharClass::Word;
+    }
+    return CharClass::Separator;
+}
+
+std::vector<std::string> split(const std::string& text, bool cjkUnigrams) {
+    std::vector<std::string> tokens;
+    std::string word;
+    std::string prevCjk;  // 上一个 CJK 字符（UTF-8）
+    bool cjkRunEmitted = false;
+
+    auto endWord = [&]() {
+        if (!word.empty()) {
+            tokens.push_back(std::move(word));
+            word.clear();
+        }
+    };
+    auto endCjkRun = [&]() {
+        // 连续片段只有一个字符时，单字作为一个词（索引时已按单字输出）
+        if (!prevCjk.empty() && !cjkRunEmitted && !cjkUnigrams) tokens.push_back(prevCjk);
+        prevCjk.clear();
+        cjkRunEmitted = false;
+    };
+
+    size_t pos = 0;
+    while (pos < text.size()) {
+        char32_t cp = normalize(decodeUtf8(text, pos));
+        switch (classify(cp)) {
+            case CharClass::Word:
+                endCjkRun();
+                if (word.size() < kMaxWordLength) appendUtf8(word, cp);
+                break;
+            case CharClass::Cjk: {
+                endWord();
+                std::string current;
+                appendUtf8(current, cp);
+                if (!prevCjk.empty()) {
+                    tokens.push_back(prevCjk + current);
+                    cjkRunEmitted = true;
+                }
+                if (cjkUnigrams) tokens.push_back(current);
+                prevCjk = std::move(current);
+                break;
+            }
+            case CharClass::Separator:
+                endWord();
+                endCjkRun();
+                break;
+        }
+    }
+    endWord();
+    endCjkRun();
+    return tokens;
+}
+}  // namespace
+
+std::vector<std::string> TextTokenizer::tokenize(const std::string& text) { return split(text, false); }
+
+std::vector<std::string> TextTokenizer::tokenizeForIndex(const std::string& text) { return split(text, true); }
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/**
+ * 全文索引分词。
+ *
+ * - 拉丁字母与数字按连续片段切词，统一转小写（全角字母数字先转半角）；
+ * - 中日韩字符按相邻二元组（bigram）切分，"协作文档" -> 协作 / 作文 / 文档，
+ *   单独出现的一个汉字作为一个词；索引时另外为每个汉字输出单字词，单字查询因此也能命中；
+ * - 标点、空白及其他符号作为分隔符。
+ */
+class TextTokenizer {
+public:
+    // 切分为查询词（按出现顺序，不去重）
+    static std::vector<std::string> tokenize(const std::string& text);
+    // 切分为索引词：在 tokenize 的结果上增加每个中日韩字符的单字词
+    static std::vector<std::string> tokenizeForIndex(const std::string& text);
+};
@@ -0,0 +1,135 @@
+#include "ZipStreamWriter.h"
+
+#include <zlib.h>
+
+#include <ctime>
+
+namespace {
+constexpr uint32_t kLocalHeaderSignature = 0x04034b50;
+constexpr uint32_t kCentralHeaderSignature = 0x02014b50;
+constexpr uint32_t kEndOfCentralSignature = 0x06054b50;
+constexpr uint16_t kVersionNeeded = 20;
+constexpr uint16_t kFlagUtf8 = 0x0800;
+constexpr uint16_t kMethodStore = 0;
+constexpr uint16_t kMethodDeflate = 8;
+constexpr uint64_t kMaxOffset = 0xFFFFFFFFULL;
+constexpr size_t kMaxEntries = 0xFFFF;
+
+void put16(std::string& out, uint16_t value) {
+    out += static_cast<char>(value & 0xFF);
+    out += static_cast<char>((value >> 8) & 0xFF);
+}
+
+void put32(std::string& out, uint32_t value) {
+    put16(out, static_cast<uint16_t>(value & 0xFFFF));
+    put16(out, static_cast<uint16_t>(value >> 16));
+}
+
+// 原始 deflate（无 zlib 头），失败时返回 false
+bool deflateRaw(const std::string& input, std::string& output) {
+    z_stream stream{};
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+    output.resize(deflateBound(&stream, static_cast<uLong>(input.size())));
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+    stream.avail_in = static_cast<uInt>(input.size());
+    stream.next_out = reinterpret_cast<Bytef*>(&output[0]);
+    stream.avail_out = static_cast<uInt>(output.size());
+    int result = ::deflate(&stream, Z_FINISH);
+    output.resize(stream.total_out);
+    deflateEnd(&stream);
+    return result == Z_STREAM_END;
+}
+}  // namespace
+
+ZipStreamWriter::ZipStreamWriter(bool deflate) : deflate_(deflate) {
+    // 所有条目使用归档开始时的本地时间
+    std::time_t now = std::time(nullptr);
+    std::tm local{};
+    localtime_r(&now, &local);
+    dosTime_ = static_cast<uint16_t>((local.tm_hour << 11) | (local.tm_min << 5) | (local.tm_sec / 2));
+    dosDate_ = static_cast<uint16_t>(((local.tm_year - 80) << 9) | ((local.tm_mon + 1) << 5) | local.tm_mday);
+}
+
+bool ZipStreamWriter::addEntry(const std::string& name, const std::string& data, std::string& out) {
+    if (entries_.size() >= kMaxEntries || data.size() > kMaxOffset || name.size() > 0xFFFF) return false;
+
+    CentralEntry entry;
+    entry.name = name;
+    entry.size = static_cast<uint32_t>(data.size());
+    entry.crc = static_cast<uint32_t>(
+            crc32(0L, reinterpret_cast<const Bytef*>(data.data()), static_cast<uInt>(data.size())));
+    entry.offset = static_cast<uint32_t>(offset_);
+
+    std::string compressed;
+    const std::string* payload = &data;
+    entry.method = kMethodStore;
+    if (deflate_ && !data.empty() && deflateRaw(data, compressed) && compressed.size() < data.size()) {
+        payload = &compressed;
+        entry.method = kMethodDeflate;
+    }
+    entry.compressedSize = static_cast<uint32_t>(payload->size());
+
+    uint64_t entryBytes = 30 + name.size() + payload->size();
+    // 预留中央目录与结尾记录的空间
+    uint64_t centralBytes = centralBytes_ + 46 + name.size() + 22;
+    if (offset_ + entryBytes + centralBytes > kMaxOffset) return false;
+
+    size_t start = out.size();
+    out.reserve(start + entryBytes);
+    put32(out, kLocalHeaderSignature);
+    put16(out, kVersionNeeded);
+    put16(out, kFlagUtf8);
+    put16(out, entry.method);
+    put16(out, dosTime_);
+    put16(out, dosDate_);
+    put32(out, entry.crc);
+    put32(out, entry.compressedSize);
+    put32(out, entry.size);
+    put16(out, static_cast<uint16_t>(name.size()));
+    put16(out, 0);  // extra field
+    out += name;
+    out += *payload;
+
+    offset_ += out.size() - start;
+    centralBytes_ += 46 + name.size();
+    entries_.push_back(std::move(entry));
+    return true;
+}
+
+std::string ZipStreamWriter::finish() {
+    std::string out;
+    uint64_t centralStart = offset_;
+    for (const auto& entry : entries_) {
+        put32(out, kCentralHeaderSignature);
+        put16(out, kVersionNeeded);  // version made by
+        put16(out, kVersionNeeded);
+        put16(out, kFlagUtf8);
+        put16(out, entry.method);
+        put16(out, dosTime_);
+        put16(out, dosDate_);
+        put32(out, entry.crc);
+        put32(out, entry.compressedSize);
+        put32(out, entry.size);
+        put16(out, static_cast<uint16_t>(entry.name.size()));
+        put16(out, 0);  // extra field
+        put16(out, 0);  // comment
+        put16(out, 0);  // disk number
+        put16(out, 0);  // internal attributes
+        put32(out, 0);  // external attributes
+        put32(out, entry.offset);
+        out += entry.name;
+    }
+    uint32_t centralSize = static_cast<uint32_t>(out.size());
+    put32(out, kEndOfCentralSignature);
+    put16(out, 0);  // disk number
+    put16(out, 0);  // disk with central directory
+    put16(out, static_cast<uint16_t>(entries_.size()));
+    put16(out, static_cast<uint16_t>(entries_.size()));
+    put32(out, centralSize);
+    put32(out, static_cast<uint32_t>(centralStart));
+    put16(out, 0);  // comment
+    offset_ += out.size();
+    return out;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * ZipStreamWriter 逐条生成 ZIP 归档的字节，供流式响应边生成边发送，整个归档不会驻留内存。
+ *
+ * - 每个条目在生成时即完成压缩（deflate，压缩后更大时改为 store），只保留中央目录所需的元数据；
+ * - 文件名按 UTF-8 标记写入；
+ * - 未实现 ZIP64：归档总大小不超过 4 GiB、条目数不超过 65535，超出时 addEntry 返回 false。
+ */
+class ZipStreamWriter {
+public:
+    explicit ZipStreamWriter(bool deflate = true);
+
+    // 生成一个文件条目（本地文件头 + 数据）追加到 out；超出格式限制时返回 false
+    bool addEntry(const std::string& name, const std::string& data, std::string& out);
+
+    // 中央目录与结尾记录，追加后归档完整；之后不能再添加条目
+    std::string finish();
+
+    size_t entryCount() const { return entries_.size(); }
+    uint64_t bytesWritten() const { return offset_; }
+
+private:
+    struct CentralEntry {
+        std::string name;
+        uint16_t method{0};
+        uint32_t crc{0};
+        uint32_t compressedSize{0};
+        uint32_t size{0};
+        uint32_t offset{0};
+    };
+
+    bool deflate_;
+    uint16_t dosTime_{0};
+    uint16_t dosDate_{0};
+    uint64_t offset_{0};
+    uint64_t centralBytes_{0};  // 中央目录已占用的字节
+    std::vector<CentralEntry> entries_;
+};
@@ -0,0 +1,204 @@
+// LocalSearchEngine 测试：写入 / 删除 / ACL 更新后各用户的可见性，以及重新打开索引（段文件加载、日志重放）。
+// 引擎状态是进程级的，且关闭后不能在同一进程中再次打开，每个阶段在单独的子进程中运行。
+#include <dirent.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "services/LocalSearchEngine.h"
+
+namespace {
+
+int failures = 0;
+
+void expect(bool ok, const std::string& name, const std::string& detail = "") {
+    if (ok) return;
+    ++failures;
+    std::cerr << "FAIL " << name;
+    if (!detail.empty()) std::cerr << "\n" << detail;
+    std::cerr << "\n";
+}
+
+std::string describe(const std::set<int>& ids) {
+    std::string out = "{";
+    for (int id : ids) {
+        if (out.size() > 1) out += ",";
+        out += std::to_string(id);
+    }
+    return out + "}";
+}
+
+// 搜索结果中的文档 id
+std::set<int> hitIds(const std::string& query, int userId) {
+    std::set<int> ids;
+    Json::Value response = LocalSearchEngine::search(query, 1, 100, userId);
+    for (const auto& hit : response["hits"]) ids.insert(hit["id"].asInt());
+    return ids;
+}
+
+void expectHits(const std::string& query, int userId, const std::set<int>& expected, const std::string& name) {
+    std::set<int> actual = hitIds(query, userId);
+    expect(actual == expected, name, "expected: " + describe(expected) + "\nactual:   " + describe(actual));
+}
+
+LocalSearchEngine::Document makeDocument(int id, int ownerId, std::vector<int> allowed, const std::string& title,
+                                         const std::string& content) {
+    LocalSearchEngine::Document document;
+    document.id = id;
+    document.ownerId = ownerId;
+    document.allowedUserIds = std::move(allowed);
+    document.title = title;
+    document.content = content;
+    return document;
+}
+
+// 在子进程中运行一个阶段；子进程的失败计入父进程
+void runStage(const std::string& name, const std::function<void()>& stage) {
+    std::cout.flush();
+    std::cerr.flush();
+    pid_t pid = ::fork();
+    if (pid < 0) {
+        expect(false, name, "fork failed");
+        return;
+    }
+    if (pid == 0) {
+        failures = 0;
+        stage();
+        std::cerr.flush();
+        ::_exit(failures > 0 ? 1 : 0);
+    }
+    int status = 0;
+    ::waitpid(pid, &status, 0);
+    expect(WIFEXITED(status) && WEXITSTATUS(status) == 0, name);
+}
+
+void removeDirectory(const std::string& directory) {
+    if (DIR* dir = ::opendir(directory.c_str())) {
+        while (dirent* entry = ::readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name != "." && name != "..") ::unlink((directory + "/" + name).c_str());
+        }
+        ::closedir(dir);
+    }
+    ::rmdir(directory.c_str());
+}
+
+// 各阶段共用的写入：1、2 属于用户 10，3 属于用户 20 并共享给 10，4 随后被删除
+void writeFixture() {
+    LocalSearchEngine::upsert({makeDocument(1, 10, {10}, "协作文档规范", "多人实时协作编辑的文档"),
+                               makeDocument(2, 10, {10, 11}, "Release Notes", "Codox 2.0 adds offline editing"),
+                               makeDocument(3, 20, {20, 10}, "周报", "本周完成了协作模块的开发"),
+                               makeDocument(4, 20, {20}, "草稿", "协作草稿")});
+    LocalSearchEngine::remove({4});
+    // 收回用户 10 对文档 3 的访问，同时共享给 30
+    LocalSearchEngine::updateAcl(3, 20, {20, 30});
+    // 替换文档 2 的内容
+    LocalSearchEngine::upsert({makeDocument(2, 10, {10, 11}, "Release Notes", "Codox 2.1 fixes sync")});
+}
+
+// writeFixture 之后各用户应看到的结果
+void expectFixture(const std::string& stage) {
+    expectHits("协作", 10, {1}, stage + ": owner sees own document only");
+    expectHits("协作", 20, {3}, stage + ": removed document is gone");
+    expectHits("协作", 30, {3}, stage + ": user granted by updateAcl");
+    expectHits("协作", 11, {}, stage + ": user without access");
+    expectHits("offline", 10, {}, stage + ": replaced content no longer matches");
+    expectHits("ＳＹＮＣ", 11, {2}, stage + ": full-width query matches replaced content");
+    expectHits("文", 10, {1}, stage + ": single CJK character");
+    expectHits("协作 规范", 10, {1}, stage + ": all terms must match");
+
+    LocalSearchEngine::Document found;
+    expect(LocalSearchEngine::find(3, found) && found.title == "周报" && found.content == "本周完成了协作模块的开发",
+           stage + ": updateAcl keeps title and content");
+    expect(!LocalSearchEngine::find(4, found), stage + ": removed document not found");
+    expect(LocalSearchEngine::documentCount() == 3, stage + ": document count",
+           std::to_string(LocalSearchEngine::documentCount()));
+}
+
+void testVisibility(const std::string& directory) {
+    expect(LocalSearchEngine::open(directory), "open");
+    expect(LocalSearchEngine::lastModified() == 0, "new index needs a full reconcile");
+
+    LocalSearchEngine::upsert({makeDocument(1, 10, {10}, "协作文档规范", "多人实时协作编辑的文档")});
+    expectHits("协作", 10, {1}, "visible to owner after upsert");
+    expectHits("协作", 11, {}, "hidden from other users");
+    LocalSearchEngine::updateAcl(1, 10, {10, 11});
+    expectHits("协作", 11, {1}, "visible after updateAcl grants access");
+    LocalSearchEngine::updateAcl(1, 10, {10});
+    expectHits("协作", 11, {}, "hidden after updateAcl revokes access");
+    LocalSearchEngine::updateAcl(99, 10, {10});
+    expect(LocalSearchEngine::documentCount() == 1, "updateAcl ignores unknown documents");
+
+    auto response = LocalSearchEngine::search("协作", 1, 20, 10);
+    expect(response["totalHits"].asInt() == 1 && response["totalPages"].asInt() == 1, "response totals");
+    expect(!response["hits"][0].isMember("allowed_user_ids") && !response["hits"][0].isMember("owner_id"),
+           "hits do not expose the ACL");
+
+    writeFixture();
+    expectFixture("in memory");
+    // 关闭时内存段落盘
+    LocalSearchEngine::close();
+}
+
+void testSegmentReload(const std::string& directory) {
+    expect(LocalSearchEngine::open(directory), "reopen");
+    Json::Value stats = LocalSearchEngine::getStats();
+    expect(stats["disk_segments"].asUInt() >= 1 && stats["memory_documents"].asUInt() == 0,
+           "reopened from segment files", stats.toStyledString());
+    expect(LocalSearchEngine::lastModified() > 0, "reopened index keeps its modification time");
+    expectFixture("segment reload");
+    LocalSearchEngine::close();
+}
+
+// 写入后不关闭直接退出（模拟进程崩溃），内存段只留在预写日志中
+void writeWithoutClose(const std::string& directory) {
+    expect(LocalSearchEngine::open(directory), "open for wal");
+    writeFixture();
+    std::cerr.flush();
+    ::_exit(failures > 0 ? 1 : 0);
+}
+
+void testWalReplay(const std::string& directory) {
+    expect(LocalSearchEngine::open(directory), "reopen for wal replay");
+    Json::Value stats = LocalSearchEngine::getStats();
+    expect(stats["disk_segments"].asUInt() == 0, "nothing was flushed before the crash", stats.toStyledString());
+    expectFixture("wal replay");
+    LocalSearchEngine::close();
+}
+
+}  // namespace
+
+int main() {
+    const char* tmp = std::getenv("TMPDIR");
+    std::string base = std::string(tmp && *tmp ? tmp : "/tmp") + "/local_search_test.XXXXXX";
+    std::vector<char> pattern(base.begin(), base.end());
+    pattern.push_back('\0');
+    if (!::mkdtemp(pattern.data())) {
+        std::cerr << "cannot create " << base << "\n";
+        return 2;
+    }
+    std::string root = pattern.data();
+    std::string segmentDir = root + "/segments";
+    std::string walDir = root + "/wal";
+
+    runStage("visibility", [&] { testVisibility(segmentDir); });
+    runStage("segment reload", [&] { testSegmentReload(segmentDir); });
+    runStage("write without close", [&] { writeWithoutClose(walDir); });
+    runStage("wal replay", [&] { testWalReplay(walDir); });
+
+    removeDirectory(segmentDir);
+    removeDirectory(walDir);
+    ::rmdir(root.c_str());
+    if (failures > 0) {
+        std::cerr << failures << " check(s) failed\n";
+        return 1;
+    }
+    std::cout << "all checks passed\n";
+    return 0;
+}
@@ -0,0 +1,245 @@
+// MarkdownCodec 一致性测试：CommonMark 规范示例、GFM 扩展、HTML→Markdown→HTML 往返、分段渲染，以及嵌套深度 / 输入规模的边界。
+// 用法：markdown_codec_test <commonmark-spec.json>
+#include <json/json.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <set>
+#include <string>
+
+#include "utils/MarkdownCodec.h"
+
+namespace {
+
+int failures = 0;
+
+void expect(bool ok, const std::string& name, const std::string& detail = "") {
+    if (ok) return;
+    ++failures;
+    std::cerr << "FAIL " << name;
+    if (!detail.empty()) std::cerr << "\n" << detail;
+    std::cerr << "\n";
+}
+
+void expectEqual(const std::string& actual, const std::string& expected, const std::string& name) {
+    expect(actual == expected, name, "expected:\n" + expected + "\nactual:\n" + actual);
+}
+
+std::string repeat(const std::string& s, size_t n) {
+    std::string out;
+    out.reserve(s.size() * n);
+    for (size_t i = 0; i < n; ++i) out += s;
+    return out;
+}
+
+// 折叠空白并去掉标签两侧的空白，只比较结构与文本
+std::string normalize(const std::string& html) {
+    std::string out;
+    bool space = false;
+    for (char c : html) {
+        if (c == ' ' || c == '\n' || c == '\t') {
+            space = true;
+            continue;
+        }
+        if (space && !out.empty() && out.back() != '>' && c != '<') out += ' ';
+        space = false;
+        out += c;
+    }
+    return out;
+}
+
+// 已知与规范不一致的示例（CommonMark 0.31.2 编号）：Tab 展开、部分 HTML 块 / 链接引用定义的边角情况等。
+// 修复某个示例后需从这里删掉，保证列表不会过时。
+const std::set<int> kKnownFailures = {
+    1,   2,   3,   12,  13,  14,  25,  26,  27,  28,  30,  32,  33,  34,  37,  38,  39,  40,  41,  91,  93,
+    193, 195, 196, 198, 206, 208, 209, 210, 211, 215, 216, 217, 236, 237, 281, 282, 283, 312, 343, 352, 353,
+    354, 359, 363, 380, 385, 395, 503, 506, 508, 526, 538, 540, 541, 574, 590, 603, 619, 620, 624, 626, 632,
+};
+
+void testSpec(const std::string& path) {
+    std::ifstream file(path);
+    Json::Value examples;
+    Json::CharReaderBuilder builder;
+    std::string errs;
+    if (!file || !Json::parseFromStream(builder, file, &examples, &errs) || !examples.isArray()) {
+        expect(false, "spec: cannot load " + path, errs);
+        return;
+    }
+    int passed = 0;
+    for (const auto& example : examples) {
+        int number = example["example"].asInt();
+        std::string actual = MarkdownCodec::toHtml(example["markdown"].asString());
+        bool ok = actual == example["html"].asString();
+        bool known = kKnownFailures.count(number) > 0;
+        if (ok) ++passed;
+        if (ok == known) {
+            expect(false, "spec example " + std::to_string(number),
+                   known ? "now passes, remove it from kKnownFailures"
+                         : "markdown:\n" + example["markdown"].asString() + "expected:\n" +
+                               example["html"].asString() + "actual:\n" + actual);
+        }
+    }
+    std::cout << "spec: " << passed << "/" << examples.size() << " examples pass\n";
+}
+
+void testGfm() {
+    expectEqual(MarkdownCodec::toHtml("| a | b |\n|:-:|--:|\n| c | d |\n"),
+                "<table>\n<thead>\n<tr>\n<th align=\"center\">a</th>\n<th align=\"right\">b</th>\n</tr>\n</thead>\n"
+                "<tbody>\n<tr>\n<td align=\"center\">c</td>\n<td align=\"right\">d</td>\n</tr>\n</tbody>\n</table>\n",
+                "gfm table");
+    expectEqual(MarkdownCodec::toHtml("~~Hi~~ Hello, ~there~ world!\n"),
+                "<p><del>Hi</del> Hello, <del>there</del> world!</p>\n", "gfm strikethrough");
+    expectEqual(MarkdownCodec::toHtml("- [ ] foo\n- [x] bar\n"),
+                "<ul>\n<li><input disabled=\"\" type=\"checkbox\" /> foo</li>\n"
+                "<li><input checked=\"\" disabled=\"\" type=\"checkbox\" /> bar</li>\n</ul>\n",
+                "gfm task list");
+    expectEqual(MarkdownCodec::toHtml("- [x] foo\n  - [ ] bar\n  - [X] baz\n- [ ] bim\n"),
+                "<ul>\n<li><input checked=\"\" disabled=\"\" type=\"checkbox\" /> foo\n<ul>\n"
+                "<li><input disabled=\"\" type=\"checkbox\" /> bar</li>\n"
+                "<li><input checked=\"\" disabled=\"\" type=\"checkbox\" /> baz</li>\n</ul>\n</li>\n"
+                "<li><input disabled=\"\" type=\"checkbox\" /> bim</li>\n</ul>\n",
+                "gfm nested task list");
+    expectEqual(MarkdownCodec::toHtml("- [ ]\n- [y] z\n- [ ]x\n"),
+                "<ul>\n<li>[ ]</li>\n<li>[y] z</li>\n<li>[ ]x</li>\n</ul>\n", "gfm not a task marker");
+    expectEqual(MarkdownCodec::toMarkdown(MarkdownCodec::toHtml("- [ ] foo\n- [x] bar\n")), "- [ ] foo\n- [x] bar",
+                "gfm task list to markdown");
+}
+
+void testRoundTrip() {
+    // 编辑器常见内容：HTML → Markdown → HTML 后结构与文本不变
+    const char* documents[] = {
+        "# Title\n\nSome *emphasis*, **strong**, ~~deleted~~ and `code`.\n",
+        "## Links\n\n[site](https://example.com \"Home\") and ![logo](/a.png) and <https://example.org>\n",
+        "Special characters: 1 < 2 & 3 > 2, a_b_c, *not emphasis*, [not a link], #tag\n",
+        "- one\n- two\n  - nested\n  - items\n- three\n",
+        "1. first\n2. second\n\n   continued paragraph\n3. third\n",
+        "- [ ] todo\n- [x] done\n",
+        "> quote\n>\n> > nested quote\n\nafter\n",
+        "```cpp\nint main() {\n    return 0;\n}\n```\n",
+        "    indented code\n",
+        "| a | b |\n|:--|:-:|\n| 1 | **2** |\n| `|` | x |\n",
+        "line one  \nline two\n\n***\n\nend\n",
+        "Heading\n=======\n\nText with trailing #\n",
+        "+ 1. not a number\n\n2) other\n",
+    };
+    for (const char* markdown : documents) {
+        std::string html = MarkdownCodec::toHtml(markdown);
+        std::string back = MarkdownCodec::toHtml(MarkdownCodec::toMarkdown(html));
+        expect(normalize(html) == normalize(back), "round trip",
+               std::string("markdown:\n") + markdown + "first:\n" + html + "second:\n" + back);
+    }
+
+    const char* editorHtml[] = {
+        "<p>Hello <strong>world</strong></p><ul><li><p>a</p></li><li><p>b</p></li></ul>",
+        "<h2>Plan</h2><ul><li><input type=\"checkbox\" checked> ship</li><li><input type=\"checkbox\"> test</li></ul>",
+        "<blockquote><p>quoted <em>text</em></p></blockquote><hr><pre><code>x &lt; y</code></pre>",
+    };
+    for (const char* html : editorHtml) {
+        std::string first = MarkdownCodec::toHtml(MarkdownCodec::toMarkdown(html));
+        std::string second = MarkdownCodec::toHtml(MarkdownCodec::toMarkdown(first));
+        expect(normalize(first) == normalize(second), "editor round trip",
+               std::string("html:\n") + html + "\nfirst:\n" + first + "second:\n" + second);
+    }
+}
+
+// 深度与规模边界：不能栈溢出，也不能退化成平方复杂度
+// 两遍分段渲染：小分段、逐字节输入下与 toHtml 一致，包括写在使用之后的链接引用定义
+std::string renderStream(const std::string& markdown, size_t segmentBytes, size_t chunkBytes) {
+    MarkdownStreamRenderer renderer(segmentBytes);
+    for (size_t offset = 0; offset < markdown.size(); offset += chunkBytes) {
+        renderer.collect(markdown.data() + offset, std::min(chunkBytes, markdown.size() - offset));
+    }
+    renderer.endCollect();
+    std::string html;
+    for (size_t offset = 0; offset < markdown.size(); offset += chunkBytes) {
+        renderer.feed(markdown.data() + offset, std::min(chunkBytes, markdown.size() - offset), html);
+    }
+    renderer.finish(html);
+    return html;
+}
+
+void testStream() {
+    std::string markdown = "See [foo] and [bar][].\n\n";
+    markdown += "```\n[foo]: /in-fence\n\n```\n\n";
+    markdown += repeat("Paragraph with [foo].\n\n", 20);
+    markdown += "- item [bar]\n\n- loose item\n\n";
+    markdown += "[foo]: /first \"Title\"\n\n[bar]: /bar\n\n[foo]: /second\n";
+    std::string expected = MarkdownCodec::toHtml(markdown);
+    expect(expected.find("href=\"/first\"") != std::string::npos, "stream: forward reference resolves");
+    for (size_t segmentBytes : {1, 16, 64, 4096}) {
+        for (size_t chunkBytes : {1, 7, 1024}) {
+            expectEqual(renderStream(markdown, segmentBytes, chunkBytes), expected,
+                        "stream segment " + std::to_string(segmentBytes) + " chunk " + std::to_string(chunkBytes));
+        }
+    }
+}
+
+void limitCase(const std::string& name, const std::function<std::string()>& run,
+               const std::function<bool(const std::string&)>& check) {
+    auto start = std::chrono::steady_clock::now();
+    std::string output = run();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    expect(check(output), "limit " + name, output.substr(0, 200));
+    expect(seconds < 5.0, "limit " + name + " took " + std::to_string(seconds) + "s");
+}
+
+void testLimits() {
+    auto contains = [](const std::string& needle) {
+        return [needle](const std::string& output) { return output.find(needle) != std::string::npos; };
+    };
+    limitCase("nested quotes", [] { return MarkdownCodec::toHtml(repeat(">", 20000) + " a\n"); },
+              contains("<blockquote>"));
+    limitCase("nested lists", [] { return MarkdownCodec::toHtml(repeat("- ", 10000) + "a\n"); }, contains("<ul>"));
+    limitCase("indented lists", [] {
+        std::string markdown;
+        for (int i = 0; i < 2000; ++i) markdown += std::string(i * 2, ' ') + "- x\n";
+        return MarkdownCodec::toHtml(markdown);
+    }, contains("<li>"));
+    limitCase("nested divs",
+              [] { return MarkdownCodec::toMarkdown(repeat("<div>", 20000) + "x" + repeat("</div>", 20000)); },
+              [](const std::string& output) { return output == "x"; });
+    limitCase("nested list items", [] { return MarkdownCodec::toMarkdown(repeat("<ul><li>", 20000) + "x"); },
+              contains("- x"));
+    limitCase("nested spans", [] { return MarkdownCodec::toMarkdown(repeat("<span><em>", 20000) + "x"); },
+              contains("x"));
+    limitCase("brackets", [] { return MarkdownCodec::toHtml(repeat("[", 40000) + "a" + repeat("]", 40000)); },
+              contains("[[[a]]]"));
+    limitCase("brackets with definition",
+              [] { return MarkdownCodec::toHtml("[a]: /u\n\n" + repeat("[", 40000) + "a" + repeat("]", 40000)); },
+              contains("<a href=\"/u\">a</a>"));
+    limitCase("unclosed links", [] { return MarkdownCodec::toHtml(repeat("[a](b", 40000)); }, contains("[a](b"));
+    limitCase("unclosed titles", [] { return MarkdownCodec::toHtml(repeat("[a](b (", 40000)); }, contains("[a]"));
+    limitCase("link parens", [] { return MarkdownCodec::toHtml(repeat("[a](b(", 40000)); }, contains("[a]"));
+    limitCase("emphasis", [] { return MarkdownCodec::toHtml(repeat("*a **a ", 40000)); }, contains("*a **a"));
+    limitCase("underscores", [] { return MarkdownCodec::toHtml(repeat("a_", 40000) + repeat("_a", 40000)); },
+              contains("a_a"));
+    limitCase("asterisk runs", [] { return MarkdownCodec::toHtml(repeat("*", 40000) + "a" + repeat("*", 40000)); },
+              contains("<strong>"));
+    limitCase("less-than", [] { return MarkdownCodec::toHtml(repeat("<", 100000)); }, contains("&lt;"));
+    limitCase("comments", [] { return MarkdownCodec::toHtml(repeat("<!--", 50000) + ">"); },
+              [](const std::string& output) { return !output.empty(); });
+    limitCase("backticks", [] { return MarkdownCodec::toHtml(repeat("` ``", 50000)); }, contains("<code>"));
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <commonmark-spec.json>\n";
+        return 2;
+    }
+    testSpec(argv[1]);
+    testGfm();
+    testRoundTrip();
+    testStream();
+    testLimits();
+    if (failures > 0) {
+        std::cerr << failures << " check(s) failed\n";
+        return 1;
+    }
+    std::cout << "all checks passed\n";
+    return 0;
+}
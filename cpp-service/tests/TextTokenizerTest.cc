@@ -0,0 +1,81 @@
+// TextTokenizer 测试：中日韩二元组与单字词、全角转半角、大小写折叠、分隔符。
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "utils/TextTokenizer.h"
+
+namespace {
+
+int failures = 0;
+
+void expect(bool ok, const std::string& name, const std::string& detail = "") {
+    if (ok) return;
+    ++failures;
+    std::cerr << "FAIL " << name;
+    if (!detail.empty()) std::cerr << "\n" << detail;
+    std::cerr << "\n";
+}
+
+std::string join(const std::vector<std::string>& tokens) {
+    std::string out;
+    for (const auto& token : tokens) {
+        if (!out.empty()) out += " | ";
+        out += token;
+    }
+    return out;
+}
+
+void expectTokens(const std::vector<std::string>& actual, const std::vector<std::string>& expected,
+                  const std::string& name) {
+    expect(actual == expected, name, "expected: " + join(expected) + "\nactual:   " + join(actual));
+}
+
+void testCjk() {
+    expectTokens(TextTokenizer::tokenize("协作文档"), {"协作", "作文", "文档"}, "cjk bigrams");
+    expectTokens(TextTokenizer::tokenizeForIndex("协作文档"), {"协", "协作", "作", "作文", "文", "文档", "档"},
+                 "cjk index unigrams");
+    // 单独的一个字：查询时作为一个词，索引时只输出一次单字词
+    expectTokens(TextTokenizer::tokenize("文"), {"文"}, "cjk single char query");
+    expectTokens(TextTokenizer::tokenizeForIndex("文"), {"文"}, "cjk single char index");
+    // 分隔符与拉丁字母打断二元组
+    expectTokens(TextTokenizer::tokenize("协作，文档"), {"协作", "文档"}, "cjk broken by punctuation");
+    expectTokens(TextTokenizer::tokenize("文a档"), {"文", "a", "档"}, "cjk broken by latin");
+    // 假名与韩文音节同样按二元组切分
+    expectTokens(TextTokenizer::tokenize("カタカナ"), {"カタ", "タカ", "カナ"}, "katakana bigrams");
+    expectTokens(TextTokenizer::tokenize("한국어"), {"한국", "국어"}, "hangul bigrams");
+}
+
+void testFolding() {
+    expectTokens(TextTokenizer::tokenize("Hello WORLD"), {"hello", "world"}, "case folding");
+    expectTokens(TextTokenizer::tokenize("ＡＢＣ１２３ ｄｅｆ"), {"abc123", "def"}, "full-width folding");
+    expectTokens(TextTokenizer::tokenize("Ｃodox"), {"codox"}, "mixed width word");
+    expectTokens(TextTokenizer::tokenizeForIndex("ＭｉｘＥＤ"), TextTokenizer::tokenize("mixed"),
+                 "query and index fold the same way");
+}
+
+void testSeparators() {
+    expectTokens(TextTokenizer::tokenize("user@example.com"), {"user", "example", "com"}, "email split");
+    expectTokens(TextTokenizer::tokenize("  --  "), {}, "separators only");
+    expectTokens(TextTokenizer::tokenize(""), {}, "empty text");
+    expectTokens(TextTokenizer::tokenize("café naïve"), {"café", "naïve"}, "accented latin kept in word");
+    expectTokens(TextTokenizer::tokenize("Doc2024版本"), {"doc2024", "版本"}, "latin then cjk");
+    // 非法 UTF-8 按分隔符处理
+    expectTokens(TextTokenizer::tokenize(std::string("ab\xff" "cd")), {"ab", "cd"}, "invalid utf-8");
+    std::string longWord(100, 'x');
+    expectTokens(TextTokenizer::tokenize(longWord), {std::string(64, 'x')}, "long word truncated");
+}
+
+}  // namespace
+
+int main() {
+    testCjk();
+    testFolding();
+    testSeparators();
+    if (failures > 0) {
+        std::cerr << failures << " check(s) failed\n";
+        return 1;
+    }
+    std::cout << "all checks passed\n";
+    return 0;
+}
@@ -0,0 +1,7 @@
+#pragma once
+// 测试用的最小 drogon/drogon.h：被测代码只用到日志宏，这里输出到 stderr，不需要链接 Drogon
+#include <iostream>
+
+#define LOG_INFO std::cerr << "\n[INFO] "
+#define LOG_WARN std::cerr << "\n[WARN] "
+#define LOG_ERROR std::cerr << "\n[ERROR] "
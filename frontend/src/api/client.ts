@@ -175,8 +175,8 @@ class ApiClient {
      * 搜索用户
      */
     async searchUsers(query: string, params?: {page?: number; page_size?: number}):
-            Promise<{users: User[]; total: number; page: number; page_size: number}> {
-        const response = await this.client.get<{users: User[]; total: number; page: number; page_size: number}>(
+            Promise<{users: User[]; has_more: boolean; page: number; page_size: number}> {
+        const response = await this.client.get<{users: User[]; has_more: boolean; page: number; page_size: number}>(
                 '/users/search', {
                     params: {q: query, ...params},
                 });
@@ -332,12 +332,17 @@ class ApiClient {
         snapshot_url: string | null; sha256: string | null; version_id: number | null;
         content_html?: string | null;
         content_text?: string | null;
+        snapshot_base64?: string;
+        snapshot_inlined?: boolean;
     }> {
+        // inline=1：小快照随 bootstrap 一起返回，省去一次下载请求；文档有 HTML / 文本内容时服务端不会内联
         const response = await this.client.get<{
             snapshot_url: string | null; sha256: string | null; version_id: number | null;
             content_html?: string | null;
             content_text?: string | null;
-        }>(`/collab/bootstrap/${docId}`);
+            snapshot_base64?: string;
+            snapshot_inlined?: boolean;
+        }>(`/collab/bootstrap/${docId}`, {params: {inline: 1}});
         return response.data;
     }
 
@@ -131,7 +131,7 @@ export function DocumentEditor({ docId, onSave, onSaveReady, canEdit = true }: D
 
                 try {
                     const bootstrapResponse = await apiClient.getBootstrap(docId);
-                    const { snapshot_url, content_html, content_text } = bootstrapResponse;
+                    const { snapshot_url, content_html, content_text, snapshot_base64 } = bootstrapResponse;
 
                     // 优化：如果有 HTML 内容，优先使用 HTML 内容初始化（更可靠）
                     // 这样可以避免快照文件可能指向旧内容的问题（特别是恢复的版本）
@@ -153,7 +153,11 @@ export function DocumentEditor({ docId, onSave, onSaveReady, canEdit = true }: D
                         // 只有在没有 HTML 内容时才尝试加载快照
                         try {
                             let snapshotBytes: Uint8Array;
-                            if (snapshot_url.startsWith('data:')) {
+                            if (snapshot_base64) {
+                                // 快照已随 bootstrap 内联返回
+                                const binary = atob(snapshot_base64);
+                                snapshotBytes = Uint8Array.from(binary, (c) => c.charCodeAt(0));
+                            } else if (snapshot_url.startsWith('data:')) {
                                 const base64Data = snapshot_url.split(',')[1];
                                 const jsonData = atob(base64Data);
                                 const snapshotData = JSON.parse(jsonData);
@@ -37,12 +37,6 @@ export function NotificationBell() {
         }
     }, []);
 
-    useEffect(() => {
-        loadUnreadCount();
-        const interval = setInterval(loadUnreadCount, 30000);
-        return () => clearInterval(interval);
-    }, [loadUnreadCount]);
-
     useEffect(() => {
         const handleClickOutside = (event: MouseEvent) => {
             if (panelRef.current && !panelRef.current.contains(event.target as Node)) {
@@ -62,7 +56,6 @@ export function NotificationBell() {
     const handleMarkAsRead = async (notificationIds: number[]) => {
         try {
             await apiClient.markNotificationsAsRead(notificationIds);
-            loadUnreadCount();
             loadNotifications();
         } catch (err) {
             console.error('Failed to mark as read:', err);
@@ -173,13 +166,27 @@ export function NotificationBell() {
         [showBrowserNotification]
     );
 
-    useNotificationWebSocket({
+    const { isConnected } = useNotificationWebSocket({
         onNotification: (notification) => {
             handleIncomingNotification(notification);
+        },
+        onResync: () => {
             loadUnreadCount();
+            loadNotifications();
+        },
+        onUnreadCount: (count) => {
+            setUnreadCount(count);
         },
     });
 
+    // 连接正常时由服务端推送未读数，只在连接断开期间轮询
+    useEffect(() => {
+        loadUnreadCount();
+        if (isConnected) return;
+        const interval = setInterval(loadUnreadCount, 30000);
+        return () => clearInterval(interval);
+    }, [loadUnreadCount, isConnected]);
+
     useEffect(() => {
         return () => {
             if (toastTimerRef.current) {
@@ -5,13 +5,25 @@ type ConnectionStatus = 'idle' | 'connecting' | 'connected' | 'disconnected';
 
 interface UseNotificationWebSocketOptions {
     onNotification?: (notification: NotificationItem) => void;
+    // 服务端因积压丢弃了部分通知，需要重新拉取
+    onResync?: (missed: number) => void;
+    // 未读数变化（写入新通知或标记已读）
+    onUnreadCount?: (count: number) => void;
     onError?: (error: Event) => void;
 }
 
-export function useNotificationWebSocket({ onNotification, onError }: UseNotificationWebSocketOptions = {}) {
+export function useNotificationWebSocket({
+    onNotification,
+    onResync,
+    onUnreadCount,
+    onError,
+}: UseNotificationWebSocketOptions = {}) {
     const [status, setStatus] = useState<ConnectionStatus>('idle');
     const socketRef = useRef<WebSocket | null>(null);
     const reconnectTimer = useRef<number | null>(null);
+    // 回调放在 ref 中，避免调用方每次渲染传入新函数导致连接反复重建
+    const handlersRef = useRef({ onNotification, onResync, onUnreadCount, onError });
+    handlersRef.current = { onNotification, onResync, onUnreadCount, onError };
 
     const buildWebSocketUrl = useCallback(() => {
         const token = localStorage.getItem('access_token');
@@ -94,11 +106,19 @@ export function useNotificationWebSocket({ onNotification, onError }: UseNotific
                             return;
                         }
 
-                        const payload = JSON.parse(trimmed);
-                        if (payload?.type === 'notification') {
-                            onNotification?.(payload.data as NotificationItem);
-                        } else if (payload?.type === 'notification_ack') {
-                            console.log('Notification WebSocket connected:', payload.message);
+                        // 后端会把短时间内的多条消息合并为一个数组帧
+                        const parsed = JSON.parse(trimmed);
+                        const messages = Array.isArray(parsed) ? parsed : [parsed];
+                        for (const payload of messages) {
+                            if (payload?.type === 'notification') {
+                                handlersRef.current.onNotification?.(payload.data as NotificationItem);
+                            } else if (payload?.type === 'unread_count') {
+                                handlersRef.current.onUnreadCount?.(Number(payload.unread_count) || 0);
+                            } else if (payload?.type === 'notifications_resync') {
+                                handlersRef.current.onResync?.(Number(payload.missed) || 0);
+                            } else if (payload?.type === 'notification_ack') {
+                                console.log('Notification WebSocket connected:', payload.message);
+                            }
                         }
                     } catch (err) {
                         console.error('Failed to parse notification payload:', err, 'Data:', event.data);
@@ -107,7 +127,7 @@ export function useNotificationWebSocket({ onNotification, onError }: UseNotific
 
                 socket.onerror = (event) => {
                     setStatus('disconnected');
-                    onError?.(event);
+                    handlersRef.current.onError?.(event);
                 };
 
                 socket.onclose = () => {
@@ -133,7 +153,7 @@ export function useNotificationWebSocket({ onNotification, onError }: UseNotific
             }
             socketRef.current?.close();
         };
-    }, [buildWebSocketUrl, onNotification, onError]);
+    }, [buildWebSocketUrl]);
 
     return { status, isConnected: status === 'connected' };
 }
@@ -50,7 +50,7 @@ export function DocumentsPage() {
       const response = await apiClient.getDocumentList(params);
       console.log('[DocumentsPage] 返回结果:', { total: response.total, count: response.docs.length });
       setDocuments(response.docs);
-      setTotal(response.total);
+      setTotal(response.total ?? 0);
       setSelectedDocs([]);
     } catch (error) {
       console.error('加载文档失败:', error);
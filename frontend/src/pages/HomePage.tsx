@@ -52,7 +52,7 @@ export function HomePage() {
         (a, b) => new Date(b.updated_at).getTime() - new Date(a.updated_at).getTime()
       );
       setDocuments(sortedDocs);
-      setTotalDocs(response.total);
+      setTotalDocs(response.total ?? response.docs.length);
     } catch (error) {
       console.error('加载文档失败:', error);
     } finally {
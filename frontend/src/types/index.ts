@@ -128,7 +128,10 @@ export interface UpdateDocumentRequest {
 
 export interface DocumentListResponse {
     docs: Document[];
-    total: number;
+    total?: number;
+    total_is_estimate?: boolean;
+    has_more: boolean;
+    next_cursor: string | null;
     page: number;
     pageSize: number;
 }
@@ -136,6 +139,8 @@ export interface DocumentListResponse {
 export interface DocumentListParams {
     page?: number;
     pageSize?: number;
+    cursor?: string; // 上一页返回的 next_cursor
+    total?: 'exact' | 'estimate' | 'none';
     tag?: string;
     author?: number;
     status?: DocumentStatus; // 按状态筛选